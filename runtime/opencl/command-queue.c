@@ -38,6 +38,83 @@
 #include "opencl.h"
 
 
+/* Wait thread of one launched ND-Range. Each ND-Range has its own thread,
+ * since the device only lets a thread wait for a specific ND-Range. This way,
+ * ND-Ranges complete in the order they finish, not in the order they were
+ * launched. */
+static void *opencl_command_queue_wait_thread_func(void *user_data)
+{
+	struct opencl_command_t *command = user_data;
+	struct opencl_command_queue_t *command_queue = command->command_queue;
+
+	/* Wait for the ND-Range to finish. It stays in the in-flight list in
+	 * the meantime, so that draining the queue waits for it. */
+	opencl_command_wait(command);
+
+	/* Hand it over to the queue thread, which joins this thread */
+	pthread_mutex_lock(&command_queue->lock);
+	list_remove(command_queue->in_flight_list, command);
+	list_add(command_queue->finished_list, command);
+	pthread_cond_broadcast(&command_queue->cond_in_flight);
+	pthread_mutex_unlock(&command_queue->lock);
+
+	/* End */
+	return NULL;
+}
+
+
+/* Join the wait threads of finished ND-Ranges and free them */
+static void opencl_command_queue_join(
+		struct opencl_command_queue_t *command_queue)
+{
+	struct opencl_command_t *command;
+
+	pthread_mutex_lock(&command_queue->lock);
+	while (command_queue->finished_list->count)
+	{
+		command = list_remove_at(command_queue->finished_list, 0);
+		pthread_mutex_unlock(&command_queue->lock);
+		pthread_join(command->wait_thread, NULL);
+		opencl_command_free(command);
+		pthread_mutex_lock(&command_queue->lock);
+	}
+	pthread_mutex_unlock(&command_queue->lock);
+}
+
+
+/* Return whether a command is an ND-Range that can run concurrently with
+ * the following commands of the queue */
+static int opencl_command_queue_is_async(
+		struct opencl_command_queue_t *command_queue,
+		struct opencl_command_t *command)
+{
+	return (command_queue->properties &
+			CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE) &&
+			command->type == opencl_command_launch_ndrange &&
+			command->device->arch_ndrange_launch_func &&
+			command->device->arch_ndrange_wait_func;
+}
+
+
+/* Launch an ND-Range without waiting for it to finish. Its wait thread
+ * completes it later. */
+static void opencl_command_queue_launch(
+		struct opencl_command_queue_t *command_queue,
+		struct opencl_command_t *command)
+{
+	/* Release the threads of ND-Ranges finished so far */
+	opencl_command_queue_join(command_queue);
+
+	/* Launch and hand it over to a new wait thread */
+	opencl_command_launch(command);
+	pthread_mutex_lock(&command_queue->lock);
+	list_add(command_queue->in_flight_list, command);
+	pthread_mutex_unlock(&command_queue->lock);
+	pthread_create(&command->wait_thread, NULL,
+		opencl_command_queue_wait_thread_func, command);
+}
+
+
 static void *opencl_command_queue_thread_func(void *user_data)
 {
 	struct opencl_command_queue_t *command_queue = user_data;
@@ -51,11 +128,27 @@ static void *opencl_command_queue_thread_func(void *user_data)
 		if (!command)
 			break;
 
+		/* In an out-of-order queue, ND-Ranges are only launched, so
+		 * that several of them run on the device at the same time */
+		if (opencl_command_queue_is_async(command_queue, command))
+		{
+			opencl_command_queue_launch(command_queue, command);
+			continue;
+		}
+
+		/* Markers used by 'clFinish' complete after all ND-Ranges
+		 * launched before them */
+		if (command->type == opencl_command_nop)
+			opencl_command_queue_drain(command_queue);
+
 		/* Run it */
 		opencl_command_run(command);
 		opencl_command_free(command);
 	}
 
+	/* Wait for launched ND-Ranges */
+	opencl_command_queue_drain(command_queue);
+
 	/* End */
 	return NULL;
 }
@@ -68,8 +161,11 @@ struct opencl_command_queue_t *opencl_command_queue_create(void)
 	/* Initialize */
 	command_queue = xcalloc(1, sizeof(struct opencl_command_queue_t));
 	command_queue->command_list = list_create();
+	command_queue->in_flight_list = list_create();
+	command_queue->finished_list = list_create();
 	pthread_mutex_init(&command_queue->lock, NULL);
 	pthread_cond_init(&command_queue->cond_process, NULL);
+	pthread_cond_init(&command_queue->cond_in_flight, NULL);
 
 	/* Create thread associated with command queue */
 	pthread_create(&command_queue->queue_thread, NULL,
@@ -94,9 +190,14 @@ void opencl_command_queue_free(struct opencl_command_queue_t *command_queue)
 	opencl_command_queue_flush(command_queue);
 	pthread_join(command_queue->queue_thread, NULL);
 	assert(!command_queue->command_list->count);
+	assert(!command_queue->in_flight_list->count);
+	assert(!command_queue->finished_list->count);
+	list_free(command_queue->in_flight_list);
+	list_free(command_queue->finished_list);
 
 	pthread_mutex_destroy(&command_queue->lock);
 	pthread_cond_destroy(&command_queue->cond_process);
+	pthread_cond_destroy(&command_queue->cond_in_flight);
 
 	free(command_queue);
 }
@@ -113,6 +214,14 @@ void opencl_command_queue_enqueue(struct opencl_command_queue_t *command_queue,
 	}
 
 	list_add(command_queue->command_list, command);
+
+	/* Submit the command right away, so that the device runs it while
+	 * the host keeps executing until it waits for an event */
+	if (!command_queue->process)
+	{
+		command_queue->process = 1;
+		pthread_cond_signal(&command_queue->cond_process);
+	}
 	pthread_mutex_unlock(&command_queue->lock);
 }
 
@@ -130,6 +239,17 @@ void opencl_command_queue_flush(struct opencl_command_queue_t *command_queue)
 }
 
 
+void opencl_command_queue_drain(struct opencl_command_queue_t *command_queue)
+{
+	pthread_mutex_lock(&command_queue->lock);
+	while (command_queue->in_flight_list->count)
+		pthread_cond_wait(&command_queue->cond_in_flight,
+				&command_queue->lock);
+	pthread_mutex_unlock(&command_queue->lock);
+	opencl_command_queue_join(command_queue);
+}
+
+
 struct opencl_command_t *
 opencl_command_queue_dequeue(struct opencl_command_queue_t *command_queue)
 {
@@ -42,6 +42,15 @@ struct opencl_command_queue_t
 	pthread_cond_t cond_process;
 
 	volatile int process;
+
+	/* ND-Ranges launched in an out-of-order command queue - elements of
+	 * type opencl_command_t. Each one has a wait thread that completes it
+	 * as soon as it finishes, while the queue thread keeps launching
+	 * commands. Finished ND-Ranges wait in 'finished_list' for the queue
+	 * thread to join their wait thread. Protected by 'lock'. */
+	struct list_t *in_flight_list;
+	struct list_t *finished_list;
+	pthread_cond_t cond_in_flight;
 };
 
 
@@ -55,5 +64,8 @@ struct opencl_command_t *opencl_command_queue_dequeue(
 		struct opencl_command_queue_t *command_queue);
 void opencl_command_queue_flush(struct opencl_command_queue_t *command_queue);
 
+/* Block until all ND-Ranges launched in the command queue have finished */
+void opencl_command_queue_drain(struct opencl_command_queue_t *command_queue);
+
 
 #endif
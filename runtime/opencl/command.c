@@ -428,3 +428,36 @@ void opencl_command_run(struct opencl_command_t *command)
 			command->done_event->time_start);
 }
 
+
+void opencl_command_launch(struct opencl_command_t *command)
+{
+	struct opencl_ndrange_t *ndrange = command->ndrange;
+
+	assert(command->type == opencl_command_launch_ndrange);
+	assert(command->device->arch_ndrange_launch_func);
+
+	if (command->num_wait_events > 0)
+		clWaitForEvents(command->num_wait_events, command->wait_events);
+	if (command->done_event)
+	{
+		opencl_event_set_status(command->done_event, CL_RUNNING);
+	}
+	command->device->arch_ndrange_launch_func(ndrange->arch_ndrange,
+		command->done_event);
+}
+
+
+void opencl_command_wait(struct opencl_command_t *command)
+{
+	struct opencl_ndrange_t *ndrange = command->ndrange;
+
+	assert(command->type == opencl_command_launch_ndrange);
+	assert(command->device->arch_ndrange_wait_func);
+
+	command->device->arch_ndrange_wait_func(ndrange->arch_ndrange,
+		command->done_event);
+	if (command->done_event)
+	{
+		opencl_event_set_status(command->done_event, CL_COMPLETE);
+	}
+}
@@ -52,6 +52,7 @@ struct opencl_command_t
 	struct opencl_command_queue_t *command_queue;
 	struct opencl_device_t *device;
 	void *ndrange;  /* Architecture-specific ND-Range */
+	pthread_t wait_thread;  /* Completes a launched ND-Range */
 
 	union
 	{
@@ -161,6 +162,13 @@ void opencl_command_free(struct opencl_command_t *command);
 
 void opencl_command_run(struct opencl_command_t *command);
 
+/* Run an ND-Range command in two steps. The launch returns as soon as the
+ * ND-Range is running on the device, and the wait blocks until it finishes
+ * and completes the command's event. Only available if the device defines
+ * the asynchronous ND-Range call-backs. */
+void opencl_command_launch(struct opencl_command_t *command);
+void opencl_command_wait(struct opencl_command_t *command);
+
 
 #endif
 
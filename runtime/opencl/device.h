@@ -112,6 +112,12 @@ struct _cl_device_id
 	opencl_arch_ndrange_run_partial_func_t arch_ndrange_run_partial_func;
 	opencl_arch_ndrange_free_func_t arch_ndrange_finish_func;
 	opencl_arch_ndrange_free_func_t arch_ndrange_free_func;
+
+	/* Optional call-back functions to run an ND-range asynchronously,
+	 * used in out-of-order command queues. The launch call-back returns
+	 * as soon as the ND-range is running on the device. */
+	opencl_arch_ndrange_launch_func_t arch_ndrange_launch_func;
+	opencl_arch_ndrange_wait_func_t arch_ndrange_wait_func;
 	
 	/* Architecture-specific device of type 'opencl_XXX_device_t'.
 	 * This pointer is used to reference what would be a sub-class in an
@@ -224,6 +224,15 @@ typedef void (*opencl_arch_ndrange_run_func_t)(void *ndrange,
 typedef void (*opencl_arch_ndrange_run_partial_func_t)(void *ndrange, 
 		unsigned int work_group_start, unsigned int work_group_count);
 
+/* Launch an ND-Range without waiting for it to finish (non-blocking call) */
+typedef void (*opencl_arch_ndrange_launch_func_t)(void *ndrange,
+	struct opencl_event_t *event);
+
+/* Wait for an ND-Range started with the launch call-back to finish, and
+ * free it (blocking call) */
+typedef void (*opencl_arch_ndrange_wait_func_t)(void *ndrange,
+	struct opencl_event_t *event);
+
 /* Finish an ND-Range (blocking call) */
 typedef void (*opencl_arch_ndrange_finish_func_t)(void *ndrange);
 
@@ -101,7 +101,8 @@ struct opencl_si_device_t *opencl_si_device_create(struct opencl_device_t *paren
 	parent->vector_width_half = 0;
 	parent->profile = "PROFILE";
 	parent->profiling_timer_resolution = 0;
-	parent->queue_properties = CL_QUEUE_PROFILING_ENABLE;
+	parent->queue_properties = CL_QUEUE_PROFILING_ENABLE |
+		CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE;
 	parent->single_fp_config = CL_FP_DENORM | 
 				CL_FP_INF_NAN | 
 				CL_FP_ROUND_TO_NEAREST | 
@@ -180,6 +181,10 @@ struct opencl_si_device_t *opencl_si_device_create(struct opencl_device_t *paren
 		opencl_si_ndrange_finish;
 	parent->arch_ndrange_free_func = (opencl_arch_ndrange_free_func_t) 
 		opencl_si_ndrange_free;
+	parent->arch_ndrange_launch_func = (opencl_arch_ndrange_launch_func_t)
+		opencl_si_ndrange_launch;
+	parent->arch_ndrange_wait_func = (opencl_arch_ndrange_wait_func_t)
+		opencl_si_ndrange_wait;
 	parent->arch_device_preferred_workgroups_func = 
 		(opencl_arch_device_preferred_workgroups_func_t)
 		opencl_si_device_preferred_workgroups;
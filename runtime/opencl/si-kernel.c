@@ -437,54 +437,46 @@ void opencl_si_ndrange_run_partial(struct opencl_si_ndrange_t *ndrange,
 		args);
 }
 
-void opencl_si_ndrange_run(struct opencl_si_ndrange_t *ndrange,
+void opencl_si_ndrange_launch(struct opencl_si_ndrange_t *ndrange,
 	struct opencl_event_t *event)
 {
-	struct sched_param sched_param_old;
-	struct sched_param sched_param_new;
-	struct timespec start, end;
+	struct timespec start;
 
 	cl_ulong cltime;
 
-	int sched_policy_new;
-	int sched_policy_old;
-
-	/* Store old scheduling policy and priority */
-	pthread_getschedparam(pthread_self(), &sched_policy_old, 
-		&sched_param_old);
-
-	/* Give dispatch threads the highest priority */
-	sched_policy_new = SCHED_RR;
-	sched_param_new.sched_priority = sched_get_priority_max(
-		sched_policy_new);
-	pthread_setschedparam(pthread_self(), sched_policy_new, 
-		&sched_param_new);
-
 	ioctl(opencl_si_device->fd, SINDRangeStart);
 
 	/* Record start time */
 	if (event)
 	{
 		clock_gettime(CLOCK_MONOTONIC, &start);
+
+		cltime = (cl_ulong)start.tv_sec;
+		cltime *= 1000000000;
+		cltime += (cl_ulong)start.tv_nsec;
+		event->time_start = cltime;
 	}
 
-	/* Run all of the work groups */
+	/* Send all of the work groups. The driver does not block the caller,
+	 * so the nd-range runs while the host keeps executing. */
 	opencl_si_ndrange_run_partial(ndrange, 0, ndrange->total_num_groups);
+}
+
+void opencl_si_ndrange_wait(struct opencl_si_ndrange_t *ndrange,
+	struct opencl_event_t *event)
+{
+	struct timespec end;
+
+	cl_ulong cltime;
 
 	/* Wait for the nd-range to complete and then flush the cache */
 	opencl_si_ndrange_finish(ndrange);
+	ioctl(opencl_si_device->fd, SINDRangeEnd);
 
 	/* Record end time */
 	if (event)
 	{
 		clock_gettime(CLOCK_MONOTONIC, &end);
-		
-		ioctl(opencl_si_device->fd, SINDRangeEnd);
-
-		cltime = (cl_ulong)start.tv_sec;
-		cltime *= 1000000000;
-		cltime += (cl_ulong)start.tv_nsec;
-		event->time_start = cltime;
 
 		cltime = (cl_ulong)end.tv_sec;
 		cltime *= 1000000000;
@@ -492,11 +484,36 @@ void opencl_si_ndrange_run(struct opencl_si_ndrange_t *ndrange,
 		event->time_end = cltime;
 	}
 
+	/* Free the nd-range */
+	opencl_si_ndrange_free(ndrange);
+}
+
+void opencl_si_ndrange_run(struct opencl_si_ndrange_t *ndrange,
+	struct opencl_event_t *event)
+{
+	struct sched_param sched_param_old;
+	struct sched_param sched_param_new;
+
+	int sched_policy_new;
+	int sched_policy_old;
+
+	/* Store old scheduling policy and priority */
+	pthread_getschedparam(pthread_self(), &sched_policy_old, 
+		&sched_param_old);
+
+	/* Give dispatch threads the highest priority */
+	sched_policy_new = SCHED_RR;
+	sched_param_new.sched_priority = sched_get_priority_max(
+		sched_policy_new);
+	pthread_setschedparam(pthread_self(), sched_policy_new, 
+		&sched_param_new);
+
+	/* Run all of the work groups and wait for them */
+	opencl_si_ndrange_launch(ndrange, event);
+	opencl_si_ndrange_wait(ndrange, event);
+
 	/* Reset old scheduling parameters */
 	pthread_setschedparam(pthread_self(), sched_policy_old, 
 		&sched_param_old);
-
-	/* Free the nd-range */
-	opencl_si_ndrange_free(ndrange);
 }
 
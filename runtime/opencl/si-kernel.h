@@ -142,6 +142,12 @@ void opencl_si_ndrange_init(struct opencl_si_ndrange_t *ndrange);
 void opencl_si_ndrange_run(struct opencl_si_ndrange_t *ndrange,
 	struct opencl_event_t *event);
 
+void opencl_si_ndrange_launch(struct opencl_si_ndrange_t *ndrange,
+	struct opencl_event_t *event);
+
+void opencl_si_ndrange_wait(struct opencl_si_ndrange_t *ndrange,
+	struct opencl_event_t *event);
+
 void opencl_si_ndrange_run_partial(struct opencl_si_ndrange_t *ndrange,
 	unsigned int work_group_start, unsigned int work_group_count);
 
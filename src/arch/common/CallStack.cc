@@ -228,5 +228,71 @@ void CallStack::BackTrace(unsigned address, std::ostream &os)
 }
 
 
+void CallStack::SaveCheckpoint(std::ostream &os) const
+{
+	// Call level
+	misc::WriteBinary(os, level);
+
+	// Stack frames
+	unsigned num_frames = stack.size();
+	misc::WriteBinary(os, num_frames);
+	for (auto &frame : stack)
+	{
+		misc::WriteBinary(os, frame.getIp());
+		misc::WriteBinary(os, frame.getSp());
+	}
+
+	// Maps
+	unsigned num_maps = maps.size();
+	misc::WriteBinary(os, num_maps);
+	for (auto &map : maps)
+	{
+		misc::WriteBinaryString(os, map.getPath());
+		misc::WriteBinary(os, map.getOffset());
+		misc::WriteBinary(os, map.getAddress());
+		misc::WriteBinary(os, map.getSize());
+		misc::WriteBinary(os, map.isDynamic());
+	}
+}
+
+
+void CallStack::LoadCheckpoint(std::istream &is)
+{
+	// Call level
+	misc::ReadBinary(is, level);
+
+	// Stack frames
+	unsigned num_frames = 0;
+	misc::ReadBinary(is, num_frames);
+	stack.clear();
+	for (unsigned i = 0; i < num_frames && is; i++)
+	{
+		unsigned ip = 0;
+		unsigned sp = 0;
+		misc::ReadBinary(is, ip);
+		misc::ReadBinary(is, sp);
+		stack.emplace_back(ip, sp);
+	}
+
+	// Maps
+	unsigned num_maps = 0;
+	misc::ReadBinary(is, num_maps);
+	maps.clear();
+	for (unsigned i = 0; i < num_maps && is; i++)
+	{
+		std::string map_path = misc::ReadBinaryString(is);
+		unsigned offset = 0;
+		unsigned address = 0;
+		unsigned size = 0;
+		bool dynamic = false;
+		misc::ReadBinary(is, offset);
+		misc::ReadBinary(is, address);
+		misc::ReadBinary(is, size);
+		misc::ReadBinary(is, dynamic);
+		maps.emplace_back(map_path, offset, address, size, dynamic);
+	}
+}
+
+
 }  // namespace comm
 
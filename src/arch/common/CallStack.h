@@ -79,6 +79,9 @@ public:
 
 	/// Return the size of the map
 	unsigned getSize() const { return size; }
+
+	/// Return whether the map was made at runtime
+	bool isDynamic() const { return dynamic; }
 };
 
 
@@ -193,6 +196,14 @@ public:
 	///	Output stream to dump the back trace to
 	void BackTrace(unsigned address, std::ostream &os = std::cout);
 
+	/// Save the stack frames, memory maps, and call level into a
+	/// checkpoint stream.
+	void SaveCheckpoint(std::ostream &os) const;
+
+	/// Restore the state saved with SaveCheckpoint(), replacing the
+	/// current stack frames and maps.
+	void LoadCheckpoint(std::istream &is);
+
 	/// Activate debug information for the call stacks.
 	///
 	/// \param path
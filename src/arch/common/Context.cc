@@ -42,6 +42,20 @@ Context::Context(Emulator *emulator) :
 }
 
 
+void Context::setId(int id)
+{
+	// Set new ID
+	this->id = id;
+	if (id_counter <= id)
+		id_counter = id + 1;
+
+	// Recompute name
+	name = misc::fmt("%s context %d",
+			emulator->getName().c_str(),
+			id);
+}
+
+
 void Context::Suspend()
 {
 	throw misc::Panic("Not implemented");
@@ -61,6 +61,12 @@ public:
 	/// architecture, the word 'context', and its identifier.
 	const std::string &getName() const { return name; }
 
+	/// Change the identifier of the context, and update its name
+	/// accordingly. This is used to restore a context with its original
+	/// identifier from a checkpoint. Identifiers assigned to contexts
+	/// created afterwards will be higher than \a id.
+	void setId(int id);
+
 	/// Suspend the context. The context must be in a non-suspended state,
 	/// or a panic exception will occur.
 	virtual void Suspend();
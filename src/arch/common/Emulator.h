@@ -73,6 +73,10 @@ public:
 	/// Increment the number of emulated instructions
 	void incNumInstructions() { ++num_instructions; }
 
+	/// Add a number of instructions emulated at once, for example by the
+	/// bulk execution of repeated string instructions.
+	void addNumInstructions(long long count) { num_instructions += count; }
+
 	/// Return the number of emulated instructions
 	long long getNumInstructions() const { return num_instructions; }
 
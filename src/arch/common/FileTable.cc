@@ -17,7 +17,10 @@
  *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  */ 
  
+#include <algorithm>
+#include <fcntl.h>
 #include <unistd.h>
+#include <unordered_map>
 
 #include "FileTable.h"
 
@@ -174,5 +177,100 @@ void FileTable::freeFileDescriptor(int index)
 }
 
 
+void FileTable::SaveCheckpoint(std::ostream &os) const
+{
+	unsigned num_descriptors = descriptors.size();
+	misc::WriteBinary(os, num_descriptors);
+	for (auto &desc : descriptors)
+	{
+		// Empty entry
+		bool present = desc.get();
+		misc::WriteBinary(os, present);
+		if (!present)
+			continue;
+
+		// Only files that can be reopened by path are supported
+		FileDescriptor::Type type = desc->getType();
+		if (type == FileDescriptor::TypePipe ||
+				type == FileDescriptor::TypeSocket ||
+				type == FileDescriptor::TypeDevice)
+			throw Error(misc::fmt("File descriptor %d of type %s "
+					"cannot be saved in a checkpoint",
+					desc->getGuestIndex(),
+					FileDescriptor::TypeTypeMap[type]));
+
+		// Current position in host file
+		long long offset = 0;
+		if (!desc->getPath().empty())
+			offset = std::max(0LL, (long long) lseek(
+					desc->getHostIndex(), 0, SEEK_CUR));
+
+		// Descriptor fields
+		misc::WriteBinary(os, type);
+		misc::WriteBinary(os, desc->getHostIndex());
+		misc::WriteBinary(os, desc->getFlags());
+		misc::WriteBinaryString(os, desc->getPath());
+		misc::WriteBinary(os, offset);
+	}
+}
+
+
+void FileTable::LoadCheckpoint(std::istream &is)
+{
+	// Saved host descriptors already reopened
+	std::unordered_map<int, int> host_indexes;
+
+	// Read descriptors
+	unsigned num_descriptors = 0;
+	misc::ReadBinary(is, num_descriptors);
+	descriptors.clear();
+	for (unsigned i = 0; i < num_descriptors && is; i++)
+	{
+		// Empty entry
+		bool present = false;
+		misc::ReadBinary(is, present);
+		descriptors.emplace_back(nullptr);
+		if (!present)
+			continue;
+
+		// Descriptor fields
+		FileDescriptor::Type type = FileDescriptor::TypeInvalid;
+		int host_index = -1;
+		int flags = 0;
+		long long offset = 0;
+		misc::ReadBinary(is, type);
+		misc::ReadBinary(is, host_index);
+		misc::ReadBinary(is, flags);
+		std::string path = misc::ReadBinaryString(is);
+		misc::ReadBinary(is, offset);
+
+		// Standard input and output of the host are used as they are.
+		// Other files are reopened once per saved host descriptor.
+		if (!path.empty())
+		{
+			auto it = host_indexes.find(host_index);
+			if (it != host_indexes.end())
+			{
+				host_index = it->second;
+			}
+			else
+			{
+				int fd = open(path.c_str(), flags &
+						~(O_CREAT | O_TRUNC | O_EXCL));
+				if (fd < 0 || lseek(fd, offset, SEEK_SET) < 0)
+					throw Error(misc::fmt("%s: Cannot reopen "
+							"file", path.c_str()));
+				host_indexes[host_index] = fd;
+				host_index = fd;
+			}
+		}
+
+		// Create descriptor
+		descriptors[i].reset(new FileDescriptor(type, i, host_index,
+				flags, path));
+	}
+}
+
+
 }  // namespace comm
 
@@ -24,6 +24,7 @@
 #include <memory>
 #include <vector>
 
+#include <lib/cpp/Error.h>
 #include <lib/cpp/Misc.h>
 #include <lib/cpp/String.h>
 
@@ -145,6 +146,18 @@ class FileTable
 
 public:
 
+	/// File table error
+	class Error : public misc::Error
+	{
+	public:
+
+		/// Constructor
+		Error(const std::string &message) : misc::Error(message)
+		{
+			AppendPrefix("File table");
+		}
+	};
+
 	/// Constructor
 	FileTable();
 	
@@ -200,6 +213,23 @@ public:
 	/// Return the guest file descriptor associated with a host file
 	/// descriptor given in \a host_index, or -1 if invalid.
 	int getGuestIndex(int host_index) const;
+
+	/// Save the file descriptors into a checkpoint stream, together with
+	/// the current offset of each host file.
+	///
+	/// \throw
+	///	An Error is thrown if the table contains pipes, sockets, or
+	///	devices, since their state cannot be recreated.
+	void SaveCheckpoint(std::ostream &os) const;
+
+	/// Replace the content of the table with the file descriptors saved
+	/// with SaveCheckpoint(). Files are reopened by path, without being
+	/// truncated, and placed at their saved offsets. Guest descriptors
+	/// sharing a host file in the saved table share it again.
+	///
+	/// \throw
+	///	An Error is thrown if a file cannot be reopened.
+	void LoadCheckpoint(std::istream &is);
 };
 
 
@@ -166,9 +166,7 @@ int Driver::CallMemRead(comm::Context *context,
 		throw Error("Accessing device memory not allocated");
 
 	// Read memory from device to host
-	std::unique_ptr<char> buffer(new char[size]);
-	global_mem->Read(device_ptr, size, buffer.get());
-	memory->Write(host_ptr, size, buffer.get());
+	memory->CopyFrom(host_ptr, global_mem, device_ptr, size);
 
 	// Return
 	return 0;
@@ -216,9 +214,7 @@ int Driver::CallMemWrite(comm::Context *context,
 	//	throw Error("Accessing device memory not allocated");
 
 	// Read memory from host to device
-	std::unique_ptr<char> buffer(new char[size]);
-	memory->Read(host_ptr, size, buffer.get());
-	global_mem->Write(device_ptr, size, buffer.get());
+	global_mem->CopyFrom(device_ptr, memory, host_ptr, size);
 
 	// Return
 	return 0;
@@ -125,10 +125,8 @@ int Driver::CallMemRead(comm::Context *context,
 		throw Error(misc::fmt("%s: accessing device memory not "
 				"allocated", __FUNCTION__));                                   
 
-	// Read memory from host to device
-	auto buffer = misc::new_unique_array<char>(size);
-	video_memory->Read(device_ptr, size, buffer.get());
-	memory->Write(host_ptr, size, buffer.get());
+	// Read memory from device to host
+	memory->CopyFrom(host_ptr, video_memory, device_ptr, size);
 	
 	// Return                                                         
 	return 0; 
@@ -173,10 +171,8 @@ int Driver::CallMemWrite(comm::Context *context,
 	if (device_ptr + size > emulator->getVideoMemoryTop())
 		throw Error(misc::fmt("Device not allocated"));
 
-	// Read memory from host to device
-	auto buffer = misc::new_unique_array<char>(size);
-	memory->Read(host_ptr, size, buffer.get());
-	video_memory->Write(device_ptr, size, buffer.get());
+	// Write memory from host to device
+	video_memory->CopyFrom(device_ptr, memory, host_ptr, size);
 
 	// Return
 	return 0;
@@ -219,10 +215,8 @@ int Driver::CallMemCopy(comm::Context *context,
 		throw Error(misc::fmt("%s: accessing device memory not "
 				"allocated", __FUNCTION__));                                   
 
-	// Read memory from host to device
-	auto buffer = misc::new_unique_array<char>(size);
-	video_memory->Read(src_ptr, size, buffer.get());
-	video_memory->Write(dest_ptr, size, buffer.get());
+	// Copy memory within the device
+	video_memory->CopyFrom(dest_ptr, video_memory, src_ptr, size);
 
 	// Return
 	return 0;  
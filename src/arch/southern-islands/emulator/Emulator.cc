@@ -17,6 +17,10 @@
  *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  */
 
+#include <algorithm>
+#include <thread>
+#include <vector>
+
 #include <arch/southern-islands/disassembler/Disassembler.h>
 #include <arch/southern-islands/emulator/WorkGroup.h>
 #include <arch/southern-islands/emulator/Wavefront.h>
@@ -40,6 +44,8 @@ std::string Emulator::isa_debug_file;
 
 long long Emulator::max_instructions;
 
+int Emulator::num_host_threads = 1;
+
 std::string Emulator::scheduler_debug_file;
  
 misc::Debug Emulator::scheduler_debug;
@@ -95,6 +101,15 @@ bool Emulator::Run()
 	if (!getNumNDRanges())
 		return false;
 
+	// Emulate work-groups in parallel. The ISA debug output is only
+	// produced in sequential emulation, so that lines of different
+	// work-groups don't get mixed.
+	if (num_host_threads > 1 && !isa_debug)
+	{
+		RunParallel();
+		return true;
+	}
+
 	// NDRange list is shared by CL/GL driver
 	for (auto it = getNDRangesBegin(), e = getNDRangesEnd(); it !=e; ++it)
 	{
@@ -120,25 +135,7 @@ bool Emulator::Run()
 		// Normally, we would iterate over the running work group list
 		// but in this case there is only a single work group being
 		// executed at a time so no loop is needed
-		while (!work_group->getFinished())
-		{
-			// Execute an instruction for each wavefront
-			for (auto wf_i = work_group->getWavefrontsBegin(), 
-					wf_e = work_group->getWavefrontsEnd();
-					wf_i != wf_e;
-					++wf_i)
-			{
-				// Get current wavefront
-				Wavefront *wavefront = (*wf_i).get();
-
-				// Check if the wavefront is finished or not
-				if (wavefront->getFinished() || wavefront->at_barrier)
-					continue;
-				
-				// Execute the wavefront
-				wavefront->Execute();
-			}
-		}
+		RunWorkGroup(work_group);
 	
 		// Now that the work group is finished, remove it from the
 		// running work group list
@@ -154,6 +151,96 @@ bool Emulator::Run()
 }
 
 
+void Emulator::RunWorkGroup(WorkGroup *work_group)
+{
+	while (!work_group->getFinished())
+	{
+		// Execute an instruction for each wavefront
+		for (auto wf_i = work_group->getWavefrontsBegin(), 
+				wf_e = work_group->getWavefrontsEnd();
+				wf_i != wf_e;
+				++wf_i)
+		{
+			// Get current wavefront
+			Wavefront *wavefront = (*wf_i).get();
+
+			// Check if the wavefront is finished or not
+			if (wavefront->getFinished() || wavefront->at_barrier)
+				continue;
+			
+			// Execute the wavefront
+			wavefront->Execute();
+		}
+	}
+}
+
+
+void Emulator::RunParallel()
+{
+	// Create host threads. There is no point in using more host threads
+	// than host CPUs.
+	if (!thread_pool)
+	{
+		int num_pool_threads = num_host_threads;
+		int num_host_cpus = std::thread::hardware_concurrency();
+		if (num_host_cpus)
+			num_pool_threads = std::min(num_pool_threads,
+					num_host_cpus);
+		thread_pool = misc::new_unique<misc::ThreadPool>(
+				num_pool_threads);
+	}
+
+	// Global memory is accessed from all host threads
+	global_memory->setThreadSafe(true);
+
+	// NDRange list is shared by CL/GL driver
+	std::vector<WorkGroup *> work_groups;
+	for (auto it = getNDRangesBegin(), e = getNDRangesEnd(); it != e; ++it)
+	{
+		// Get NDRange
+		NDRange *ndrange = it->get();
+
+		// Move a batch of waiting work-groups to the running work
+		// groups list. Work-groups have their own local memory and
+		// wavefronts, and gather their own statistics while they run.
+		work_groups.clear();
+		while (!ndrange->isWaitingWorkGroupsEmpty() &&
+				(int) work_groups.size() <
+				thread_pool->getNumThreads() *
+				WorkGroupsPerHostThread)
+		{
+			long work_group_id = ndrange->GetWaitingWorkGroup();
+			WorkGroup *work_group = ndrange->ScheduleWorkGroup(
+					work_group_id);
+			work_group->setPrivateStatistics(true);
+			work_groups.push_back(work_group);
+		}
+
+		// If there's no work groups to run, go to next nd-range
+		if (work_groups.empty())
+			continue;
+
+		// Emulate the work-groups on the host threads
+		thread_pool->Run(work_groups.size(), [&work_groups](int index)
+		{
+			RunWorkGroup(work_groups[index]);
+		});
+
+		// Remove the finished work-groups, in the same order as they
+		// were scheduled
+		for (WorkGroup *work_group : work_groups)
+		{
+			work_group->FlushStatistics();
+			ndrange->RemoveWorkGroup(work_group);
+		}
+
+		// If a context has been suspended while waiting for the ndrange
+		// check if it can be woken up.
+		ndrange->WakeupContext();
+	}
+}
+
+
 void Emulator::createBufferDesc(unsigned base_addr, unsigned size,
 		int num_elems, Argument::DataType data_type, 
 		WorkItem::BufferDescriptor *buffer_descriptor)
@@ -373,6 +460,21 @@ void Emulator::RegisterOptions()
 			scheduler_debug_file,
 			"File to dump how the work groups, and wavefronts are "
 			"scheduled on the Gpu's compute units.");
+
+	// Option --si-host-threads <num>
+	command_line->RegisterInt32("--si-host-threads <num>",
+			num_host_threads,
+			"Number of host threads emulating work-groups of an "
+			"ND-range in parallel in functional simulation, or "
+			"emulating the instructions fetched by compute units in "
+			"parallel in detailed simulation. In functional "
+			"simulation, work-groups only synchronize on global "
+			"atomic instructions. In detailed simulation, compute "
+			"units advance their pipelines and emulate instructions "
+			"accessing global memory sequentially, so results don't "
+			"depend on the number of host threads. Debug and trace "
+			"outputs disable parallel simulation. The default value "
+			"is 1.");
 }
 
 
@@ -380,6 +482,11 @@ void Emulator::ProcessOptions()
 {
 	isa_debug.setPath(isa_debug_file);
 	scheduler_debug.setPath(scheduler_debug_file);
+
+	// Number of host threads
+	if (num_host_threads < 1)
+		throw Error("Value for '--si-host-threads' must be greater "
+				"than 0");
 }
 	
 	
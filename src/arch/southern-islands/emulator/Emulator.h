@@ -23,11 +23,13 @@
 #include <iostream>
 #include <list>
 #include <memory>
+#include <mutex>
 
 #include <arch/common/Emulator.h>
 #include <arch/southern-islands/disassembler/Argument.h>
 #include <lib/cpp/Debug.h>
 #include <lib/cpp/Error.h>
+#include <lib/cpp/ThreadPool.h>
 #include <memory/Memory.h>
 
 #include "NDRange.h"
@@ -101,6 +103,13 @@ private:
 	// Maximum number of instructions
 	static long long max_instructions;
 
+	// Number of host threads emulating work-groups in parallel
+	static int num_host_threads;
+
+	// Number of work-groups scheduled at once for each host thread in
+	// parallel emulation
+	static const int WorkGroupsPerHostThread = 4;
+
 
 
 
@@ -128,6 +137,20 @@ private:
 
 	// Number of ndranges currently running
 	int ndranges_running = 0;
+
+	// Pool of host threads for parallel emulation of work-groups
+	std::unique_ptr<misc::ThreadPool> thread_pool;
+
+	// Lock serializing global atomic instructions
+	std::mutex atomic_mutex;
+
+	// Emulate a work-group until it finishes, interleaving the execution
+	// of its wavefronts
+	static void RunWorkGroup(WorkGroup *work_group);
+
+	// Run one iteration of the emulation loop, emulating several
+	// work-groups of each ND-range in parallel
+	void RunParallel();
 	
 public:
 
@@ -216,6 +239,16 @@ public:
 	/// Simulator to determine if the max has been reached.
 	static long long getMaxInstructions () { return max_instructions; }
 
+	/// Return the number of host threads emulating work-groups
+	static int getNumHostThreads() { return num_host_threads; }
+
+	/// Set the number of host threads emulating work-groups, as given
+	/// with option '--si-host-threads'
+	static void setNumHostThreads(int num_host_threads)
+	{
+		Emulator::num_host_threads = num_host_threads;
+	}
+
 
 
 
@@ -274,6 +307,10 @@ public:
 	/// Get global memory
 	mem::Memory *getGlobalMemory() { return global_memory; }
 
+	/// Return the lock that global atomic instructions must hold while
+	/// they update global memory
+	std::mutex &getAtomicMutex() { return atomic_mutex; }
+
 	/// Get video_memory_top
 	unsigned getVideoMemoryTop() const { return video_memory_top; }
 
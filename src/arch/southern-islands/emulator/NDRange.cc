@@ -17,6 +17,8 @@
  *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  */
 
+#include <algorithm>
+
 #include <arch/southern-islands/disassembler/Argument.h>
 #include <arch/southern-islands/driver/Driver.h>
 #include <arch/southern-islands/driver/Kernel.h>
@@ -144,6 +146,43 @@ void NDRange::SetupInstructionMemory(const char *buf, unsigned size, unsigned pc
 	// Save a copy of buffer in NDRange
 	instruction_buffer = misc::new_unique_array<char>(size);
 	instruction_memory->Read(pc, size, instruction_buffer.get());
+
+	// Decode all instructions once
+	DecodeInstructions();
+}
+
+
+void NDRange::DecodeInstructions()
+{
+	// Copy the instruction buffer with room for the literal constant of
+	// an instruction at the end
+	std::vector<char> buffer(instruction_buffer_size + 8);
+	std::copy(instruction_buffer.get(), instruction_buffer.get() +
+			instruction_buffer_size, buffer.begin());
+
+	// Decode instructions sequentially. Decoding stops at the first
+	// encoding that is not recognized, which could be data following the
+	// code. Wavefronts decode instructions not present in the table
+	// themselves when they reach them.
+	instructions.clear();
+	instruction_index.assign((instruction_buffer_size + 3) / 4, -1);
+	unsigned offset = 0;
+	while (offset < instruction_buffer_size && offset % 4 == 0)
+	{
+		Instruction instruction;
+		try
+		{
+			instruction.Decode(buffer.data() + offset,
+					instruction_address + offset);
+		}
+		catch (misc::Exception &e)
+		{
+			break;
+		}
+		instruction_index[offset / 4] = instructions.size();
+		instructions.push_back(instruction);
+		offset += instruction.getSize();
+	}
 }
 
 
@@ -23,9 +23,11 @@
 #include <deque>
 #include <list>
 #include <memory>
+#include <vector>
 
 #include <arch/common/Context.h>
 #include <arch/southern-islands/disassembler/Binary.h>
+#include <arch/southern-islands/disassembler/Instruction.h>
 #include <memory/Memory.h>
 #include <memory/Mmu.h>
 
@@ -161,6 +163,17 @@ private:
 	unsigned instruction_address = 0;
 	unsigned instruction_buffer_size = 0;
 
+	// Instructions decoded once when the instruction memory is set up,
+	// shared by all wavefronts of the ND-range
+	std::vector<Instruction> instructions;
+
+	// Index in 'instructions' of the instruction starting at each 4-byte
+	// offset from 'instruction_address', or -1 if it was not decoded
+	std::vector<int> instruction_index;
+
+	// Decode the instruction buffer into 'instructions'
+	void DecodeInstructions();
+
 	// Local memory top to assign to local arguments.
 	// Initially it is equal to the size of local variables in 
 	// kernel function.
@@ -255,6 +268,9 @@ public:
 
 	/// Get num_vgpr_used
 	unsigned getNumVgprUsed() const { return num_vgpr_used; }
+
+	/// Get num_sgpr_used
+	unsigned getNumSgprUsed() const { return num_sgpr_used; }
 	
 	/// Get pointer to local_mem_top
 	int *getLocalMemTopPtr() { return &local_mem_top; }
@@ -346,6 +362,20 @@ public:
 	unsigned getInstructionBufferSize() const { 
 			return instruction_buffer_size; }
 
+	/// Return the instruction decoded in advance at the given address of
+	/// the instruction memory, or null if no instruction at that address
+	/// could be decoded in advance. The instruction is shared by all
+	/// wavefronts and must not be modified.
+	Instruction *getInstruction(unsigned pc)
+	{
+		unsigned offset = pc - instruction_address;
+		unsigned index = offset / 4;
+		if (offset % 4 || index >= instruction_index.size() ||
+				instruction_index[index] < 0)
+			return nullptr;
+		return &instructions[instruction_index[index]];
+	}
+
 	/// Get user element object
 	BinaryUserElement *getUserElement(int idx)
 	{
@@ -17,6 +17,8 @@
  *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  */
 
+#include <algorithm>
+
 #include <arch/southern-islands/disassembler/Disassembler.h>
 #include <arch/southern-islands/disassembler/Instruction.h>
 #include <lib/cpp/Debug.h>
@@ -151,9 +153,7 @@ void Wavefront::Execute()
 	// Get current work-group
 	WorkGroup *work_group = this->work_group;
 	NDRange *ndrange = work_group->getNDRange();
-	Emulator *emulator = ndrange->getEmulator();
 	WorkItem *work_item = NULL;
-	this->instruction = misc::new_unique<Instruction>();
 
 	// Reset instruction flags
 	vector_memory_write = 0;
@@ -176,22 +176,28 @@ void Wavefront::Execute()
 	unsigned total_inst_buffer_size = ndrange->getInstructionBufferSize();
 	assert(total_inst_buffer_size > pc);
 
-	// Find out the remaining size of the instruction memory
-	unsigned remaining_inst_buffer_size = total_inst_buffer_size - pc;
-
-	// Create a buffer based on the remaining instruction memory
-	auto inst_buffer = misc::new_unique_array<char>(
-			remaining_inst_buffer_size);
-	ndrange->getInstructionMemory()->Read(pc, remaining_inst_buffer_size, 
-			inst_buffer.get());
-
-	// Decode the next instruction in the instruction memory
-	// Note: We need to pass the whole buffer for a single instruction
-	// because we don't know the size of the next instruction yet
-	instruction->Decode(inst_buffer.get(), pc);
+	// Take the instruction decoded in advance by the ND-range
+	instruction = ndrange->getInstruction(pc);
+	if (!instruction)
+	{
+		// Read at most the maximum instruction size from the remaining
+		// instruction memory
+		char inst_buffer[8] = {};
+		unsigned remaining_inst_buffer_size = std::min(
+				(unsigned) sizeof inst_buffer,
+				total_inst_buffer_size - pc);
+		ndrange->getInstructionMemory()->Read(pc,
+				remaining_inst_buffer_size, inst_buffer);
+
+		// Decode it
+		if (!private_instruction)
+			private_instruction = misc::new_unique<Instruction>();
+		private_instruction->Decode(inst_buffer, pc);
+		instruction = private_instruction.get();
+	}
 
 	// Update the statistics
-	emulator->incNumInstructions();
+	work_group->incNumInstructions();
 
 	// Extract the properties of the newest instruction
 	this->inst_size = instruction->getSize();
@@ -219,12 +225,12 @@ void Wavefront::Execute()
 		}
 
 		// Stats
-		emulator->incScalarAluInstCount();
+		work_group->incScalarAluInstCount();
 		scalar_alu_instruction_count++;
 
 		// Only one work item executes the instruction
 		work_item = scalar_work_item.get();
-		work_item->Execute(opcode, instruction.get());
+		work_item->Execute(opcode, instruction);
 
 		// Add newlines between each instruction
 		Emulator::isa_debug << "\n\n";
@@ -243,12 +249,12 @@ void Wavefront::Execute()
 		}
 		
 		// Stats
-		emulator->incScalarAluInstCount();
+		work_group->incScalarAluInstCount();
 		scalar_alu_instruction_count++;
 
 		// Only one work item executes the instruction
 		work_item = scalar_work_item.get();
-		work_item->Execute(opcode, instruction.get());
+		work_item->Execute(opcode, instruction);
 
 		// Add newlines between each instruction
 		Emulator::isa_debug << "\n\n";
@@ -270,17 +276,17 @@ void Wavefront::Execute()
 		if (bytes->sopp.op > 1 &&
 			bytes->sopp.op < 10)
 		{
-			emulator->incBranchInstCount();
+			work_group->incBranchInstCount();
 			branch_instruction_count++;
 		} else
 		{
-			emulator->incScalarAluInstCount();
+			work_group->incScalarAluInstCount();
 			scalar_alu_instruction_count++;
 		}
 
 		// Only one work item executes the instruction
 		work_item = scalar_work_item.get();
-		work_item->Execute(opcode, instruction.get());
+		work_item->Execute(opcode, instruction);
 
 		// Add newlines between each instruction
 		Emulator::isa_debug << "\n\n";
@@ -299,12 +305,12 @@ void Wavefront::Execute()
 		}
 
 		// Stats
-		emulator->incScalarAluInstCount();
+		work_group->incScalarAluInstCount();
 		scalar_alu_instruction_count++;
 
 		// Only one work item executes the instruction
 		work_item = scalar_work_item.get();
-		work_item->Execute(opcode, instruction.get());
+		work_item->Execute(opcode, instruction);
 
 		// Add newlines between each instruction
 		Emulator::isa_debug << "\n\n";
@@ -323,12 +329,12 @@ void Wavefront::Execute()
 		}
 
 		// Stats
-		emulator->incScalarAluInstCount();
+		work_group->incScalarAluInstCount();
 		scalar_alu_instruction_count++;
 
 		// Only one work item executes the instruction
 		work_item = scalar_work_item.get();
-		work_item->Execute(opcode, instruction.get());
+		work_item->Execute(opcode, instruction);
 
 		// Add newlines between each instruction
 		Emulator::isa_debug << "\n\n";
@@ -348,12 +354,12 @@ void Wavefront::Execute()
 		}
 
 		// Stats
-		emulator->incScalarMemInstCount();
+		work_group->incScalarMemInstCount();
 		scalar_memory_instruction_count++;
 
 		// Only one work item executes the instruction
 		work_item = scalar_work_item.get();
-		work_item->Execute(opcode, instruction.get());
+		work_item->Execute(opcode, instruction);
 
 		// Add newlines between each instruction
 		Emulator::isa_debug << "\n\n";
@@ -373,16 +379,20 @@ void Wavefront::Execute()
 		}
 
 		// Stats
-		emulator->incVectorAluInstCount();
+		work_group->incVectorAluInstCount();
 		vector_alu_instruction_count++;
 	
-		// Execute the instruction
-		for (auto it = work_items_begin, e = work_items_end;
-				it != e; ++it)
+		// Execute the instruction for all work-items at once if
+		// possible, or one work-item at a time otherwise
+		if (Emulator::isa_debug || !ExecuteVectorAlu(opcode, instruction))
 		{
-			work_item = (*it).get();
-			if (isWorkItemActive(work_item->getIdInWavefront()))
-				work_item->Execute(opcode, instruction.get());
+			for (auto it = work_items_begin, e = work_items_end;
+					it != e; ++it)
+			{
+				work_item = (*it).get();
+				if (isWorkItemActive(work_item->getIdInWavefront()))
+					work_item->Execute(opcode, instruction);
+			}
 		}
 
 		// Add newlines between each instruction
@@ -402,7 +412,7 @@ void Wavefront::Execute()
 		}
 
 		// Stats
-		emulator->incVectorAluInstCount();
+		work_group->incVectorAluInstCount();
 		vector_alu_instruction_count++;
 
 		// Special case: V_READFIRSTLANE_B32
@@ -416,7 +426,7 @@ void Wavefront::Execute()
 			if (work_item->ReadSReg(Instruction::RegisterExec) == 0 && 
 				work_item->ReadSReg(Instruction::RegisterExec + 1) == 0)
 			{
-				work_item->Execute(opcode, instruction.get());
+				work_item->Execute(opcode, instruction);
 			}
 			else 
 			{
@@ -426,21 +436,23 @@ void Wavefront::Execute()
 					work_item = (*it).get();
 					if (isWorkItemActive(work_item->getIdInWavefront()))
 					{
-						work_item->Execute(opcode, instruction.get());
+						work_item->Execute(opcode, instruction);
 					}
 				}
 			}
 		}
-		else
+		else if (Emulator::isa_debug ||
+				!ExecuteVectorAlu(opcode, instruction))
 		{
-			// Execute the instruction
+			// Execute the instruction one work-item at a time when it
+			// has no whole-wavefront implementation
 			for (auto it = work_items_begin, e = work_items_end; 
 				it != e; ++it)
 			{
 				work_item = (*it).get();
 				if (isWorkItemActive(work_item->getIdInWavefront()))
 				{
-					work_item->Execute(opcode, instruction.get());
+					work_item->Execute(opcode, instruction);
 				}
 			}
 		}
@@ -462,17 +474,21 @@ void Wavefront::Execute()
 		}
 
 		// Stats
-		emulator->incVectorAluInstCount();
+		work_group->incVectorAluInstCount();
 		vector_alu_instruction_count++;
 	
-		// Execute the instruction
-		for (auto it = work_items_begin, e = work_items_end; 
-				it != e; ++it)
+		// Execute the instruction for all work-items at once if
+		// possible, or one work-item at a time otherwise
+		if (Emulator::isa_debug || !ExecuteVectorAlu(opcode, instruction))
 		{
-			work_item = (*it).get();
-			if (isWorkItemActive(work_item->getIdInWavefront()))
+			for (auto it = work_items_begin, e = work_items_end; 
+					it != e; ++it)
 			{
-				work_item->Execute(opcode, instruction.get());
+				work_item = (*it).get();
+				if (isWorkItemActive(work_item->getIdInWavefront()))
+				{
+					work_item->Execute(opcode, instruction);
+				}
 			}
 		}
 
@@ -493,7 +509,7 @@ void Wavefront::Execute()
 		}
 
 		// Stats
-		emulator->incVectorAluInstCount();
+		work_group->incVectorAluInstCount();
 		vector_alu_instruction_count++;
 	
 		// Execute the instruction
@@ -503,7 +519,7 @@ void Wavefront::Execute()
 			work_item = (*it).get();
 			if (isWorkItemActive(work_item->getIdInWavefront()))
 			{
-				work_item->Execute(opcode, instruction.get());
+				work_item->Execute(opcode, instruction);
 			}
 		}
 
@@ -524,7 +540,7 @@ void Wavefront::Execute()
 		}
 
 		// Stats
-		emulator->incVectorAluInstCount();
+		work_group->incVectorAluInstCount();
 		vector_alu_instruction_count++;
 	
 		// Execute the instruction
@@ -534,7 +550,7 @@ void Wavefront::Execute()
 			work_item = (*it).get();
 			if (isWorkItemActive(work_item->getIdInWavefront()))
 			{
-				work_item->Execute(opcode, instruction.get());
+				work_item->Execute(opcode, instruction);
 			}
 		}
 
@@ -555,7 +571,7 @@ void Wavefront::Execute()
 		}
 
 		// Stats
-		emulator->incVectorAluInstCount();
+		work_group->incVectorAluInstCount();
 		vector_alu_instruction_count++;
 
 		// Execute the instruction
@@ -565,7 +581,7 @@ void Wavefront::Execute()
 			work_item = (*it).get();
 			if (isWorkItemActive(work_item->getIdInWavefront()))
 			{
-				work_item->Execute(opcode, instruction.get());
+				work_item->Execute(opcode, instruction);
 			}
 		}
 
@@ -586,7 +602,7 @@ void Wavefront::Execute()
 		}
 
 		// Stats
-		emulator->incLdsInstCount();
+		work_group->incLdsInstCount();
 		lds_instruction_count++;
 
 		// Record access type
@@ -614,7 +630,7 @@ void Wavefront::Execute()
 			work_item = (*it).get();
 			if (isWorkItemActive(work_item->getIdInWavefront()))
 			{
-				work_item->Execute(opcode, instruction.get());
+				work_item->Execute(opcode, instruction);
 			}
 		}
 
@@ -636,7 +652,7 @@ void Wavefront::Execute()
 		}
 
 		// Stats
-		emulator->incVectorMemInstCount();
+		work_group->incVectorMemInstCount();
 		vector_memory_instruction_count++;
 
 		// Record access type
@@ -660,7 +676,7 @@ void Wavefront::Execute()
 			work_item = (*it).get();
 			if (isWorkItemActive(work_item->getIdInWavefront()))
 			{
-				work_item->Execute(opcode, instruction.get());
+				work_item->Execute(opcode, instruction);
 			}
 		}
 
@@ -681,7 +697,7 @@ void Wavefront::Execute()
 		}
 
 		// Stats
-		emulator->incVectorMemInstCount();
+		work_group->incVectorMemInstCount();
 		vector_memory_instruction_count++;
 
 		// Record access type
@@ -712,7 +728,7 @@ void Wavefront::Execute()
 			work_item = (*it).get();
 			if (isWorkItemActive(work_item->getIdInWavefront()))
 			{
-				work_item->Execute(opcode, instruction.get());
+				work_item->Execute(opcode, instruction);
 			}
 		}
 
@@ -733,7 +749,7 @@ void Wavefront::Execute()
 		}
 
 		// Stats
-		emulator->incExportInstCount();
+		work_group->incExportInstCount();
 		export_instruction_count++;
 
 		// Record access type
@@ -746,7 +762,7 @@ void Wavefront::Execute()
 			work_item = (*it).get();
 			if (isWorkItemActive(work_item->getIdInWavefront()))
 			{
-				work_item->Execute(opcode, instruction.get());
+				work_item->Execute(opcode, instruction);
 			}
 		}
 
@@ -20,6 +20,7 @@
 #ifndef ARCH_SOUTHERN_ISLANDS_EMU_WAVEFRONT_H
 #define ARCH_SOUTHERN_ISLANDS_EMU_WAVEFRONT_H
 
+#include <cassert>
 #include <memory>
 #include <vector>
 
@@ -48,6 +49,13 @@ public:
 /// execute it multiple times.
 class Wavefront
 {
+public:
+
+	/// Maximum number of work-items in a wavefront
+	static const int MaxWorkItems = 64;
+
+private:
+
 	// Global wavefront identifier
 	int id;
 
@@ -66,8 +74,13 @@ class Wavefront
 	// instruction to be executed.
 	unsigned pc = 0;
 
-	// Current instruction
-	std::unique_ptr<Instruction> instruction;
+	// Current instruction, either shared by all wavefronts of the ND-range
+	// or pointing to 'private_instruction'
+	Instruction *instruction = nullptr;
+
+	// Instruction decoded by this wavefront when it is not available in
+	// the ND-range
+	std::unique_ptr<Instruction> private_instruction;
 	int inst_size = 0;
 
 	// Associated scalar work-item
@@ -89,6 +102,11 @@ class Wavefront
 	// Scalar registers
 	Instruction::Register sreg[256];
 
+	// Vector registers, stored as the values of each register for all
+	// work-items of the wavefront, indexed by their identifier within the
+	// wavefront
+	Instruction::Register vreg[256][MaxWorkItems];
+
 	// Associated wavefront pool entry
 	WavefrontPoolEntry *wavefront_pool_entry = nullptr;
 
@@ -126,6 +144,51 @@ class Wavefront
 	// Number of export instructions executed
 	long long export_instruction_count = 0;
 
+	// Return the mask of work-items present in the wavefront and enabled
+	// in the execution mask
+	unsigned long long getActiveMask() const;
+
+	// Return the values of a source operand of a vector ALU instruction
+	// for all work-items. Scalar operands and literal constants are
+	// replicated in 'buffer'. Register reads are counted once per active
+	// work-item, as if each of them read the operand.
+	const Instruction::Register *ReadVectorAluSource(int src,
+			unsigned literal, int num_active,
+			Instruction::Register *buffer);
+
+	// Write the values of a vector register for the work-items in 'mask'
+	void WriteVectorAluResult(int vdst,
+			const Instruction::Register *result,
+			unsigned long long mask, int num_active);
+
+	// Write the bits of VCC for the work-items in 'mask'
+	void WriteVectorAluVcc(unsigned long long vcc,
+			unsigned long long mask, int num_active);
+
+	// Execute a VOP1, VOP2, or VOPC instruction computing the result of
+	// each work-item with 'operation'
+	template<typename Operation> void ExecuteVop1(Instruction *instruction,
+			Operation operation);
+	template<typename Operation> void ExecuteVop2(Instruction *instruction,
+			Operation operation);
+	template<typename Operation> void ExecuteVopc(Instruction *instruction,
+			Operation operation);
+
+	// Execute a VOP2 instruction that also writes a carry bit of each
+	// work-item into VCC, returned by 'operation'
+	template<typename Operation> void ExecuteVop2Carry(
+			Instruction *instruction, Operation operation);
+
+	// Execute instruction V_CNDMASK_B32 in its VOP2 encoding
+	void ExecuteVCndmaskB32(Instruction *instruction);
+
+	// Execute a vector ALU instruction for all active work-items at once.
+	// The return value is false if the instruction has no whole-wavefront
+	// implementation, in which case it must be executed one work-item at a
+	// time.
+	bool ExecuteVectorAlu(Instruction::Opcode opcode,
+			Instruction *instruction);
+
 public:
 
 	/// Constructor
@@ -205,6 +268,15 @@ public:
 	/// Return content in scalar register as unsigned integer
 	unsigned getSregUint(int sreg_id) const;
 
+	/// Return the content of a vector register as an unsigned integer for
+	/// the work-item with the given identifier within the wavefront
+	unsigned getVregUint(int vreg_id, int id_in_wavefront) const
+	{
+		assert(vreg_id >= 0 && vreg_id < 256);
+		assert(id_in_wavefront >= 0 && id_in_wavefront < MaxWorkItems);
+		return vreg[vreg_id][id_in_wavefront].as_uint;
+	}
+
 	/// Return pointer to a workitem inside this wavefront
 	WorkItem *getWorkItem(int id_in_wavefront)
 	{
@@ -231,7 +303,7 @@ public:
 	unsigned getWorkItemCount() const { return work_item_count; }
 
 	/// Get the associated instruction
-	Instruction *getInstruction() const { return instruction.get(); }
+	Instruction *getInstruction() const { return instruction; }
 
 	/// Return true if work-item is active. The work-item identifier is
 	/// given relative to the first work-item in the wavefront
@@ -305,6 +377,15 @@ public:
 	/// Set scalar register as an unsigned int
 	void setSregUint(int id, unsigned int value);
 
+	/// Set the content of a vector register as an unsigned integer for the
+	/// work-item with the given identifier within the wavefront
+	void setVregUint(int vreg_id, int id_in_wavefront, unsigned value)
+	{
+		assert(vreg_id >= 0 && vreg_id < 256);
+		assert(id_in_wavefront >= 0 && id_in_wavefront < MaxWorkItems);
+		vreg[vreg_id][id_in_wavefront].as_uint = value;
+	}
+
 	/// Set the wavefront pool entry associated with the wavefront
 	void setWavefrontPoolEntry(WavefrontPoolEntry *entry)
 	{
@@ -0,0 +1,719 @@
+/*
+ *  Multi2Sim
+ *  Copyright (C) 2015  Rafael Ubal (ubal@ece.neu.edu)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <bitset>
+#include <cmath>
+
+#include <lib/cpp/Misc.h>
+
+#include "Wavefront.h"
+#include "WorkGroup.h"
+
+
+namespace SI
+{
+
+// Macros for instruction format interpretation
+#define INST_VOP1   instruction->getBytes()->vop1
+#define INST_VOP2   instruction->getBytes()->vop2
+#define INST_VOPC   instruction->getBytes()->vopc
+
+
+//
+// The functions in this file execute the most common vector ALU instructions
+// for all work-items of a wavefront at once, on the vector registers stored
+// by the wavefront. Each operation is applied to all 64 values of its
+// operands in a loop that the compiler can vectorize, and the results are
+// merged into the destination under the execution mask. The results and the
+// register access statistics are the same as when each active work-item
+// executes the instruction through WorkItem::Execute().
+//
+
+
+unsigned long long Wavefront::getActiveMask() const
+{
+	// Work-items present in the wavefront
+	unsigned long long mask = work_item_count >= MaxWorkItems ?
+			~0ULL : (1ULL << work_item_count) - 1;
+
+	// Work-items enabled in the execution mask
+	unsigned long long exec =
+			(unsigned long long) sreg[Instruction::RegisterExec + 1].as_uint << 32 |
+			sreg[Instruction::RegisterExec].as_uint;
+	return mask & exec;
+}
+
+
+const Instruction::Register *Wavefront::ReadVectorAluSource(int src,
+		unsigned literal, int num_active,
+		Instruction::Register *buffer)
+{
+	// Vector register
+	if (src >= 256)
+	{
+		work_group->incVregReadCount(num_active);
+		return vreg[src - 256];
+	}
+
+	// Literal constant or scalar register
+	unsigned value;
+	if (src == 0xFF)
+	{
+		value = literal;
+	}
+	else
+	{
+		value = getSregUint(src);
+		work_group->incSregReadCount(num_active - 1);
+	}
+
+	// Replicate it for all work-items
+	for (int i = 0; i < MaxWorkItems; i++)
+		buffer[i].as_uint = value;
+	return buffer;
+}
+
+
+void Wavefront::WriteVectorAluResult(int vdst,
+		const Instruction::Register *result,
+		unsigned long long mask, int num_active)
+{
+	// Expand the mask into one value per work-item
+	unsigned lane_mask[MaxWorkItems];
+	for (int i = 0; i < MaxWorkItems; i++)
+		lane_mask[i] = -(unsigned) ((mask >> i) & 1);
+
+	// Merge results into the destination register
+	Instruction::Register *dst = vreg[vdst];
+	for (int i = 0; i < MaxWorkItems; i++)
+		dst[i].as_uint = (result[i].as_uint & lane_mask[i]) |
+				(dst[i].as_uint & ~lane_mask[i]);
+
+	// Statistics
+	work_group->incVregWriteCount(num_active);
+}
+
+
+void Wavefront::WriteVectorAluVcc(unsigned long long vcc,
+		unsigned long long mask, int num_active)
+{
+	// Merge bits of active work-items
+	unsigned long long old_vcc =
+			(unsigned long long) sreg[Instruction::RegisterVcc + 1].as_uint << 32 |
+			sreg[Instruction::RegisterVcc].as_uint;
+	vcc = (old_vcc & ~mask) | (vcc & mask);
+
+	// Update VCC and VCCZ
+	sreg[Instruction::RegisterVcc].as_uint = vcc;
+	sreg[Instruction::RegisterVcc + 1].as_uint = vcc >> 32;
+	sreg[Instruction::RegisterVccz].as_uint = !vcc;
+
+	// Statistics. Each work-item reads and writes one half of VCC.
+	work_group->incSregReadCount(num_active);
+	work_group->incSregWriteCount(num_active);
+}
+
+
+template<typename Operation>
+void Wavefront::ExecuteVop1(Instruction *instruction, Operation operation)
+{
+	// Active work-items
+	unsigned long long mask = getActiveMask();
+	int num_active = std::bitset<MaxWorkItems>(mask).count();
+	if (!num_active)
+		return;
+
+	// Read operand
+	Instruction::Register buffer[MaxWorkItems];
+	const Instruction::Register *s0 = ReadVectorAluSource(INST_VOP1.src0,
+			INST_VOP1.lit_cnst, num_active, buffer);
+
+	// Compute and write results
+	Instruction::Register result[MaxWorkItems];
+	for (int i = 0; i < MaxWorkItems; i++)
+		operation(result[i], s0[i]);
+	WriteVectorAluResult(INST_VOP1.vdst, result, mask, num_active);
+}
+
+
+template<typename Operation>
+void Wavefront::ExecuteVop2(Instruction *instruction, Operation operation)
+{
+	// Active work-items
+	unsigned long long mask = getActiveMask();
+	int num_active = std::bitset<MaxWorkItems>(mask).count();
+	if (!num_active)
+		return;
+
+	// Read operands
+	Instruction::Register buffer[MaxWorkItems];
+	const Instruction::Register *s0 = ReadVectorAluSource(INST_VOP2.src0,
+			INST_VOP2.lit_cnst, num_active, buffer);
+	const Instruction::Register *s1 = vreg[INST_VOP2.vsrc1];
+	work_group->incVregReadCount(num_active);
+
+	// Compute and write results. The result starts with the current value
+	// of the destination, used by multiply-accumulate instructions.
+	Instruction::Register result[MaxWorkItems];
+	for (int i = 0; i < MaxWorkItems; i++)
+	{
+		result[i] = vreg[INST_VOP2.vdst][i];
+		operation(result[i], s0[i], s1[i]);
+	}
+	WriteVectorAluResult(INST_VOP2.vdst, result, mask, num_active);
+}
+
+
+template<typename Operation>
+void Wavefront::ExecuteVopc(Instruction *instruction, Operation operation)
+{
+	// Active work-items
+	unsigned long long mask = getActiveMask();
+	int num_active = std::bitset<MaxWorkItems>(mask).count();
+	if (!num_active)
+		return;
+
+	// Read operands
+	Instruction::Register buffer[MaxWorkItems];
+	const Instruction::Register *s0 = ReadVectorAluSource(INST_VOPC.src0,
+			INST_VOPC.lit_cnst, num_active, buffer);
+	const Instruction::Register *s1 = vreg[INST_VOPC.vsrc1];
+	work_group->incVregReadCount(num_active);
+
+	// Compare
+	unsigned result[MaxWorkItems];
+	for (int i = 0; i < MaxWorkItems; i++)
+		result[i] = operation(s0[i], s1[i]);
+
+	// Write VCC
+	unsigned long long vcc = 0;
+	for (int i = 0; i < MaxWorkItems; i++)
+		vcc |= (unsigned long long) result[i] << i;
+	WriteVectorAluVcc(vcc, mask, num_active);
+}
+
+
+template<typename Operation>
+void Wavefront::ExecuteVop2Carry(Instruction *instruction, Operation operation)
+{
+	// Active work-items
+	unsigned long long mask = getActiveMask();
+	int num_active = std::bitset<MaxWorkItems>(mask).count();
+	if (!num_active)
+		return;
+
+	// Read operands
+	Instruction::Register buffer[MaxWorkItems];
+	const Instruction::Register *s0 = ReadVectorAluSource(INST_VOP2.src0,
+			INST_VOP2.lit_cnst, num_active, buffer);
+	const Instruction::Register *s1 = vreg[INST_VOP2.vsrc1];
+	work_group->incVregReadCount(num_active);
+
+	// Compute results and carry bits
+	Instruction::Register result[MaxWorkItems];
+	unsigned carry[MaxWorkItems];
+	for (int i = 0; i < MaxWorkItems; i++)
+		carry[i] = operation(result[i], s0[i], s1[i]);
+
+	// Write results and VCC
+	unsigned long long vcc = 0;
+	for (int i = 0; i < MaxWorkItems; i++)
+		vcc |= (unsigned long long) carry[i] << i;
+	WriteVectorAluResult(INST_VOP2.vdst, result, mask, num_active);
+	WriteVectorAluVcc(vcc, mask, num_active);
+}
+
+
+void Wavefront::ExecuteVCndmaskB32(Instruction *instruction)
+{
+	// Active work-items
+	unsigned long long mask = getActiveMask();
+	int num_active = std::bitset<MaxWorkItems>(mask).count();
+	if (!num_active)
+		return;
+
+	// Read operands
+	Instruction::Register buffer[MaxWorkItems];
+	const Instruction::Register *s0 = ReadVectorAluSource(INST_VOP2.src0,
+			INST_VOP2.lit_cnst, num_active, buffer);
+	const Instruction::Register *s1 = vreg[INST_VOP2.vsrc1];
+	work_group->incVregReadCount(num_active);
+
+	// Read VCC, once for each work-item
+	unsigned long long vcc =
+			(unsigned long long) sreg[Instruction::RegisterVcc + 1].as_uint << 32 |
+			sreg[Instruction::RegisterVcc].as_uint;
+	work_group->incSregReadCount(num_active);
+
+	// Select
+	Instruction::Register result[MaxWorkItems];
+	for (int i = 0; i < MaxWorkItems; i++)
+		result[i].as_uint = (vcc >> i) & 1 ? s1[i].as_uint : s0[i].as_uint;
+	WriteVectorAluResult(INST_VOP2.vdst, result, mask, num_active);
+}
+
+
+bool Wavefront::ExecuteVectorAlu(Instruction::Opcode opcode,
+		Instruction *instruction)
+{
+	typedef Instruction::Register Register;
+
+	// Instructions writing VCC for each work-item are executed one
+	// work-item at a time if they also read VCC as a source, since each
+	// work-item sees the bits written by the previous ones.
+	int src0 = instruction->getBytes()->vop2.src0;
+	bool src0_is_vcc = src0 == Instruction::RegisterVcc ||
+			src0 == Instruction::RegisterVcc + 1 ||
+			src0 == Instruction::RegisterVccz;
+
+	switch (opcode)
+	{
+
+	// VOP1
+
+	case Instruction::Opcode_V_MOV_B32:
+
+		ExecuteVop1(instruction, [](Register &d, Register s0)
+		{
+			d.as_uint = s0.as_uint;
+		});
+		return true;
+
+	case Instruction::Opcode_V_CVT_F32_I32:
+
+		ExecuteVop1(instruction, [](Register &d, Register s0)
+		{
+			d.as_float = (float) s0.as_int;
+		});
+		return true;
+
+	case Instruction::Opcode_V_CVT_F32_U32:
+
+		ExecuteVop1(instruction, [](Register &d, Register s0)
+		{
+			d.as_float = (float) s0.as_uint;
+		});
+		return true;
+
+	case Instruction::Opcode_V_RCP_F32:
+
+		ExecuteVop1(instruction, [](Register &d, Register s0)
+		{
+			d.as_float = 1.0f / s0.as_float;
+		});
+		return true;
+
+	case Instruction::Opcode_V_SQRT_F32:
+
+		ExecuteVop1(instruction, [](Register &d, Register s0)
+		{
+			d.as_float = sqrtf(s0.as_float);
+		});
+		return true;
+
+	case Instruction::Opcode_V_NOT_B32:
+
+		ExecuteVop1(instruction, [](Register &d, Register s0)
+		{
+			d.as_uint = ~s0.as_uint;
+		});
+		return true;
+
+	// VOP2
+
+	case Instruction::Opcode_V_CNDMASK_B32:
+
+		ExecuteVCndmaskB32(instruction);
+		return true;
+
+	case Instruction::Opcode_V_ADD_F32:
+
+		ExecuteVop2(instruction, [](Register &d, Register s0, Register s1)
+		{
+			d.as_float = s0.as_float + s1.as_float;
+		});
+		return true;
+
+	case Instruction::Opcode_V_SUB_F32:
+
+		ExecuteVop2(instruction, [](Register &d, Register s0, Register s1)
+		{
+			d.as_float = s0.as_float - s1.as_float;
+		});
+		return true;
+
+	case Instruction::Opcode_V_SUBREV_F32:
+
+		ExecuteVop2(instruction, [](Register &d, Register s0, Register s1)
+		{
+			d.as_float = s1.as_float - s0.as_float;
+		});
+		return true;
+
+	case Instruction::Opcode_V_MUL_LEGACY_F32:
+
+		ExecuteVop2(instruction, [](Register &d, Register s0, Register s1)
+		{
+			d.as_float = s0.as_float == 0.0f || s1.as_float == 0.0f ?
+					0.0f : s0.as_float * s1.as_float;
+		});
+		return true;
+
+	case Instruction::Opcode_V_MUL_F32:
+
+		ExecuteVop2(instruction, [](Register &d, Register s0, Register s1)
+		{
+			d.as_float = s0.as_float * s1.as_float;
+		});
+		return true;
+
+	case Instruction::Opcode_V_MUL_I32_I24:
+
+		ExecuteVop2(instruction, [](Register &d, Register s0, Register s1)
+		{
+			d.as_int = (int) misc::SignExtend32(s0.as_uint, 24) *
+					(int) misc::SignExtend32(s1.as_uint, 24);
+		});
+		return true;
+
+	case Instruction::Opcode_V_MIN_F32:
+
+		ExecuteVop2(instruction, [](Register &d, Register s0, Register s1)
+		{
+			d.as_float = s0.as_float < s1.as_float ?
+					s0.as_float : s1.as_float;
+		});
+		return true;
+
+	case Instruction::Opcode_V_MAX_F32:
+
+		ExecuteVop2(instruction, [](Register &d, Register s0, Register s1)
+		{
+			d.as_float = s0.as_float > s1.as_float ?
+					s0.as_float : s1.as_float;
+		});
+		return true;
+
+	case Instruction::Opcode_V_MIN_I32:
+
+		ExecuteVop2(instruction, [](Register &d, Register s0, Register s1)
+		{
+			d.as_int = s0.as_int < s1.as_int ? s0.as_int : s1.as_int;
+		});
+		return true;
+
+	case Instruction::Opcode_V_MAX_I32:
+
+		ExecuteVop2(instruction, [](Register &d, Register s0, Register s1)
+		{
+			d.as_int = s0.as_int > s1.as_int ? s0.as_int : s1.as_int;
+		});
+		return true;
+
+	case Instruction::Opcode_V_MIN_U32:
+
+		ExecuteVop2(instruction, [](Register &d, Register s0, Register s1)
+		{
+			d.as_uint = s0.as_uint < s1.as_uint ?
+					s0.as_uint : s1.as_uint;
+		});
+		return true;
+
+	case Instruction::Opcode_V_MAX_U32:
+
+		ExecuteVop2(instruction, [](Register &d, Register s0, Register s1)
+		{
+			d.as_uint = s0.as_uint > s1.as_uint ?
+					s0.as_uint : s1.as_uint;
+		});
+		return true;
+
+	case Instruction::Opcode_V_LSHRREV_B32:
+
+		// Literal shift amounts are not masked
+		if (INST_VOP2.src0 == 0xFF)
+			return false;
+		ExecuteVop2(instruction, [](Register &d, Register s0, Register s1)
+		{
+			d.as_uint = s1.as_uint >> (s0.as_uint & 0x1F);
+		});
+		return true;
+
+	case Instruction::Opcode_V_ASHRREV_I32:
+
+		ExecuteVop2(instruction, [](Register &d, Register s0, Register s1)
+		{
+			d.as_int = s1.as_int >> (s0.as_uint & 0x1F);
+		});
+		return true;
+
+	case Instruction::Opcode_V_LSHLREV_B32:
+
+		// Literal shift amounts are not masked
+		if (INST_VOP2.src0 == 0xFF)
+			return false;
+		ExecuteVop2(instruction, [](Register &d, Register s0, Register s1)
+		{
+			d.as_uint = s1.as_uint << (s0.as_uint & 0x1F);
+		});
+		return true;
+
+	case Instruction::Opcode_V_AND_B32:
+
+		ExecuteVop2(instruction, [](Register &d, Register s0, Register s1)
+		{
+			d.as_uint = s0.as_uint & s1.as_uint;
+		});
+		return true;
+
+	case Instruction::Opcode_V_OR_B32:
+
+		ExecuteVop2(instruction, [](Register &d, Register s0, Register s1)
+		{
+			d.as_uint = s0.as_uint | s1.as_uint;
+		});
+		return true;
+
+	case Instruction::Opcode_V_XOR_B32:
+
+		ExecuteVop2(instruction, [](Register &d, Register s0, Register s1)
+		{
+			d.as_uint = s0.as_uint ^ s1.as_uint;
+		});
+		return true;
+
+	case Instruction::Opcode_V_MAC_F32:
+
+		// The destination is also read by each work-item
+		work_group->incVregReadCount(std::bitset<MaxWorkItems>(
+				getActiveMask()).count());
+		ExecuteVop2(instruction, [](Register &d, Register s0, Register s1)
+		{
+			d.as_float = s0.as_float * s1.as_float + d.as_float;
+		});
+		return true;
+
+	case Instruction::Opcode_V_ADD_I32:
+
+		if (src0_is_vcc)
+			return false;
+		ExecuteVop2Carry(instruction, [](Register &d, Register s0,
+				Register s1) -> unsigned
+		{
+			d.as_uint = s0.as_uint + s1.as_uint;
+			return !!(((long long) s0.as_int +
+					(long long) s1.as_int) >> 32);
+		});
+		return true;
+
+	case Instruction::Opcode_V_SUB_I32:
+
+		if (src0_is_vcc)
+			return false;
+		ExecuteVop2Carry(instruction, [](Register &d, Register s0,
+				Register s1) -> unsigned
+		{
+			d.as_uint = s0.as_uint - s1.as_uint;
+			return s1.as_int > s0.as_int;
+		});
+		return true;
+
+	case Instruction::Opcode_V_SUBREV_I32:
+
+		if (src0_is_vcc)
+			return false;
+		ExecuteVop2Carry(instruction, [](Register &d, Register s0,
+				Register s1) -> unsigned
+		{
+			d.as_uint = s1.as_uint - s0.as_uint;
+			return s0.as_int > s1.as_int;
+		});
+		return true;
+
+	// VOPC
+
+	case Instruction::Opcode_V_CMP_LT_F32:
+
+		if (src0_is_vcc)
+			return false;
+		ExecuteVopc(instruction, [](Register s0, Register s1)
+		{
+			return s0.as_float < s1.as_float;
+		});
+		return true;
+
+	case Instruction::Opcode_V_CMP_GT_F32:
+
+		if (src0_is_vcc)
+			return false;
+		ExecuteVopc(instruction, [](Register s0, Register s1)
+		{
+			return s0.as_float > s1.as_float;
+		});
+		return true;
+
+	case Instruction::Opcode_V_CMP_GE_F32:
+
+		if (src0_is_vcc)
+			return false;
+		ExecuteVopc(instruction, [](Register s0, Register s1)
+		{
+			return s0.as_float >= s1.as_float;
+		});
+		return true;
+
+	case Instruction::Opcode_V_CMP_NGT_F32:
+
+		if (src0_is_vcc)
+			return false;
+		ExecuteVopc(instruction, [](Register s0, Register s1)
+		{
+			return !(s0.as_float > s1.as_float);
+		});
+		return true;
+
+	case Instruction::Opcode_V_CMP_NEQ_F32:
+
+		if (src0_is_vcc)
+			return false;
+		ExecuteVopc(instruction, [](Register s0, Register s1)
+		{
+			return !(s0.as_float == s1.as_float);
+		});
+		return true;
+
+	case Instruction::Opcode_V_CMP_LT_I32:
+
+		if (src0_is_vcc)
+			return false;
+		ExecuteVopc(instruction, [](Register s0, Register s1)
+		{
+			return s0.as_int < s1.as_int;
+		});
+		return true;
+
+	case Instruction::Opcode_V_CMP_EQ_I32:
+
+		if (src0_is_vcc)
+			return false;
+		ExecuteVopc(instruction, [](Register s0, Register s1)
+		{
+			return s0.as_int == s1.as_int;
+		});
+		return true;
+
+	case Instruction::Opcode_V_CMP_LE_I32:
+
+		if (src0_is_vcc)
+			return false;
+		ExecuteVopc(instruction, [](Register s0, Register s1)
+		{
+			return s0.as_int <= s1.as_int;
+		});
+		return true;
+
+	case Instruction::Opcode_V_CMP_GT_I32:
+
+		if (src0_is_vcc)
+			return false;
+		ExecuteVopc(instruction, [](Register s0, Register s1)
+		{
+			return s0.as_int > s1.as_int;
+		});
+		return true;
+
+	case Instruction::Opcode_V_CMP_NE_I32:
+
+		if (src0_is_vcc)
+			return false;
+		ExecuteVopc(instruction, [](Register s0, Register s1)
+		{
+			return s0.as_int != s1.as_int;
+		});
+		return true;
+
+	case Instruction::Opcode_V_CMP_GE_I32:
+
+		if (src0_is_vcc)
+			return false;
+		ExecuteVopc(instruction, [](Register s0, Register s1)
+		{
+			return s0.as_int >= s1.as_int;
+		});
+		return true;
+
+	case Instruction::Opcode_V_CMP_LT_U32:
+
+		if (src0_is_vcc)
+			return false;
+		ExecuteVopc(instruction, [](Register s0, Register s1)
+		{
+			return s0.as_uint < s1.as_uint;
+		});
+		return true;
+
+	case Instruction::Opcode_V_CMP_LE_U32:
+
+		if (src0_is_vcc)
+			return false;
+		ExecuteVopc(instruction, [](Register s0, Register s1)
+		{
+			return s0.as_uint <= s1.as_uint;
+		});
+		return true;
+
+	case Instruction::Opcode_V_CMP_GT_U32:
+
+		if (src0_is_vcc)
+			return false;
+		ExecuteVopc(instruction, [](Register s0, Register s1)
+		{
+			return s0.as_uint > s1.as_uint;
+		});
+		return true;
+
+	case Instruction::Opcode_V_CMP_NE_U32:
+
+		if (src0_is_vcc)
+			return false;
+		ExecuteVopc(instruction, [](Register s0, Register s1)
+		{
+			return s0.as_uint != s1.as_uint;
+		});
+		return true;
+
+	case Instruction::Opcode_V_CMP_GE_U32:
+
+		if (src0_is_vcc)
+			return false;
+		ExecuteVopc(instruction, [](Register s0, Register s1)
+		{
+			return s0.as_uint >= s1.as_uint;
+		});
+		return true;
+
+	default:
+
+		// Executed one work-item at a time
+		return false;
+	}
+}
+
+
+}  // namespace SI
@@ -28,7 +28,7 @@ namespace SI
 {
 
 // Private constant declaring wavefront size
-const unsigned WorkGroup::WavefrontSize = 64;
+const unsigned WorkGroup::WavefrontSize = Wavefront::MaxWorkItems;
 
 
 WorkGroup::WorkGroup(NDRange *ndrange, unsigned id)
@@ -350,5 +350,101 @@ WorkGroup::WorkGroup(NDRange *ndrange, unsigned id)
 	// Statistics 
 	ndrange->getEmulator()->incWorkGroupCount();
 }
+
+
+void WorkGroup::FlushStatistics()
+{
+	Emulator *emulator = ndrange->getEmulator();
+	emulator->addNumInstructions(num_instructions);
+	emulator->num_scalar_alu_instructions += num_scalar_alu_instructions;
+	emulator->num_scalar_memory_instructions +=
+			num_scalar_memory_instructions;
+	emulator->num_branch_instructions += num_branch_instructions;
+	emulator->num_vector_alu_instructions += num_vector_alu_instructions;
+	emulator->num_lds_instructions += num_lds_instructions;
+	emulator->num_vector_memory_instructions +=
+			num_vector_memory_instructions;
+	emulator->num_export_instructions += num_export_instructions;
+	num_instructions = 0;
+	num_scalar_alu_instructions = 0;
+	num_scalar_memory_instructions = 0;
+	num_branch_instructions = 0;
+	num_vector_alu_instructions = 0;
+	num_lds_instructions = 0;
+	num_vector_memory_instructions = 0;
+	num_export_instructions = 0;
+}
+
+
+void WorkGroup::incNumInstructions()
+{
+	if (private_statistics)
+		num_instructions++;
+	else
+		ndrange->getEmulator()->incNumInstructions();
+}
+
+
+void WorkGroup::incScalarAluInstCount()
+{
+	if (private_statistics)
+		num_scalar_alu_instructions++;
+	else
+		ndrange->getEmulator()->incScalarAluInstCount();
+}
+
+
+void WorkGroup::incScalarMemInstCount()
+{
+	if (private_statistics)
+		num_scalar_memory_instructions++;
+	else
+		ndrange->getEmulator()->incScalarMemInstCount();
+}
+
+
+void WorkGroup::incBranchInstCount()
+{
+	if (private_statistics)
+		num_branch_instructions++;
+	else
+		ndrange->getEmulator()->incBranchInstCount();
+}
+
+
+void WorkGroup::incVectorAluInstCount()
+{
+	if (private_statistics)
+		num_vector_alu_instructions++;
+	else
+		ndrange->getEmulator()->incVectorAluInstCount();
+}
+
+
+void WorkGroup::incLdsInstCount()
+{
+	if (private_statistics)
+		num_lds_instructions++;
+	else
+		ndrange->getEmulator()->incLdsInstCount();
+}
+
+
+void WorkGroup::incVectorMemInstCount()
+{
+	if (private_statistics)
+		num_vector_memory_instructions++;
+	else
+		ndrange->getEmulator()->incVectorMemInstCount();
+}
+
+
+void WorkGroup::incExportInstCount()
+{
+	if (private_statistics)
+		num_export_instructions++;
+	else
+		ndrange->getEmulator()->incExportInstCount();
+}
 	
 }  // namespace SI
@@ -103,6 +103,22 @@ class WorkGroup
 	// Number of vectorr registers being written to
 	long long vreg_write_count = 0;
 
+	// Flag indicating that the work-group is emulated on a host worker
+	// thread. Instruction statistics are then gathered in the work-group
+	// instead of the emulator, and added to the emulator by
+	// FlushStatistics().
+	bool private_statistics = false;
+
+	// Instruction statistics gathered in the work-group
+	long long num_instructions = 0;
+	long long num_scalar_alu_instructions = 0;
+	long long num_scalar_memory_instructions = 0;
+	long long num_branch_instructions = 0;
+	long long num_vector_alu_instructions = 0;
+	long long num_lds_instructions = 0;
+	long long num_vector_memory_instructions = 0;
+	long long num_export_instructions = 0;
+
 public:
 
 	/// Constructor
@@ -232,17 +248,53 @@ public:
 	/// Increase wavefronts_completed_emu counter
 	void incWavefrontsCompletedTiming() { wavefronts_completed_timing++; }
 
-	/// Increase scalar register read counter
-	void incSregReadCount() { sreg_read_count++; }
+	/// Increase scalar register read counter by the given number of accesses
+	void incSregReadCount(long long count = 1) { sreg_read_count += count; }
+
+	/// Increase scalar register write counter by the given number of accesses
+	void incSregWriteCount(long long count = 1) { sreg_write_count += count; }
+
+	/// Increase vector register read counter by the given number of accesses
+	void incVregReadCount(long long count = 1) { vreg_read_count += count; }
+
+	/// Increase vector register write counter by the given number of accesses
+	void incVregWriteCount(long long count = 1) { vreg_write_count += count; }
+
+	/// Gather instruction statistics in the work-group instead of the
+	/// emulator, so that the work-group can be emulated on a host worker
+	/// thread
+	void setPrivateStatistics(bool private_statistics)
+	{
+		this->private_statistics = private_statistics;
+	}
+
+	/// Add the instruction statistics gathered in the work-group to the
+	/// emulator and reset them
+	void FlushStatistics();
+
+	/// Count an instruction executed by a wavefront of the work-group
+	void incNumInstructions();
+
+	/// Count a scalar ALU instruction
+	void incScalarAluInstCount();
+
+	/// Count a scalar memory instruction
+	void incScalarMemInstCount();
+
+	/// Count a branch instruction
+	void incBranchInstCount();
+
+	/// Count a vector ALU instruction
+	void incVectorAluInstCount();
 
-	/// Increase scalar register write counter
-	void incSregWriteCount() { sreg_write_count++; }
+	/// Count an LDS instruction
+	void incLdsInstCount();
 
-	/// Increase vector register read counter
-	void incVregReadCount() { vreg_read_count++; }
+	/// Count a vector memory instruction
+	void incVectorMemInstCount();
 
-	/// Increase vector register write counter
-	void incVregWriteCount() { vreg_write_count++; }
+	/// Count an export instruction
+	void incExportInstCount();
 
 	/// Set wavefront_at_barrier counter
 	void setWavefrontsAtBarrier(unsigned counter)
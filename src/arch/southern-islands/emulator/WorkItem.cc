@@ -281,7 +281,7 @@ unsigned WorkItem::ReadVReg(int vreg)
 	// Statistics
 	work_group->incVregReadCount();
 
-	return this->vreg[vreg].as_uint;
+	return wavefront->getVregUint(vreg, id_in_wavefront);
 }
 
 
@@ -290,7 +290,7 @@ void WorkItem::WriteVReg(int vreg,
 {
 	assert(vreg >= 0);
 	assert(vreg < 256);
-	this->vreg[vreg].as_uint = value;
+	wavefront->setVregUint(vreg, id_in_wavefront, value);
 
 	// Statistics
 	work_group->incVregWriteCount();
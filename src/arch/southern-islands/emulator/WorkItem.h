@@ -193,9 +193,6 @@ private:
 	// Local memory
 	mem::Memory *lds = nullptr;
 
-	// Vector registers
-	Instruction::Register vreg[256];
-
 	// Emulation of ISA. This code expands to one function per ISA
 	// instruction. For example: ISA_s_mov_b32_Impl(Instruction *inst)
 #define DEFINST(_name, _fmt_str, _fmt, _opcode, _size, _flags) \
@@ -388,7 +385,8 @@ public:
 	///
 	void WriteSReg(int sreg, unsigned value);
 
-	/// Get value of a vector register
+	/// Get value of a vector register. Vector registers are stored in the
+	/// wavefront for all of its work-items.
 	///
 	/// \param vreg Vector register identifier
 	///
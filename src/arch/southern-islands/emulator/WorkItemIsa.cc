@@ -20,6 +20,7 @@
 #include <cassert>
 #include <limits>
 #include <cmath>
+#include <mutex>
 #include <lib/cpp/Misc.h>
 
 #include "Emulator.h"
@@ -7399,6 +7400,11 @@ void WorkItem::ISA_BUFFER_ATOMIC_ADD_Impl(Instruction *instruction)
 	unsigned addr = base + mem_offset + inst_offset + off_vgpr + 
 		stride * (idx_vgpr + id_in_wavefront);
 
+	// Global atomics of work-groups emulated on different host threads
+	// are serialized
+	std::lock_guard<std::mutex> lock(work_group->getNDRange()->
+			getEmulator()->getAtomicMutex());
+
 	// Read existing value from global memory
 	
 	global_mem->Read(addr, bytes_to_read, prev_value.as_byte);
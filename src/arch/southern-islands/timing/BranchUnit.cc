@@ -73,9 +73,8 @@ void BranchUnit::Issue(std::unique_ptr<Uop> uop)
 
 void BranchUnit::Complete()
 {
-	// Get compute unit and GPU objects
+	// Get compute unit
 	ComputeUnit *compute_unit = getComputeUnit();
-	Gpu *gpu = compute_unit->getGpu();
 
 	// Sanity check the write buffer
 	assert((int) write_buffer.size() <= write_latency * width);
@@ -111,7 +110,8 @@ void BranchUnit::Complete()
 
 		// Statistics
 		num_instructions++;
-		gpu->last_complete_cycle = compute_unit->getTiming()->getCycle();
+		compute_unit->last_complete_cycle = compute_unit->getTiming()->
+				getCycle();
 	}
 }
 
@@ -17,6 +17,8 @@
  *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  */
 
+#include <algorithm>
+
 #include <arch/southern-islands/disassembler/Instruction.h>
 #include <arch/southern-islands/emulator/Emulator.h>
 #include <arch/southern-islands/emulator/NDRange.h>
@@ -46,11 +48,41 @@ int ComputeUnit::lds_alloc_size = 64;
 int ComputeUnit::lds_latency = 2;                                                      
 int ComputeUnit::lds_block_size = 64;                                                  
 int ComputeUnit::lds_num_ports = 2; 
+ComputeUnit::SchedulingPolicy ComputeUnit::default_scheduling_policy =
+		SchedulingPolicyFixed;
+std::vector<ComputeUnit::SchedulingPolicy> ComputeUnit::scheduling_policies;
+int ComputeUnit::max_active_wavefronts = 4;
+
+misc::StringMap ComputeUnit::scheduling_policy_map =
+{
+	{ "Fixed", SchedulingPolicyFixed },
+	{ "LooseRoundRobin", SchedulingPolicyLooseRoundRobin },
+	{ "GreedyThenOldest", SchedulingPolicyGreedyThenOldest },
+	{ "TwoLevel", SchedulingPolicyTwoLevel },
+	{ "MemoryAware", SchedulingPolicyMemoryAware }
+};
+
+const misc::StringMap ComputeUnit::wavefront_state_map =
+{
+	{ "Issued", WavefrontStateIssued },
+	{ "ExecutionUnitBusy", WavefrontStateExecutionUnitBusy },
+	{ "FetchBufferEmpty", WavefrontStateFetchBufferEmpty },
+	{ "InFlight", WavefrontStateInFlight },
+	{ "VectorMemory", WavefrontStateVectorMemory },
+	{ "ScalarMemory", WavefrontStateScalarMemory },
+	{ "LDS", WavefrontStateLds },
+	{ "Barrier", WavefrontStateBarrier },
+	{ "Finished", WavefrontStateFinished },
+	{ "NoWavefront", WavefrontStateNoWavefront }
+};
 	
 
 ComputeUnit::ComputeUnit(int index, Gpu *gpu) :
 		gpu(gpu),
 		index(index),
+		scheduling_policy(index < (int) scheduling_policies.size() ?
+				scheduling_policies[index] :
+				default_scheduling_policy),
 		scalar_unit(this),
 		branch_unit(this),
 		lds_unit(this),
@@ -74,6 +106,7 @@ ComputeUnit::ComputeUnit(int index, Gpu *gpu) :
 		fetch_buffers[i] = misc::new_unique<FetchBuffer>(i, this);
 		simd_units[i] = misc::new_unique<SimdUnit>(this);
 	}
+	fetch_buffer_states.resize(max_wavefronts_per_wavefront_pool);
 }
 
 
@@ -89,8 +122,8 @@ void ComputeUnit::IssueToExecutionUnit(FetchBuffer *fetch_buffer,
 		if (!execution_unit->canIssue())
 			break;
 
-		// Find oldest uop
-		auto oldest_uop_iterator = fetch_buffer->end();
+		// Find the uop preferred by the scheduling policy
+		auto preferred_uop_iterator = fetch_buffer->end();
 		for (auto it = fetch_buffer->begin(),
 				e = fetch_buffer->end();
 				it != e;
@@ -106,25 +139,30 @@ void ComputeUnit::IssueToExecutionUnit(FetchBuffer *fetch_buffer,
 			if (timing->getCycle() < uop->fetch_ready)
 				continue;
 
-			// Save oldest uop
-			if (oldest_uop_iterator == fetch_buffer->end() ||
-					uop->getWavefront()->getId() <
-					(*oldest_uop_iterator)->getWavefront()->getId())
-				oldest_uop_iterator = it;
+			// Save preferred uop
+			if (preferred_uop_iterator == fetch_buffer->end() ||
+					isPreferredUop(uop,
+					preferred_uop_iterator->get(),
+					fetch_buffer))
+				preferred_uop_iterator = it;
 		}
 
 		// Stop if no instruction found
-		if (oldest_uop_iterator == fetch_buffer->end())
+		if (preferred_uop_iterator == fetch_buffer->end())
 			break;
 
-		Uop *uop = oldest_uop_iterator->get();
+		Uop *uop = preferred_uop_iterator->get();
 		long long compute_unit_id = uop->getIdInComputeUnit();
 		int wavefront_id = uop->getWavefront()->getId();
 		long long id_in_wavefront = uop->getIdInWavefront();
 
+		// Record the wavefront for the scheduling policy
+		fetch_buffer->setLastIssuedWavefrontId(wavefront_id);
+		uop->getWavefrontPoolEntry()->issue_cycle = timing->getCycle();
+
 		// Erase from fetch buffer, issue to execution unit
-		execution_unit->Issue(std::move(*oldest_uop_iterator));
-		fetch_buffer->Remove(oldest_uop_iterator);
+		execution_unit->Issue(std::move(*preferred_uop_iterator));
+		fetch_buffer->Remove(preferred_uop_iterator);
 
 		// Trace
 		Timing::trace << misc::fmt("si.inst "
@@ -172,6 +210,9 @@ void ComputeUnit::Issue(FetchBuffer *fetch_buffer)
 		if (timing->getCycle() < uop->fetch_ready)
 			continue;
 
+		// Statistics
+		num_issue_stalls++;
+
 		// Trace
 		Timing::trace << misc::fmt("si.inst "
 				"id=%lld "
@@ -187,6 +228,296 @@ void ComputeUnit::Issue(FetchBuffer *fetch_buffer)
 }
 
 
+bool ComputeUnit::isPreferredUop(Uop *uop, Uop *other,
+		FetchBuffer *fetch_buffer)
+{
+	// Uops of the same wavefront are issued in program order, and
+	// wavefronts are otherwise issued oldest first
+	int id = uop->getWavefront()->getId();
+	int other_id = other->getWavefront()->getId();
+	int last_id = fetch_buffer->getLastIssuedWavefrontId();
+	switch (scheduling_policy)
+	{
+
+	case SchedulingPolicyLooseRoundRobin:
+	case SchedulingPolicyTwoLevel:
+
+		// Wavefronts following the last one issued go first
+		if ((id > last_id) != (other_id > last_id))
+			return id > last_id;
+		return id < other_id;
+
+	case SchedulingPolicyGreedyThenOldest:
+
+		// The last wavefront issued goes first
+		if ((id == last_id) != (other_id == last_id))
+			return id == last_id;
+		return id < other_id;
+
+	case SchedulingPolicyMemoryAware:
+	{
+		// Wavefronts without outstanding vector memory accesses go
+		// first
+		bool waiting = uop->getWavefrontPoolEntry()->vm_cnt > 0;
+		bool other_waiting = other->getWavefrontPoolEntry()->vm_cnt > 0;
+		if (waiting != other_waiting)
+			return !waiting;
+		return id < other_id;
+	}
+
+	default:
+
+		return id < other_id;
+	}
+}
+
+
+void ComputeUnit::SortFetchCandidates(WavefrontPool *wavefront_pool,
+		std::vector<WavefrontPoolEntry *> &candidates)
+{
+	// Position of an entry in the round-robin order, starting after the
+	// last entry fetched from
+	int num_entries = wavefront_pool->getNumEntries();
+	int last_entry = wavefront_pool->getLastFetchedEntry();
+	auto round_robin_position = [num_entries, last_entry]
+			(WavefrontPoolEntry *entry)
+	{
+		return (entry->getIdInWavefrontPool() - last_entry - 1 +
+				num_entries) % num_entries;
+	};
+
+	switch (scheduling_policy)
+	{
+
+	case SchedulingPolicyLooseRoundRobin:
+	case SchedulingPolicyTwoLevel:
+
+		std::sort(candidates.begin(), candidates.end(),
+				[&](WavefrontPoolEntry *a, WavefrontPoolEntry *b)
+				{
+					return round_robin_position(a) <
+							round_robin_position(b);
+				});
+		break;
+
+	case SchedulingPolicyGreedyThenOldest:
+
+		// The last entry fetched from goes first, followed by the
+		// oldest wavefronts
+		std::sort(candidates.begin(), candidates.end(),
+				[last_entry](WavefrontPoolEntry *a,
+				WavefrontPoolEntry *b)
+				{
+					bool greedy_a = a->getIdInWavefrontPool() ==
+							last_entry;
+					bool greedy_b = b->getIdInWavefrontPool() ==
+							last_entry;
+					if (greedy_a != greedy_b)
+						return greedy_a;
+					return a->getWavefront()->getId() <
+							b->getWavefront()->getId();
+				});
+		break;
+
+	case SchedulingPolicyMemoryAware:
+
+		// Wavefronts without outstanding vector memory accesses go
+		// first, oldest first
+		std::sort(candidates.begin(), candidates.end(),
+				[](WavefrontPoolEntry *a, WavefrontPoolEntry *b)
+				{
+					bool waiting_a = a->vm_cnt > 0;
+					bool waiting_b = b->vm_cnt > 0;
+					if (waiting_a != waiting_b)
+						return !waiting_a;
+					return a->getWavefront()->getId() <
+							b->getWavefront()->getId();
+				});
+		break;
+
+	default:
+
+		// Fixed order of the wavefront pool entries
+		break;
+	}
+}
+
+
+void ComputeUnit::UpdateActiveWavefronts(WavefrontPool *wavefront_pool)
+{
+	// A wavefront can be active if it can still fetch instructions
+	// without waiting for a long-latency event
+	auto can_be_active = [](WavefrontPoolEntry *entry)
+	{
+		Wavefront *wavefront = entry->getWavefront();
+		return wavefront && !entry->wavefront_finished &&
+				!wavefront->getFinished() &&
+				!entry->isWaitingForMemory() &&
+				!entry->wait_for_barrier;
+	};
+
+	// Demote active wavefronts, and collect pending ones
+	int num_active = 0;
+	std::vector<WavefrontPoolEntry *> &pending = fetch_candidates;
+	pending.clear();
+	for (auto &entry : *wavefront_pool)
+	{
+		if (!can_be_active(entry.get()))
+			entry->active = false;
+		else if (entry->active)
+			num_active++;
+		else
+			pending.push_back(entry.get());
+	}
+
+	// Promote the oldest pending wavefronts
+	if (num_active >= max_active_wavefronts || pending.empty())
+		return;
+	std::sort(pending.begin(), pending.end(),
+			[](WavefrontPoolEntry *a, WavefrontPoolEntry *b)
+			{
+				return a->getWavefront()->getId() <
+						b->getWavefront()->getId();
+			});
+	for (WavefrontPoolEntry *entry : pending)
+	{
+		if (num_active == max_active_wavefronts)
+			break;
+		entry->active = true;
+		num_active++;
+	}
+}
+
+
+bool ComputeUnit::isGlobalMemoryInstruction(Wavefront *wavefront)
+{
+	// Instructions not decoded in advance are assumed to access global
+	// memory
+	Instruction *instruction = wavefront->getWorkGroup()->getNDRange()->
+			getInstruction(wavefront->getPC());
+	if (!instruction)
+		return true;
+
+	// Scalar and vector memory instructions, and exports
+	switch (instruction->getFormat())
+	{
+	case Instruction::FormatSMRD:
+	case Instruction::FormatMUBUF:
+	case Instruction::FormatMTBUF:
+	case Instruction::FormatMIMG:
+	case Instruction::FormatEXP:
+		return true;
+
+	default:
+		return false;
+	}
+}
+
+
+void ComputeUnit::Emulate(Uop *uop)
+{
+	// Emulate the instruction. The work-group gathers its own
+	// statistics, added to the emulator as a shared operation.
+	Wavefront *wavefront = uop->getWavefront();
+	WorkGroup *work_group = uop->getWorkGroup();
+	wavefront->Execute();
+	RunShared([work_group]
+	{
+		work_group->FlushStatistics();
+	});
+
+	// Properties of the instruction
+	uop->vector_memory_read = wavefront->vector_memory_read;
+	uop->vector_memory_write = wavefront->vector_memory_write;
+	uop->vector_memory_atomic = wavefront->vector_memory_atomic;
+	uop->scalar_memory_read = wavefront->scalar_memory_read;
+	uop->lds_read = wavefront->lds_read;
+	uop->lds_write = wavefront->lds_write;
+	uop->wavefront_last_instruction = wavefront->finished;
+	uop->memory_wait = wavefront->memory_wait;
+	uop->at_barrier = wavefront->isBarrierInstruction();
+	uop->setInstruction(wavefront->getInstruction());
+	uop->vector_memory_global_coherency =
+			wavefront->vector_memory_global_coherency;
+
+	// Checks
+	assert(wavefront->getWorkGroup() && uop->getWorkGroup());
+
+	// Convert instruction name to string
+	if (Timing::trace || Timing::pipeline_debug)
+	{
+		std::string instruction_name = wavefront->
+				getInstruction()->getName();
+		misc::StringSingleSpaces(instruction_name);
+
+		// Trace
+		Timing::trace << misc::fmt("si.new_inst "
+				"id=%lld "
+				"cu=%d "
+				"ib=%d "
+				"wf=%d "
+				"uop_id=%lld "
+				"stg=\"f\" "
+				"asm=\"%s\"\n",
+				uop->getIdInComputeUnit(),
+				index,
+				uop->getWavefrontPoolId(),
+				uop->getWavefront()->getId(),
+				uop->getIdInWavefront(),
+				instruction_name.c_str());
+
+		// Debug
+		Timing::pipeline_debug << misc::fmt(
+				"wg=%d/wf=%d cu=%d wfPool=%d "
+				"inst=%lld asm=%s id_in_wf=%lld\n"
+				"\tinst=%lld (Fetch)\n",
+				uop->getWavefront()->getWorkGroup()->
+				getId(),
+				uop->getWavefront()->getId(),
+				index,
+				uop->getWavefrontPoolId(),
+				uop->getId(),
+				instruction_name.c_str(),
+				uop->getIdInWavefront(),
+				uop->getId());
+	}
+
+	// Update last memory accesses
+	for (auto it = wavefront->getWorkItemsBegin(),
+			e = wavefront->getWorkItemsEnd();
+			it != e;
+			++it)
+	{
+		// Get work item
+		WorkItem *work_item = it->get();
+
+		// Get uop work item info
+		Uop::WorkItemInfo *work_item_info;
+		work_item_info =
+			&uop->work_item_info_list[work_item->getIdInWavefront()];
+
+		// Global memory
+		work_item_info->global_memory_access_address =
+				work_item->global_memory_access_address;
+		work_item_info->global_memory_access_size =
+				work_item->global_memory_access_size;
+
+		// LDS
+		work_item_info->lds_access_count =
+			work_item->lds_access_count;
+		for (int j = 0; j < work_item->lds_access_count; j++)
+		{
+			work_item_info->lds_access[j].type =
+				work_item->lds_access[j].type;
+			work_item_info->lds_access[j].addr =
+				work_item->lds_access[j].addr;
+			work_item_info->lds_access[j].size =
+				work_item->lds_access[j].size;
+		}
+	}
+}
+
+
 void ComputeUnit::Fetch(FetchBuffer *fetch_buffer,
 		WavefrontPool *wavefront_pool)
 {
@@ -195,10 +526,12 @@ void ComputeUnit::Fetch(FetchBuffer *fetch_buffer,
 	assert(wavefront_pool);
 	assert(fetch_buffer->getId() == wavefront_pool->getId());
 
-	// Set up variables
-	int instructions_processed = 0;
+	// Update the active set of the two-level scheduling policy
+	if (scheduling_policy == SchedulingPolicyTwoLevel)
+		UpdateActiveWavefronts(wavefront_pool);
 
-	// Fetch the instructions
+	// Find the wavefronts that an instruction can be fetched from
+	fetch_candidates.clear();
 	for (auto it = wavefront_pool->begin(),
 			e = wavefront_pool->end();
 			it != e;
@@ -228,10 +561,6 @@ void ComputeUnit::Fetch(FetchBuffer *fetch_buffer,
 			continue;
 		}
 
-		// Only fetch a fixed number of instructions per cycle
-		if (instructions_processed == fetch_width)
-			continue;
-
 		// Wavefront is not ready (previous instructions is still
 		// in flight
 		if (!wavefront_pool_entry->ready)
@@ -283,21 +612,56 @@ void ComputeUnit::Fetch(FetchBuffer *fetch_buffer,
 						wavefront->getWorkGroup()->
 						getId(),
 						wavefront->getId());
+				num_memory_stalls++;
 				continue;
 			}
 		}
 
 		// Wavefront is ready but waiting at barrier
 		if (wavefront_pool_entry->wait_for_barrier)
+		{
+			num_barrier_stalls++;
+			continue;
+		}
+
+		// Wavefront is pending in the two-level scheduling policy
+		if (scheduling_policy == SchedulingPolicyTwoLevel &&
+				!wavefront_pool_entry->active)
+		{
+			num_pending_stalls++;
+			continue;
+		}
+
+		// Candidate for fetch
+		fetch_candidates.push_back(wavefront_pool_entry);
+	}
+
+	// Order the candidates as per the scheduling policy
+	SortFetchCandidates(wavefront_pool, fetch_candidates);
+
+	// Fetch the instructions
+	int instructions_processed = 0;
+	for (WavefrontPoolEntry *wavefront_pool_entry : fetch_candidates)
+	{
+		// Only fetch a fixed number of instructions per cycle
+		if (instructions_processed == fetch_width)
+		{
+			num_scheduler_stalls++;
 			continue;
+		}
 
 		// Stall if fetch buffer is full
 		assert(fetch_buffer->getSize() <= fetch_buffer_size);
 		if (fetch_buffer->getSize() == fetch_buffer_size)
+		{
+			num_fetch_buffer_stalls++;
 			continue;
+		}
 
-		// Emulate instructions
-		wavefront->Execute();
+		// Record the entry for the scheduling policy
+		Wavefront *wavefront = wavefront_pool_entry->getWavefront();
+		wavefront_pool->setLastFetchedEntry(
+				wavefront_pool_entry->getIdInWavefrontPool());
 		wavefront_pool_entry->ready = false;
 
 		// Create uop
@@ -307,94 +671,14 @@ void ComputeUnit::Fetch(FetchBuffer *fetch_buffer,
 				timing->getCycle(),
 				wavefront->getWorkGroup(),
 				fetch_buffer->getId());
-		uop->vector_memory_read = wavefront->vector_memory_read;
-		uop->vector_memory_write = wavefront->vector_memory_write;
-		uop->vector_memory_atomic = wavefront->vector_memory_atomic;
-		uop->scalar_memory_read = wavefront->scalar_memory_read;
-		uop->lds_read = wavefront->lds_read;
-		uop->lds_write = wavefront->lds_write;
-		uop->wavefront_last_instruction = wavefront->finished;
-		uop->memory_wait = wavefront->memory_wait;
-		uop->at_barrier = wavefront->isBarrierInstruction();
-		uop->setInstruction(wavefront->getInstruction());
-		uop->vector_memory_global_coherency =
-				wavefront->vector_memory_global_coherency;
-
-		// Checks
-		assert(wavefront->getWorkGroup() && uop->getWorkGroup());
-
-		// Convert instruction name to string
-		if (Timing::trace || Timing::pipeline_debug)
-		{
-			std::string instruction_name = wavefront->
-					getInstruction()->getName();
-			misc::StringSingleSpaces(instruction_name);
-
-			// Trace
-			Timing::trace << misc::fmt("si.new_inst "
-					"id=%lld "
-					"cu=%d "
-					"ib=%d "
-					"wf=%d "
-					"uop_id=%lld "
-					"stg=\"f\" "
-					"asm=\"%s\"\n",
-					uop->getIdInComputeUnit(),
-					index,
-					uop->getWavefrontPoolId(),
-					uop->getWavefront()->getId(),
-					uop->getIdInWavefront(),
-					instruction_name.c_str());
-
-			// Debug
-			Timing::pipeline_debug << misc::fmt(
-					"wg=%d/wf=%d cu=%d wfPool=%d "
-					"inst=%lld asm=%s id_in_wf=%lld\n"
-					"\tinst=%lld (Fetch)\n",
-					uop->getWavefront()->getWorkGroup()->
-					getId(),
-					uop->getWavefront()->getId(),
-					index,
-					uop->getWavefrontPoolId(),
-					uop->getId(),
-					instruction_name.c_str(),
-					uop->getIdInWavefront(),
-					uop->getId());
-		}
 
-		// Update last memory accesses
-		for (auto it = wavefront->getWorkItemsBegin(),
-				e = wavefront->getWorkItemsEnd();
-				it != e;
-				++it)
-		{
-			// Get work item
-			WorkItem *work_item = it->get();
-
-			// Get uop work item info
-			Uop::WorkItemInfo *work_item_info;
-			work_item_info =
-				&uop->work_item_info_list[work_item->getIdInWavefront()];
-
-			// Global memory
-			work_item_info->global_memory_access_address =
-					work_item->global_memory_access_address;
-			work_item_info->global_memory_access_size =
-					work_item->global_memory_access_size;
-
-			// LDS
-			work_item_info->lds_access_count =
-				work_item->lds_access_count;
-			for (int j = 0; j < work_item->lds_access_count; j++)
-			{
-				work_item_info->lds_access[j].type =
-					work_item->lds_access[j].type;
-				work_item_info->lds_access[j].addr =
-					work_item->lds_access[j].addr;
-				work_item_info->lds_access[j].size =
-					work_item->lds_access[j].size;
-			}
-		}
+		// Emulate the instruction. While compute units run in
+		// parallel, only instructions accessing global memory are
+		// emulated now, in the same order as in sequential mode.
+		if (defer_emulation && !isGlobalMemoryInstruction(wavefront))
+			deferred_uops.push_back(uop.get());
+		else
+			Emulate(uop.get());
 
 		// Access instruction cache. Record the time when the
 		// instruction will have been fetched, as per the latency
@@ -411,23 +695,41 @@ void ComputeUnit::Fetch(FetchBuffer *fetch_buffer,
 }
 
 
+int ComputeUnit::FindWorkGroupSlot(NDRange *ndrange)
+{
+	// Resources taken by a work-group of the ND-range
+	const WavefrontPool::WorkGroupResources &resources =
+			gpu->getWorkGroupResources(ndrange);
+
+	// Find a free slot in a wavefront pool with enough resources left
+	int num_slots = max_work_groups_per_wavefront_pool *
+			num_wavefront_pools;
+	for (int slot = 0; slot < num_slots; slot++)
+	{
+		if (slot < (int) work_groups.size() && work_groups[slot])
+			continue;
+		if (wavefront_pools[slot % num_wavefront_pools]->
+				canMapWorkGroup(resources))
+			return slot;
+	}
+
+	// No slot available
+	return -1;
+}
+
+
 void ComputeUnit::MapWorkGroup(WorkGroup *work_group)
 {
 	// Checks
 	assert(work_group);
-	assert((int) work_groups.size() <= gpu->getWorkGroupsPerComputeUnit());
 	assert(!work_group->id_in_compute_unit);
 
 	// Find an available slot
-	while (work_group->id_in_compute_unit < gpu->getWorkGroupsPerComputeUnit()
-			&& (work_group->id_in_compute_unit < 
-			(int) work_groups.size()) && 
-			(work_groups[work_group->id_in_compute_unit] != nullptr))
-		work_group->id_in_compute_unit++;
+	work_group->id_in_compute_unit = FindWorkGroupSlot(
+			work_group->getNDRange());
 
 	// Checks
-	assert(work_group->id_in_compute_unit <
-			gpu->getWorkGroupsPerComputeUnit());
+	assert(work_group->id_in_compute_unit >= 0);
 
 	// Save timing simulator
 	timing = Timing::getInstance();
@@ -442,15 +744,9 @@ void ComputeUnit::MapWorkGroup(WorkGroup *work_group)
 	// Insert work group into the list
 	AddWorkGroup(work_group);
 
-	// Checks
-	assert((int) work_groups.size() <= gpu->getWorkGroupsPerComputeUnit());
-	
-	// If compute unit is not full, add it back to the available list
-	if ((int) work_groups.size() < gpu->getWorkGroupsPerComputeUnit())
-	{
-		if (!in_available_compute_units)
-			gpu->InsertInAvailableComputeUnits(this);
-	}
+	// Statistics of the work group are added to the emulator after each
+	// instruction, which is a shared operation
+	work_group->setPrivateStatistics(true);
 
 	// Assign wavefront identifiers in compute unit
 	int wavefront_id = 0;
@@ -481,7 +777,13 @@ void ComputeUnit::MapWorkGroup(WorkGroup *work_group)
 			max_wavefronts_per_wavefront_pool);
 
 	// Insert wavefronts into an instruction buffer
-	work_group->wavefront_pool->MapWavefronts(work_group);
+	work_group->wavefront_pool->MapWavefronts(work_group,
+			gpu->getWorkGroupResources(work_group->getNDRange()));
+
+	// If the compute unit can still host work-groups of any mapped
+	// ND-range, add it back to the available list
+	if (!in_available_compute_units && gpu->isComputeUnitAvailable(this))
+		gpu->InsertInAvailableComputeUnits(this);
 
 	// Increment count of mapped work groups
 	num_mapped_work_groups++;
@@ -512,25 +814,14 @@ void ComputeUnit::MapWorkGroup(WorkGroup *work_group)
 
 void ComputeUnit::AddWorkGroup(WorkGroup *work_group)
 {
-	// Add a work group only if the id in compute unit is the id for a new 
-	// work group in the compute unit's list
+	// Grow the list of work groups up to the slot of the new work group
 	int index = work_group->id_in_compute_unit;
-	if (index == (int) work_groups.size() &&
-			(int) work_groups.size() < 
-			gpu->getWorkGroupsPerComputeUnit())
-	{
-		work_groups.push_back(work_group);
-	}
-	else
-	{
-		// Make sure an entry is emptied up
-		assert(work_groups[index] == nullptr);
-		assert(work_groups.size() <=
-				(unsigned) gpu->getWorkGroupsPerComputeUnit());
+	if (index >= (int) work_groups.size())
+		work_groups.resize(index + 1, nullptr);
 
-		// Set the new work group to the empty entry
-		work_groups[index] = work_group;
-	}
+	// Make sure an entry is emptied up, and set the new work group to it
+	assert(work_groups[index] == nullptr);
+	work_groups[index] = work_group;
 
 	// Checks
 	assert(work_group->id_in_compute_unit == index);
@@ -564,24 +855,6 @@ void ComputeUnit::RemoveWorkGroup(WorkGroup *work_group)
 }
 
 
-void ComputeUnit::Reset()
-{
-	// If there are no work groups ever assigned to this compute unit
-	// the size would be zero, so no reset is required. 
-	if (!work_groups.size())
-		return;
-
-	// Debug info
-	Emulator::scheduler_debug << misc::fmt("@%lld compute unit %d "
-			"reset\n",
-			timing->getCycle(),
-			index);
-
-	// Reset the workgroups size to 0
-	work_groups.resize(0);
-}
-
-
 void ComputeUnit::UnmapWorkGroup(WorkGroup *work_group)
 {
 	// Get Gpu object
@@ -598,12 +871,12 @@ void ComputeUnit::UnmapWorkGroup(WorkGroup *work_group)
 	RemoveWorkGroup(work_group);
 
 	// Unmap wavefronts from instruction buffer
-	work_group->wavefront_pool->UnmapWavefronts(work_group);
+	work_group->wavefront_pool->UnmapWavefronts(work_group,
+			gpu->getWorkGroupResources(work_group->getNDRange()));
 	
 	// If compute unit is not already in the available list, place
 	// it there. The vector list of work groups does not shrink,
 	// when we unmap a workgroup.
-	assert((int) work_groups.size() <= gpu->getWorkGroupsPerComputeUnit());
 	if (!in_available_compute_units)
 		gpu->InsertInAvailableComputeUnits(this);
 
@@ -647,15 +920,131 @@ void ComputeUnit::UpdateFetchVisualization(FetchBuffer *fetch_buffer)
 }
 
 
+ComputeUnit::WavefrontState ComputeUnit::getWavefrontState(
+		WavefrontPoolEntry *entry,
+		WavefrontState fetch_buffer_state) const
+{
+	// No wavefront
+	Wavefront *wavefront = entry->getWavefront();
+	if (!entry->valid || !wavefront)
+		return WavefrontStateNoWavefront;
+
+	// Instruction issued in this cycle
+	if (entry->issue_cycle == timing->getCycle())
+		return WavefrontStateIssued;
+
+	// Instruction in the fetch buffer
+	if (fetch_buffer_state != WavefrontStateCount)
+		return fetch_buffer_state;
+
+	// Outstanding memory accesses, charged to the memory with the
+	// longest latency
+	WavefrontState memory_state = WavefrontStateCount;
+	if (entry->vm_cnt || entry->exp_cnt)
+		memory_state = WavefrontStateVectorMemory;
+	else if (entry->lgkm_cnt > entry->lds_cnt)
+		memory_state = WavefrontStateScalarMemory;
+	else if (entry->lds_cnt)
+		memory_state = WavefrontStateLds;
+
+	// Finished wavefront, waiting for its memory accesses or for the
+	// rest of the work-group
+	if (entry->wavefront_finished || wavefront->getFinished())
+		return memory_state == WavefrontStateCount ?
+				WavefrontStateFinished : memory_state;
+
+	// Waiting at a barrier
+	if (entry->wait_for_barrier)
+		return WavefrontStateBarrier;
+
+	// Waiting for memory in a wait instruction
+	if (entry->isWaitingForMemory())
+		return memory_state;
+
+	// Previous instruction not done yet
+	if (!entry->ready)
+		return WavefrontStateInFlight;
+
+	// Ready to fetch
+	return WavefrontStateFetchBufferEmpty;
+}
+
+
+void ComputeUnit::RecordWavefrontStates()
+{
+	// Occupancy
+	num_accounted_cycles++;
+	num_occupancy_limit += gpu->getMaxWavefrontsPerComputeUnit();
+
+	// Entries of each wavefront pool
+	for (int i = 0; i < num_wavefront_pools; i++)
+	{
+		// States given by the instructions in the fetch buffer. A
+		// wavefront with an instruction that completed fetch is ready
+		// to issue, and otherwise it is still being fetched.
+		std::fill(fetch_buffer_states.begin(),
+				fetch_buffer_states.end(),
+				WavefrontStateCount);
+		for (auto &uop : *fetch_buffers[i])
+		{
+			WavefrontState &state = fetch_buffer_states[uop->
+					getWavefrontPoolEntry()->
+					getIdInWavefrontPool()];
+			if (timing->getCycle() >= uop->fetch_ready)
+				state = WavefrontStateExecutionUnitBusy;
+			else if (state == WavefrontStateCount)
+				state = WavefrontStateFetchBufferEmpty;
+		}
+
+		// State of each entry
+		for (auto &entry : *wavefront_pools[i])
+		{
+			WavefrontState state = getWavefrontState(entry.get(),
+					fetch_buffer_states[entry->
+					getIdInWavefrontPool()]);
+			wavefront_states[state]++;
+			if (state != WavefrontStateNoWavefront)
+				num_resident_wavefronts++;
+		}
+	}
+}
+
+
+void ComputeUnit::RunDeferredOperations()
+{
+	for (auto &operation : deferred_operations)
+		operation();
+	deferred_operations.clear();
+}
+
+
+void ComputeUnit::RunDeferredEmulation()
+{
+	// Emulate the instructions in the order in which they were fetched
+	for (Uop *uop : deferred_uops)
+		Emulate(uop);
+	deferred_uops.clear();
+
+	// Statistics
+	RecordWavefrontStates();
+}
+
+
 void ComputeUnit::Run()
 {
-	// Return if no work groups are mapped to this compute unit
-	if (!work_groups.size())
-		return;
-	
 	// Save timing simulator
 	timing = Timing::getInstance();
 
+	// Return if no work groups are mapped to this compute unit. The
+	// wavefront states are recorded after deferred instructions are
+	// emulated.
+	if (!work_groups.size())
+	{
+		if (!defer_emulation)
+			RecordWavefrontStates();
+		return;
+	}
+
 	// Issue buffer chosen to issue this cycle
 	int active_issue_buffer = timing->getCycle() % num_wavefront_pools;
 	assert(active_issue_buffer >= 0 && active_issue_buffer < num_wavefront_pools);
@@ -691,6 +1080,10 @@ void ComputeUnit::Run()
 	// Fetch
 	for (int i = 0; i < num_wavefront_pools; i++)
 		Fetch(fetch_buffers[i].get(), wavefront_pools[i].get());
+
+	// Statistics
+	if (!defer_emulation)
+		RecordWavefrontStates();
 }
 
 
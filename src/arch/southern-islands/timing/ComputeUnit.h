@@ -20,8 +20,10 @@
 #ifndef ARCH_SOUTHERN_ISLANDS_TIMING_COMPUTE_UNIT_H
 #define ARCH_SOUTHERN_ISLANDS_TIMING_COMPUTE_UNIT_H
 
+#include <functional>
 #include <list>
 
+#include <lib/cpp/String.h>
 #include <memory/Module.h>
 
 #include "BranchUnit.h"
@@ -46,6 +48,45 @@ class Gpu;
 /// Class representing one compute unit in the GPU device.
 class ComputeUnit
 {
+public:
+
+	/// Policies to choose the wavefronts that instructions are fetched
+	/// and issued from
+	enum SchedulingPolicy
+	{
+		SchedulingPolicyInvalid = 0,
+		SchedulingPolicyFixed,
+		SchedulingPolicyLooseRoundRobin,
+		SchedulingPolicyGreedyThenOldest,
+		SchedulingPolicyTwoLevel,
+		SchedulingPolicyMemoryAware
+	};
+
+	/// String map for SchedulingPolicy
+	static misc::StringMap scheduling_policy_map;
+
+	/// State of a wavefront pool entry in a cycle, accounted to find out
+	/// why wavefronts do not issue
+	enum WavefrontState
+	{
+		WavefrontStateIssued = 0,		// Instruction issued
+		WavefrontStateExecutionUnitBusy,	// Instruction ready to issue not issued
+		WavefrontStateFetchBufferEmpty,		// No instruction ready to issue
+		WavefrontStateInFlight,			// Previous instruction executing
+		WavefrontStateVectorMemory,		// Waiting for vector memory
+		WavefrontStateScalarMemory,		// Waiting for scalar memory
+		WavefrontStateLds,			// Waiting for the LDS
+		WavefrontStateBarrier,			// Waiting at a barrier
+		WavefrontStateFinished,			// Waiting for the rest of the work-group
+		WavefrontStateNoWavefront,		// No wavefront in the entry
+		WavefrontStateCount
+	};
+
+	/// String map for WavefrontState
+	static const misc::StringMap wavefront_state_map;
+
+private:
+
 	// Fetch an instruction from the given wavefront pool
 	void Fetch(FetchBuffer *fetch_buffer, WavefrontPool *wavefront_pool);
 
@@ -71,9 +112,25 @@ class ComputeUnit
 	// constructor.
 	int index;
 
+	// Policy to schedule wavefronts in fetch and issue
+	SchedulingPolicy scheduling_policy;
+
+	// Wavefront pool entries that an instruction can be fetched from in
+	// the current cycle, kept to avoid allocations
+	std::vector<WavefrontPoolEntry *> fetch_candidates;
+
+	// State of each entry of a wavefront pool given by the instructions
+	// of its fetch buffer, kept to avoid allocations
+	std::vector<WavefrontState> fetch_buffer_states;
+
 	// List of work-groups currently mapped to the compute unit
 	std::vector<WorkGroup *> work_groups;
 
+	// Return the first free work-group slot where a work-group of the
+	// given mapped ND-range fits, or -1 if there is none. A slot is
+	// associated with wavefront pool 'slot % num_wavefront_pools'.
+	int FindWorkGroupSlot(NDRange *ndrange);
+
 	// Variable number of wavefront pools
 	std::vector<std::unique_ptr<WavefrontPool>> wavefront_pools;
 
@@ -101,6 +158,29 @@ class ComputeUnit
 	// Counter of identifiers assigned to uops in this compute unit
 	long long uop_id_counter = 0;
 
+	// Operations with effects outside of the compute unit, deferred while
+	// compute units emulate instructions in parallel
+	std::vector<std::function<void()>> deferred_operations;
+
+	// True while operations passed to RunShared() are deferred
+	bool defer_operations = false;
+
+	// Uops fetched in the current cycle whose instructions are emulated
+	// after all compute units advanced their pipelines
+	std::vector<Uop *> deferred_uops;
+
+	// True while the emulation of instructions that don't access global
+	// memory is deferred
+	bool defer_emulation = false;
+
+	// Return whether the next instruction of a wavefront accesses global
+	// memory
+	static bool isGlobalMemoryInstruction(Wavefront *wavefront);
+
+	// Emulate the instruction of a fetched uop, and copy its properties
+	// into the uop
+	void Emulate(Uop *uop);
+
 public:
 
 	//
@@ -110,6 +190,16 @@ public:
 	/// Number of wavefront pools per compute unit, configured by the user
 	static int num_wavefront_pools;
 
+	/// Scheduling policy of compute units without a policy of their own
+	static SchedulingPolicy default_scheduling_policy;
+
+	/// Scheduling policy of each compute unit, configured by the user
+	static std::vector<SchedulingPolicy> scheduling_policies;
+
+	/// Maximum number of wavefronts in the active set of each wavefront
+	/// pool with the two-level scheduling policy
+	static int max_active_wavefronts;
+
 	/// Fetch latency in cycles
 	static int fetch_latency;
 
@@ -158,15 +248,18 @@ public:
 	/// Constructor
 	ComputeUnit(int index, Gpu *gpu);
 
-	/// Reset the compute unit for the next NDRange
-	void Reset();
-
 	/// Advance compute unit state by one cycle
 	void Run();
 
 	/// Return the index of this compute unit in the GPU
 	int getIndex() const { return index; }
 
+	/// Return the policy to schedule wavefronts in fetch and issue
+	SchedulingPolicy getSchedulingPolicy() const
+	{
+		return scheduling_policy;
+	}
+
 	/// Return a new unique sequential identifier for the next uop in the
 	/// compute unit.
 	long long getUopId() { return ++uop_id_counter; }
@@ -177,6 +270,13 @@ public:
 	/// Return the associated timing simulator
 	Timing *getTiming() const { return timing; }
 	
+	/// Return whether a work-group of the given mapped ND-range fits in
+	/// the compute unit next to the work-groups already running on it
+	bool canMapWorkGroup(NDRange *ndrange)
+	{
+		return FindWorkGroupSlot(ndrange) >= 0;
+	}
+
 	/// Map a work group to the compute unit
 	void MapWorkGroup(WorkGroup *work_group);
 
@@ -189,9 +289,77 @@ public:
 	/// Remove a work group pointer from the work_groups list
 	void RemoveWorkGroup(WorkGroup *work_group);
 
+	/// Run an operation with effects outside of the compute unit, such as
+	/// adding statistics to the emulator. While compute units emulate
+	/// instructions in parallel, the operation is deferred until all of
+	/// them finished.
+	template<typename Operation> void RunShared(Operation operation)
+	{
+		if (defer_operations)
+			deferred_operations.emplace_back(std::move(operation));
+		else
+			operation();
+	}
+
+	/// Start or stop deferring the operations passed to RunShared()
+	void setDeferOperations(bool defer_operations)
+	{
+		this->defer_operations = defer_operations;
+	}
+
+	/// Run the deferred operations in the order in which they were passed
+	/// to RunShared()
+	void RunDeferredOperations();
+
+	/// Start or stop deferring the emulation of fetched instructions that
+	/// don't access global memory
+	void setDeferEmulation(bool defer_emulation)
+	{
+		this->defer_emulation = defer_emulation;
+	}
+
+	/// Emulate the instructions deferred in the current cycle, and record
+	/// the wavefront states of the cycle. Compute units can run this
+	/// function in parallel, since instructions not accessing global
+	/// memory only change the state of their own work-group.
+	void RunDeferredEmulation();
+
 	/// Return the associated LDS module
 	mem::Module *getLdsModule() const { return lds_module.get(); }
 
+	/// Return the vector memory unit
+	VectorMemoryUnit *getVectorMemoryUnit() { return &vector_memory_unit; }
+
+	/// Return the fetch buffer with the given index
+	FetchBuffer *getFetchBuffer(int index) const
+	{
+		return fetch_buffers[index].get();
+	}
+
+	/// Sort the wavefront pool entries that an instruction can be fetched
+	/// from, in the order given by the scheduling policy
+	void SortFetchCandidates(WavefrontPool *wavefront_pool,
+			std::vector<WavefrontPoolEntry *> &candidates);
+
+	/// Return true if the scheduling policy issues the given uop before
+	/// the other uop, both taken from the given fetch buffer
+	bool isPreferredUop(Uop *uop, Uop *other, FetchBuffer *fetch_buffer);
+
+	/// Demote wavefronts waiting for memory or barriers from the active
+	/// set of the two-level scheduling policy, and promote the oldest
+	/// pending wavefronts in their place
+	void UpdateActiveWavefronts(WavefrontPool *wavefront_pool);
+
+	/// Return the state of a wavefront pool entry in the current cycle,
+	/// given the state from the instructions in its fetch buffer, or
+	/// WavefrontStateCount if it has none
+	WavefrontState getWavefrontState(WavefrontPoolEntry *entry,
+			WavefrontState fetch_buffer_state) const;
+
+	/// Add the state of all wavefront pool entries in the current cycle,
+	/// as well as the occupancy, to the statistics
+	void RecordWavefrontStates();
+
 	// Dump function
 	void Dump(std::ostream &os = std::cout) const;
 
@@ -224,6 +392,9 @@ public:
 	/// Flag to indicate if the compute unit is currently available or not
 	bool in_available_compute_units = false;
 
+	/// Last cycle when a uop completed execution in the compute unit
+	long long last_complete_cycle = 0;
+
 
 
 
@@ -266,6 +437,43 @@ public:
 
 	// Number of total mapped work groups for the compute unit
 	long long num_mapped_work_groups = 0;
+
+	// Number of times a wavefront ready to fetch was not chosen by the
+	// scheduling policy, or ran out of fetch width
+	long long num_scheduler_stalls = 0;
+
+	// Number of times a wavefront ready to fetch was pending, outside of
+	// the active set of the two-level scheduling policy
+	long long num_pending_stalls = 0;
+
+	// Number of times a wavefront could not fetch while waiting for its
+	// outstanding memory accesses
+	long long num_memory_stalls = 0;
+
+	// Number of times a wavefront could not fetch while waiting at a
+	// barrier
+	long long num_barrier_stalls = 0;
+
+	// Number of times a wavefront ready to fetch found its fetch buffer
+	// full
+	long long num_fetch_buffer_stalls = 0;
+
+	// Number of times a fetched instruction was not issued in a cycle
+	// where its fetch buffer was issuing
+	long long num_issue_stalls = 0;
+
+	// Number of wavefront pool entries in each state, added every cycle
+	long long wavefront_states[WavefrontStateCount] = { };
+
+	// Number of cycles accounted in 'wavefront_states'
+	long long num_accounted_cycles = 0;
+
+	// Number of wavefronts mapped to the compute unit, added every cycle
+	long long num_resident_wavefronts = 0;
+
+	// Maximum number of wavefronts that the mapped ND-ranges allow in the
+	// compute unit, added every cycle
+	long long num_occupancy_limit = 0;
 };
 
 }
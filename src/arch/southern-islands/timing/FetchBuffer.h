@@ -45,6 +45,10 @@ class FetchBuffer
 	// Buffer of instructions
 	std::list<std::unique_ptr<Uop>> buffer;
 
+	// Identifier of the wavefront that an instruction was last issued
+	// from, or -1 if none was yet
+	int last_issued_wavefront_id = -1;
+
 public:
 	
 	/// Constructor
@@ -81,6 +85,16 @@ public:
 
 	/// Remove the uop pointed to by the given iterator.
 	void Remove(std::list<std::unique_ptr<Uop>>::iterator it);
+
+	/// Return the identifier of the wavefront that an instruction was
+	/// last issued from, or -1 if none was yet
+	int getLastIssuedWavefrontId() const
+	{
+		return last_issued_wavefront_id;
+	}
+
+	/// Record the wavefront that an instruction was last issued from
+	void setLastIssuedWavefrontId(int id) { last_issued_wavefront_id = id; }
 };
 
 }
@@ -35,6 +35,7 @@ int Gpu::num_vector_registers = 65536;
 int Gpu::lds_allocation_size = 64; 
 int Gpu::lds_size = 65536;
 long long Gpu::max_cycles = 0;
+Gpu::DispatchPolicy Gpu::dispatch_policy = DispatchPolicyFifo;
 
 // String map of the argument's access type                                      
 const misc::StringMap Gpu::register_allocation_granularity_map =                                
@@ -43,6 +44,14 @@ const misc::StringMap Gpu::register_allocation_granularity_map =
 	{ "WorkGroup", RegisterAllocationWorkGroup }
 }; 
 
+// String map of the dispatch policies
+misc::StringMap Gpu::dispatch_policy_map =
+{
+	{ "Fifo", DispatchPolicyFifo },
+	{ "RoundRobin", DispatchPolicyRoundRobin },
+	{ "Partition", DispatchPolicyPartition }
+};
+
 Gpu::Gpu()
 {
 	// Create MMU
@@ -62,12 +71,49 @@ Gpu::Gpu()
 }
 
 
-ComputeUnit *Gpu::getAvailableComputeUnit()
+int Gpu::getMappedNDRangeIndex(NDRange *ndrange) const
 {
-	if (available_compute_units.empty())
-		return nullptr;
-	else
-		return available_compute_units.front();
+	for (int index = 0; index < (int) mapped_ndranges.size(); index++)
+		if (mapped_ndranges[index].ndrange == ndrange)
+			return index;
+	return -1;
+}
+
+
+bool Gpu::isInPartition(ComputeUnit *compute_unit, int index) const
+{
+	// Without spatial partitioning, ND-ranges share all compute units
+	if (dispatch_policy != DispatchPolicyPartition)
+		return true;
+
+	// Compute units are split into as many contiguous blocks as ND-ranges
+	// are mapped
+	return compute_unit->getIndex() * (int) mapped_ndranges.size() /
+			num_compute_units == index;
+}
+
+
+ComputeUnit *Gpu::getAvailableComputeUnit(NDRange *ndrange)
+{
+	// Get mapped ND-range
+	int index = getMappedNDRangeIndex(ndrange);
+	assert(index >= 0);
+
+	// Find the first compute unit where a work-group fits
+	for (ComputeUnit *compute_unit : available_compute_units)
+		if (isInPartition(compute_unit, index) &&
+				compute_unit->canMapWorkGroup(ndrange))
+			return compute_unit;
+	return nullptr;
+}
+
+
+bool Gpu::isComputeUnitAvailable(ComputeUnit *compute_unit)
+{
+	for (MappedNDRange &mapped_ndrange : mapped_ndranges)
+		if (compute_unit->canMapWorkGroup(mapped_ndrange.ndrange))
+			return true;
+	return false;
 }
 
 
@@ -99,13 +145,26 @@ void Gpu::RemoveFromAvailableComputeUnits(ComputeUnit *compute_unit)
 }
 
 
+const WavefrontPool::WorkGroupResources &Gpu::getWorkGroupResources(
+		NDRange *ndrange) const
+{
+	int index = getMappedNDRangeIndex(ndrange);
+	assert(index >= 0);
+	return mapped_ndranges[index].resources;
+}
+
+
 void Gpu::MapNDRange(NDRange *ndrange)
 {
+	// Check that the ND-range is not mapped yet
+	assert(!isNDRangeMapped(ndrange));
+
 	// Check that at least one work-group can be allocated per 
 	// wavefront pool
-	Gpu::CalcGetWorkGroupsPerWavefrontPool(ndrange->getLocalSize1D(),
-			ndrange->getNumVgprUsed(),
-			ndrange->getLocalMemTop());
+	WavefrontPool::WorkGroupResources resources =
+			CalcWorkGroupResources(ndrange);
+	int work_groups_per_wavefront_pool =
+			CalcGetWorkGroupsPerWavefrontPool(resources);
 
 	// Make sure the number of work groups per wavefront pool is non-zero
 	if (!work_groups_per_wavefront_pool)
@@ -118,104 +177,284 @@ void Gpu::MapNDRange(NDRange *ndrange)
 			"be executed.\n"));
 	}
 
-	// Calculate limit of work groups per compute unit
-	work_groups_per_compute_unit = work_groups_per_wavefront_pool *
-			ComputeUnit::num_wavefront_pools;
-	assert(work_groups_per_wavefront_pool <=
-			ComputeUnit::max_work_groups_per_wavefront_pool);
 	// Debug info
 	Emulator::scheduler_debug << misc::fmt("NDRange %d calculations:\n"
 			"\t%d work group per wavefront pool\n"
-			"\t%d work group slot per compute unit\n",
+			"\t%d work group slot per compute unit\n"
+			"\t%d concurrent ND-ranges\n",
 			ndrange->getId(),
 			work_groups_per_wavefront_pool,
-			work_groups_per_compute_unit);
+			work_groups_per_wavefront_pool *
+			ComputeUnit::num_wavefront_pools,
+			(int) mapped_ndranges.size() + 1);
 
 	// Map ndrange
-	mapped_ndrange = ndrange;
+	mapped_ndranges.push_back({ ndrange, resources,
+			work_groups_per_wavefront_pool *
+			resources.num_wavefronts *
+			ComputeUnit::num_wavefront_pools });
+	UpdateMaxWavefrontsPerComputeUnit();
+
+	// Compute units that were left out of the available list because
+	// the work-groups of other ND-ranges did not fit can now host
+	// work-groups of this one
+	for (auto &compute_unit : compute_units)
+		if (!compute_unit->in_available_compute_units &&
+				compute_unit->canMapWorkGroup(ndrange))
+			InsertInAvailableComputeUnits(compute_unit.get());
 }
 
 
 void Gpu::UnmapNDRange(NDRange *ndrange)
 {
+	// Nothing to do if not mapped
+	int index = getMappedNDRangeIndex(ndrange);
+	if (index < 0)
+		return;
+
+	// Work-groups of the ND-range must have been unmapped from the
+	// compute units, which keep running work-groups of other ND-ranges
+	assert(ndrange->isRunningWorkGroupsEmpty());
+
 	// Unmap NDRange
-	mapped_ndrange = nullptr;
+	mapped_ndranges.erase(mapped_ndranges.begin() + index);
+	UpdateMaxWavefrontsPerComputeUnit();
+	if (round_robin_index > index)
+		round_robin_index--;
+	if (round_robin_index >= (int) mapped_ndranges.size())
+		round_robin_index = 0;
+}
 
-	//Erase every workgroup in each compute unit, setting the
-	// work_groups size to 0
-	for (auto &compute_unit : compute_units)
-		compute_unit->Reset();
+
+void Gpu::UpdateMaxWavefrontsPerComputeUnit()
+{
+	max_wavefronts_per_compute_unit = 0;
+	for (MappedNDRange &mapped_ndrange : mapped_ndranges)
+		max_wavefronts_per_compute_unit = std::max(
+				max_wavefronts_per_compute_unit,
+				mapped_ndrange.max_wavefronts_per_compute_unit);
 }
 
 
-void Gpu::CalcGetWorkGroupsPerWavefrontPool(int work_items_per_work_group, 
-		int registers_per_work_item, int local_memory_per_work_group)
+WavefrontPool::WorkGroupResources Gpu::CalcWorkGroupResources(
+		NDRange *ndrange) const
 {
-	// Get maximum number of work-groups per SIMD as limited by the 
-	// maximum number of wavefronts, given the number of wavefronts per 
-	// work-group in the NDRange
+	// Wavefronts in the work-group
+	WavefrontPool::WorkGroupResources resources;
+	int work_items_per_work_group = ndrange->getLocalSize1D();
 	assert(WorkGroup::WavefrontSize > 0);
-	int wavefronts_per_work_group = (work_items_per_work_group + 
+	resources.num_wavefronts = (work_items_per_work_group + 
 			WorkGroup::WavefrontSize - 1) / 
 			WorkGroup::WavefrontSize;
-	int max_work_groups_limited_by_max_wavefronts = 
-			ComputeUnit::max_wavefronts_per_wavefront_pool /
-			wavefronts_per_work_group;
 
-	// Get maximum number of work-groups per SIMD as limited by the number 
-	// of available registers, given the number of registers used per 
-	// work-item.
-	int registers_per_work_group;
+	// Vector registers, given the number of registers used per work-item
+	int registers_per_work_item = ndrange->getNumVgprUsed();
 	if (register_allocation_granularity == RegisterAllocationWavefront)
 	{
-		registers_per_work_group = misc::RoundUp(
+		resources.num_vector_registers = misc::RoundUp(
 				registers_per_work_item *
 				WorkGroup::WavefrontSize, 
 				register_allocation_size) * 
-				wavefronts_per_work_group;
+				resources.num_wavefronts;
 	}
 	else
 	{
-		registers_per_work_group = misc::RoundUp(
+		resources.num_vector_registers = misc::RoundUp(
 				registers_per_work_item *
 				work_items_per_work_group, 
 				register_allocation_size);
 	}
-	
-	// FIXME need to account for scalar registers
+
+	// Scalar registers are allocated for each wavefront
+	resources.num_scalar_registers = ndrange->getNumSgprUsed() *
+			resources.num_wavefronts;
+
+	// Local memory
+	resources.local_memory_size = misc::RoundUp(
+			(int) ndrange->getLocalMemTop(),
+			lds_allocation_size);
+	return resources;
+}
+
+
+int Gpu::CalcGetWorkGroupsPerWavefrontPool(
+		const WavefrontPool::WorkGroupResources &resources) const
+{
+	// Get maximum number of work-groups per SIMD as limited by the 
+	// maximum number of wavefronts, given the number of wavefronts per 
+	// work-group in the NDRange
+	int max_work_groups_limited_by_max_wavefronts = 
+			ComputeUnit::max_wavefronts_per_wavefront_pool /
+			resources.num_wavefronts;
+
+	// Get maximum number of work-groups per SIMD as limited by the number 
+	// of available registers
 	int max_work_groups_limited_by_num_registers = 
-			registers_per_work_group ?
-			num_vector_registers / registers_per_work_group :
+			resources.num_vector_registers ?
+			num_vector_registers / resources.num_vector_registers :
+			ComputeUnit::max_work_groups_per_wavefront_pool;
+	int max_work_groups_limited_by_num_scalar_registers =
+			resources.num_scalar_registers ?
+			num_scalar_registers / resources.num_scalar_registers :
 			ComputeUnit::max_work_groups_per_wavefront_pool;
 
 	// Get maximum number of work-groups per SIMD as limited by the 
-	// amount of available local memory, given the local memory used 
-	// by each work-group in the NDRange
-	local_memory_per_work_group = misc::RoundUp(local_memory_per_work_group, 
-			lds_allocation_size);
+	// amount of available local memory
 	int max_work_groups_limited_by_local_memory = 
-			local_memory_per_work_group ?
-			lds_size / local_memory_per_work_group :
+			resources.local_memory_size ?
+			lds_size / resources.local_memory_size :
 			ComputeUnit::max_work_groups_per_wavefront_pool;
 
 	// Based on the limits above, calculate the actual limit of work-groups 
 	// per SIMD.
-	work_groups_per_wavefront_pool = 
+	int work_groups_per_wavefront_pool = 
 			ComputeUnit::max_work_groups_per_wavefront_pool;
 	work_groups_per_wavefront_pool = std::min(work_groups_per_wavefront_pool,
 			max_work_groups_limited_by_max_wavefronts);
-	work_groups_per_wavefront_pool= std::min(work_groups_per_wavefront_pool, 
+	work_groups_per_wavefront_pool = std::min(work_groups_per_wavefront_pool, 
 			max_work_groups_limited_by_num_registers);
+	work_groups_per_wavefront_pool = std::min(work_groups_per_wavefront_pool, 
+			max_work_groups_limited_by_num_scalar_registers);
 	work_groups_per_wavefront_pool = std::min(work_groups_per_wavefront_pool, 
 			max_work_groups_limited_by_local_memory);
+	return work_groups_per_wavefront_pool;
 }
 
 
-void Gpu::Run()
+bool Gpu::DispatchWorkGroup(int index)
+{
+	// Nothing to dispatch
+	NDRange *ndrange = mapped_ndranges[index].ndrange;
+	if (ndrange->isWaitingWorkGroupsEmpty())
+		return false;
+
+	// Get an available compute unit
+	ComputeUnit *available_compute_unit = getAvailableComputeUnit(ndrange);
+	if (!available_compute_unit)
+		return false;
+
+	// Remove work group from list and get its ID
+	long work_group_id = ndrange->GetWaitingWorkGroup();
+	WorkGroup *work_group = ndrange->ScheduleWorkGroup(work_group_id);
+
+	// If the last work group is sent, then set the value to true
+	if (ndrange->isWaitingWorkGroupsEmpty())
+		ndrange->setLastWorkgroupSent(true);
+
+	// Remove it from the available compute units list. It will be
+	// re-added later if it still has room for more work groups.
+	RemoveFromAvailableComputeUnits(available_compute_unit);
+
+	// Map the work group to a compute unit
+	available_compute_unit->MapWorkGroup(work_group);
+	return true;
+}
+
+
+void Gpu::DispatchWorkGroups()
+{
+	// Nothing mapped
+	int num_mapped_ndranges = mapped_ndranges.size();
+	if (!num_mapped_ndranges)
+		return;
+
+	switch (dispatch_policy)
+	{
+
+	case DispatchPolicyRoundRobin:
+	{
+		// ND-ranges take turns to dispatch one work-group at a time,
+		// starting at a different ND-range in every cycle
+		bool dispatched = true;
+		while (dispatched)
+		{
+			dispatched = false;
+			for (int i = 0; i < num_mapped_ndranges; i++)
+				if (DispatchWorkGroup((round_robin_index + i) %
+						num_mapped_ndranges))
+					dispatched = true;
+		}
+		round_robin_index = (round_robin_index + 1) %
+				num_mapped_ndranges;
+		break;
+	}
+
+	default:
+
+		// ND-ranges dispatch all the work-groups that fit in the order
+		// in which they were mapped, within their own partition of
+		// compute units for the spatial partitioning policy
+		for (int index = 0; index < num_mapped_ndranges; index++)
+			while (DispatchWorkGroup(index))
+				continue;
+	}
+}
+
+
+void Gpu::RunParallel()
 {
-	// Advance one cycle in each compute unit
+	// Create host threads. There is no point in using more host threads
+	// than host CPUs.
+	if (!thread_pool)
+	{
+		int num_pool_threads = Emulator::getNumHostThreads();
+		int num_host_cpus = std::thread::hardware_concurrency();
+		if (num_host_cpus)
+			num_pool_threads = std::min(num_pool_threads,
+					num_host_cpus);
+		thread_pool = misc::new_unique<misc::ThreadPool>(
+				num_pool_threads);
+	}
+
+	// Advance the pipeline of each compute unit in order, as in
+	// sequential mode. Instructions accessing global memory are emulated
+	// right away, and the emulation of the others is deferred.
 	for (auto &compute_unit : compute_units)
+	{
+		compute_unit->setDeferEmulation(true);
 		compute_unit->Run();
+		compute_unit->setDeferEmulation(false);
+	}
+
+	// Emulate the deferred instructions in parallel. Operations with
+	// effects outside of a compute unit are deferred again.
+	for (auto &compute_unit : compute_units)
+		compute_unit->setDeferOperations(true);
+	thread_pool->Run(compute_units.size(), [this](int index)
+	{
+		compute_units[index]->RunDeferredEmulation();
+	});
+
+	// Run deferred operations in compute unit order
+	for (auto &compute_unit : compute_units)
+	{
+		compute_unit->setDeferOperations(false);
+		compute_unit->RunDeferredOperations();
+	}
+}
+
+
+void Gpu::Run()
+{
+	// Advance one cycle in each compute unit. Debug and trace output are
+	// only produced sequentially, so that lines of different compute
+	// units don't get mixed.
+	if (Emulator::getNumHostThreads() > 1 && !Emulator::isa_debug &&
+			!Emulator::scheduler_debug && !Timing::pipeline_debug &&
+			!Timing::trace)
+	{
+		RunParallel();
+	}
+	else
+	{
+		for (auto &compute_unit : compute_units)
+			compute_unit->Run();
+	}
+
+	// Last cycle when a uop completed execution
+	for (auto &compute_unit : compute_units)
+		last_complete_cycle = std::max(last_complete_cycle,
+				compute_unit->last_complete_cycle);
 }
 
 }
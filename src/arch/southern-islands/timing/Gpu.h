@@ -23,6 +23,7 @@
 #include <vector>
 
 #include <lib/cpp/Misc.h>
+#include <lib/cpp/ThreadPool.h>
 #include <memory/Mmu.h>
 
 #include "ComputeUnit.h"
@@ -48,6 +49,19 @@ public:
 	/// String map depciting the various allocation granularities
 	static const misc::StringMap register_allocation_granularity_map;
 
+	/// Policy used to dispatch the work-groups of several ND-ranges
+	/// mapped to the GPU at the same time
+	enum DispatchPolicy
+	{
+		DispatchPolicyInvalid = 0,
+		DispatchPolicyFifo,
+		DispatchPolicyRoundRobin,
+		DispatchPolicyPartition
+	};
+
+	/// String map for the dispatch policies
+	static misc::StringMap dispatch_policy_map;
+
 private:
 		
 	//
@@ -67,14 +81,57 @@ private:
 	RegisterAllocationGranularity register_allocation_granularity = 
 			RegisterAllocationInvalid;
 
-	/// Number of work groups allowed in a wavefront pool
-	int work_groups_per_wavefront_pool = 0;
+	// ND-range mapped to the GPU, with the resources that each of its
+	// work-groups takes from a wavefront pool
+	struct MappedNDRange
+	{
+		NDRange *ndrange;
+		WavefrontPool::WorkGroupResources resources;
+
+		// Maximum number of wavefronts of the ND-range that fit in a
+		// compute unit
+		int max_wavefronts_per_compute_unit;
+	};
+
+	// ND-ranges mapped to the GPU, in the order in which they were mapped
+	std::vector<MappedNDRange> mapped_ndranges;
 
-	/// Number of work_groups allowed in a compute unit
-	int work_groups_per_compute_unit = 0;
+	// Position in 'mapped_ndranges' of the ND-range that dispatches a
+	// work-group first in the next cycle, for the round-robin policy
+	int round_robin_index = 0;
 
-	/// Mapped NDRange to the GPU
-	NDRange *mapped_ndrange = nullptr;
+	// Highest value of 'max_wavefronts_per_compute_unit' among the mapped
+	// ND-ranges, updated when ND-ranges are mapped and unmapped
+	int max_wavefronts_per_compute_unit = 0;
+
+	// Update 'max_wavefronts_per_compute_unit'
+	void UpdateMaxWavefrontsPerComputeUnit();
+
+	// Return the position of an ND-range in 'mapped_ndranges', or -1 if
+	// it is not mapped
+	int getMappedNDRangeIndex(NDRange *ndrange) const;
+
+	// Return whether the given compute unit belongs to the partition of
+	// the ND-range in the given position of 'mapped_ndranges'. All compute
+	// units belong to all partitions unless the spatial partitioning
+	// policy is used.
+	bool isInPartition(ComputeUnit *compute_unit, int index) const;
+
+	// Dispatch one waiting work-group of the ND-range in the given
+	// position of 'mapped_ndranges' to an available compute unit. The
+	// function returns true if a work-group was dispatched.
+	bool DispatchWorkGroup(int index);
+
+	// Host threads running compute units in parallel, created the first
+	// time they are used
+	std::unique_ptr<misc::ThreadPool> thread_pool;
+
+	// Advance one cycle in all compute units, emulating instructions in
+	// parallel. The pipelines of the compute units advance sequentially,
+	// and only the emulation of instructions that don't access global
+	// memory runs on the host threads, so that simulation results are
+	// the same as in sequential mode.
+	void RunParallel();
 
 public:
 
@@ -111,6 +168,9 @@ public:
 	// Size of lds memory
 	static int lds_size;
 
+	// Policy to dispatch work-groups of concurrent ND-ranges
+	static DispatchPolicy dispatch_policy;
+
 
 
 
@@ -124,9 +184,14 @@ public:
 	/// Constructor
 	Gpu();
 
-	/// Return the iterator of an available compute unit. If no compute
-	/// units are available a nullptr is returned.
-	ComputeUnit *getAvailableComputeUnit();
+	/// Return the first compute unit in the list of available units that
+	/// can host a work-group of the given mapped ND-range. If no compute
+	/// unit is available, nullptr is returned.
+	ComputeUnit *getAvailableComputeUnit(NDRange *ndrange);
+
+	/// Return whether the given compute unit can host a work-group of any
+	/// of the mapped ND-ranges
+	bool isComputeUnitAvailable(ComputeUnit *compute_unit);
 
 	/// Insert the given compute unit in the list of available units. The
 	/// compute unit must not be currently present in the list.
@@ -143,26 +208,53 @@ public:
 		return compute_units[index].get();
 	}
 
-	/// Return the number of work groups per compute unit
-	int getWorkGroupsPerComputeUnit() const 
-	{
-		return work_groups_per_compute_unit; 
-	}
-
 	/// Return the associated MMU
 	mem::Mmu *getMmu() const { return mmu.get(); }
 
-	/// Map an NDRange to the GPU object
+	/// Map an NDRange to the GPU object. Several ND-ranges can be mapped
+	/// at the same time, sharing the compute units.
 	void MapNDRange(NDRange *ndrange);
 
-	// Unmap an NDRange from the GPU
+	/// Unmap an NDRange from the GPU. Nothing is done if the ND-range is
+	/// not mapped.
 	void UnmapNDRange(NDRange *ndrange);
+
+	/// Return whether the ND-range is mapped to the GPU
+	bool isNDRangeMapped(NDRange *ndrange) const
+	{
+		return getMappedNDRangeIndex(ndrange) >= 0;
+	}
+
+	/// Return the number of ND-ranges mapped to the GPU
+	int getNumMappedNDRanges() const { return mapped_ndranges.size(); }
+
+	/// Return the maximum number of wavefronts that a compute unit can
+	/// host with the mapped ND-range allowing the most, as limited by
+	/// the resources that its work-groups take. This is the occupancy
+	/// that the compute units can achieve at best.
+	int getMaxWavefrontsPerComputeUnit() const
+	{
+		return max_wavefronts_per_compute_unit;
+	}
+
+	/// Return the resources that each work-group of a mapped ND-range
+	/// takes from a wavefront pool
+	const WavefrontPool::WorkGroupResources &getWorkGroupResources(
+			NDRange *ndrange) const;
+
+	/// Calculate the resources that each work-group of an ND-range takes
+	/// from a wavefront pool
+	WavefrontPool::WorkGroupResources CalcWorkGroupResources(
+			NDRange *ndrange) const;
 	
-	// Calculate the number of allowed work groups per wavefront pool
-	void CalcGetWorkGroupsPerWavefrontPool(
-			int work_items_per_work_group, 
-			int registers_per_work_item, 
-			int local_memory_per_work_group);
+	/// Calculate the number of work-groups taking the given resources
+	/// that fit in an empty wavefront pool
+	int CalcGetWorkGroupsPerWavefrontPool(
+			const WavefrontPool::WorkGroupResources &resources) const;
+
+	/// Dispatch waiting work-groups of the mapped ND-ranges to available
+	/// compute units, following the dispatch policy
+	void DispatchWorkGroups();
 
 	/// Return an iterator to the first compute unit
 	std::vector<std::unique_ptr<ComputeUnit>>::iterator getComputeUnitsBegin()
@@ -188,14 +280,13 @@ public:
 		return available_compute_units.end();
 	}
 
-	/// Advance one cycle in the GPU state
+	/// Advance one cycle in the GPU state. Compute units emulate
+	/// instructions in parallel if the Southern Islands emulator is given
+	/// more than one host thread and no debug or trace output is produced.
 	void Run();
 	
 	/// Add a compute unit to the list of available compute units
 	ComputeUnit *AddComputeUnit(ComputeUnit *compute_unit);
-
-	/// Getter for the mapped NDRange of the GPU
-	NDRange *getNDRange() const { return mapped_ndrange; }
 };
 
 }
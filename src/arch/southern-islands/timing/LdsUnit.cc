@@ -71,6 +71,7 @@ void LdsUnit::Issue(std::unique_ptr<Uop> uop)
 	// One more instruction of this kind
 	compute_unit->num_lds_instructions++;
 	uop->getWavefrontPoolEntry()->lgkm_cnt++;
+	uop->getWavefrontPoolEntry()->lds_cnt++;
 
 	// Issue it
 	ExecutionUnit::Issue(std::move(uop));
@@ -99,7 +100,9 @@ void LdsUnit::Complete()
 
 		// Statistics
 		assert(uop->getWavefrontPoolEntry()->lgkm_cnt > 0);
+		assert(uop->getWavefrontPoolEntry()->lds_cnt > 0);
 		uop->getWavefrontPoolEntry()->lgkm_cnt--;
+		uop->getWavefrontPoolEntry()->lds_cnt--;
 
 		// Trace
 		Timing::trace << misc::fmt("si.end_inst "
@@ -117,7 +120,7 @@ void LdsUnit::Complete()
 
 		// Statistics
 		num_instructions++;
-		compute_unit->getGpu()->last_complete_cycle = compute_unit->
+		compute_unit->last_complete_cycle = compute_unit->
 				getTiming()->getCycle();
 	}
 }
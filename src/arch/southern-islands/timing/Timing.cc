@@ -17,6 +17,8 @@
  *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  */
 
+#include <algorithm>
+
 #include <arch/common/Arch.h>
 #include <lib/cpp/CommandLine.h>
 #include <memory/System.h>
@@ -51,6 +53,10 @@ esim::Trace Timing::trace;
 
 std::string Timing::pipeline_debug_file;
 
+std::string Timing::wavefront_states_file;
+
+long long Timing::wavefront_states_interval = 10000;
+
 misc::Debug Timing::pipeline_debug;
 
 const std::string Timing::help_message =
@@ -70,6 +76,14 @@ const std::string Timing::help_message =
 	"      Frequency for the Southern Islands GPU in MHz.\n"
 	"  NumComputeUnits = <num> (Default = 32)\n"
 	"      Number of compute units in the GPU.\n"
+	"  DispatchPolicy = {Fifo|RoundRobin|Partition} (Default = Fifo)\n"
+	"      Policy to dispatch the work-groups of several ND-ranges running\n"
+	"      concurrently. With 'Fifo', ND-ranges dispatch work-groups in the\n"
+	"      order in which they were launched, and later ND-ranges use the\n"
+	"      compute unit resources left. With 'RoundRobin', ND-ranges take\n"
+	"      turns to dispatch one work-group at a time. With 'Partition',\n"
+	"      compute units are split into as many contiguous blocks as\n"
+	"      ND-ranges are running, each dispatching to its own block.\n"
 	"\n"
 	"Section '[ ComputeUnit ]': parameters for the Compute Units.\n"
 	"\n"
@@ -87,6 +101,28 @@ const std::string Timing::help_message =
 	"  NumScalarRegisters = <num> (Default = 2048)\n"
 	"      Number of scalar registers per compute unit. These are\n"
 	"      shared by all wavefront pools/SIMDs.\n"
+	"  SchedulingPolicy = {Fixed|LooseRoundRobin|GreedyThenOldest|TwoLevel|\n"
+	"      MemoryAware} (Default = Fixed)\n"
+	"      Policy to choose the wavefronts of a wavefront pool that\n"
+	"      instructions are fetched and issued from. With 'Fixed',\n"
+	"      wavefronts fetch in the order of the wavefront pool entries,\n"
+	"      and the oldest wavefront issues first. With 'LooseRoundRobin',\n"
+	"      wavefronts take turns. With 'GreedyThenOldest', the last\n"
+	"      wavefront keeps priority while it is ready, followed by the\n"
+	"      oldest ones. With 'TwoLevel', only the wavefronts of an active\n"
+	"      set take turns, and wavefronts waiting for memory or barriers\n"
+	"      are replaced by the oldest pending ones. With 'MemoryAware',\n"
+	"      wavefronts with outstanding vector memory accesses go last.\n"
+	"  MaxActiveWavefronts = <num> (Default = 4)\n"
+	"      Number of wavefronts in the active set of each wavefront pool\n"
+	"      with the 'TwoLevel' scheduling policy.\n"
+	"\n"
+	"Section '[ ComputeUnit <index> ]': parameters for the compute unit\n"
+	"with the given index, overriding those in section [ ComputeUnit ].\n"
+	"\n"
+	"  SchedulingPolicy = {Fixed|LooseRoundRobin|GreedyThenOldest|TwoLevel|\n"
+	"      MemoryAware}\n"
+	"      Policy to schedule wavefronts in this compute unit.\n"
 	"\n"
 	"Section '[ FrontEnd ]': parameters for fetch and issue.\n"
 	"\n"
@@ -218,6 +254,10 @@ const std::string Timing::help_message =
 	"      Latency of register file writes in number of cycles.\n"
 	"  WriteBufferSize = <num> (Default = 1)\n"
 	"      Size of the buffer holding register write instructions.\n"
+	"  CoalesceGranularity = <bytes> (Default = 64)\n"
+	"      Size of the blocks that the global memory accesses of all\n"
+	"      work-items in a wavefront are coalesced into. Each block\n"
+	"      is accessed once in the vector cache.\n"
 	"\n"
 	"Section '[ LDS ]': defines the parameters of the Local Data Share\n"
 	"on each compute unit.\n"
@@ -256,6 +296,25 @@ Timing::Timing() : comm::Timing("SouthernIslands")
 			trace_version_major, trace_version_minor,
 			gpu->num_compute_units));
 
+	// Open time series of wavefront states, with a header naming the
+	// columns
+	if (!wavefront_states_file.empty())
+	{
+		wavefront_states_stream.open(wavefront_states_file);
+		if (!wavefront_states_stream.good())
+			throw Error(misc::fmt("%s: Cannot open wavefront "
+					"states file",
+					wavefront_states_file.c_str()));
+		wavefront_states_stream << "Cycle ComputeUnit";
+		for (int i = 0; i < ComputeUnit::WavefrontStateCount; i++)
+			wavefront_states_stream << ' ' << ComputeUnit::
+					wavefront_state_map[i];
+		wavefront_states_stream << " ResidentWavefronts "
+				"WavefrontLimit\n";
+		wavefront_states_last.resize(Gpu::num_compute_units *
+				(ComputeUnit::WavefrontStateCount + 2));
+	}
+
 	// Debug info
 	Emulator::scheduler_debug << "SI Gpu with " << gpu->num_compute_units 
 			<< " compute unit is created\n";
@@ -672,6 +731,23 @@ void Timing::RegisterOptions()
 	command_line->RegisterString("--si-debug <file>", pipeline_debug_file,
 			"Reports the details of the SI pipeline units in every "
 			"cycle.");
+
+	// Option --si-wavefront-states <file>
+	command_line->RegisterString("--si-wavefront-states <file>",
+			wavefront_states_file,
+			"File to dump a time series of the state of the wavefronts "
+			"in each compute unit. Every interval, a line is added for "
+			"each compute unit with the wavefront pool entries "
+			"accounted to every state (issued, waiting for memory, at "
+			"a barrier, etc.) in that interval, followed by the "
+			"resident wavefronts and the occupancy limit. The totals "
+			"are included in the report of option '--si-report'.");
+
+	// Option --si-wavefront-states-interval <cycles>
+	command_line->RegisterInt64("--si-wavefront-states-interval <cycles> "
+			"(default = 10000)", wavefront_states_interval,
+			"Number of cycles between lines of the wavefront states "
+			"time series given with option '--si-wavefront-states'.");
 }
 
 
@@ -682,6 +758,11 @@ void Timing::ProcessOptions()
 	if (!config_file.empty())
 		ini_file.Load(config_file);
 		
+	// Check valid interval in '--si-wavefront-states-interval'
+	if (wavefront_states_interval < 1)
+		throw Error("Value for '--si-wavefront-states-interval' must be "
+				"greater than 0");
+
 	// Instantiate timing simulator if '--si-sim detailed' is present
 	if (sim_kind == comm::Arch::SimDetailed)
 	{
@@ -720,6 +801,9 @@ void Timing::ParseConfiguration(misc::IniFile *ini_file)
 				ini_file->getPath().c_str()));
 	Gpu::num_compute_units = ini_file->ReadInt(section, "NumComputeUnits",
 						   Gpu::num_compute_units);
+	Gpu::dispatch_policy = (Gpu::DispatchPolicy) ini_file->ReadEnum(section,
+			"DispatchPolicy", Gpu::dispatch_policy_map,
+			Gpu::DispatchPolicyFifo);
 
 	// Section [ComputeUnit]
 	section = "ComputeUnit";
@@ -733,6 +817,30 @@ void Timing::ParseConfiguration(misc::IniFile *ini_file)
 					ComputeUnit::max_wavefronts_per_wavefront_pool);
 	//TODO ComputeUnit::num_vector_registers
 	//TODO ComputeUnit::num_scalar_register
+	ComputeUnit::default_scheduling_policy =
+			(ComputeUnit::SchedulingPolicy) ini_file->ReadEnum(
+			section, "SchedulingPolicy",
+			ComputeUnit::scheduling_policy_map,
+			ComputeUnit::SchedulingPolicyFixed);
+	ComputeUnit::max_active_wavefronts = ini_file->ReadInt(section,
+					"MaxActiveWavefronts",
+					ComputeUnit::max_active_wavefronts);
+	if (ComputeUnit::max_active_wavefronts < 1)
+		throw Error(misc::fmt("%s: The value for 'MaxActiveWavefronts' "
+				"must be greater than 0.\n",
+				ini_file->getPath().c_str()));
+
+	// Sections [ComputeUnit <index>]
+	ComputeUnit::scheduling_policies.clear();
+	for (int i = 0; i < Gpu::num_compute_units; i++)
+	{
+		section = misc::fmt("ComputeUnit %d", i);
+		ComputeUnit::scheduling_policies.push_back(
+				(ComputeUnit::SchedulingPolicy) ini_file->ReadEnum(
+				section, "SchedulingPolicy",
+				ComputeUnit::scheduling_policy_map,
+				ComputeUnit::default_scheduling_policy));
+	}
 
 	// Section [FrontEnd]
 	section = "FrontEnd";
@@ -838,6 +946,7 @@ void Timing::ParseConfiguration(misc::IniFile *ini_file)
 					LdsUnit::write_buffer_size);
 
 	// Section [VectorMemUnit]
+	section = "VectorMemUnit";
 	VectorMemoryUnit::width = ini_file->ReadInt(section, "Width",
 					VectorMemoryUnit::width);
 	VectorMemoryUnit::issue_buffer_size = ini_file->ReadInt(section,
@@ -862,6 +971,18 @@ void Timing::ParseConfiguration(misc::IniFile *ini_file)
 	VectorMemoryUnit::write_buffer_size = ini_file->ReadInt(section,
 					"WriteBufferSize",
 					VectorMemoryUnit::write_buffer_size);
+	VectorMemoryUnit::coalesce_granularity = ini_file->ReadInt(section,
+					"CoalesceGranularity",
+					VectorMemoryUnit::coalesce_granularity);
+	if (VectorMemoryUnit::coalesce_granularity < 1 ||
+			VectorMemoryUnit::coalesce_granularity >
+			(int) mem::Mmu::PageSize ||
+			(VectorMemoryUnit::coalesce_granularity &
+			(VectorMemoryUnit::coalesce_granularity - 1)))
+		throw Error(misc::fmt("%s: The value for 'CoalesceGranularity' "
+				"must be a power of 2 no greater than the "
+				"page size.\n",
+				ini_file->getPath().c_str()));
 
 	// TODO Section [LDS]
 	// Enforce only the allowed variables
@@ -874,6 +995,8 @@ void Timing::DumpConfiguration(std::ofstream &os) const
 	os << misc::fmt("[ Config.Device ]\n");
 	os << misc::fmt("Frequency = %d\n", frequency);
 	os << misc::fmt("NumComputeUnits = %d\n", Gpu::num_compute_units);
+	os << misc::fmt("DispatchPolicy = %s\n", Gpu::dispatch_policy_map
+			.MapValue(Gpu::dispatch_policy));
 	os << misc::fmt("\n");
 
 	// Compute Unit
@@ -885,6 +1008,11 @@ void Timing::DumpConfiguration(std::ofstream &os) const
 			ComputeUnit::max_work_groups_per_wavefront_pool);
 	os << misc::fmt("MaxWavefrontsPerWavefrontPool = %d\n",
 			ComputeUnit::max_wavefronts_per_wavefront_pool);
+	os << misc::fmt("SchedulingPolicy = %s\n",
+			ComputeUnit::scheduling_policy_map.MapValue(
+			ComputeUnit::default_scheduling_policy));
+	os << misc::fmt("MaxActiveWavefronts = %d\n",
+			ComputeUnit::max_active_wavefronts);
 	os << misc::fmt("\n");
 
 	// Front-End
@@ -978,6 +1106,8 @@ void Timing::DumpConfiguration(std::ofstream &os) const
 	os << misc::fmt("WriteLatency = %d\n", VectorMemoryUnit::write_latency);
 	os << misc::fmt("WriteBufferSize = %d\n",
 			VectorMemoryUnit::write_buffer_size);
+	os << misc::fmt("CoalesceGranularity = %d\n",
+			VectorMemoryUnit::coalesce_granularity);
 	os << misc::fmt("\n");
 
 	// LDS
@@ -1017,8 +1147,117 @@ void Timing::DumpSummary(std::ostream &os) const
 }
 
 
+void Timing::DumpWavefrontStates(std::ostream &os,
+		const std::vector<ComputeUnit *> &compute_units) const
+{
+	// Add up statistics of all compute units, which account for the same
+	// cycles
+	long long wavefront_states[ComputeUnit::WavefrontStateCount] = { };
+	long long num_cycles = 0;
+	long long num_resident_wavefronts = 0;
+	long long num_occupancy_limit = 0;
+	for (ComputeUnit *compute_unit : compute_units)
+	{
+		for (int i = 0; i < ComputeUnit::WavefrontStateCount; i++)
+			wavefront_states[i] += compute_unit->wavefront_states[i];
+		num_cycles = std::max(num_cycles,
+				compute_unit->num_accounted_cycles);
+		num_resident_wavefronts +=
+				compute_unit->num_resident_wavefronts;
+		num_occupancy_limit += compute_unit->num_occupancy_limit;
+	}
+
+	// Header
+	os << "; Wavefront states (sum = cycles * wavefront pool entries)\n";
+	os << ";    Issued - instruction issued\n";
+	os << ";    ExecutionUnitBusy - instruction ready to issue, but its\n";
+	os << ";        execution unit was busy or its fetch buffer not issuing\n";
+	os << ";    FetchBufferEmpty - no instruction ready to issue, being\n";
+	os << ";        fetched or waiting to be fetched\n";
+	os << ";    InFlight - previous instruction still executing\n";
+	os << ";    VectorMemory, ScalarMemory, LDS - waiting for memory\n";
+	os << ";    Barrier - waiting for the work-group at a barrier\n";
+	os << ";    Finished - waiting for the rest of the work-group\n";
+	os << ";    NoWavefront - entry not used by any wavefront\n";
+
+	// States
+	long long total = 0;
+	for (int i = 0; i < ComputeUnit::WavefrontStateCount; i++)
+	{
+		os << misc::fmt("WavefrontStates.%s = %lld\n",
+				ComputeUnit::wavefront_state_map[i],
+				wavefront_states[i]);
+		total += wavefront_states[i];
+	}
+	os << misc::fmt("WavefrontStates.Total = %lld\n", total);
+
+	// Occupancy, as the average number of resident wavefronts per cycle,
+	// and the average limit given by the resources of the mapped
+	// ND-ranges
+	os << misc::fmt("Occupancy.ResidentWavefronts = %.4g\n", num_cycles ?
+			(double) num_resident_wavefronts / num_cycles : 0.0);
+	os << misc::fmt("Occupancy.WavefrontLimit = %.4g\n", num_cycles ?
+			(double) num_occupancy_limit / num_cycles : 0.0);
+	os << misc::fmt("Occupancy.Achieved = %.4g\n", num_occupancy_limit ?
+			(double) num_resident_wavefronts / num_occupancy_limit :
+			0.0);
+}
+
+
+void Timing::DumpWavefrontStatesInterval() const
+{
+	wavefront_states_dumped_cycle = wavefront_states_cycle;
+	long long *last = wavefront_states_last.data();
+	for (auto it = gpu->getComputeUnitsBegin(),
+			e = gpu->getComputeUnitsEnd();
+			it != e;
+			++it)
+	{
+		// States in the interval
+		ComputeUnit *compute_unit = it->get();
+		wavefront_states_stream << wavefront_states_cycle << ' '
+				<< compute_unit->getIndex();
+		for (int i = 0; i < ComputeUnit::WavefrontStateCount; i++)
+		{
+			wavefront_states_stream << ' ' <<
+					compute_unit->wavefront_states[i] -
+					last[i];
+			last[i] = compute_unit->wavefront_states[i];
+		}
+		last += ComputeUnit::WavefrontStateCount;
+
+		// Occupancy in the interval
+		wavefront_states_stream << ' ' <<
+				compute_unit->num_resident_wavefronts - last[0];
+		wavefront_states_stream << ' ' <<
+				compute_unit->num_occupancy_limit - last[1];
+		wavefront_states_stream << '\n';
+		last[0] = compute_unit->num_resident_wavefronts;
+		last[1] = compute_unit->num_occupancy_limit;
+		last += 2;
+	}
+}
+
+
+void Timing::FlushWavefrontStates() const
+{
+	// Nothing to add if there is no time series, or no cycles were
+	// recorded after its last line
+	if (!wavefront_states_stream.is_open() ||
+			wavefront_states_cycle == wavefront_states_dumped_cycle)
+		return;
+
+	// Last interval
+	DumpWavefrontStatesInterval();
+	wavefront_states_stream.flush();
+}
+
+
 void Timing::DumpReport() const
 {
+	// Finish the time series of wavefront states
+	FlushWavefrontStates();
+
 	// Check if the report file has been set
 	if (report_file.empty())
 		return;
@@ -1052,7 +1291,17 @@ void Timing::DumpReport() const
 			emulator->num_vector_memory_instructions);                                  
 	report << misc::fmt("Cycles = %lld\n", getCycle());                  
 	report << misc::fmt("InstructionsPerCycle = %.4g\n", instructions_per_cycle);             
-	report << misc::fmt("\n\n");                                                      
+	report << misc::fmt("\n");
+
+	// Wavefront states of all compute units
+	std::vector<ComputeUnit *> compute_units;
+	for (auto it = gpu->getComputeUnitsBegin(),
+			e = gpu->getComputeUnitsEnd();
+			it != e;
+			++it)
+		compute_units.push_back(it->get());
+	DumpWavefrontStates(report, compute_units);
+	report << misc::fmt("\n\n");
 
 	// Report for compute units  
 	for (auto it = gpu->getComputeUnitsBegin(), 
@@ -1106,6 +1355,31 @@ void Timing::DumpReport() const
 		report << misc::fmt("LDS.Writes = %lld\n", compute_unit->getLdsModule()->num_writes);              
 		report << misc::fmt("LDS.CoalescedWrites = %lld\n",                       
 				coalesced_writes); 
+		report << misc::fmt("\n");
+		report << misc::fmt("VectorMem.WorkItemAccesses = %lld\n",
+				compute_unit->getVectorMemoryUnit()->
+				num_work_item_accesses);
+		report << misc::fmt("VectorMem.BlockAccesses = %lld\n",
+				compute_unit->getVectorMemoryUnit()->
+				num_block_accesses);
+		report << misc::fmt("\n");
+		report << misc::fmt("SchedulingPolicy = %s\n",
+				ComputeUnit::scheduling_policy_map.MapValue(
+				compute_unit->getSchedulingPolicy()));
+		report << misc::fmt("Stalls.Scheduler = %lld\n",
+				compute_unit->num_scheduler_stalls);
+		report << misc::fmt("Stalls.Pending = %lld\n",
+				compute_unit->num_pending_stalls);
+		report << misc::fmt("Stalls.Memory = %lld\n",
+				compute_unit->num_memory_stalls);
+		report << misc::fmt("Stalls.Barrier = %lld\n",
+				compute_unit->num_barrier_stalls);
+		report << misc::fmt("Stalls.FetchBuffer = %lld\n",
+				compute_unit->num_fetch_buffer_stalls);
+		report << misc::fmt("Stalls.Issue = %lld\n",
+				compute_unit->num_issue_stalls);
+		report << misc::fmt("\n");
+		DumpWavefrontStates(report, { compute_unit });
 		report << misc::fmt("\n\n");                                              
 	}         
 
@@ -1124,11 +1398,8 @@ bool Timing::Run()
 	if (!emulator->getNumNDRanges())
 		return false;
 
-	// TODO instead of statically allocating the whole GPU to one NDRange
-	// which wastes the resources, dynamically add the workgroups of
-	// different NDRanges to the compute units, if all work groups of
-	// the current NDRange is scheduled, and resources are available
-	// Add any available work groups to the waiting list
+	// Map ND-ranges with work groups waiting to be dispatched. Several
+	// ND-ranges can be mapped at the same time, sharing the compute units.
 	for (auto it = emulator->getNDRangesBegin();
 			it != emulator->getNDRangesEnd();
 			++it)
@@ -1136,57 +1407,27 @@ bool Timing::Run()
 		// Get pointer to NDRange
 		NDRange *ndrange = it->get();
 
-		// Setup WorkGroup pointer
-		WorkGroup *work_group = nullptr;
-
+		// Create its address space the first time it is seen
 		if (ndrange->address_space == nullptr)
-		{
-			// TODO the problem is that the NDRange keeps getting
-			// mapped and unmapped since the waitingworkgroups list
-			// of ndrange only grows with the driver calls.
-			// This solution doesn't work.
 			ndrange->address_space = gpu->getMmu()
 					->newSpace("Southern Islands");
+
+		// Map it
+		if (!ndrange->isWaitingWorkGroupsEmpty() &&
+				!gpu->isNDRangeMapped(ndrange))
 			gpu->MapNDRange(ndrange);
-		}
+	}
 
-		// If the waiting list is not empty
-		if (!ndrange->isWaitingWorkGroupsEmpty())
-		{
-			// Save the number of waiting work groups
-			unsigned num_waiting_work_groups = ndrange->
-					getNumWaitingWorkgroups();
-
-			// Map work groups to compute units
-			for (unsigned i = 0; i < num_waiting_work_groups; i++)
-			{
-				// Get an available compute unit
-				ComputeUnit *available_compute_unit =
-						gpu->getAvailableComputeUnit();
-
-				// Exit if no compute unit available
-				if (!available_compute_unit)
-					break;
-
-				// Remove work group from list and get its ID
-				long work_group_id = ndrange->GetWaitingWorkGroup();
-				work_group = ndrange->ScheduleWorkGroup(work_group_id);
-
-				// If the last work group is sent, then set the value
-				// to true
-				if (ndrange->isWaitingWorkGroupsEmpty())
-					ndrange->setLastWorkgroupSent(true);
-
-				// Remove it from the available compute units list.
-				// It will be re-added later if it still has room for
-				// more work groups.
-				gpu->RemoveFromAvailableComputeUnits(
-						available_compute_unit);
-
-				// Map the work group to a compute unit
-				available_compute_unit->MapWorkGroup(work_group);
-			}
-		}
+	// Dispatch waiting work groups to compute units
+	gpu->DispatchWorkGroups();
+
+	// Unmap finished ND-ranges
+	for (auto it = emulator->getNDRangesBegin();
+			it != emulator->getNDRangesEnd();
+			++it)
+	{
+		// Get pointer to NDRange
+		NDRange *ndrange = it->get();
 
 		if (ndrange->isRunningWorkGroupsEmpty() &&
 				ndrange->LastWorkGroupSent())
@@ -1227,6 +1468,15 @@ bool Timing::Run()
 	// Run one loop iteration on each busy compute unit
 	gpu->Run();
 
+	// Sample wavefront states time series. The last interval is added
+	// when the report is dumped.
+	if (wavefront_states_stream.is_open())
+	{
+		wavefront_states_cycle = getCycle();
+		if (wavefront_states_cycle % wavefront_states_interval == 0)
+			DumpWavefrontStatesInterval();
+	}
+
 	// Still running
 	return true;
 }
@@ -65,6 +65,12 @@ class Timing : public comm::Timing
 	// Frequency of memory system in MHz
 	static int frequency;
 
+	// File to dump the time series of wavefront states
+	static std::string wavefront_states_file;
+
+	// Number of cycles between samples of the wavefront states
+	static long long wavefront_states_interval;
+
 
 	
 	
@@ -78,6 +84,35 @@ class Timing : public comm::Timing
 	// List of entry modules to the memory hierarchy
 	std::vector<mem::Module *> entry_modules;
 
+	// Time series of wavefront states, if requested by the user. The
+	// last interval, usually shorter than the others, is added when the
+	// report is dumped.
+	mutable std::ofstream wavefront_states_stream;
+
+	// Statistics of each compute unit added to the time series so far,
+	// with the wavefront states followed by the resident wavefronts and
+	// the occupancy limit
+	mutable std::vector<long long> wavefront_states_last;
+
+	// Last cycle when the wavefront states were recorded
+	long long wavefront_states_cycle = 0;
+
+	// Cycle of the last line of the time series
+	mutable long long wavefront_states_dumped_cycle = 0;
+
+	// Dump the wavefront states and occupancy added up for the given
+	// compute units
+	void DumpWavefrontStates(std::ostream &os,
+			const std::vector<ComputeUnit *> &compute_units) const;
+
+	// Add one line per compute unit to the time series of wavefront
+	// states, with the values in the last interval
+	void DumpWavefrontStatesInterval() const;
+
+	// Add the cycles recorded after the last line of the time series of
+	// wavefront states, if any
+	void FlushWavefrontStates() const;
+
 public:
 
 	//
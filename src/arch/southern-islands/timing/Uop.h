@@ -116,9 +116,6 @@ public:
 		// Active after instruction emulation
 		bool active = true;
 
-		// Mark a work item that has successfully made a cache access
-		bool accessed_cache = false;
-
 		// Number of lds_accesses
 		int lds_access_count;
 
@@ -131,6 +128,28 @@ public:
 	/// in wavefront.
 	std::vector<WorkItemInfo> work_item_info_list;
 
+	/// Block of global memory accessed by a vector memory instruction,
+	/// combining the accesses of all work-items that fall into it
+	struct BlockAccess
+	{
+		// Virtual address of the block
+		unsigned virtual_address;
+
+		// Physical address of the block
+		unsigned physical_address;
+
+		// Mark a block that has successfully made a cache access
+		bool accessed_cache = false;
+	};
+
+	/// Blocks accessed by a vector memory instruction, in the order in
+	/// which work-items first access them
+	std::vector<BlockAccess> block_accesses;
+
+	/// Flag indicating whether the accesses of the work-items were
+	/// coalesced into 'block_accesses'
+	bool coalesced = false;
+
 	/// Return the unique identifier assigned in sequential order to the
 	/// uop when it was created.
 	long long getId() const { return id; }
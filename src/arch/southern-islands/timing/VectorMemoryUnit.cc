@@ -17,6 +17,8 @@
  *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  */
 
+#include <algorithm>
+
 #include <arch/southern-islands/emulator/Wavefront.h>
 #include <arch/southern-islands/emulator/WorkGroup.h>
 #include <arch/southern-islands/emulator/NDRange.h>
@@ -40,6 +42,7 @@ int VectorMemoryUnit::read_buffer_size = 1;
 int VectorMemoryUnit::max_inflight_mem_accesses = 32;
 int VectorMemoryUnit::write_latency = 1;
 int VectorMemoryUnit::write_buffer_size = 1;
+int VectorMemoryUnit::coalesce_granularity = 64;
 
 
 void VectorMemoryUnit::Run()
@@ -74,7 +77,7 @@ void VectorMemoryUnit::Issue(std::unique_ptr<Uop> uop)
 
 	// One more instruction of this kind
 	compute_unit->num_vector_memory_instructions++;
-	uop->getWavefrontPoolEntry()->lgkm_cnt++;
+	uop->getWavefrontPoolEntry()->vm_cnt++;
 
 	// Issue it
 	ExecutionUnit::Issue(std::move(uop));
@@ -82,9 +85,8 @@ void VectorMemoryUnit::Issue(std::unique_ptr<Uop> uop)
 
 void VectorMemoryUnit::Complete()
 {
-	// Get compute unit and GPU objects
+	// Get compute unit
 	ComputeUnit *compute_unit = getComputeUnit();
-	Gpu *gpu = compute_unit->getGpu();
 
 	// Sanity check the write buffer
 	assert((int) write_buffer.size() <= width);
@@ -101,8 +103,8 @@ void VectorMemoryUnit::Complete()
 			break;
 	
 		// Access complete, remove the uop from the queue
-		assert(uop->getWavefrontPoolEntry()->lgkm_cnt > 0);
-		uop->getWavefrontPoolEntry()->lgkm_cnt--;
+		assert(uop->getWavefrontPoolEntry()->vm_cnt > 0);
+		uop->getWavefrontPoolEntry()->vm_cnt--;
 		
 		// Record trace
 		Timing::trace << misc::fmt("si.end_inst "
@@ -121,7 +123,8 @@ void VectorMemoryUnit::Complete()
 
 		// Statistics
 		num_instructions++;
-		gpu->last_complete_cycle = compute_unit->getTiming()->getCycle();
+		compute_unit->last_complete_cycle = compute_unit->getTiming()->
+				getCycle();
 	}
 }
 
@@ -300,9 +303,14 @@ void VectorMemoryUnit::Memory()
 					__FUNCTION__));
 		}
 
-		// This variable keeps track if any work items are unsuccessful
+		// Coalesce the accesses of the work-items the first time the
+		// uop reaches this stage
+		if (!uop->coalesced)
+			Coalesce(uop);
+
+		// This variable keeps track if any blocks are unsuccessful
 		// in making an access to the vector cache.
-		bool all_work_items_accessed = true;
+		bool all_blocks_accessed = true;
 
 		// Access global memory
 		assert(!uop->global_memory_witness);
@@ -314,71 +322,41 @@ void VectorMemoryUnit::Memory()
 				uop->getIdInWavefront(),
 				uop->getWorkGroup()->getId(),
 				uop->getWavefront()->getId());
-		for (auto wi_it = uop->getWavefront()->getWorkItemsBegin(),
-				wi_e = uop->getWavefront()->getWorkItemsEnd();
-				wi_it != wi_e;
-				++wi_it)
+		for (Uop::BlockAccess &block_access : uop->block_accesses)
 		{
-			// Get work item
-			WorkItem *work_item = wi_it->get();
-
-			// Access memory for each active work-item
-			if (uop->getWavefront()->isWorkItemActive(
-					work_item->getIdInWavefront()))
+			// Check if the block has already made a successful
+			// vector cache access. If so, move on to the next block.
+			if (block_access.accessed_cache)
+				continue;
+
+			// Make sure we can access the vector cache. If so,
+			// submit the access and mark the accessed flag of the
+			// block.
+			if (compute_unit->vector_cache->canAccess(
+					block_access.physical_address))
 			{
-				// Get the work item uop
-				Uop::WorkItemInfo *work_item_info = 
-						&uop->work_item_info_list[
-						work_item->getIdInWavefront()];
-
-				// Check if the work item info struct has
-				// already made a successful vector cache
-				// access. If so, move on to the next work item.
-				if (work_item_info->accessed_cache)	
-					continue;
-
-				// Translate virtual address to a physical 
-				// address
-				unsigned physical_address = compute_unit->
-						getGpu()->
-						getMmu()->
-						TranslateVirtualAddress(
-						uop->getWorkGroup()->
-						getNDRange()->
-						address_space,
-						work_item_info->
-						global_memory_access_address);
-		
-
-				// Make sure we can access the vector cache. If 
-				// so, submit the access. If we can access the
-				// cache, mark the accessed flag of the work 
-				// item info struct.
-				if (compute_unit->vector_cache->
-						canAccess(physical_address))
-				{
-					compute_unit->vector_cache->Access(
-							module_access_type,
-							physical_address, 
-							&uop->global_memory_witness);
-					work_item_info->accessed_cache = true;
-
-					// Access global memory
-					uop->global_memory_witness--;
-				}
-				else
-				{
-					all_work_items_accessed = false;
-				}
+				compute_unit->vector_cache->Access(
+						module_access_type,
+						block_access.physical_address,
+						&uop->global_memory_witness);
+				block_access.accessed_cache = true;
+
+				// Access global memory
+				uop->global_memory_witness--;
+				num_block_accesses++;
+			}
+			else
+			{
+				all_blocks_accessed = false;
 			}
 		}
 
-		// Make sure that all the work items in the wavefront have 
+		// Make sure that all the blocks accessed by the wavefront have
 		// successfully accessed the vector cache. If not, the uop
 		// is not moved to the write buffer. Instead, the uop will
-		// be re-processed next cycle. Once all work items access
-		// the vector cache, the uop will be moved to the write buffer.
-		if (!all_work_items_accessed)
+		// be re-processed next cycle. Once all blocks access the
+		// vector cache, the uop will be moved to the write buffer.
+		if (!all_blocks_accessed)
 			continue;
 
 
@@ -401,6 +379,95 @@ void VectorMemoryUnit::Memory()
 	}
 }
 
+void VectorMemoryUnit::Coalesce(Uop *uop)
+{
+	// Blocks accessed by each active work-item
+	Wavefront *wavefront = uop->getWavefront();
+	for (int id_in_wavefront = 0; id_in_wavefront <
+			(int) uop->work_item_info_list.size();
+			id_in_wavefront++)
+	{
+		// Skip inactive work-items
+		if (!wavefront->isWorkItemActive(id_in_wavefront))
+			continue;
+
+		// Range of blocks accessed
+		Uop::WorkItemInfo *work_item_info =
+				&uop->work_item_info_list[id_in_wavefront];
+		unsigned address = work_item_info->global_memory_access_address;
+		unsigned size = std::max(1u,
+				work_item_info->global_memory_access_size);
+		unsigned block_mask = ~(coalesce_granularity - 1);
+		unsigned first_block = address & block_mask;
+		unsigned last_block = (address + size - 1) & block_mask;
+		num_work_item_accesses++;
+
+		// Add blocks not accessed by previous work-items
+		for (unsigned block = first_block; ; block += coalesce_granularity)
+		{
+			// Look for the block starting with the most recent one,
+			// which neighbor work-items usually share
+			auto it = std::find_if(uop->block_accesses.rbegin(),
+					uop->block_accesses.rend(),
+					[block](const Uop::BlockAccess &block_access)
+					{
+						return block_access.virtual_address
+								== block;
+					});
+
+			// New block
+			if (it == uop->block_accesses.rend())
+			{
+				Uop::BlockAccess block_access;
+				block_access.virtual_address = block;
+				uop->block_accesses.push_back(block_access);
+			}
+
+			// Last block
+			if (block == last_block)
+				break;
+		}
+	}
+
+	// Translate the blocks, creating pages in the order in which they are
+	// first accessed
+	Translate(uop);
+
+	// Done
+	uop->coalesced = true;
+}
+
+
+void VectorMemoryUnit::Translate(Uop *uop)
+{
+	// Get MMU and address space
+	mem::Mmu *mmu = getComputeUnit()->getGpu()->getMmu();
+	mem::Mmu::Space *address_space = uop->getWorkGroup()->getNDRange()->
+			address_space;
+
+	// Blocks are translated only if they are in a different page than the
+	// previous one
+	bool page_translated = false;
+	unsigned virtual_page = 0;
+	unsigned physical_page = 0;
+	for (Uop::BlockAccess &block_access : uop->block_accesses)
+	{
+		unsigned block = block_access.virtual_address;
+		if (!page_translated || (block & mem::Mmu::PageMask) !=
+				virtual_page)
+		{
+			virtual_page = block & mem::Mmu::PageMask;
+			physical_page = mmu->TranslateVirtualAddress(
+					address_space,
+					virtual_page);
+			page_translated = true;
+		}
+		block_access.physical_address = physical_page +
+				(block & ~mem::Mmu::PageMask);
+	}
+}
+
+
 void VectorMemoryUnit::Read()
 {
 	// Get compute unit object
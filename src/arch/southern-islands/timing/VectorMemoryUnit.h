@@ -44,6 +44,9 @@ class VectorMemoryUnit : public ExecutionUnit
 	// Variable number of register instructions
 	std::deque<std::unique_ptr<Uop>> write_buffer;
 
+	// Translate the virtual addresses of the blocks accessed by a uop
+	void Translate(Uop *uop);
+
 public:
 
 	//
@@ -77,6 +80,10 @@ public:
 	/// Size of the write buffer in number of entries
 	static int write_buffer_size;
 
+	/// Size in bytes of the blocks that the global memory accesses of the
+	/// work-items in a wavefront are coalesced into
+	static int coalesce_granularity;
+
 
 
 
@@ -117,6 +124,12 @@ public:
 
 	// Number of vector memory instructions
 	long long num_instructions;
+
+	/// Number of global memory accesses of individual work-items
+	long long num_work_item_accesses = 0;
+
+	/// Number of vector cache accesses after coalescing
+	long long num_block_accesses = 0;
 	
 	/// Return whether there is room in the issue buffer of the
 	/// vector memory unit to absorb a new instruction.
@@ -131,6 +144,12 @@ public:
 
 	/// Issue the given instruction into the vector memory unit
 	void Issue(std::unique_ptr<Uop> uop) override;
+
+	/// Group the global memory accesses of the active work-items of a uop
+	/// into accesses to blocks of 'coalesce_granularity' bytes, in the
+	/// order in which work-items first access them, and translate their
+	/// addresses.
+	void Coalesce(Uop *uop);
 };
 
 }
@@ -20,6 +20,7 @@
 #include <arch/southern-islands/emulator/WorkGroup.h>
 
 #include "ComputeUnit.h"
+#include "Gpu.h"
 #include "VectorMemoryUnit.h"
 #include "WavefrontPool.h"
 
@@ -34,6 +35,7 @@ void WavefrontPoolEntry::Clear()
 	assert(!vm_cnt);
 	assert(!exp_cnt);
 	assert(!lgkm_cnt);
+	assert(!lds_cnt);
 	assert(!mem_wait);
 	assert(!wait_for_barrier);
 
@@ -44,6 +46,8 @@ void WavefrontPoolEntry::Clear()
 	ready = false;
 	ready_next_cycle = false;
 	wavefront_finished = false;
+	active = false;
+	issue_cycle = -1;
 }
 
 
@@ -60,14 +64,31 @@ WavefrontPool::WavefrontPool(int id, ComputeUnit *compute_unit) :
 }
 
 
-void WavefrontPool::MapWavefronts(WorkGroup *work_group)
+bool WavefrontPool::canMapWorkGroup(const WorkGroupResources &resources) const
 {
-	// Determine starting ID for wavefronts in the instruction buffer
-	int wg_id_in_wfp = work_group->getIdInComputeUnit() /
-			ComputeUnit::num_wavefront_pools;
-	int first_entry = wg_id_in_wfp * work_group->getWavefrontsInWorkgroup();
+	return num_work_groups < ComputeUnit::max_work_groups_per_wavefront_pool &&
+			num_wavefronts + resources.num_wavefronts <=
+			ComputeUnit::max_wavefronts_per_wavefront_pool &&
+			num_vector_registers + resources.num_vector_registers <=
+			Gpu::num_vector_registers &&
+			num_scalar_registers + resources.num_scalar_registers <=
+			Gpu::num_scalar_registers &&
+			local_memory_size + resources.local_memory_size <=
+			Gpu::lds_size;
+}
+
 
-	// Initialize entry index within wavefront pool
+void WavefrontPool::MapWavefronts(WorkGroup *work_group,
+		const WorkGroupResources &resources)
+{
+	// Make sure the work-group fits
+	assert(canMapWorkGroup(resources));
+	assert(resources.num_wavefronts ==
+			(int) work_group->getWavefrontsInWorkgroup());
+
+	// Initialize entry index within wavefront pool. Work-groups of
+	// different ND-ranges can have a different number of wavefronts, so
+	// wavefronts take the first free entries.
 	int entry_index = 0;
 
 	// Assign wavefronts to the wavefront pool
@@ -79,9 +100,13 @@ void WavefrontPool::MapWavefronts(WorkGroup *work_group)
 		// Get the wavefront object
 		Wavefront *wavefront = it->get();
 
+		// Find a free entry in the wavefront pool
+		while (wavefront_pool_entries[entry_index]->valid)
+			entry_index++;
+
 		// Set entry pointer to an entry in the wavefront pool
 		WavefrontPoolEntry *wavefront_pool_entry = 
-			wavefront_pool_entries[first_entry + entry_index].get();
+			wavefront_pool_entries[entry_index].get();
 
 		// Make sure the entry was set and that it is not yet valid.
 		// Having the valid field set would indicate that it was 
@@ -98,13 +123,17 @@ void WavefrontPool::MapWavefronts(WorkGroup *work_group)
 		// Increment the number of wavefronts associated with the 
 		// wavefront pool
 		num_wavefronts++;
-
-		// Increment the entry index
-		entry_index++;
 	}
+
+	// Allocate resources
+	num_work_groups++;
+	num_vector_registers += resources.num_vector_registers;
+	num_scalar_registers += resources.num_scalar_registers;
+	local_memory_size += resources.local_memory_size;
 }
 
-void WavefrontPool::UnmapWavefronts(WorkGroup *work_group)
+void WavefrontPool::UnmapWavefronts(WorkGroup *work_group,
+		const WorkGroupResources &resources)
 {
 	// Reset mapped wavefronts
 	assert(num_wavefronts >= (int) work_group->getWavefrontsInWorkgroup());
@@ -135,6 +164,13 @@ void WavefrontPool::UnmapWavefronts(WorkGroup *work_group)
 	
 	// Adjust the number of wavefronts mapped to the wavefront pool
 	num_wavefronts -= work_group->getWavefrontsInWorkgroup();
+
+	// Release resources
+	assert(num_work_groups > 0);
+	num_work_groups--;
+	num_vector_registers -= resources.num_vector_registers;
+	num_scalar_registers -= resources.num_scalar_registers;
+	local_memory_size -= resources.local_memory_size;
 }
 
 
@@ -98,6 +98,9 @@ public:
 	/// Number of outstanding LDS, GLDS, or constant memory accesses
 	int lgkm_cnt = 0;
 
+	/// Number of outstanding LDS accesses, also counted in 'lgkm_cnt'
+	int lds_cnt = 0;
+
 
 
 	
@@ -122,6 +125,20 @@ public:
 
 	/// Indicates whether the wavefront needs to wait for a memory access
 	bool mem_wait = false;
+
+	/// Indicates whether the wavefront is in the active set of the
+	/// two-level scheduling policy
+	bool active = false;
+
+	/// Last cycle when an instruction of the wavefront was issued
+	long long issue_cycle = -1;
+
+	/// Return whether the wavefront is stalled in a wait instruction
+	/// until its outstanding memory accesses complete
+	bool isWaitingForMemory() const
+	{
+		return mem_wait && (vm_cnt || exp_cnt || lgkm_cnt);
+	}
 };
 
 
@@ -140,22 +157,63 @@ class WavefrontPool
 	// Number of wavefronts associated with the wavefront pool
 	int num_wavefronts = 0;
 
+	// Number of work-groups mapped to the wavefront pool
+	int num_work_groups = 0;
+
+	// Number of vector registers allocated to mapped work-groups
+	int num_vector_registers = 0;
+
+	// Number of scalar registers allocated to mapped work-groups
+	int num_scalar_registers = 0;
+
+	// Amount of local memory allocated to mapped work-groups
+	int local_memory_size = 0;
+
 	// Wavefront pool entries that belong to this pool
 	std::vector<std::unique_ptr<WavefrontPoolEntry>> wavefront_pool_entries;
 
+	// Index of the last entry that an instruction was fetched from, or -1
+	// if none was yet
+	int last_fetched_entry = -1;
+
 public:
 
+	/// Resources that a work-group takes from the wavefront pool it is
+	/// mapped to. All work-groups of an ND-range take the same resources.
+	struct WorkGroupResources
+	{
+		/// Number of wavefronts
+		int num_wavefronts = 0;
+
+		/// Number of vector registers
+		int num_vector_registers = 0;
+
+		/// Number of scalar registers
+		int num_scalar_registers = 0;
+
+		/// Amount of local memory in bytes
+		int local_memory_size = 0;
+	};
+
 	/// Constructor
 	WavefrontPool(int id, ComputeUnit *compute_unit);
 
 	/// Return the identifier for this wavefront pool
 	int getId() const { return id; }
 
-	/// Map wavefronts to the wavefront pool
-	void MapWavefronts(WorkGroup *work_group);
+	/// Return whether a work-group taking the given resources fits in
+	/// the wavefront pool next to the work-groups already mapped to it
+	bool canMapWorkGroup(const WorkGroupResources &resources) const;
+
+	/// Map the wavefronts of a work-group to free entries of the
+	/// wavefront pool, and allocate the resources it takes
+	void MapWavefronts(WorkGroup *work_group,
+			const WorkGroupResources &resources);
 	
-	/// Unmap wavefronts from the wavefront pool
-	void UnmapWavefronts(WorkGroup *work_group);
+	/// Unmap the wavefronts of a work-group from the wavefront pool, and
+	/// release the resources it takes
+	void UnmapWavefronts(WorkGroup *work_group,
+			const WorkGroupResources &resources);
 
 	/// Return an iterator to the first wavefront pool entry
 	/// in wavefront_pool_entries
@@ -172,6 +230,16 @@ public:
 
 	/// Return the associated compute unit
 	ComputeUnit *getComputeUnit() const { return compute_unit; }
+
+	/// Return the number of entries in the wavefront pool
+	int getNumEntries() const { return wavefront_pool_entries.size(); }
+
+	/// Return the index of the last entry that an instruction was fetched
+	/// from, or -1 if none was yet
+	int getLastFetchedEntry() const { return last_fetched_entry; }
+
+	/// Record the entry that an instruction was last fetched from
+	void setLastFetchedEntry(int index) { last_fetched_entry = index; }
 };
 
 }
@@ -552,6 +552,31 @@ private:
 	// 'repXXX' prefixes.
 	void StartRepInst();
 
+	// Return the number of iterations of a string instruction with a
+	// 'repXXX' prefix that can run in bulk within the current call to
+	// Execute(), or 0 if bulk execution is not possible. This is only
+	// the case in a functional simulation, where no micro-instructions
+	// are generated. If 'keep_last' is true, the last iteration is left
+	// to the regular execution path, since it sets the final flags.
+	unsigned getRepBulkLimit(bool keep_last);
+
+	// Return a pointer to the host copy of the string element of 'size'
+	// bytes at 'address', and in 'count' the number of consecutive
+	// elements in direction 'dir' that lie in the same page, including
+	// the first. Return null if the page is not allocated or does not
+	// grant 'access', so that the regular execution path raises the exact
+	// guest fault.
+	char *getRepBulkData(unsigned address, int size, int dir,
+			mem::Memory::AccessType access, unsigned &count);
+
+	// Bulk execution of the iterations of 'rep movs', 'rep stos',
+	// 'repz/repnz cmps', and 'repz/repnz scas' that follow the first one.
+	// Argument 'repz' is true for prefix 'repz', and false for 'repnz'.
+	void ExecuteRepBulkMovs(int size);
+	void ExecuteRepBulkStos(int size);
+	void ExecuteRepBulkCmps(int size, bool repz);
+	void ExecuteRepBulkScas(int size, bool repz);
+
 	// Load from register/memory
 	unsigned char LoadRm8();
 	unsigned short LoadRm16();
@@ -870,6 +895,25 @@ public:
 
 
 
+	//
+	// Checkpoints (ContextCheckpoint.cc)
+	//
+
+	/// Save the architectural state of the context into a checkpoint
+	/// stream. Objects shared with a context saved earlier, such as the
+	/// memory image or the file table, are saved as a reference to the
+	/// first context sharing them. A context in speculative mode is saved
+	/// in its last non-speculative state.
+	void SaveCheckpoint(std::ostream &os) const;
+
+	/// Restore the state of a context just created with
+	/// Emulator::newContext() from a checkpoint stream. Contexts must be
+	/// restored in the same order in which they were saved.
+	void LoadCheckpoint(std::istream &is);
+
+
+
+
 	//
 	// Context lists
 	//
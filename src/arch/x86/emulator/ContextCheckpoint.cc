@@ -0,0 +1,377 @@
+/*
+ *  Multi2Sim
+ *  Copyright (C) 2015  Rafael Ubal (ubal@ece.neu.edu)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <lib/esim/Engine.h>
+
+#include "Context.h"
+#include "Emulator.h"
+
+
+namespace x86
+{
+
+// Save a vector of strings into a checkpoint stream
+static void SaveStrings(std::ostream &os, const std::vector<std::string> &v)
+{
+	unsigned size = v.size();
+	misc::WriteBinary(os, size);
+	for (auto &s : v)
+		misc::WriteBinaryString(os, s);
+}
+
+
+// Load a vector of strings saved with SaveStrings()
+static void LoadStrings(std::istream &is, std::vector<std::string> &v)
+{
+	unsigned size = 0;
+	misc::ReadBinary(is, size);
+	for (unsigned i = 0; i < size && is; i++)
+		v.emplace_back(misc::ReadBinaryString(is));
+}
+
+
+void Context::SaveCheckpoint(std::ostream &os) const
+{
+	// Find the first contexts sharing objects with this one
+	const Context *memory_owner = this;
+	const Context *loader_owner = this;
+	const Context *file_table_owner = this;
+	const Context *signal_handler_table_owner = this;
+	for (auto it = emulator->getContextsBegin(); it->get() != this; ++it)
+	{
+		Context *context = it->get();
+		if (memory_owner == this && context->memory == memory)
+			memory_owner = context;
+		if (loader_owner == this && context->loader == loader)
+			loader_owner = context;
+		if (file_table_owner == this &&
+				context->file_table == file_table)
+			file_table_owner = context;
+		if (signal_handler_table_owner == this &&
+				context->signal_handler_table ==
+				signal_handler_table)
+			signal_handler_table_owner = context;
+	}
+
+	// Identifier and state. A context is saved as unmapped, and in its
+	// last non-speculative state.
+	bool spec_mode = getState(StateSpecMode);
+	unsigned saved_state = state & ~(StateSpecMode | StateAlloc |
+			StateMapped);
+	misc::WriteBinary(os, getId());
+	misc::WriteBinary(os, saved_state);
+	misc::WriteBinary(os, spec_mode ? backup_regs : regs);
+
+	// Parent contexts
+	misc::WriteBinary(os, parent ? parent->getId() : 0);
+	misc::WriteBinary(os, group_parent ? group_parent->getId() : 0);
+
+	// Memory image, shared with the MMU space
+	misc::WriteBinary(os, memory_owner->getId());
+	if (memory_owner == this)
+		memory->SaveCheckpoint(os);
+
+	// Loader. The program binary is only needed while loading the
+	// program, so it is not saved.
+	misc::WriteBinary(os, loader_owner->getId());
+	if (loader_owner == this)
+	{
+		SaveStrings(os, loader->args);
+		SaveStrings(os, loader->env);
+		misc::WriteBinaryString(os, loader->interp);
+		misc::WriteBinaryString(os, loader->exe);
+		misc::WriteBinaryString(os, loader->cwd);
+		misc::WriteBinaryString(os, loader->stdin_file_name);
+		misc::WriteBinaryString(os, loader->stdout_file_name);
+		misc::WriteBinary(os, loader->stack_base);
+		misc::WriteBinary(os, loader->stack_top);
+		misc::WriteBinary(os, loader->stack_size);
+		misc::WriteBinary(os, loader->environ_base);
+		misc::WriteBinary(os, loader->bottom);
+		misc::WriteBinary(os, loader->prog_entry);
+		misc::WriteBinary(os, loader->interp_prog_entry);
+		misc::WriteBinary(os, loader->phdt_base);
+		misc::WriteBinary(os, loader->phdr_count);
+		misc::WriteBinary(os, loader->at_random_addr);
+		misc::WriteBinary(os, loader->at_random_addr_holder);
+	}
+
+	// File table
+	misc::WriteBinary(os, file_table_owner->getId());
+	if (file_table_owner == this)
+		file_table->SaveCheckpoint(os);
+
+	// Signals
+	misc::WriteBinary(os, signal_handler_table_owner->getId());
+	if (signal_handler_table_owner == this)
+		signal_handler_table->SaveCheckpoint(os);
+	signal_mask_table.SaveCheckpoint(os);
+
+	// Call stack
+	bool has_call_stack = call_stack.get();
+	misc::WriteBinary(os, has_call_stack);
+	if (has_call_stack)
+		call_stack->SaveCheckpoint(os);
+
+	// Emulation fields
+	misc::WriteBinary(os, last_eip);
+	misc::WriteBinary(os, current_eip);
+	misc::WriteBinary(os, target_eip);
+	misc::WriteBinary(os, exit_signal);
+	misc::WriteBinary(os, exit_code);
+	misc::WriteBinary(os, clear_child_tid);
+	misc::WriteBinary(os, robust_list_head);
+	misc::WriteBinary(os, str_op_esi);
+	misc::WriteBinary(os, str_op_edi);
+	misc::WriteBinary(os, str_op_dir);
+	misc::WriteBinary(os, str_op_count);
+	misc::WriteBinary(os, glibc_segment_base);
+	misc::WriteBinary(os, glibc_segment_limit);
+	misc::WriteBinary(os, sched_policy);
+	misc::WriteBinary(os, sched_priority);
+
+	// Suspension. Wakeup times are saved relative to the current time, so
+	// that the remaining time is preserved when the checkpoint is loaded.
+	long long now = esim::Engine::getInstance()->getRealTime();
+	long long nanosleep_time = getState(StateNanosleep) ?
+			syscall_nanosleep_wakeup_time - now : 0;
+	long long poll_time = getState(StatePoll) && syscall_poll_time ?
+			syscall_poll_time - now : 0;
+	misc::WriteBinary(os, wakeup_state);
+	misc::WriteBinary(os, wakeup_futex);
+	misc::WriteBinary(os, wakeup_futex_bitset);
+	misc::WriteBinary(os, wakeup_futex_sleep);
+	misc::WriteBinary(os, nanosleep_time);
+	misc::WriteBinary(os, syscall_read_fd);
+	misc::WriteBinary(os, syscall_write_fd);
+	misc::WriteBinary(os, poll_time);
+	misc::WriteBinary(os, syscall_poll_fd);
+	misc::WriteBinary(os, syscall_poll_events);
+	misc::WriteBinary(os, syscall_waitpid_pid);
+}
+
+
+void Context::LoadCheckpoint(std::istream &is)
+{
+	// Identifier and state
+	int id = 0;
+	unsigned saved_state = 0;
+	misc::ReadBinary(is, id);
+	misc::ReadBinary(is, saved_state);
+	misc::ReadBinary(is, regs);
+	setId(id);
+
+	// Return a context restored earlier from the checkpoint
+	auto getSavedContext = [&](int id) -> Context *
+	{
+		Context *context = emulator->getContext(id);
+		if (!is || !context || context == this)
+			throw Error(misc::fmt("[%s] Invalid context %d in "
+					"checkpoint", getName().c_str(), id));
+		return context;
+	};
+
+	// Parent contexts
+	int parent_id = 0;
+	int group_parent_id = 0;
+	misc::ReadBinary(is, parent_id);
+	misc::ReadBinary(is, group_parent_id);
+	parent = parent_id ? getSavedContext(parent_id) : nullptr;
+	group_parent = group_parent_id ? getSavedContext(group_parent_id) :
+			nullptr;
+
+	// Memory image. Contexts sharing a memory image share the virtual
+	// memory space in the MMU as well.
+	int owner_id = 0;
+	misc::ReadBinary(is, owner_id);
+	if (owner_id == id)
+	{
+		memory = misc::new_shared<mem::Memory>();
+		memory->LoadCheckpoint(is);
+		mmu_space = mmu->newSpace();
+	}
+	else
+	{
+		Context *owner = getSavedContext(owner_id);
+		memory = owner->memory;
+		mmu_space = owner->mmu_space;
+	}
+	spec_mem = misc::new_unique<mem::SpecMem>(memory.get());
+
+	// Loader
+	misc::ReadBinary(is, owner_id);
+	if (owner_id == id)
+	{
+		loader = misc::new_shared<Loader>();
+		LoadStrings(is, loader->args);
+		LoadStrings(is, loader->env);
+		loader->interp = misc::ReadBinaryString(is);
+		loader->exe = misc::ReadBinaryString(is);
+		loader->cwd = misc::ReadBinaryString(is);
+		loader->stdin_file_name = misc::ReadBinaryString(is);
+		loader->stdout_file_name = misc::ReadBinaryString(is);
+		misc::ReadBinary(is, loader->stack_base);
+		misc::ReadBinary(is, loader->stack_top);
+		misc::ReadBinary(is, loader->stack_size);
+		misc::ReadBinary(is, loader->environ_base);
+		misc::ReadBinary(is, loader->bottom);
+		misc::ReadBinary(is, loader->prog_entry);
+		misc::ReadBinary(is, loader->interp_prog_entry);
+		misc::ReadBinary(is, loader->phdt_base);
+		misc::ReadBinary(is, loader->phdr_count);
+		misc::ReadBinary(is, loader->at_random_addr);
+		misc::ReadBinary(is, loader->at_random_addr_holder);
+	}
+	else
+	{
+		loader = getSavedContext(owner_id)->loader;
+	}
+
+	// File table
+	misc::ReadBinary(is, owner_id);
+	if (owner_id == id)
+	{
+		file_table = misc::new_shared<comm::FileTable>();
+		file_table->LoadCheckpoint(is);
+	}
+	else
+	{
+		file_table = getSavedContext(owner_id)->file_table;
+	}
+
+	// Signals
+	misc::ReadBinary(is, owner_id);
+	if (owner_id == id)
+	{
+		signal_handler_table = misc::new_shared<SignalHandlerTable>();
+		signal_handler_table->LoadCheckpoint(is);
+	}
+	else
+	{
+		signal_handler_table = getSavedContext(owner_id)->
+				signal_handler_table;
+	}
+	signal_mask_table.LoadCheckpoint(is);
+
+	// Call stack
+	bool has_call_stack = false;
+	misc::ReadBinary(is, has_call_stack);
+	if (has_call_stack)
+	{
+		call_stack = misc::new_unique<comm::CallStack>(loader->exe);
+		call_stack->LoadCheckpoint(is);
+	}
+
+	// Emulation fields
+	misc::ReadBinary(is, last_eip);
+	misc::ReadBinary(is, current_eip);
+	misc::ReadBinary(is, target_eip);
+	misc::ReadBinary(is, exit_signal);
+	misc::ReadBinary(is, exit_code);
+	misc::ReadBinary(is, clear_child_tid);
+	misc::ReadBinary(is, robust_list_head);
+	misc::ReadBinary(is, str_op_esi);
+	misc::ReadBinary(is, str_op_edi);
+	misc::ReadBinary(is, str_op_dir);
+	misc::ReadBinary(is, str_op_count);
+	misc::ReadBinary(is, glibc_segment_base);
+	misc::ReadBinary(is, glibc_segment_limit);
+	misc::ReadBinary(is, sched_policy);
+	misc::ReadBinary(is, sched_priority);
+
+	// Suspension
+	long long now = esim::Engine::getInstance()->getRealTime();
+	long long nanosleep_time = 0;
+	long long poll_time = 0;
+	misc::ReadBinary(is, wakeup_state);
+	misc::ReadBinary(is, wakeup_futex);
+	misc::ReadBinary(is, wakeup_futex_bitset);
+	misc::ReadBinary(is, wakeup_futex_sleep);
+	misc::ReadBinary(is, nanosleep_time);
+	misc::ReadBinary(is, syscall_read_fd);
+	misc::ReadBinary(is, syscall_write_fd);
+	misc::ReadBinary(is, poll_time);
+	misc::ReadBinary(is, syscall_poll_fd);
+	misc::ReadBinary(is, syscall_poll_events);
+	misc::ReadBinary(is, syscall_waitpid_pid);
+	syscall_nanosleep_wakeup_time = now + nanosleep_time;
+	syscall_poll_time = poll_time ? now + poll_time : 0;
+	if (!is)
+		throw Error(misc::fmt("[%s] Truncated checkpoint",
+				getName().c_str()));
+
+	// Restore the wakeup callbacks of a context suspended in a system call
+	if (saved_state & StateCallback)
+	{
+		switch (wakeup_state)
+		{
+		case StateNanosleep:
+			can_wakeup_fn = &Context::SyscallNanosleepCanWakeup;
+			wakeup_fn = &Context::SyscallNanosleepWakeup;
+			break;
+
+		case StateRead:
+			can_wakeup_fn = &Context::SyscallReadCanWakeup;
+			wakeup_fn = &Context::SyscallReadWakeup;
+			break;
+
+		case StateWrite:
+			can_wakeup_fn = &Context::SyscallWriteCanWakeup;
+			wakeup_fn = &Context::SyscallWriteWakeup;
+			break;
+
+		case StatePoll:
+			can_wakeup_fn = &Context::SyscallPollCanWakeup;
+			wakeup_fn = &Context::SyscallPollWakeup;
+			break;
+
+		case StateSigsuspend:
+			can_wakeup_fn = &Context::SyscallSigsuspendCanWakeup;
+			wakeup_fn = &Context::SyscallSigsuspendWakeup;
+			break;
+
+		case StateWaitpid:
+			can_wakeup_fn = &Context::SyscallWaitpidCanWakeup;
+			wakeup_fn = &Context::SyscallWaitpidWakeup;
+			break;
+
+		default:
+			throw Error(misc::fmt("[%s] Invalid wakeup state in "
+					"checkpoint", getName().c_str()));
+		}
+	}
+
+	// Set state, which updates the emulator context lists
+	UpdateState(saved_state);
+
+	// Relaunch the host thread waiting for the event the context was
+	// suspended on.
+	if (saved_state & StateCallback && wakeup_state & (StateNanosleep |
+			StateRead | StateWrite | StatePoll))
+	{
+		host_thread_suspend_active = true;
+		if (pthread_create(&host_thread_suspend, nullptr,
+				&Context::HostThreadSuspend, this))
+			throw misc::Panic("Could not launch host thread");
+	}
+	emulator->ProcessEventsSchedule();
+}
+
+}  // namespace x86
+
@@ -3212,6 +3212,23 @@ void Context::ExecuteInst_xchg_rm16_r16()
 			Uinst::DepR16,
 			0,
 			0);
+
+	// Magic instruction 'xchg %bx, %bx', with the command in eax. It is
+	// ignored in speculative mode, since it is not part of the correct
+	// execution path.
+	if (inst.getModRm() == 0xdb && !getState(StateSpecMode))
+	{
+		unsigned command = regs.getEax();
+		if (command > Emulator::MagicCommandInvalid &&
+				command < Emulator::MagicCommandCount)
+		{
+			emulator->InsertMagicCommand(
+					(Emulator::MagicCommand) command);
+			emulator->isa_debug << misc::fmt("  magic=%s",
+					Emulator::magic_command_map.MapValue(
+					command));
+		}
+	}
 }
 
 
@@ -17,14 +17,248 @@
  *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  */
 
+#include <algorithm>
+#include <cstring>
+
 #include <lib/cpp/Misc.h>
 
 #include "Context.h"
+#include "Emulator.h"
 
 
 namespace x86
 {
 
+//
+// Bulk execution of repeated string instructions
+//
+
+// The functions below access the memory directly, and they are only invoked
+// in non-speculative mode, as determined by getRepBulkLimit().
+
+unsigned Context::getRepBulkLimit(bool keep_last)
+{
+	// Only in functional simulation, and with no trace of individual
+	// instructions
+	if (uinst_active || getState(StateSpecMode) || emulator->isa_debug)
+		return 0;
+
+	// Iterations left
+	long long limit = regs.getEcx();
+	if (keep_last)
+		limit--;
+
+	// Every iteration counts as one instruction. Do not go beyond the
+	// instruction limit or a pending checkpoint, accounting for the
+	// current instruction.
+	limit = std::min(limit, emulator->getRemainingInstructions() - 1);
+	return limit > 0 ? limit : 0;
+}
+
+
+char *Context::getRepBulkData(unsigned address, int size, int dir,
+		mem::Memory::AccessType access, unsigned &count)
+{
+	// Page must exist and grant access
+	count = 0;
+	mem::Memory::Page *page = memory->getPage(address);
+	if (!page || (memory->getSafe() &&
+			(page->getPerm() & access) != access))
+		return nullptr;
+
+	// Element must not cross the page boundary
+	unsigned offset = address & (mem::Memory::PageSize - 1);
+	if (offset + size > mem::Memory::PageSize)
+		return nullptr;
+
+	// Number of elements in the page, going forward or backward
+	count = dir > 0 ? (mem::Memory::PageSize - offset) / size :
+			offset / size + 1;
+
+	// Return data, setting the 'modified' flag for writes
+	if (access == mem::Memory::AccessWrite)
+		page->addPerm(mem::Memory::AccessModified);
+	page->AllocateData();
+	return page->getData() + offset;
+}
+
+
+void Context::ExecuteRepBulkMovs(int size)
+{
+	int dir = regs.getFlag(Instruction::FlagDF) ? -1 : 1;
+	unsigned limit = getRepBulkLimit(false);
+	unsigned count = 0;
+	while (count < limit)
+	{
+		// Elements in current source and destination pages
+		unsigned src_count;
+		unsigned dst_count;
+		char *src = getRepBulkData(regs.getEsi(), size, dir,
+				mem::Memory::AccessRead, src_count);
+		char *dst = src ? getRepBulkData(regs.getEdi(), size, dir,
+				mem::Memory::AccessWrite, dst_count) : nullptr;
+		if (!dst)
+			break;
+		unsigned n = std::min(limit - count, std::min(src_count,
+				dst_count));
+
+		// A write must not reach a later read of the same chunk
+		unsigned distance = dir > 0 ? regs.getEdi() - regs.getEsi() :
+				regs.getEsi() - regs.getEdi();
+		if (distance && distance < n * size)
+			n = distance / size;
+		if (!n)
+			break;
+
+		// Copy. Going backward, the chunk ends at the current element.
+		unsigned bytes = n * size;
+		if (dir < 0)
+		{
+			src -= bytes - size;
+			dst -= bytes - size;
+		}
+		memmove(dst, src, bytes);
+
+		// Advance
+		regs.incEsi(dir * bytes);
+		regs.incEdi(dir * bytes);
+		regs.decEcx(n);
+		count += n;
+	}
+
+	// Each iteration is one instruction
+	str_op_count += count;
+	emulator->addNumInstructions(count);
+}
+
+
+void Context::ExecuteRepBulkStos(int size)
+{
+	int dir = regs.getFlag(Instruction::FlagDF) ? -1 : 1;
+	unsigned value = regs.getEax();
+	unsigned limit = getRepBulkLimit(false);
+	unsigned count = 0;
+	while (count < limit)
+	{
+		// Elements in current destination page
+		unsigned dst_count;
+		char *dst = getRepBulkData(regs.getEdi(), size, dir,
+				mem::Memory::AccessWrite, dst_count);
+		if (!dst)
+			break;
+		unsigned n = std::min(limit - count, dst_count);
+
+		// Fill. Going backward, the chunk ends at the current element.
+		unsigned bytes = n * size;
+		if (dir < 0)
+			dst -= bytes - size;
+		if (size == 1)
+			memset(dst, value, bytes);
+		else
+			for (unsigned i = 0; i < bytes; i += size)
+				memcpy(dst + i, &value, size);
+
+		// Advance
+		regs.incEdi(dir * bytes);
+		regs.decEcx(n);
+		count += n;
+	}
+
+	// Each iteration is one instruction
+	str_op_count += count;
+	emulator->addNumInstructions(count);
+}
+
+
+void Context::ExecuteRepBulkCmps(int size, bool repz)
+{
+	// Iterations that keep the repetition going compare equal for 'repz',
+	// producing the same flags, or different for 'repnz'. Flags of the
+	// latter are overwritten by the iteration that follows, which is
+	// always run regularly.
+	int dir = regs.getFlag(Instruction::FlagDF) ? -1 : 1;
+	unsigned limit = getRepBulkLimit(true);
+	unsigned count = 0;
+	while (count < limit)
+	{
+		// Elements in current source and destination pages
+		unsigned src_count;
+		unsigned dst_count;
+		char *src = getRepBulkData(regs.getEsi(), size, dir,
+				mem::Memory::AccessRead, src_count);
+		char *dst = src ? getRepBulkData(regs.getEdi(), size, dir,
+				mem::Memory::AccessRead, dst_count) : nullptr;
+		if (!dst)
+			break;
+		unsigned n = std::min(limit - count, std::min(src_count,
+				dst_count));
+
+		// Find the first iteration that stops the repetition
+		unsigned k;
+		for (k = 0; k < n; k++)
+		{
+			int offset = dir * (int) (k * size);
+			bool equal = !memcmp(src + offset, dst + offset, size);
+			if (equal != repz)
+				break;
+		}
+
+		// Advance
+		regs.incEsi(dir * (int) (k * size));
+		regs.incEdi(dir * (int) (k * size));
+		regs.decEcx(k);
+		count += k;
+		if (k < n)
+			break;
+	}
+
+	// Each iteration is one instruction
+	str_op_count += count;
+	emulator->addNumInstructions(count);
+}
+
+
+void Context::ExecuteRepBulkScas(int size, bool repz)
+{
+	// Flags are handled as in ExecuteRepBulkCmps()
+	int dir = regs.getFlag(Instruction::FlagDF) ? -1 : 1;
+	unsigned value = regs.getEax();
+	unsigned limit = getRepBulkLimit(true);
+	unsigned count = 0;
+	while (count < limit)
+	{
+		// Elements in current destination page
+		unsigned dst_count;
+		char *dst = getRepBulkData(regs.getEdi(), size, dir,
+				mem::Memory::AccessRead, dst_count);
+		if (!dst)
+			break;
+		unsigned n = std::min(limit - count, dst_count);
+
+		// Find the first iteration that stops the repetition
+		unsigned k;
+		for (k = 0; k < n; k++)
+		{
+			int offset = dir * (int) (k * size);
+			bool equal = !memcmp(&value, dst + offset, size);
+			if (equal != repz)
+				break;
+		}
+
+		// Advance
+		regs.incEdi(dir * (int) (k * size));
+		regs.decEcx(k);
+		count += k;
+		if (k < n)
+			break;
+	}
+
+	// Each iteration is one instruction
+	str_op_count += count;
+	emulator->addNumInstructions(count);
+}
+
+
 // Macros defined to prevent accidental use of functions that cause unsafe
 // execution in speculative mode.
 #undef assert
@@ -51,7 +285,7 @@ void Context::StartRepInst()
 }
 
 
-#define OP_REP_IMPL(X, SIZE) \
+#define OP_REP_IMPL(X, SIZE, BULK) \
 	void Context::ExecuteInst_rep_##X() \
 	{ \
 		StartRepInst(); \
@@ -61,6 +295,7 @@ void Context::StartRepInst()
 			ExecuteStringInst_##X(); \
 			regs.decEcx(); \
 			regs.decEip(inst.getSize()); \
+			BULK; \
 		} \
 		\
 		newUinst_##X( \
@@ -85,7 +320,7 @@ void Context::StartRepInst()
 	}
 
 
-#define OP_REPZ_IMPL(X, SIZE) \
+#define OP_REPZ_IMPL(X, SIZE, BULK) \
 	void Context::ExecuteInst_repz_##X() \
 	{ \
 		StartRepInst(); \
@@ -95,7 +330,10 @@ void Context::StartRepInst()
 			ExecuteStringInst_##X(); \
 			regs.decEcx(); \
 			if (regs.getFlag(Instruction::FlagZF)) \
+			{ \
 				regs.decEip(inst.getSize()); \
+				BULK; \
+			} \
 		} \
 		\
 		newUinst_##X( \
@@ -120,7 +358,7 @@ void Context::StartRepInst()
 	}
 
 
-#define OP_REPNZ_IMPL(X, SIZE) \
+#define OP_REPNZ_IMPL(X, SIZE, BULK) \
 	void Context::ExecuteInst_repnz_##X() \
 	{ \
 		StartRepInst(); \
@@ -130,7 +368,10 @@ void Context::StartRepInst()
 			ExecuteStringInst_##X(); \
 			regs.decEcx(); \
 			if (!regs.getFlag(Instruction::FlagZF)) \
+			{ \
 				regs.decEip(inst.getSize()); \
+				BULK; \
+			} \
 		} \
 		\
 		newUinst_##X( \
@@ -939,32 +1180,34 @@ void Context::ExecuteInst_stosd()
 // Repetition prefixes
 ///
 
-OP_REP_IMPL(insb, 1)
-OP_REP_IMPL(insd, 4)
+// The last argument runs the remaining iterations in bulk, if supported
+
+OP_REP_IMPL(insb, 1, )
+OP_REP_IMPL(insd, 4, )
 
-OP_REP_IMPL(movsb, 1)
-OP_REP_IMPL(movsd, 4)
+OP_REP_IMPL(movsb, 1, ExecuteRepBulkMovs(1))
+OP_REP_IMPL(movsd, 4, ExecuteRepBulkMovs(4))
 
-OP_REP_IMPL(outsb, 1)
-OP_REP_IMPL(outsd, 4)
+OP_REP_IMPL(outsb, 1, )
+OP_REP_IMPL(outsd, 4, )
 
-OP_REP_IMPL(lodsb, 1)
-OP_REP_IMPL(lodsd, 4)
+OP_REP_IMPL(lodsb, 1, )
+OP_REP_IMPL(lodsd, 4, )
 
-OP_REP_IMPL(stosb, 1)
-OP_REP_IMPL(stosd, 4)
+OP_REP_IMPL(stosb, 1, ExecuteRepBulkStos(1))
+OP_REP_IMPL(stosd, 4, ExecuteRepBulkStos(4))
 
-OP_REPZ_IMPL(cmpsb, 1)
-OP_REPZ_IMPL(cmpsd, 4)
+OP_REPZ_IMPL(cmpsb, 1, ExecuteRepBulkCmps(1, true))
+OP_REPZ_IMPL(cmpsd, 4, ExecuteRepBulkCmps(4, true))
 
-OP_REPZ_IMPL(scasb, 1)
-OP_REPZ_IMPL(scasd, 4)
+OP_REPZ_IMPL(scasb, 1, ExecuteRepBulkScas(1, true))
+OP_REPZ_IMPL(scasd, 4, ExecuteRepBulkScas(4, true))
 
-OP_REPNZ_IMPL(cmpsb, 1)
-OP_REPNZ_IMPL(cmpsd, 4)
+OP_REPNZ_IMPL(cmpsb, 1, ExecuteRepBulkCmps(1, false))
+OP_REPNZ_IMPL(cmpsd, 4, ExecuteRepBulkCmps(4, false))
 
-OP_REPNZ_IMPL(scasb, 1)
-OP_REPNZ_IMPL(scasd, 4)
+OP_REPNZ_IMPL(scasb, 1, ExecuteRepBulkScas(1, false))
+OP_REPNZ_IMPL(scasd, 4, ExecuteRepBulkScas(4, false))
 
 
 
@@ -17,6 +17,10 @@
  *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  */
 
+#include <cstring>
+#include <fstream>
+#include <limits>
+
 #include <arch/x86/disassembler/Disassembler.h>
 #include <lib/esim/Engine.h>
 
@@ -35,8 +39,27 @@ std::string Emulator::syscall_debug_file;
 
 long long Emulator::max_instructions;
 
+std::string Emulator::checkpoint_save_file;
+std::string Emulator::checkpoint_load_file;
+long long Emulator::checkpoint_instructions;
+
+// Header and version of checkpoint files
+static const char checkpoint_magic[] = "m2s-x86-checkpoint";
+static const unsigned checkpoint_version = 1;
+
 std::unique_ptr<Emulator> Emulator::instance;
 
+const misc::StringMap Emulator::magic_command_map =
+{
+	{ "Invalid", MagicCommandInvalid },
+	{ "RoiBegin", MagicCommandRoiBegin },
+	{ "RoiEnd", MagicCommandRoiEnd },
+	{ "StatsReset", MagicCommandStatsReset },
+	{ "StatsDump", MagicCommandStatsDump },
+	{ "SwitchDetailed", MagicCommandSwitchDetailed },
+	{ "SwitchFunctional", MagicCommandSwitchFunctional }
+};
+
 misc::Debug Emulator::call_debug;
 misc::Debug Emulator::context_debug;
 misc::Debug Emulator::isa_debug;
@@ -91,6 +114,33 @@ void Emulator::RegisterOptions()
 			"instructions. On x86 detailed simulation, it is given as "
 			"the number of committed (non-speculative) instructions. "
 			"A value of 0 means no limit.");
+
+	// Option --x86-checkpoint-save <file>
+	command_line->RegisterString("--x86-checkpoint-save <file>",
+			checkpoint_save_file,
+			"Save the state of all x86 contexts into a checkpoint "
+			"file, and finish the simulation. The checkpoint "
+			"includes registers, memory images, signal state, and "
+			"open files. It is saved after the number of emulated "
+			"instructions given in option '--x86-checkpoint-inst'.");
+
+	// Option --x86-checkpoint-inst <number>
+	command_line->RegisterInt64("--x86-checkpoint-inst <number> "
+			"(default = 0)",
+			checkpoint_instructions,
+			"Number of emulated x86 instructions after which the "
+			"checkpoint given in option '--x86-checkpoint-save' is "
+			"saved. A value of 0 saves the checkpoint right after "
+			"loading the programs.");
+
+	// Option --x86-checkpoint-load <file>
+	command_line->RegisterString("--x86-checkpoint-load <file>",
+			checkpoint_load_file,
+			"Restore x86 contexts from a checkpoint file saved with "
+			"option '--x86-checkpoint-save', instead of loading them "
+			"from program executables. Files open in the guest "
+			"programs are reopened by path, so they must still exist "
+			"with the same content.");
 }
 
 
@@ -421,6 +471,102 @@ void Emulator::ProcessEvents()
 }
 
 
+void Emulator::SaveCheckpoint(const std::string &path)
+{
+	// Open file
+	std::ofstream f(path, std::ios::binary);
+	if (!f)
+		throw Error(misc::fmt("%s: Cannot open checkpoint file",
+				path.c_str()));
+
+	// Header
+	f.write(checkpoint_magic, sizeof checkpoint_magic);
+	misc::WriteBinary(f, checkpoint_version);
+
+	// Emulator state
+	misc::WriteBinary(f, num_instructions);
+	misc::WriteBinary(f, pid);
+	misc::WriteBinary(f, futex_sleep_count);
+
+	// Contexts
+	unsigned num_contexts = contexts.size();
+	misc::WriteBinary(f, num_contexts);
+	for (auto &context : contexts)
+		context->SaveCheckpoint(f);
+
+	// Check errors
+	f.close();
+	if (!f)
+		throw Error(misc::fmt("%s: Cannot write checkpoint file",
+				path.c_str()));
+}
+
+
+void Emulator::LoadCheckpoint(const std::string &path)
+{
+	// Open file
+	std::ifstream f(path, std::ios::binary);
+	if (!f)
+		throw Error(misc::fmt("%s: Cannot open checkpoint file",
+				path.c_str()));
+
+	// Header
+	char magic[sizeof checkpoint_magic];
+	unsigned version = 0;
+	f.read(magic, sizeof magic);
+	misc::ReadBinary(f, version);
+	if (!f || memcmp(magic, checkpoint_magic, sizeof magic) ||
+			version != checkpoint_version)
+		throw Error(misc::fmt("%s: Not a valid checkpoint file",
+				path.c_str()));
+
+	// Contexts must be restored in an empty emulator, so that their
+	// identifiers do not clash with existing contexts.
+	if (contexts.size())
+		throw misc::Panic("Checkpoint loaded with existing contexts");
+
+	// Emulator state
+	misc::ReadBinary(f, num_instructions);
+	misc::ReadBinary(f, pid);
+	misc::ReadBinary(f, futex_sleep_count);
+
+	// Contexts
+	unsigned num_contexts = 0;
+	misc::ReadBinary(f, num_contexts);
+	for (unsigned i = 0; i < num_contexts; i++)
+	{
+		Context *context = newContext();
+		context->LoadCheckpoint(f);
+	}
+}
+
+
+long long Emulator::getRemainingInstructions() const
+{
+	long long remaining = std::numeric_limits<long long>::max();
+	if (max_instructions)
+		remaining = max_instructions - num_instructions;
+	if (!checkpoint_save_file.empty() && !checkpoint_saved)
+		remaining = std::min(remaining,
+				checkpoint_instructions - num_instructions);
+	return remaining;
+}
+
+
+void Emulator::CheckCheckpoint()
+{
+	// Nothing to do
+	if (checkpoint_save_file.empty() || checkpoint_saved ||
+			num_instructions < checkpoint_instructions)
+		return;
+
+	// Save checkpoint and finish
+	SaveCheckpoint(checkpoint_save_file);
+	checkpoint_saved = true;
+	esim->Finish("x86Checkpoint");
+}
+
+
 bool Emulator::Run()
 {
 	// Stop if there is no more contexts
@@ -431,6 +577,9 @@ bool Emulator::Run()
 	if (max_instructions && num_instructions >= max_instructions)
 		esim->Finish("x86MaxInst");
 
+	// Save checkpoint if requested
+	CheckCheckpoint();
+
 	// Stop if any previous reason met
 	if (esim->hasFinished())
 		return true;
@@ -448,6 +597,10 @@ bool Emulator::Run()
 		context->Execute();
 	}
 
+	// Magic commands only affect the timing simulator, and are ignored
+	// in a functional simulation.
+	magic_commands.clear();
+
 	// Free finished contexts
 	while (finished_contexts.size())
 		FreeContext(finished_contexts.front());
@@ -20,6 +20,7 @@
 #ifndef ARCH_X86_EMULATOR_EMULATOR_H
 #define ARCH_X86_EMULATOR_EMULATOR_H
 
+#include <deque>
 #include <pthread.h>
 
 #include <arch/common/Arch.h>
@@ -54,6 +55,29 @@ public:
 /// x86 emulator
 class Emulator : public comm::Emulator
 {
+public:
+
+	/// Commands passed in register eax to the magic instruction
+	/// 'xchg %bx, %bx'. This instruction is a no-op on real hardware, so
+	/// guest programs can use it to mark their regions of interest and
+	/// control the simulation without any other modification.
+	enum MagicCommand
+	{
+		MagicCommandInvalid = 0,
+		MagicCommandRoiBegin,
+		MagicCommandRoiEnd,
+		MagicCommandStatsReset,
+		MagicCommandStatsDump,
+		MagicCommandSwitchDetailed,
+		MagicCommandSwitchFunctional,
+		MagicCommandCount
+	};
+
+	/// String map for MagicCommand
+	static const misc::StringMap magic_command_map;
+
+private:
+
 	//
 	// Static fields
 	//
@@ -68,6 +92,13 @@ class Emulator : public comm::Emulator
 	// Maximum number of instructions
 	static long long max_instructions;
 
+	// Checkpoint files
+	static std::string checkpoint_save_file;
+	static std::string checkpoint_load_file;
+
+	// Number of instructions after which the checkpoint is saved
+	static long long checkpoint_instructions;
+
 	// Unique instance of singleton
 	static std::unique_ptr<Emulator> instance;
 
@@ -110,6 +141,13 @@ class Emulator : public comm::Emulator
 	// for FIFO wakeups.
 	long long futex_sleep_count = 0;
 
+	// Flag indicating that the checkpoint was already saved
+	bool checkpoint_saved = false;
+
+	// Commands of magic instructions executed by guest programs, in
+	// program order, and not processed yet
+	std::deque<MagicCommand> magic_commands;
+
 
 public:
 
@@ -132,6 +170,13 @@ public:
 	/// Return the maximum number of instructions, as set up by the user
 	static long long getMaxInstructions() { return max_instructions; }
 
+	/// Return the checkpoint file given in option
+	/// `--x86-checkpoint-load`, or an empty string if none was given.
+	static const std::string &getCheckpointLoadFile()
+	{
+		return checkpoint_load_file;
+	}
+
 	/// Debugger for function calls
 	static misc::Debug call_debug;
 
@@ -207,6 +252,53 @@ public:
 	/// locked before invoking this function.
 	void ProcessEventsScheduleUnsafe() { process_events_force = true; }
 
+	/// Save the state of all contexts into a checkpoint file.
+	///
+	/// \throw
+	///	An Error is thrown if the file cannot be written, or if the
+	///	state of some context cannot be saved.
+	void SaveCheckpoint(const std::string &path);
+
+	/// Create contexts from a checkpoint file saved with
+	/// SaveCheckpoint(). The emulator must not have any contexts.
+	///
+	/// \throw
+	///	An Error is thrown if the file cannot be read, or if it is not
+	///	a valid checkpoint.
+	void LoadCheckpoint(const std::string &path);
+
+	/// Return the number of instructions that can still be emulated
+	/// before reaching the limit given in option `--x86-max-inst` or the
+	/// instruction of a pending checkpoint. If there is no such limit, the
+	/// largest representable value is returned.
+	long long getRemainingInstructions() const;
+
+	/// Save the checkpoint given in option `--x86-checkpoint-save` if the
+	/// number of emulated instructions has reached the value given in
+	/// option `--x86-checkpoint-inst`, and finish the simulation.
+	void CheckCheckpoint();
+
+	/// Record the command of a magic instruction executed by a context
+	/// in non-speculative mode. Commands are processed by the timing
+	/// simulator, which might stop fetching new instructions as soon as
+	/// one is pending.
+	void InsertMagicCommand(MagicCommand command)
+	{
+		magic_commands.push_back(command);
+	}
+
+	/// Return whether there are magic commands pending to be processed
+	bool hasMagicCommands() const { return !magic_commands.empty(); }
+
+	/// Remove and return the oldest pending magic command
+	MagicCommand ExtractMagicCommand()
+	{
+		assert(!magic_commands.empty());
+		MagicCommand command = magic_commands.front();
+		magic_commands.pop_front();
+		return command;
+	}
+
 	/// Run one iteration of the emulation loop.
 	/// \return This function \c true if the iteration had a useful
 	/// emulation, and \c false if all contexts finished execution.
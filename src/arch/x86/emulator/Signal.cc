@@ -122,6 +122,24 @@ void SignalHandler::WriteToMemory(mem::Memory *memory, unsigned address)
 }
 
 
+void SignalHandler::SaveCheckpoint(std::ostream &os) const
+{
+	misc::WriteBinary(os, handler);
+	misc::WriteBinary(os, flags);
+	misc::WriteBinary(os, restorer);
+	mask.SaveCheckpoint(os);
+}
+
+
+void SignalHandler::LoadCheckpoint(std::istream &is)
+{
+	misc::ReadBinary(is, handler);
+	misc::ReadBinary(is, flags);
+	misc::ReadBinary(is, restorer);
+	mask.LoadCheckpoint(is);
+}
+
+
 void SignalHandler::Dump(std::ostream &os) const
 {
 	os << misc::fmt("handler = 0x%x, ", handler)
@@ -131,5 +149,41 @@ void SignalHandler::Dump(std::ostream &os) const
 }
 
 
+void SignalMaskTable::SaveCheckpoint(std::ostream &os) const
+{
+	// Signal masks
+	pending.SaveCheckpoint(os);
+	blocked.SaveCheckpoint(os);
+	backup.SaveCheckpoint(os);
+	misc::WriteBinary(os, ret_code_ptr);
+
+	// Register file backed up during a signal handler
+	bool has_regs = regs.get();
+	misc::WriteBinary(os, has_regs);
+	if (has_regs)
+		misc::WriteBinary(os, *regs);
+}
+
+
+void SignalMaskTable::LoadCheckpoint(std::istream &is)
+{
+	// Signal masks
+	pending.LoadCheckpoint(is);
+	blocked.LoadCheckpoint(is);
+	backup.LoadCheckpoint(is);
+	misc::ReadBinary(is, ret_code_ptr);
+
+	// Register file backed up during a signal handler
+	bool has_regs = false;
+	misc::ReadBinary(is, has_regs);
+	regs.reset();
+	if (has_regs)
+	{
+		regs.reset(new Regs());
+		misc::ReadBinary(is, *regs);
+	}
+}
+
+
 }  // namespace x86
 
@@ -201,6 +201,18 @@ public:
 		assert(bitmap.getSizeInBytes() == 8);
 		memory->Write(address, 8, bitmap.getBuffer());
 	}
+
+	/// Save signal set into a checkpoint stream
+	void SaveCheckpoint(std::ostream &os) const {
+		assert(bitmap.getSizeInBytes() == 8);
+		os.write(bitmap.getBuffer(), 8);
+	}
+
+	/// Load signal set from a checkpoint stream
+	void LoadCheckpoint(std::istream &is) {
+		assert(bitmap.getSizeInBytes() == 8);
+		is.read(bitmap.getBuffer(), 8);
+	}
 };
 
 
@@ -266,6 +278,12 @@ public:
 
 	/// Return address where the return code can be found.
 	unsigned getRetCodePtr() const { return ret_code_ptr; }
+
+	/// Save signal masks and the register backup into a checkpoint stream
+	void SaveCheckpoint(std::ostream &os) const;
+
+	/// Load the state saved with SaveCheckpoint()
+	void LoadCheckpoint(std::istream &is);
 };
 
 
@@ -308,6 +326,12 @@ public:
 
 	/// Write the content of the signal handler to memory
 	void WriteToMemory(mem::Memory *memory, unsigned address);
+
+	/// Save signal handler into a checkpoint stream
+	void SaveCheckpoint(std::ostream &os) const;
+
+	/// Load signal handler from a checkpoint stream
+	void LoadCheckpoint(std::istream &is);
 };
 
 
@@ -326,6 +350,18 @@ public:
 		assert(misc::inRange(sig, 1, 64));
 		return &signal_handler[sig - 1];
 	}
+
+	/// Save all signal handlers into a checkpoint stream
+	void SaveCheckpoint(std::ostream &os) const {
+		for (auto &handler : signal_handler)
+			handler.SaveCheckpoint(os);
+	}
+
+	/// Load all signal handlers from a checkpoint stream
+	void LoadCheckpoint(std::istream &is) {
+		for (auto &handler : signal_handler)
+			handler.LoadCheckpoint(is);
+	}
 };
 
 
@@ -111,6 +111,15 @@ public:
 	// Get the issue latency based on given type count
 	static int getAluIssueLatency(int type_count) { return configuration[type_count][2]; }
 
+	// Get the operation latency of a micro-instruction, or 1 cycle if it
+	// does not require a functional unit
+	static int getLatency(Uinst::Opcode opcode)
+	{
+		FunctionalUnit::Type type = type_table[opcode];
+		return type == FunctionalUnit::TypeNone ? 1 :
+				configuration[type][1];
+	}
+
 };
 
 }
@@ -17,6 +17,10 @@
  *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  */
 
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
 #include <lib/cpp/Misc.h>
 
 #include "BranchPredictor.h"
@@ -35,6 +39,21 @@ int BranchPredictor::two_level_l1_size;
 int BranchPredictor::two_level_l2_size;
 int BranchPredictor::two_level_history_size;
 int BranchPredictor::two_level_l2_height;
+int BranchPredictor::tage_base_size;
+int BranchPredictor::tage_num_tables;
+int BranchPredictor::tage_table_size;
+int BranchPredictor::tage_tag_bits;
+int BranchPredictor::tage_min_history;
+int BranchPredictor::tage_max_history;
+int BranchPredictor::perceptron_num_tables;
+int BranchPredictor::perceptron_table_size;
+int BranchPredictor::perceptron_max_history;
+BranchPredictor::IndirectKind BranchPredictor::indirect_kind;
+int BranchPredictor::ittage_num_tables;
+int BranchPredictor::ittage_table_size;
+int BranchPredictor::ittage_tag_bits;
+int BranchPredictor::ittage_min_history;
+int BranchPredictor::ittage_max_history;
 
 misc::StringMap BranchPredictor::KindMap =
 {
@@ -43,9 +62,41 @@ misc::StringMap BranchPredictor::KindMap =
 	{"NotTaken", KindNottaken},
 	{"Bimodal", KindBimod},
 	{"TwoLevel", KindTwoLevel},
-	{"Combined", KindCombined}
+	{"Combined", KindCombined},
+	{"TAGE", KindTage},
+	{"Perceptron", KindPerceptron}
+};
+
+misc::StringMap BranchPredictor::IndirectKindMap =
+{
+	{"BTB", IndirectKindBtb},
+	{"ITTAGE", IndirectKindIttage}
 };
 
+// Number of updates after which the useful counters of the TAGE and ITTAGE
+// predictors are aged
+static const int useful_reset_period = 256 * 1024;
+
+// Shortest history of the perceptron tables that use global history
+static const int perceptron_min_history = 2;
+
+
+void BranchPredictor::FoldedHistory::Update(const unsigned char *history,
+		int head)
+{
+	// Nothing to fold into
+	if (!folded_length)
+		return;
+
+	// Shift in the newest outcome, and take out the one that just left
+	// the history
+	value = (value << 1) | history[head];
+	value ^= history[(head + length) & (history_buffer_size - 1)] <<
+			(length % folded_length);
+	value ^= value >> folded_length;
+	value &= (1u << folded_length) - 1;
+}
+
 BranchPredictor::BranchPredictor(const std::string &name)
 	:
 	name(name)
@@ -83,6 +134,69 @@ BranchPredictor::BranchPredictor(const std::string &name)
 	for (int i = 0; i < btb_num_sets; i++)
 		for (int j = 0; j < btb_num_ways; j++)
 			btb[i * btb_num_ways + j].counter = j;
+
+	// Global history
+	if (kind == KindTage || kind == KindPerceptron ||
+			indirect_kind == IndirectKindIttage)
+		history = misc::new_unique_array<unsigned char>(
+				history_buffer_size);
+
+	// TAGE predictor, with base counters initialized to weakly taken
+	if (kind == KindTage)
+	{
+		tage_base = misc::new_unique_array<uint8_t>(
+				(tage_base_size + 3) / 4);
+		for (int i = 0; i < (tage_base_size + 3) / 4; i++)
+			tage_base[i] = 0xaa;
+		tage_tables = misc::new_unique_array<uint16_t>(
+				tage_num_tables * tage_table_size);
+		for (int i = 0; i < tage_num_tables; i++)
+		{
+			int length = getGeometricLength(i, tage_num_tables,
+					tage_min_history, tage_max_history);
+			index_histories[i].length = length;
+			index_histories[i].folded_length =
+					misc::LogBase2(tage_table_size);
+			tag_histories[i].length = length;
+			tag_histories[i].folded_length = tage_tag_bits;
+			tag_histories_2[i].length = length;
+			tag_histories_2[i].folded_length = tage_tag_bits - 1;
+		}
+	}
+
+	// Perceptron predictor. Table 0 does not use global history.
+	if (kind == KindPerceptron)
+	{
+		perceptron_weights = misc::new_unique_array<int8_t>(
+				perceptron_num_tables * perceptron_table_size);
+		perceptron_threshold = perceptron_num_tables;
+		for (int i = 1; i < perceptron_num_tables; i++)
+		{
+			index_histories[i].length = getGeometricLength(i - 1,
+					perceptron_num_tables - 1,
+					perceptron_min_history,
+					perceptron_max_history);
+			index_histories[i].folded_length =
+					misc::LogBase2(perceptron_table_size);
+		}
+	}
+
+	// ITTAGE predictor
+	if (indirect_kind == IndirectKindIttage)
+	{
+		ittage_tables = misc::new_unique_array<IttageEntry>(
+				ittage_num_tables * ittage_table_size);
+		for (int i = 0; i < ittage_num_tables; i++)
+		{
+			int length = getGeometricLength(i, ittage_num_tables,
+					ittage_min_history, ittage_max_history);
+			ittage_index_histories[i].length = length;
+			ittage_index_histories[i].folded_length =
+					misc::LogBase2(ittage_table_size);
+			ittage_tag_histories[i].length = length;
+			ittage_tag_histories[i].folded_length = ittage_tag_bits;
+		}
+	}
 }
 
 
@@ -105,6 +219,28 @@ void BranchPredictor::ParseConfiguration(misc::IniFile *ini_file)
 	two_level_l2_size = ini_file->ReadInt(section, "TwoLevel.L2Size", 1024);
 	two_level_history_size = ini_file->ReadInt(section, "TwoLevel.HistorySize", 8);
 
+	// TAGE predictor parameters
+	tage_base_size = ini_file->ReadInt(section, "TAGE.BaseSize", 4096);
+	tage_num_tables = ini_file->ReadInt(section, "TAGE.NumTables", 7);
+	tage_table_size = ini_file->ReadInt(section, "TAGE.TableSize", 1024);
+	tage_tag_bits = ini_file->ReadInt(section, "TAGE.TagBits", 9);
+	tage_min_history = ini_file->ReadInt(section, "TAGE.MinHistory", 4);
+	tage_max_history = ini_file->ReadInt(section, "TAGE.MaxHistory", 200);
+
+	// Perceptron predictor parameters
+	perceptron_num_tables = ini_file->ReadInt(section, "Perceptron.NumTables", 8);
+	perceptron_table_size = ini_file->ReadInt(section, "Perceptron.TableSize", 1024);
+	perceptron_max_history = ini_file->ReadInt(section, "Perceptron.MaxHistory", 64);
+
+	// Indirect target predictor parameters
+	indirect_kind = (IndirectKind) ini_file->ReadEnum(section, "Indirect",
+			IndirectKindMap, IndirectKindBtb);
+	ittage_num_tables = ini_file->ReadInt(section, "ITTAGE.NumTables", 5);
+	ittage_table_size = ini_file->ReadInt(section, "ITTAGE.TableSize", 256);
+	ittage_tag_bits = ini_file->ReadInt(section, "ITTAGE.TagBits", 9);
+	ittage_min_history = ini_file->ReadInt(section, "ITTAGE.MinHistory", 4);
+	ittage_max_history = ini_file->ReadInt(section, "ITTAGE.MaxHistory", 64);
+
 	// Two-level branch predictor parameter
 	two_level_l2_height = 1 << two_level_history_size;
 
@@ -123,6 +259,53 @@ void BranchPredictor::ParseConfiguration(misc::IniFile *ini_file)
 		throw Error("two-level predictor sizes must be power of 2");
 	if (two_level_l2_size & (two_level_l2_size - 1))
 		throw Error("two-level predictor sizes must be power of 2");
+
+	// Integrity of TAGE parameters
+	if (tage_base_size < 1 || (tage_base_size & (tage_base_size - 1)))
+		throw Error("TAGE base predictor size must be a power of 2");
+	if (tage_num_tables < 1 || tage_num_tables > MaxTables)
+		throw Error(misc::fmt("number of TAGE tables must be between "
+				"1 and %d", MaxTables));
+	if (tage_table_size < 1 || tage_table_size > 65536 ||
+			(tage_table_size & (tage_table_size - 1)))
+		throw Error("TAGE table size must be a power of 2 up to 65536");
+	if (tage_tag_bits < 2 || tage_tag_bits > 11)
+		throw Error("TAGE tags must have between 2 and 11 bits");
+	if (tage_min_history < 1 || tage_min_history > tage_max_history ||
+			tage_max_history > MaxHistoryLength)
+		throw Error(misc::fmt("TAGE history lengths must satisfy "
+				"1 <= MinHistory <= MaxHistory <= %d",
+				MaxHistoryLength));
+
+	// Integrity of perceptron parameters
+	if (perceptron_num_tables < 1 || perceptron_num_tables > MaxTables)
+		throw Error(misc::fmt("number of perceptron tables must be "
+				"between 1 and %d", MaxTables));
+	if (perceptron_table_size < 1 || perceptron_table_size > 65536 ||
+			(perceptron_table_size & (perceptron_table_size - 1)))
+		throw Error("perceptron table size must be a power of 2 up "
+				"to 65536");
+	if (perceptron_max_history < perceptron_min_history ||
+			perceptron_max_history > MaxHistoryLength)
+		throw Error(misc::fmt("perceptron history length must be "
+				"between %d and %d", perceptron_min_history,
+				MaxHistoryLength));
+
+	// Integrity of ITTAGE parameters
+	if (ittage_num_tables < 1 || ittage_num_tables > MaxTables)
+		throw Error(misc::fmt("number of ITTAGE tables must be between "
+				"1 and %d", MaxTables));
+	if (ittage_table_size < 1 || ittage_table_size > 65536 ||
+			(ittage_table_size & (ittage_table_size - 1)))
+		throw Error("ITTAGE table size must be a power of 2 up to "
+				"65536");
+	if (ittage_tag_bits < 1 || ittage_tag_bits > 16)
+		throw Error("ITTAGE tags must have between 1 and 16 bits");
+	if (ittage_min_history < 1 || ittage_min_history > ittage_max_history ||
+			ittage_max_history > MaxHistoryLength)
+		throw Error(misc::fmt("ITTAGE history lengths must satisfy "
+				"1 <= MinHistory <= MaxHistory <= %d",
+				MaxHistoryLength));
 }
 
 
@@ -138,6 +321,426 @@ void BranchPredictor::DumpConfiguration(std::ostream &os)
 	os << misc::fmt("\tTwoLevel.L1Size: %d\n", two_level_l1_size);
 	os << misc::fmt("\tTwoLevel.L2Size: %d\n", two_level_l2_size);
 	os << misc::fmt("\tTwoLevel.HistorySize: %d\n", two_level_history_size);
+	os << misc::fmt("\tTAGE.BaseSize: %d\n", tage_base_size);
+	os << misc::fmt("\tTAGE.NumTables: %d\n", tage_num_tables);
+	os << misc::fmt("\tTAGE.TableSize: %d\n", tage_table_size);
+	os << misc::fmt("\tTAGE.TagBits: %d\n", tage_tag_bits);
+	os << misc::fmt("\tTAGE.MinHistory: %d\n", tage_min_history);
+	os << misc::fmt("\tTAGE.MaxHistory: %d\n", tage_max_history);
+	os << misc::fmt("\tPerceptron.NumTables: %d\n", perceptron_num_tables);
+	os << misc::fmt("\tPerceptron.TableSize: %d\n", perceptron_table_size);
+	os << misc::fmt("\tPerceptron.MaxHistory: %d\n", perceptron_max_history);
+	os << misc::fmt("\tIndirect: %s\n", IndirectKindMap[indirect_kind]);
+	os << misc::fmt("\tITTAGE.NumTables: %d\n", ittage_num_tables);
+	os << misc::fmt("\tITTAGE.TableSize: %d\n", ittage_table_size);
+	os << misc::fmt("\tITTAGE.TagBits: %d\n", ittage_tag_bits);
+	os << misc::fmt("\tITTAGE.MinHistory: %d\n", ittage_min_history);
+	os << misc::fmt("\tITTAGE.MaxHistory: %d\n", ittage_max_history);
+}
+
+
+void BranchPredictor::DumpReport(std::ostream &os) const
+{
+	os << "; Branch predictor\n";
+	os << misc::fmt("BranchPredictor.Conditional = %lld\n",
+			num_conditional_branches);
+	os << misc::fmt("BranchPredictor.ConditionalMispred = %lld\n",
+			num_mispredicted_conditional_branches);
+	os << misc::fmt("BranchPredictor.Indirect = %lld\n",
+			num_indirect_branches);
+	os << misc::fmt("BranchPredictor.IndirectMispred = %lld\n",
+			num_mispredicted_indirect_branches);
+	os << '\n';
+}
+
+
+int BranchPredictor::getGeometricLength(int index, int num_tables,
+		int min, int max)
+{
+	if (num_tables == 1)
+		return min;
+	double ratio = (double) max / min;
+	double exponent = (double) index / (num_tables - 1);
+	return (int) (min * pow(ratio, exponent) + 0.5);
+}
+
+
+void BranchPredictor::UpdateHistory(bool taken)
+{
+	// Insert outcome
+	history_head = (history_head - 1) & (history_buffer_size - 1);
+	history[history_head] = taken;
+
+	// Update folded histories
+	for (int i = 0; i < MaxTables; i++)
+	{
+		index_histories[i].Update(history.get(), history_head);
+		tag_histories[i].Update(history.get(), history_head);
+		tag_histories_2[i].Update(history.get(), history_head);
+		ittage_index_histories[i].Update(history.get(), history_head);
+		ittage_tag_histories[i].Update(history.get(), history_head);
+	}
+}
+
+
+unsigned BranchPredictor::getRandom()
+{
+	// Xorshift generator, so that simulations are deterministic
+	random_state ^= random_state << 13;
+	random_state ^= random_state >> 17;
+	random_state ^= random_state << 5;
+	return random_state;
+}
+
+
+void BranchPredictor::setTageBaseCounter(int index, int counter)
+{
+	assert(counter >= 0 && counter <= 3);
+	int shift = (index & 3) * 2;
+	tage_base[index >> 2] = (tage_base[index >> 2] & ~(3 << shift)) |
+			(counter << shift);
+}
+
+
+BranchPredictor::Prediction BranchPredictor::LookupTage(Uop *uop)
+{
+	// Base predictor
+	unsigned pc = uop->eip;
+	uop->tage_base_index = pc & (tage_base_size - 1);
+	Prediction base_prediction = getTageBaseCounter(uop->tage_base_index) > 1 ?
+			PredictionTaken : PredictionNotTaken;
+
+	// Compute indices and tags of all tables, and find the two longest
+	// histories with a matching tag
+	int provider = -1;
+	int alternate = -1;
+	for (int i = tage_num_tables - 1; i >= 0; i--)
+	{
+		uop->predictor_indices[i] = (pc ^ (pc >> (i + 1)) ^
+				index_histories[i].value) &
+				(tage_table_size - 1);
+		uop->predictor_tags[i] = (pc ^ tag_histories[i].value ^
+				(tag_histories_2[i].value << 1)) &
+				((1 << tage_tag_bits) - 1);
+		uint16_t entry = getTageEntry(i, uop->predictor_indices[i]);
+		if (getTageTag(entry) != uop->predictor_tags[i])
+			continue;
+		if (provider < 0)
+			provider = i;
+		else if (alternate < 0)
+			alternate = i;
+	}
+
+	// Alternate prediction
+	uop->tage_alternate_prediction = base_prediction;
+	if (alternate >= 0)
+		uop->tage_alternate_prediction = getTageCounter(getTageEntry(
+				alternate, uop->predictor_indices[alternate])) > 3 ?
+				PredictionTaken : PredictionNotTaken;
+
+	// No table matched, use base predictor
+	uop->tage_provider = provider;
+	if (provider < 0)
+	{
+		uop->tage_provider_prediction = base_prediction;
+		return base_prediction;
+	}
+
+	// Provider prediction. For a weak entry that was just allocated, the
+	// alternate prediction may be more accurate.
+	uint16_t entry = getTageEntry(provider, uop->predictor_indices[provider]);
+	int counter = getTageCounter(entry);
+	uop->tage_provider_prediction = counter > 3 ?
+			PredictionTaken : PredictionNotTaken;
+	bool weak = counter == 3 || counter == 4;
+	if (weak && !getTageUseful(entry) && tage_use_alternate >= 8)
+		return uop->tage_alternate_prediction;
+	return uop->tage_provider_prediction;
+}
+
+
+void BranchPredictor::UpdateTage(Uop *uop, bool taken)
+{
+	Prediction outcome = taken ? PredictionTaken : PredictionNotTaken;
+
+	// The provider entry may have been replaced since the lookup
+	int provider = uop->tage_provider;
+	uint16_t *provider_entry = nullptr;
+	if (provider >= 0)
+	{
+		provider_entry = &getTageEntry(provider,
+				uop->predictor_indices[provider]);
+		if (getTageTag(*provider_entry) != uop->predictor_tags[provider])
+			provider_entry = nullptr;
+	}
+
+	// Learn whether newly allocated entries are better than the alternate
+	// prediction
+	if (provider_entry && uop->tage_provider_prediction !=
+			uop->tage_alternate_prediction)
+	{
+		int counter = getTageCounter(*provider_entry);
+		if ((counter == 3 || counter == 4) &&
+				!getTageUseful(*provider_entry))
+		{
+			if (uop->tage_alternate_prediction == outcome)
+				tage_use_alternate = std::min(tage_use_alternate + 1, 15);
+			else
+				tage_use_alternate = std::max(tage_use_alternate - 1, 0);
+		}
+	}
+
+	// On a misprediction, allocate an entry in a table with longer
+	// history. The first candidate is skipped at random, so that
+	// entries are not always allocated in the same table.
+	if (uop->prediction != outcome && provider < tage_num_tables - 1)
+	{
+		int allocated = -1;
+		bool skip = getRandom() & 1;
+		for (int i = provider + 1; i < tage_num_tables; i++)
+		{
+			uint16_t &entry = getTageEntry(i, uop->predictor_indices[i]);
+			if (getTageUseful(entry))
+				continue;
+			allocated = i;
+			if (skip)
+			{
+				skip = false;
+				continue;
+			}
+			break;
+		}
+		if (allocated >= 0)
+		{
+			getTageEntry(allocated, uop->predictor_indices[allocated]) =
+					getTageEntry(taken ? 4 : 3, 0,
+					uop->predictor_tags[allocated]);
+		}
+		else
+		{
+			for (int i = provider + 1; i < tage_num_tables; i++)
+			{
+				uint16_t &entry = getTageEntry(i,
+						uop->predictor_indices[i]);
+				entry = getTageEntry(getTageCounter(entry),
+						std::max(getTageUseful(entry) - 1, 0),
+						getTageTag(entry));
+			}
+		}
+	}
+
+	// Update provider entry, or base predictor
+	if (provider_entry)
+	{
+		int counter = getTageCounter(*provider_entry);
+		int useful = getTageUseful(*provider_entry);
+		counter = taken ? std::min(counter + 1, 7) :
+				std::max(counter - 1, 0);
+		if (uop->tage_provider_prediction != uop->tage_alternate_prediction)
+			useful = uop->tage_provider_prediction == outcome ?
+					std::min(useful + 1, 3) :
+					std::max(useful - 1, 0);
+		*provider_entry = getTageEntry(counter, useful,
+				getTageTag(*provider_entry));
+	}
+	else if (provider < 0)
+	{
+		int counter = getTageBaseCounter(uop->tage_base_index);
+		counter = taken ? std::min(counter + 1, 3) :
+				std::max(counter - 1, 0);
+		setTageBaseCounter(uop->tage_base_index, counter);
+	}
+
+	// Periodically age useful counters
+	if (++tage_num_updates >= useful_reset_period)
+	{
+		tage_num_updates = 0;
+		for (int i = 0; i < tage_num_tables * tage_table_size; i++)
+		{
+			uint16_t &entry = tage_tables[i];
+			entry = getTageEntry(getTageCounter(entry),
+					getTageUseful(entry) >> 1,
+					getTageTag(entry));
+		}
+	}
+}
+
+
+BranchPredictor::Prediction BranchPredictor::LookupPerceptron(Uop *uop)
+{
+	// Add up one weight of each table. Table 0 has a folded history of
+	// length 0, so it is indexed only by address.
+	unsigned pc = uop->eip;
+	int output = 0;
+	for (int i = 0; i < perceptron_num_tables; i++)
+	{
+		uop->predictor_indices[i] = (pc ^ (pc >> (i + 1)) ^
+				index_histories[i].value) &
+				(perceptron_table_size - 1);
+		output += perceptron_weights[i * perceptron_table_size +
+				uop->predictor_indices[i]];
+	}
+
+	// Prediction
+	uop->perceptron_output = output;
+	return output >= 0 ? PredictionTaken : PredictionNotTaken;
+}
+
+
+void BranchPredictor::UpdatePerceptron(Uop *uop, bool taken)
+{
+	// Train only on a misprediction or a low-confidence output
+	int output = uop->perceptron_output;
+	bool mispredicted = (output >= 0) != taken;
+	if (!mispredicted && std::abs(output) > perceptron_threshold)
+		return;
+
+	// Update weights, saturating at 6 bits
+	for (int i = 0; i < perceptron_num_tables; i++)
+	{
+		int8_t &weight = perceptron_weights[i * perceptron_table_size +
+				uop->predictor_indices[i]];
+		if (taken && weight < 31)
+			weight++;
+		else if (!taken && weight > -32)
+			weight--;
+	}
+
+	// Adapt the threshold, so that mispredictions and low-confidence
+	// updates are balanced
+	if (mispredicted)
+	{
+		perceptron_threshold_counter++;
+		if (perceptron_threshold_counter >= 63)
+		{
+			perceptron_threshold++;
+			perceptron_threshold_counter = 0;
+		}
+	}
+	else
+	{
+		perceptron_threshold_counter--;
+		if (perceptron_threshold_counter <= -64)
+		{
+			perceptron_threshold = std::max(perceptron_threshold - 1, 0);
+			perceptron_threshold_counter = 0;
+		}
+	}
+}
+
+
+bool BranchPredictor::isIndirect(Uop *uop)
+{
+	Uinst *uinst = uop->getUinst();
+	return (uinst->getOpcode() == Uinst::OpcodeJump ||
+			uinst->getOpcode() == Uinst::OpcodeCall) &&
+			uinst->getIDep(0) != Uinst::DepNone;
+}
+
+
+unsigned BranchPredictor::LookupIttage(Uop *uop)
+{
+	// Compute indices and tags of all tables, and find the longest history
+	// with a matching tag
+	unsigned pc = uop->eip;
+	uop->ittage_provider = -1;
+	for (int i = ittage_num_tables - 1; i >= 0; i--)
+	{
+		uop->ittage_indices[i] = (pc ^ (pc >> (i + 2)) ^
+				ittage_index_histories[i].value) &
+				(ittage_table_size - 1);
+		uop->ittage_tags[i] = (pc ^ ittage_tag_histories[i].value) &
+				((1u << ittage_tag_bits) - 1);
+		IttageEntry &entry = ittage_tables[i * ittage_table_size +
+				uop->ittage_indices[i]];
+		if (uop->ittage_provider < 0 && entry.tag == uop->ittage_tags[i])
+			uop->ittage_provider = i;
+	}
+
+	// No table matched
+	if (uop->ittage_provider < 0)
+		return 0;
+
+	// Target of the provider
+	int provider = uop->ittage_provider;
+	return ittage_tables[provider * ittage_table_size +
+			uop->ittage_indices[provider]].target;
+}
+
+
+void BranchPredictor::UpdateIttage(Uop *uop)
+{
+	// Update provider entry, if still present. The target is only replaced
+	// once the confidence reaches 0.
+	int provider = uop->ittage_provider;
+	if (provider >= 0)
+	{
+		IttageEntry &entry = ittage_tables[provider * ittage_table_size +
+				uop->ittage_indices[provider]];
+		if (entry.tag == uop->ittage_tags[provider])
+		{
+			if (entry.target == uop->neip)
+			{
+				entry.confidence = std::min(entry.confidence + 1, 3);
+				entry.useful = 1;
+			}
+			else if (entry.confidence)
+			{
+				entry.confidence--;
+			}
+			else
+			{
+				entry.target = uop->neip;
+				entry.useful = 0;
+			}
+		}
+	}
+
+	// On a misprediction, allocate an entry in a table with longer
+	// history, or make room for future allocations
+	if (uop->ittage_target != uop->neip && provider < ittage_num_tables - 1)
+	{
+		int allocated = -1;
+		bool skip = getRandom() & 1;
+		for (int i = provider + 1; i < ittage_num_tables; i++)
+		{
+			IttageEntry &entry = ittage_tables[i * ittage_table_size +
+					uop->ittage_indices[i]];
+			if (entry.useful)
+				continue;
+			allocated = i;
+			if (skip)
+			{
+				skip = false;
+				continue;
+			}
+			break;
+		}
+		if (allocated >= 0)
+		{
+			IttageEntry &entry = ittage_tables[allocated *
+					ittage_table_size +
+					uop->ittage_indices[allocated]];
+			entry.target = uop->neip;
+			entry.tag = uop->ittage_tags[allocated];
+			entry.confidence = 0;
+			entry.useful = 0;
+		}
+		else
+		{
+			for (int i = provider + 1; i < ittage_num_tables; i++)
+				ittage_tables[i * ittage_table_size +
+						uop->ittage_indices[i]].useful = 0;
+		}
+	}
+
+	// Periodically reset useful bits
+	if (++ittage_num_updates >= useful_reset_period)
+	{
+		ittage_num_updates = 0;
+		for (int i = 0; i < ittage_num_tables * ittage_table_size; i++)
+			ittage_tables[i].useful = 0;
+	}
 }
 
 
@@ -222,6 +825,20 @@ BranchPredictor::Prediction BranchPredictor::Lookup(Uop *uop)
 		uop->prediction = choice_prediction;
 	}
 
+	// TAGE
+	if (kind == KindTage)
+		uop->prediction = LookupTage(uop);
+
+	// Perceptron
+	if (kind == KindPerceptron)
+		uop->prediction = LookupPerceptron(uop);
+
+	// Insert the branch outcome in the global history. Only uops in the
+	// correct path are known at fetch, so the history never needs to be
+	// repaired after a misprediction.
+	if (history && !uop->speculative_mode)
+		UpdateHistory(uop->neip != uop->eip + uop->mop_size);
+
 	// Return prediction
 	assert(uop->prediction == PredictionTaken || uop->prediction == PredictionNotTaken);
 	return uop->prediction;
@@ -258,7 +875,7 @@ int BranchPredictor::LookupMultiple(unsigned int eip, int count)
 }
 
 
-void BranchPredictor::Update(Uop *uop)
+void BranchPredictor::UpdatePredictors(Uop *uop)
 {
 	// Taken/NotTaken flag
 	bool taken;
@@ -279,11 +896,6 @@ void BranchPredictor::Update(Uop *uop)
 	assert(uop->getFlags() & Uinst::FlagCtrl);
 	taken = uop->neip != uop->eip + uop->mop_size;
 
-	// Stats
-	accesses++;
-	if (uop->neip == uop->predicted_neip)
-		hits++;
-
 	// Update predictors. This is only done for conditional branches. Thus,
 	// exit now if instruction is a call, ret, or jmp.
 	// No update is performed in a perfect branch predictor either.
@@ -330,6 +942,61 @@ void BranchPredictor::Update(Uop *uop)
 		else
 			*choice_ptr = *choice_ptr + 1 > 3 ? 3 : *choice_ptr + 1;
 	}
+
+	// TAGE
+	if (kind == KindTage)
+		UpdateTage(uop, taken);
+
+	// Perceptron
+	if (kind == KindPerceptron)
+		UpdatePerceptron(uop, taken);
+}
+
+
+void BranchPredictor::Update(Uop *uop)
+{
+	// Stats
+	accesses++;
+	if (uop->neip == uop->predicted_neip)
+		hits++;
+
+	// Conditional branches
+	Uinst::Opcode opcode = uop->getUinst()->getOpcode();
+	if (!(uop->getFlags() & Uinst::FlagUncond) &&
+			opcode != Uinst::OpcodeIbranch)
+	{
+		bool taken = uop->neip != uop->eip + uop->mop_size;
+		num_conditional_branches++;
+		if ((uop->prediction == PredictionTaken) != taken)
+			num_mispredicted_conditional_branches++;
+	}
+
+	// Indirect jumps and calls
+	if (isIndirect(uop))
+	{
+		num_indirect_branches++;
+		if (uop->neip != uop->predicted_neip)
+			num_mispredicted_indirect_branches++;
+	}
+
+	// Update predictors
+	UpdatePredictors(uop);
+}
+
+
+void BranchPredictor::Warm(Uop *uop)
+{
+	// Access BTB and RAS, and fill in the prediction fields of the uop,
+	// as the fetch stage would do.
+	assert(!uop->speculative_mode);
+	assert(uop->getFlags() & Uinst::FlagCtrl);
+	LookupBtb(uop);
+	Lookup(uop);
+
+	// Train predictors and BTB with the actual outcome, as the commit
+	// stage would do, but without recording statistics.
+	UpdatePredictors(uop);
+	UpdateBtb(uop);
 }
 
 
@@ -382,6 +1049,16 @@ unsigned int BranchPredictor::LookupBtb(Uop *uop)
 		target = ras[ras_index];
 	}
 
+	// Indirect jumps and calls take the target from the ITTAGE predictor
+	// if any of its tables provides one, and from the BTB otherwise
+	if (indirect_kind == IndirectKindIttage && isIndirect(uop))
+	{
+		unsigned ittage_target = LookupIttage(uop);
+		if (hit && ittage_target)
+			target = ittage_target;
+		uop->ittage_target = target;
+	}
+
 	// Return
 	return target;
 }
@@ -438,6 +1115,10 @@ void BranchPredictor::UpdateBtb(Uop *uop)
 		found_entry->counter = btb_num_ways - 1;
 		found_entry->target = uop->neip;
 	}
+
+	// Indirect target predictor
+	if (indirect_kind == IndirectKindIttage && isIndirect(uop))
+		UpdateIttage(uop);
 }
 
 
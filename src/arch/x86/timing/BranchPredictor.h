@@ -20,6 +20,9 @@
 #ifndef ARCH_X86_TIMING_BRANCH_PREDICTOR_H
 #define ARCH_X86_TIMING_BRANCH_PREDICTOR_H
 
+#include <cstdint>
+#include <iostream>
+#include <memory>
 #include <string>
 
 #include <arch/x86/emulator/Uinst.h>
@@ -54,12 +57,32 @@ public:
 		KindNottaken,
 		KindBimod,
 		KindTwoLevel,
-		KindCombined
+		KindCombined,
+		KindTage,
+		KindPerceptron
 	};
 
 	/// string map of branch predictor kind
 	static misc::StringMap KindMap;
 
+	/// Predictor for the targets of indirect jumps and calls
+	enum IndirectKind
+	{
+		IndirectKindInvalid = 0,
+		IndirectKindBtb,
+		IndirectKindIttage
+	};
+
+	/// String map for values of type IndirectKind
+	static misc::StringMap IndirectKindMap;
+
+	/// Maximum number of tables in the TAGE, perceptron, and ITTAGE
+	/// predictors
+	static const int MaxTables = 12;
+
+	/// Maximum global history length
+	static const int MaxHistoryLength = 1024;
+
 private:
 
 	//
@@ -96,6 +119,47 @@ private:
 	// Height of the level 2 table of the two-level predictor
 	static int two_level_l2_height;
 
+	// Number of entries of the TAGE base predictor
+	static int tage_base_size;
+
+	// Number of tagged tables of the TAGE predictor
+	static int tage_num_tables;
+
+	// Number of entries of each tagged TAGE table
+	static int tage_table_size;
+
+	// Number of bits in the tags of the TAGE predictor
+	static int tage_tag_bits;
+
+	// History lengths of the shortest and longest TAGE tables
+	static int tage_min_history;
+	static int tage_max_history;
+
+	// Number of weight tables of the perceptron predictor
+	static int perceptron_num_tables;
+
+	// Number of weights in each table of the perceptron predictor
+	static int perceptron_table_size;
+
+	// Longest history used by the perceptron predictor
+	static int perceptron_max_history;
+
+	// Indirect target predictor kind
+	static IndirectKind indirect_kind;
+
+	// Number of tagged tables of the ITTAGE predictor
+	static int ittage_num_tables;
+
+	// Number of entries of each ITTAGE table
+	static int ittage_table_size;
+
+	// Number of bits in the tags of the ITTAGE predictor
+	static int ittage_tag_bits;
+
+	// History lengths of the shortest and longest ITTAGE tables
+	static int ittage_min_history;
+	static int ittage_max_history;
+
 
 
 
@@ -138,10 +202,196 @@ private:
 	//   2,3 - Use two-level adaptive predictor
 	std::unique_ptr<char[]> choice;
 
-	// Stats 
+
+
+
+	//
+	// Global history, used by the TAGE, perceptron, and ITTAGE predictors
+	//
+
+	// Number of entries in the global history buffer, larger than the
+	// maximum history length
+	static const int history_buffer_size = 2 * MaxHistoryLength;
+
+	// Outcomes of the last conditional branches in a circular buffer, one
+	// per byte. The most recent outcome is at position 'history_head'.
+	std::unique_ptr<unsigned char[]> history;
+
+	// Position of the most recent outcome in the history buffer
+	int history_head = 0;
+
+	// Global history of a given length, folded by exclusive-or into a
+	// value of fewer bits. The value is updated incrementally as new
+	// outcomes enter the history and old ones leave it.
+	struct FoldedHistory
+	{
+		unsigned value = 0;
+		int length = 0;
+		int folded_length = 0;
+
+		// Update with the new outcome at the head of the history
+		void Update(const unsigned char *history, int head);
+	};
+
+	// Folded histories for the indices and tags of the TAGE tables, or for
+	// the indices of the perceptron tables
+	FoldedHistory index_histories[MaxTables];
+	FoldedHistory tag_histories[MaxTables];
+	FoldedHistory tag_histories_2[MaxTables];
+
+	// Folded histories for the indices and tags of the ITTAGE tables
+	FoldedHistory ittage_index_histories[MaxTables];
+	FoldedHistory ittage_tag_histories[MaxTables];
+
+	// Return the history length of table 'index' out of 'num_tables',
+	// in a geometric series between 'min' and 'max'
+	static int getGeometricLength(int index, int num_tables, int min,
+			int max);
+
+	// Insert the outcome of a conditional branch in the global history
+	void UpdateHistory(bool taken);
+
+	// Pseudo-random number generator for the allocation of entries
+	unsigned random_state = 1;
+
+	// Return the next pseudo-random number
+	unsigned getRandom();
+
+
+
+
+	//
+	// TAGE predictor
+	//
+
+	// Base predictor, with 2-bit counters packed four per byte
+	std::unique_ptr<uint8_t[]> tage_base;
+
+	// Tagged tables, with 'tage_table_size' entries per table. Each entry is
+	// packed in 16 bits, with a 3-bit counter in bits 0-2, a 2-bit useful
+	// counter in bits 3-4, and the tag in bits 5-15.
+	std::unique_ptr<uint16_t[]> tage_tables;
+
+	// Counter choosing the alternate prediction when the provider entry
+	// was just allocated. The alternate is used if it is 8 or more.
+	int tage_use_alternate = 8;
+
+	// Number of updates since the useful counters were last aged
+	int tage_num_updates = 0;
+
+	// Return the counter of the base predictor at an index
+	int getTageBaseCounter(int index) const
+	{
+		return (tage_base[index >> 2] >> ((index & 3) * 2)) & 3;
+	}
+
+	// Set the counter of the base predictor at an index
+	void setTageBaseCounter(int index, int counter);
+
+	// Return the entry of a TAGE table
+	uint16_t &getTageEntry(int table, int index)
+	{
+		return tage_tables[table * tage_table_size + index];
+	}
+
+	// Fields of a packed TAGE entry
+	static int getTageCounter(uint16_t entry) { return entry & 7; }
+	static int getTageUseful(uint16_t entry) { return (entry >> 3) & 3; }
+	static int getTageTag(uint16_t entry) { return entry >> 5; }
+	static uint16_t getTageEntry(int counter, int useful, int tag)
+	{
+		return counter | useful << 3 | tag << 5;
+	}
+
+	// Look up the TAGE predictor, filling in the TAGE fields of the uop
+	Prediction LookupTage(Uop *uop);
+
+	// Update the TAGE predictor with the outcome of a branch
+	void UpdateTage(Uop *uop, bool taken);
+
+
+
+
+	//
+	// Perceptron predictor
+	//
+
+	// Weights, with 'perceptron_table_size' 6-bit signed weights in each
+	// table, one per byte. Table 0 is indexed by the branch address only,
+	// and the other tables by the address hashed with the global history.
+	std::unique_ptr<int8_t[]> perceptron_weights;
+
+	// Threshold of the perceptron output below which weights are trained
+	// even if the prediction was correct. It adapts to balance
+	// mispredictions and trainings on correct predictions.
+	int perceptron_threshold = 0;
+
+	// Counter adjusting the threshold
+	int perceptron_threshold_counter = 0;
+
+	// Look up the perceptron predictor, filling in the perceptron fields of
+	// the uop
+	Prediction LookupPerceptron(Uop *uop);
+
+	// Update the perceptron predictor with the outcome of a branch
+	void UpdatePerceptron(Uop *uop, bool taken);
+
+
+
+
+	//
+	// ITTAGE indirect target predictor
+	//
+
+	// Entry of an ITTAGE table
+	struct IttageEntry
+	{
+		unsigned target;
+		uint16_t tag;
+		uint8_t confidence;
+		uint8_t useful;
+	};
+
+	// Tagged tables, with 'ittage_table_size' entries per table. The BTB
+	// acts as the base predictor.
+	std::unique_ptr<IttageEntry[]> ittage_tables;
+
+	// Number of updates since the useful bits were last cleared
+	int ittage_num_updates = 0;
+
+	// Return true if the uop is an indirect jump or call
+	static bool isIndirect(Uop *uop);
+
+	// Look up the ITTAGE predictor, filling in the ITTAGE fields of the uop.
+	// Return the predicted target, or 0 if no table provides one.
+	unsigned LookupIttage(Uop *uop);
+
+	// Update the ITTAGE predictor with the target of an indirect branch
+	void UpdateIttage(Uop *uop);
+
+
+
+
+	//
+	// Statistics
+	//
+
 	long long accesses = 0;
 	long long hits = 0;
 
+	// Committed conditional branches, and those with a mispredicted
+	// direction
+	long long num_conditional_branches = 0;
+	long long num_mispredicted_conditional_branches = 0;
+
+	// Committed indirect jumps and calls, and those with a mispredicted
+	// target
+	long long num_indirect_branches = 0;
+	long long num_mispredicted_indirect_branches = 0;
+
+	// Update the predictor tables with the outcome of a branch
+	void UpdatePredictors(Uop *uop);
+
 public:
 
 	//
@@ -185,6 +435,36 @@ public:
 
 	static int getTwoLevelL2Height() { return two_level_l2_height; }
 
+	static int getTageBaseSize() { return tage_base_size; }
+
+	static int getTageNumTables() { return tage_num_tables; }
+
+	static int getTageTableSize() { return tage_table_size; }
+
+	static int getTageTagBits() { return tage_tag_bits; }
+
+	static int getTageMinHistory() { return tage_min_history; }
+
+	static int getTageMaxHistory() { return tage_max_history; }
+
+	static int getPerceptronNumTables() { return perceptron_num_tables; }
+
+	static int getPerceptronTableSize() { return perceptron_table_size; }
+
+	static int getPerceptronMaxHistory() { return perceptron_max_history; }
+
+	static IndirectKind getIndirectKind() { return indirect_kind; }
+
+	static int getIttageNumTables() { return ittage_num_tables; }
+
+	static int getIttageTableSize() { return ittage_table_size; }
+
+	static int getIttageTagBits() { return ittage_tag_bits; }
+
+	static int getIttageMinHistory() { return ittage_min_history; }
+
+	static int getIttageMaxHistory() { return ittage_max_history; }
+
 
 
 
@@ -201,6 +481,29 @@ public:
 	/// Dump configuration
 	void DumpConfiguration(std::ostream &os = std::cout);
 
+	/// Dump statistics of the TAGE, perceptron, and ITTAGE predictors
+	void DumpReport(std::ostream &os = std::cout) const;
+
+	/// Return the number of committed conditional branches
+	long long getNumConditionalBranches() const { return num_conditional_branches; }
+
+	/// Return the number of conditional branches with a mispredicted
+	/// direction
+	long long getNumMispredictedConditionalBranches() const
+	{
+		return num_mispredicted_conditional_branches;
+	}
+
+	/// Return the number of committed indirect jumps and calls
+	long long getNumIndirectBranches() const { return num_indirect_branches; }
+
+	/// Return the number of indirect jumps and calls with a mispredicted
+	/// target
+	long long getNumMispredictedIndirectBranches() const
+	{
+		return num_mispredicted_indirect_branches;
+	}
+
 	char getBimodStatus(int index) const { return bimod[index]; }
 
 	int getTwoLevelBhtStatus(int index) const { return two_level_bht[index]; }
@@ -247,6 +550,17 @@ public:
 	///
 	void Update(Uop *uop);
 
+	/// Train the BTB, the RAS, and the predictor tables with the actual
+	/// outcome of a branch executed during functional simulation. The
+	/// prediction fields of the uop are filled in, and no statistics are
+	/// recorded.
+	///
+	/// \param uop
+	/// 	Micro-instruction of a non-speculative branch, with fields
+	///	\c eip, \c mop_size, and \c neip set.
+	///
+	void Warm(Uop *uop);
+
 	/// Lookup BTB. If it contains the uop address, return target. The BTB
 	/// also contains information about the type of branch, i.e., jump,
 	/// call, ret, or conditional. If instruction is call or ret, access RAS
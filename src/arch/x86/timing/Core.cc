@@ -48,7 +48,7 @@ void Core::Dump(std::ostream &os) const
 }
 
 
-void Core::InsertInEventQueue(std::shared_ptr<Uop> uop, int latency)
+void Core::InsertInEventQueue(Uop *uop, int latency)
 {
 	// Sanity
 	assert(!uop->in_event_queue);
@@ -57,22 +57,9 @@ void Core::InsertInEventQueue(std::shared_ptr<Uop> uop, int latency)
 	assert(!uop->completed);
 	uop->complete_when = cpu->getCycle() + latency;
 
-	// Find position in event queue
-	auto it = event_queue.begin();
-	auto e = event_queue.end();
-	while (it != e)
-	{
-		// Check if position found
-		if (uop->Compare(it->get()) < 0)
-			break;
-
-		// Next
-		++it;
-	}
-
-	// Insert
-	uop->event_queue_iterator = event_queue.insert(it, uop);
+	// Insert in the bucket of its completion cycle
 	uop->in_event_queue = true;
+	event_queue.Insert(uop);
 }
 
 
@@ -81,15 +68,11 @@ void Core::ExtractFromEventQueue(Uop *uop)
 	// Uop must be in the queue
 	assert(uop->in_event_queue);
 
-	// Save iterator
-	auto it = uop->event_queue_iterator;
-
 	// Indicate that the uop is not in the queue anymore
 	uop->in_event_queue = false;
-	uop->event_queue_iterator = event_queue.end();
 
-	// Remove it as the last step, as this may free the uop
-	event_queue.erase(it);
+	// Remove it as the last step
+	event_queue.Erase(uop);
 }
 
 
@@ -212,6 +195,10 @@ void Core::Dispatch()
 
 void Core::Issue()
 {
+	// Replay loads that issued before older stores to the same address
+	for (auto &thread : threads)
+		thread->CheckMemoryOrder();
+
 	switch (Cpu::getIssueKind())
 	{
 	
@@ -308,11 +295,11 @@ void Core::Writeback()
 	for (;;)
 	{
 		// No more elements in the event queue
-		if (event_queue.empty())
+		if (event_queue.isEmpty())
 			break;
 
 		// Pick uop from the head of the event queue
-		std::shared_ptr<Uop> uop = event_queue.front();
+		Uop *uop = event_queue.Front();
 
 		// If the uop is set to complete later than the current cycle,
 		// there is nothing else to extract from the event queue.
@@ -324,7 +311,7 @@ void Core::Writeback()
 		assert(!uop->completed);
 
 		// Extract element from event queue
-		ExtractFromEventQueue(uop.get());
+		ExtractFromEventQueue(uop);
 
 		// If this instruction is the first in speculative mode
 		// (typically a mispredicted branch), and recovery is configured
@@ -358,7 +345,7 @@ void Core::Writeback()
 		// Write output registers
 		Thread *thread = uop->getThread();
 		RegisterFile *register_file = thread->getRegisterFile();
-		register_file->WriteUop(uop.get());
+		register_file->WriteUop(uop);
 
 		// Increment number of writes to core's register counters
 		num_integer_register_writes += uop->getNumIntegerOutputs();
@@ -370,9 +357,18 @@ void Core::Writeback()
 		thread->incNumFloatingPointRegisterWrites(uop->getNumFloatingPointOutputs());
 		thread->incNumXmmRegisterWrites(uop->getNumXmmOutputs());
 		
+		// Uops no longer in the reorder buffer, such as squashed loads
+		// and committed stores, are released here. Other uops are
+		// released at commit, or when a recovery squashes them.
+		bool release = !uop->in_reorder_buffer;
+
 		// Recover from mispeculation
 		if (recover)
 			thread->Recover();
+
+		// Free uop
+		if (release)
+			thread->getUopPool()->FreeIfNotQueued(uop);
 	}
 }
 
@@ -447,6 +443,10 @@ void Core::Commit()
 
 		throw misc::Panic("Invalid commit kind");
 	}
+
+	// Charge commit slots of all threads to their CPI stacks
+	for (auto &thread : threads)
+		thread->UpdateCpiStack();
 }
 
 
@@ -461,5 +461,13 @@ void Core::Run()
 	Fetch();
 }
 
+
+void Core::RunInterval()
+{
+	// Each thread uses the full bandwidth of the core
+	for (auto &thread : threads)
+		thread->RunInterval();
+}
+
 }
 
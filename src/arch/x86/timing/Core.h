@@ -28,6 +28,7 @@
 
 #include "Alu.h"
 #include "Thread.h"
+#include "TimingWheel.h"
 
 
 namespace x86
@@ -57,8 +58,8 @@ private:
 	// Arithmetic-logic unit
 	Alu alu;
 
-	// Event queue
-	std::list<std::shared_ptr<Uop>> event_queue;
+	// Event queue, holding issued uops until their completion cycle
+	TimingWheel event_queue;
 
 
 
@@ -156,6 +157,9 @@ private:
 	// Number of committed micro-instructions
 	long long num_committed_uinsts = 0;
 
+	// Number of committed macro-instructions
+	long long num_committed_instructions = 0;
+
 	// Number of squashed micro-instructions
 	long long num_squashed_uinsts = 0;
 
@@ -165,6 +169,15 @@ private:
 	// Number of mis-predicted branch micro-instructions
 	long long num_mispredicted_branches = 0;
 
+	// Number of loads that obtained their data from the store queue
+	long long num_forwarded_loads = 0;
+
+	// Number of memory order violations
+	long long num_memory_order_violations = 0;
+
+	// Number of micro-instructions replayed after memory order violations
+	long long num_replayed_uinsts = 0;
+
 
 
 
@@ -288,22 +301,17 @@ public:
 	/// Insert uop into event queue, making it ready to be extract in
 	/// \a latency cycles from now. The uop's field `complete_when` is
 	/// set to the current cycle plus \a latency in the function.
-	void InsertInEventQueue(std::shared_ptr<Uop> uop, int latency);
+	void InsertInEventQueue(Uop *uop, int latency);
 
-	/// Extract uop from event queue. The given uop must be placed at the
-	/// head of the event queue.
+	/// Extract uop from event queue. The uop can be at any position of
+	/// the queue.
 	void ExtractFromEventQueue(Uop *uop);
 
-	/// Return an iterator to the first element of the event queue
-	std::list<std::shared_ptr<Uop>>::iterator getEventQueueBegin()
+	/// Add all uops in the event queue to the given vector, in no
+	/// particular order.
+	void getEventQueueUops(std::vector<Uop *> &uops) const
 	{
-		return event_queue.begin();
-	}
-
-	/// Return a past-the-end iterator to the event queue
-	std::list<std::shared_ptr<Uop>>::iterator getEventQueueEnd()
-	{
-		return event_queue.end();
+		event_queue.getUops(uops);
 	}
 
 
@@ -382,6 +390,10 @@ public:
 	/// Run one simulation cycle for all pipeline stages of the core.
 	void Run();
 
+	/// Run one simulation cycle of the interval model for all threads of
+	/// the core.
+	void RunInterval();
+
 	/// Fetch stage
 	void Fetch();
 
@@ -409,7 +421,7 @@ public:
 
 	/// Increment the counter for reasons of dispatch stalls by the given
 	/// quantum.
-	void incDispatchStall(Thread::DispatchStall stall, int quantum)
+	void incDispatchStall(Thread::DispatchStall stall, long long quantum)
 	{
 		assert(stall > Thread::DispatchStallInvalid && stall < Thread::DispatchStallMax);
 		dispatch_stall[stall] += quantum;
@@ -519,6 +531,15 @@ public:
 		return num_committed_uinsts;
 	}
 
+	/// Increment the number of committed macro-instructions
+	void incNumCommittedInstructions() { num_committed_instructions++; }
+
+	/// Return the number of committed macro-instructions
+	long long getNumCommittedInstructions() const
+	{
+		return num_committed_instructions;
+	}
+
 	/// Increment the number of reads to integer registers
 	void incNumIntegerRegisterReads(int count = 1)
 	{
@@ -608,6 +629,24 @@ public:
 	
 	/// Return the number of mispredicted branches
 	long long getNumMispredictedBranches() const { return num_mispredicted_branches; }
+
+	/// Increment the number of loads forwarded from the store queue
+	void incNumForwardedLoads() { num_forwarded_loads++; }
+
+	/// Return the number of loads forwarded from the store queue
+	long long getNumForwardedLoads() const { return num_forwarded_loads; }
+
+	/// Increment the number of memory order violations
+	void incNumMemoryOrderViolations() { num_memory_order_violations++; }
+
+	/// Return the number of memory order violations
+	long long getNumMemoryOrderViolations() const { return num_memory_order_violations; }
+
+	/// Increment the number of replayed micro-instructions
+	void incNumReplayedUinsts() { num_replayed_uinsts++; }
+
+	/// Return the number of replayed micro-instructions
+	long long getNumReplayedUinsts() const { return num_replayed_uinsts; }
 };
 
 }
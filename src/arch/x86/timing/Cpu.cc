@@ -17,6 +17,8 @@
  *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  */
 
+#include <algorithm>
+
 #include "Cpu.h"
 #include "Timing.h"
 
@@ -24,6 +26,12 @@
 namespace x86
 {
 
+misc::StringMap Cpu::core_model_map =
+{
+	{"detailed", CoreModelDetailed},
+	{"interval", CoreModelInterval}
+};
+
 misc::StringMap Cpu::recover_kind_map =
 {
 	{"Writeback", RecoverKindWriteback},
@@ -78,7 +86,10 @@ int Cpu::context_quantum;
 int Cpu::thread_quantum;
 int Cpu::thread_switch_penalty;
 long long Cpu::num_fast_forward_instructions;
+bool Cpu::functional_warming;
+int Cpu::num_host_threads = 1;
 long long Cpu::max_cycles = 0;
+Cpu::CoreModel Cpu::core_model = CoreModelDetailed;
 int Cpu::recover_penalty;
 Cpu::RecoverKind Cpu::recover_kind;
 Cpu::FetchKind Cpu::fetch_kind;
@@ -124,6 +135,26 @@ Cpu::Cpu(Timing *timing) : timing(timing)
 	cores.reserve(num_cores);
 	for (int i = 0; i < num_cores; i++)
 		cores.emplace_back(misc::new_unique<Core>(this, i));
+
+	// Host threads for parallel simulation of cores. There is no point in
+	// using more host threads than cores or host CPUs. The number of
+	// host threads actually created does not affect the results.
+	if (num_host_threads > 1 && num_cores > 1)
+	{
+		int num_pool_threads = std::min(num_host_threads, num_cores);
+		int num_host_cpus = std::thread::hardware_concurrency();
+		if (num_host_cpus)
+			num_pool_threads = std::min(num_pool_threads,
+					num_host_cpus);
+		thread_pool = misc::new_unique<misc::ThreadPool>(
+				num_pool_threads);
+		pending_memory_accesses.resize(num_cores);
+	}
+
+	// Binary pipeline trace
+	if (PipelineTrace::isEnabled())
+		pipeline_trace = misc::new_unique<PipelineTrace>(num_cores,
+				num_threads);
 }
 
 
@@ -136,6 +167,16 @@ void Cpu::ParseConfiguration(misc::IniFile *ini_file)
 	section = "General";
 	num_cores = ini_file->ReadInt(section, "Cores", num_cores);
 	num_threads = ini_file->ReadInt(section, "Threads", num_threads);
+	num_fast_forward_instructions = ini_file->ReadInt64(section,
+			"FastForward", 0);
+	functional_warming = ini_file->ReadBool(section, "FunctionalWarming",
+			false);
+	num_host_threads = ini_file->ReadInt(section, "HostThreads", 1);
+	if (num_host_threads < 1)
+		throw Timing::Error(misc::fmt("%s: %s: 'HostThreads' must be "
+				"greater than 0",
+				ini_file->getPath().c_str(),
+				section.c_str()));
 	context_quantum = ini_file->ReadInt(section, "ContextQuantum", 100000);
 	thread_quantum = ini_file->ReadInt(section, "ThreadQuantum", 1000);
 	thread_switch_penalty = ini_file->ReadInt(section, "ThreadSwitchPenalty", 0);
@@ -181,16 +222,159 @@ void Cpu::Run()
 	// Invoke scheduler
 	Schedule();
 
-	// Run all cores
+	// The interval model runs all cores sequentially, since it executes
+	// instructions in the emulator as they are fetched
+	if (core_model == CoreModelInterval)
+	{
+		for (auto &core : cores)
+			core->RunInterval();
+	}
+
+	// Run all cores sequentially. This is also done while tracing or
+	// dumping debug information, so that output lines of different cores
+	// don't get mixed.
+	else if (!thread_pool || Timing::trace || RegisterFile::debug ||
+			TraceCache::debug)
+	{
+		for (auto &core : cores)
+			core->Run();
+	}
+	else
+	{
+		// Stages from commit to decode only modify state private to
+		// each core, so they run in parallel. Memory accesses and
+		// context evictions are postponed.
+		running_in_parallel = true;
+		thread_pool->Run(num_cores, [this](int index)
+		{
+			Core *core = cores[index].get();
+			core->Commit();
+			core->Writeback();
+			core->Issue();
+			core->Dispatch();
+			core->Decode();
+		});
+		running_in_parallel = false;
+
+		// The fetch stage runs the emulator, so it is simulated
+		// sequentially. Postponed actions of each core are applied
+		// right before its fetch stage, in the same order as in the
+		// sequential simulation.
+		for (auto &core : cores)
+		{
+			StartPendingMemoryAccesses(core->getId());
+			for (int i = 0; i < num_threads; i++)
+				core->getThread(i)->EvictPostponedContext();
+			core->Fetch();
+		}
+	}
+
+	// Finish simulation if any thread stopped committing instructions
+	for (auto &core : cores)
+	{
+		for (int i = 0; i < num_threads; i++)
+		{
+			Thread *thread = core->getThread(i);
+			if (!thread->isCommitStalled())
+				continue;
+
+			// Show warning
+			misc::Warning("[x86] %s: simulation ended due to a "
+					"commit stall.\n\t%s",
+					thread->getName().c_str(),
+					Thread::commit_stall_error);
+
+			// Print state of the core
+			std::cerr << *core;
+
+			// Finish simulation
+			esim::Engine *esim_engine = esim::Engine::getInstance();
+			esim_engine->Finish("Stall");
+			return;
+		}
+	}
+}
+
+
+long long Cpu::getIntervalNextCycle() const
+{
+	// Next call to the scheduler when a context quantum expires
+	long long next_cycle = min_context_allocate_cycle + context_quantum;
+
+	// Next cycle in which any thread runs
+	for (auto &core : cores)
+	{
+		for (int i = 0; i < num_threads; i++)
+		{
+			Thread *thread = core->getThread(i);
+			next_cycle = std::min(next_cycle,
+					thread->getIntervalNextCycle());
+		}
+	}
+	return std::max(next_cycle, getCycle() + 1);
+}
+
+
+void Cpu::SkipInterval(long long num_cycles)
+{
+	// Lost slots of all threads
+	for (auto &core : cores)
+	{
+		for (int i = 0; i < num_threads; i++)
+			core->getThread(i)->SkipInterval(num_cycles);
+	}
+	num_skipped_cycles += num_cycles;
+}
+
+
+bool Cpu::isPipelineEmpty() const
+{
 	for (auto &core : cores)
-		core->Run();
+	{
+		for (int i = 0; i < num_threads; i++)
+		{
+			Thread *thread = core->getThread(i);
+			if (!thread->isPipelineEmpty() ||
+					!thread->isLoadStoreQueueEmpty())
+				return false;
+		}
+	}
+	return true;
+}
+
+
+void Cpu::Warm(Context *context, unsigned eip)
+{
+	// Use the thread that the context is mapped to. Otherwise, pick the
+	// thread that the scheduler would choose, without mapping the context.
+	Thread *found_thread = context->getState(Context::StateMapped) ?
+			context->thread : nullptr;
+	for (int i = 0; !found_thread && i < num_cores; i++)
+	{
+		for (int j = 0; j < num_threads; j++)
+		{
+			// Context does not have affinity with this thread
+			Thread *thread = getThread(i, j);
+			if (!context->thread_affinity->Test(thread->getIdInCpu()))
+				continue;
+
+			// Check if this thread is better
+			if (!found_thread || thread->getNumMappedContexts() <
+					found_thread->getNumMappedContexts())
+				found_thread = thread;
+		}
+	}
+
+	// Warm thread structures
+	if (found_thread)
+		found_thread->Warm(context, eip);
 }
 
 
 void Cpu::MemoryAccess(mem::Module *module,
 			mem::Module::AccessType access_type,
 			unsigned address,
-			std::shared_ptr<Uop> uop)
+			Uop *uop)
 {
 	// New frame
 	auto frame = misc::new_shared<MemoryAccessFrame>();
@@ -198,6 +382,16 @@ void Cpu::MemoryAccess(mem::Module *module,
 	frame->access_type = access_type;
 	frame->address = address;
 	frame->uop = uop;
+	uop->num_memory_accesses++;
+
+	// While cores run in parallel, the access is scheduled later by the
+	// CPU, since the event engine is shared
+	if (running_in_parallel)
+	{
+		pending_memory_accesses[uop->getCore()->getId()].push_back(
+				frame);
+		return;
+	}
 
 	// Schedule event
 	esim::Engine *esim_engine = esim::Engine::getInstance();
@@ -205,6 +399,15 @@ void Cpu::MemoryAccess(mem::Module *module,
 }
 
 
+void Cpu::StartPendingMemoryAccesses(int core_index)
+{
+	esim::Engine *esim_engine = esim::Engine::getInstance();
+	for (auto &frame : pending_memory_accesses[core_index])
+		esim_engine->Call(event_memory_access_start, frame);
+	pending_memory_accesses[core_index].clear();
+}
+
+
 void Cpu::MemoryAccessHandler(esim::Event *event, esim::Frame *esim_frame)
 {
 	// Get actual frame
@@ -215,17 +418,30 @@ void Cpu::MemoryAccessHandler(esim::Event *event, esim::Frame *esim_frame)
 	{
 		// Start access
 		mem::Module *module = frame->module;
-		frame->uop->memory_access = module->Access(
+		frame->id = module->Access(
 				frame->access_type,
 				frame->address,
 				nullptr,
 				event_memory_access_end);
+		frame->uop->memory_access = frame->id;
 	}
 	else if (event == event_memory_access_end)
 	{
+		// The access no longer holds the uop
+		Uop *uop = frame->uop;
+		assert(uop->num_memory_accesses > 0);
+		uop->num_memory_accesses--;
+
+		// Discard the access if the load was replayed meanwhile
+		if (uop->memory_access != frame->id)
+		{
+			uop->getThread()->getUopPool()->FreeIfNotQueued(uop);
+			return;
+		}
+
 		// Insert uop into the core's event queue
-		Core *core = frame->uop->getCore();
-		core->InsertInEventQueue(frame->uop, 0);
+		Core *core = uop->getCore();
+		core->InsertInEventQueue(uop, 0);
 	}
 	else
 	{
@@ -241,7 +457,7 @@ long long Cpu::getCycle() const
 }
 
 
-void Cpu::InsertInTraceList(std::shared_ptr<Uop> uop)
+void Cpu::InsertInTraceList(Uop *uop)
 {
 	assert(Timing::trace == true);
 	assert(!uop->in_trace_list);
@@ -255,7 +471,7 @@ void Cpu::EmptyTraceList()
 	while (trace_list.size())
 	{
 		// Get instruction at the head
-		std::shared_ptr<Uop> uop = trace_list.front();
+		Uop *uop = trace_list.front();
 		assert(uop->in_trace_list);
 
 		// Remove from trace list
@@ -269,8 +485,131 @@ void Cpu::EmptyTraceList()
 				"core=%d\n",
 				uop->getIdInCore(),
 				uop->getCore()->getId());
+
+		// Free uop
+		uop->getThread()->getUopPool()->FreeIfNotQueued(uop);
 	}
 }
 
+
+
+std::vector<long long> Cpu::getNumDispatchedUinstArray() const
+{
+	std::vector<long long> array(Uinst::OpcodeCount);
+	for (auto &core : cores)
+		for (int i = 0; i < Uinst::OpcodeCount; i++)
+			array[i] += core->getNumDispatchedUinstArray()[i];
+	return array;
 }
 
+
+long long Cpu::getNumDispatchedUinsts() const
+{
+	long long count = 0;
+	for (auto &core : cores)
+		count += core->getNumDispatchedUinsts();
+	return count;
+}
+
+
+std::vector<long long> Cpu::getNumIssuedUinstArray() const
+{
+	std::vector<long long> array(Uinst::OpcodeCount);
+	for (auto &core : cores)
+		for (int i = 0; i < Uinst::OpcodeCount; i++)
+			array[i] += core->getNumIssuedUinstArray()[i];
+	return array;
+}
+
+
+long long Cpu::getNumIssuedUinsts() const
+{
+	long long count = 0;
+	for (auto &core : cores)
+		count += core->getNumIssuedUinsts();
+	return count;
+}
+
+
+std::vector<long long> Cpu::getNumCommittedUinstArray() const
+{
+	std::vector<long long> array(Uinst::OpcodeCount);
+	for (auto &core : cores)
+		for (int i = 0; i < Uinst::OpcodeCount; i++)
+			array[i] += core->getNumCommittedUinstArray()[i];
+	return array;
+}
+
+
+long long Cpu::getNumCommittedUinsts() const
+{
+	long long count = 0;
+	for (auto &core : cores)
+		count += core->getNumCommittedUinsts();
+	return count;
+}
+
+
+long long Cpu::getNumSquashedUinsts() const
+{
+	long long count = 0;
+	for (auto &core : cores)
+		count += core->getNumSquashedUinsts();
+	return count;
+}
+
+
+long long Cpu::getNumCommittedInstructions() const
+{
+	long long count = 0;
+	for (auto &core : cores)
+		count += core->getNumCommittedInstructions();
+	return count;
+}
+
+
+long long Cpu::getNumBranches() const
+{
+	long long count = 0;
+	for (auto &core : cores)
+		count += core->getNumBranches();
+	return count;
+}
+
+
+long long Cpu::getNumMispredictedBranches() const
+{
+	long long count = 0;
+	for (auto &core : cores)
+		count += core->getNumMispredictedBranches();
+	return count;
+}
+
+
+long long Cpu::getNumForwardedLoads() const
+{
+	long long count = 0;
+	for (auto &core : cores)
+		count += core->getNumForwardedLoads();
+	return count;
+}
+
+
+long long Cpu::getNumMemoryOrderViolations() const
+{
+	long long count = 0;
+	for (auto &core : cores)
+		count += core->getNumMemoryOrderViolations();
+	return count;
+}
+
+
+long long Cpu::getNumReplayedUinsts() const
+{
+	long long count = 0;
+	for (auto &core : cores)
+		count += core->getNumReplayedUinsts();
+	return count;
+}
+
+}
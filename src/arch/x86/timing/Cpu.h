@@ -24,12 +24,14 @@
 #include <list>
 #include <vector>
 
+#include <lib/cpp/ThreadPool.h>
 #include <memory/Mmu.h>
 #include <memory/Module.h>
 #include <arch/x86/emulator/Emulator.h>
 #include <arch/x86/emulator/Uinst.h>
 
 #include "Core.h"
+#include "PipelineTrace.h"
 #include "Thread.h"
 #include "Uop.h"
 
@@ -45,6 +47,17 @@ class Cpu
 {
 public:
 
+	/// Core timing model
+	enum CoreModel
+	{
+		CoreModelInvalid = 0,
+		CoreModelDetailed,
+		CoreModelInterval
+	};
+
+	/// Core model string map
+	static misc::StringMap core_model_map;
+
 	/// Recover kind
 	enum RecoverKind
 	{
@@ -136,6 +149,9 @@ public:
 	// Maximum number of cycles to simulate
 	static long long max_cycles;
 
+	// Core timing model
+	static CoreModel core_model;
+
 
 private:
 
@@ -161,6 +177,12 @@ private:
 	// Number of fast forward instructions
 	static long long num_fast_forward_instructions;
 
+	// Update microarchitectural state during functional execution
+	static bool functional_warming;
+
+	// Number of host threads simulating cores in parallel
+	static int num_host_threads;
+
 
 
 	//
@@ -183,7 +205,21 @@ private:
 	std::string stage;
 
 	// List containing uops that need to report an 'end_inst' trace event 
-	std::list<std::shared_ptr<Uop>> trace_list;
+	std::list<Uop *> trace_list;
+
+	// Binary pipeline trace, or null if not enabled
+	std::unique_ptr<PipelineTrace> pipeline_trace;
+
+	// If true, no thread fetches new instructions, letting the pipelines
+	// drain. Used to switch from detailed to functional simulation.
+	bool fetch_stopped = false;
+
+	// Host threads running the cores, or null if cores are simulated
+	// sequentially
+	std::unique_ptr<misc::ThreadPool> thread_pool;
+
+	// True while cores are being simulated in parallel
+	bool running_in_parallel = false;
 
 
 
@@ -195,36 +231,12 @@ private:
 	// Number of fectched micro-instructions
 	long long num_fetched_uinsts = 0;
 
-	// Number of dispatched micro-instructions for every opcode
-	long long num_dispatched_uinst_array[Uinst::OpcodeCount] = { };
-
-	// Number of issued micro-instructions for every opcode
-	long long num_issued_uinst_array[Uinst::OpcodeCount] = { };
-
-	// Number of committed micro-instructions for every opcode
-	long long num_committed_uinst_array[Uinst::OpcodeCount] = { };
-
-	// Number of dispatched micro-instructions
-	long long num_dispatched_uinsts = 0;
-
-	// Number of issued micro-instructions
-	long long num_issued_uinsts = 0;
+	// Number of cycles in which the interval model did not run
+	long long num_skipped_cycles = 0;
 
-	// Number of committed micro-instructions
-	long long num_committed_uinsts = 0;
-
-
-	// Committed macro-instructions
-	long long num_committed_instructions = 0;
-
-	// Number of squashed micro-instructions
-	long long num_squashed_uinsts = 0;
-
-	// Number of branch micro-instructions
-	long long num_branches = 0;
-
-	// Number of mis-predicted branch micro-instructions
-	long long num_mispredicted_branches = 0;
+	// The rest of the statistics are kept per core, and added up when
+	// requested, so that cores do not update shared counters while they
+	// are simulated in parallel.
 
 
 
@@ -258,8 +270,12 @@ private:
 		// Physical address to access
 		unsigned address = -1;
 
-		// Uop associated with the memory access
-		std::shared_ptr<Uop> uop;
+		// Uop associated with the memory access, which is not freed
+		// while the access is in flight
+		Uop *uop = nullptr;
+
+		// Access identifier returned by the module
+		long long id = 0;
 	};
 
 	// Event scheduled to start a memory access
@@ -271,6 +287,15 @@ private:
 	// Event handler for memory accesses
 	static void MemoryAccessHandler(esim::Event *event, esim::Frame *frame);
 
+	// Memory accesses started by each core while cores are simulated in
+	// parallel, indexed by core
+	std::vector<std::vector<std::shared_ptr<MemoryAccessFrame>>>
+			pending_memory_accesses;
+
+	// Schedule the memory accesses that a core started while running in
+	// parallel
+	void StartPendingMemoryAccesses(int core_index);
+
 
 
 
@@ -438,9 +463,20 @@ public:
 		return num_fast_forward_instructions;
 	}
 
+	/// Return whether instructions executed functionally warm up the
+	/// caches and branch predictors, as configured by the user.
+	static bool getFunctionalWarming() { return functional_warming; }
+
+	/// Return the number of host threads used to simulate the cores, as
+	/// configured by the user
+	static int getNumHostThreads() { return num_host_threads; }
+
 	/// Return the maximum number of cycles to simulate, as configured by
 	/// the user
 	static long long getMaxCycles() { return max_cycles; }
+
+	/// Return the core timing model, as selected by the user
+	static CoreModel getCoreModel() { return core_model; }
 	
 	/// Read branch predictor configuration from configuration file
 	static void ParseConfiguration(misc::IniFile *ini_file);
@@ -480,7 +516,7 @@ public:
 	/// Insert an uop into a list of uops that still need to dump an
 	/// 'end_inst' trace event. This will happen when the trace list is
 	/// emptied with a call to EmptyUopTraceList().
-	void InsertInTraceList(std::shared_ptr<Uop> uop);
+	void InsertInTraceList(Uop *uop);
 
 	/// Empty the uop trace list and make every uop contained in it dump
 	/// its last 'end_inst' trace event.
@@ -489,6 +525,51 @@ public:
 	/// Simulate one cycle of the CPU for all its cores and threads.
 	void Run();
 
+	/// Return the first cycle after the current one in which the interval
+	/// model has work to do in any thread or in the scheduler, assuming
+	/// that no memory access completes before then.
+	long long getIntervalNextCycle() const;
+
+	/// Account for \a num_cycles cycles following the current one in which
+	/// the interval model does not run, as returned by
+	/// getIntervalNextCycle().
+	void SkipInterval(long long num_cycles);
+
+	/// Stop or resume instruction fetch in all threads. While fetch is
+	/// stopped, in-flight uops continue until the pipelines are empty.
+	void setFetchStopped(bool fetch_stopped)
+	{
+		this->fetch_stopped = fetch_stopped;
+	}
+
+	/// Return whether instruction fetch is stopped
+	bool isFetchStopped() const { return fetch_stopped; }
+
+	/// Return true while the cores are being simulated in parallel by
+	/// different host threads. Actions with effects outside of the core
+	/// are then postponed until the end of the parallel part of the cycle.
+	bool isRunningInParallel() const { return running_in_parallel; }
+
+	/// Return the binary pipeline trace, or null if it was not enabled
+	/// with option '--x86-pipeline-trace'
+	PipelineTrace *getPipelineTrace() const { return pipeline_trace.get(); }
+
+	/// Return true if there is no uop in the pipeline of any thread,
+	/// including stores still waiting to access memory after commit.
+	bool isPipelineEmpty() const;
+
+	/// Feed an instruction that a context just executed functionally into
+	/// the caches, branch predictor, and trace cache of the hardware thread
+	/// that the context is mapped to, or would be mapped to otherwise.
+	///
+	/// \param context
+	///	Context that executed the instruction
+	///
+	/// \param eip
+	///	Address of the instruction
+	///
+	void Warm(Context *context, unsigned eip);
+
 	/// Update structure occupancy statistics
 	void UpdateOccupancyStats();
 
@@ -501,7 +582,7 @@ public:
 	void MemoryAccess(mem::Module *module,
 			mem::Module::AccessType access_type,
 			unsigned address,
-			std::shared_ptr<Uop> uop);
+			Uop *uop);
 
 
 
@@ -541,89 +622,47 @@ public:
 	/// Increment the number of fetched micro-instructions
 	void incNumFetchedUinsts() { num_fetched_uinsts++; }
 
-	/// Increment the number of dispatched micro-instructions of a kind
-	void incNumDispatchedUinsts(Uinst::Opcode opcode)
-	{
-		assert(opcode < Uinst::OpcodeCount);
-		num_dispatched_uinst_array[opcode]++;
-		num_dispatched_uinsts++;
-	}
+	/// Return the number of cycles skipped by the interval model
+	long long getNumSkippedCycles() const { return num_skipped_cycles; }
 
-	/// Return the array of dispatched micro-instructions
-	const long long *getNumDispatchedUinstArray() const
-	{
-		return num_dispatched_uinst_array;
-	}
+	/// Return the number of dispatched micro-instructions of each kind
+	std::vector<long long> getNumDispatchedUinstArray() const;
 
 	/// Return the number of dispatched micro-instructions
-	long long getNumDispatchedUinsts() const
-	{
-		return num_dispatched_uinsts;
-	}
+	long long getNumDispatchedUinsts() const;
 
-	/// Increment the number of issued micro-instructions of a kind
-	void incNumIssuedUinsts(Uinst::Opcode opcode)
-	{
-		assert(opcode < Uinst::OpcodeCount);
-		num_issued_uinst_array[opcode]++;
-		num_issued_uinsts++;
-	}
-
-	/// Return the array of issued micro-instructions
-	const long long *getNumIssuedUinstArray() const
-	{
-		return num_issued_uinst_array;
-	}
+	/// Return the number of issued micro-instructions of each kind
+	std::vector<long long> getNumIssuedUinstArray() const;
 
 	/// Return the number of issued micro-instructions
-	long long getNumIssuedUinsts() const
-	{
-		return num_issued_uinsts;
-	}
+	long long getNumIssuedUinsts() const;
 
-	/// Increment the number of committed micro-instructions of a type
-	void incNumCommittedUinsts(Uinst::Opcode opcode)
-	{
-		assert(opcode < Uinst::OpcodeCount);
-		num_committed_uinst_array[opcode]++;
-		num_committed_uinsts++;
-	}
-
-	/// Return the array of committed micro-instructions
-	const long long *getNumCommittedUinstArray() const
-	{
-		return num_committed_uinst_array;
-	}
+	/// Return the number of committed micro-instructions of each kind
+	std::vector<long long> getNumCommittedUinstArray() const;
 
 	/// Return the number of committed micro-instructions
-	long long getNumCommittedUinsts() const
-	{
-		return num_committed_uinsts;
-	}
-
-	/// Increment the number of squashed micro-instructions
-	void incNumSquashedUinsts() { num_squashed_uinsts++; }
+	long long getNumCommittedUinsts() const;
 
 	/// Return the number of squashed micro-instructions
-	long long getNumSquashedUinsts() const { return num_squashed_uinsts; }
+	long long getNumSquashedUinsts() const;
 
-	/// Increment the number of committed instructions
-	void incNumCommittedInstructions() { num_committed_instructions++; }
-	
 	/// Return the number of committed macro-instructions
-	long long getNumCommittedInstructions() const { return num_committed_instructions; }
-
-	/// Increment the number of branches
-	void incNumBranches() { num_branches++; }
+	long long getNumCommittedInstructions() const;
 
 	/// Return the number of committed branches
-	long long getNumBranches() const { return num_branches; }
-
-	/// Increment the number of mispredicted branches
-	void incNumMispredictedBranches() { num_mispredicted_branches++; }
+	long long getNumBranches() const;
 
 	/// Return the number of mispredicted branches
-	long long getNumMispredictedBranches() const { return num_mispredicted_branches; }
+	long long getNumMispredictedBranches() const;
+
+	/// Return the number of loads forwarded from the store queue
+	long long getNumForwardedLoads() const;
+
+	/// Return the number of memory order violations
+	long long getNumMemoryOrderViolations() const;
+
+	/// Return the number of uops replayed after memory order violations
+	long long getNumReplayedUinsts() const;
 };
 
 }
@@ -0,0 +1,146 @@
+/*
+ *  Multi2Sim
+ *  Copyright (C) 2015  Rafael Ubal (ubal@ece.neu.edu)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <lib/cpp/Misc.h>
+
+#include "MemoryDependencePredictor.h"
+#include "Uop.h"
+
+
+namespace x86
+{
+
+MemoryDependencePredictor::Kind MemoryDependencePredictor::kind;
+int MemoryDependencePredictor::store_forward_latency;
+int MemoryDependencePredictor::store_set_table_size;
+int MemoryDependencePredictor::num_store_sets;
+
+misc::StringMap MemoryDependencePredictor::KindMap =
+{
+	{"None", KindNone},
+	{"Conservative", KindConservative},
+	{"Speculative", KindSpeculative},
+	{"StoreSet", KindStoreSet}
+};
+
+
+void MemoryDependencePredictor::ParseConfiguration(misc::IniFile *ini_file)
+{
+	// Section [Queues]
+	std::string section = "Queues";
+
+	// Read parameters
+	kind = (Kind) ini_file->ReadEnum(section, "MemoryDependence",
+			KindMap, KindNone);
+	store_forward_latency = ini_file->ReadInt(section,
+			"StoreForwardLatency", 2);
+	store_set_table_size = ini_file->ReadInt(section,
+			"StoreSetTableSize", 1024);
+	num_store_sets = ini_file->ReadInt(section, "StoreSetCount", 128);
+
+	// Integrity
+	if (store_forward_latency < 1)
+		throw Error("store forwarding latency must be at least 1");
+	if (store_set_table_size < 1 ||
+			(store_set_table_size & (store_set_table_size - 1)))
+		throw Error("number of entries in the store set identifier "
+				"table must be a power of 2");
+	if (num_store_sets < 1)
+		throw Error("number of store sets must be at least 1");
+}
+
+
+MemoryDependencePredictor::MemoryDependencePredictor(const std::string &name)
+		:
+		name(name)
+{
+	// Tables are only used by the store set predictor
+	if (kind != KindStoreSet)
+		return;
+
+	// Store set identifier table
+	store_set_table = misc::new_unique_array<int>(store_set_table_size);
+	for (int i = 0; i < store_set_table_size; i++)
+		store_set_table[i] = -1;
+
+	// Last fetched store table
+	last_store_table = misc::new_unique_array<long long>(num_store_sets);
+}
+
+
+int MemoryDependencePredictor::getIndex(Uop *uop) const
+{
+	// Uops of the same macro-instruction share the address
+	return (uop->eip + uop->mop_index) & (store_set_table_size - 1);
+}
+
+
+void MemoryDependencePredictor::Dispatch(Uop *uop)
+{
+	// Only for the store set predictor
+	if (kind != KindStoreSet)
+		return;
+
+	// Instruction not in any store set
+	int store_set = store_set_table[getIndex(uop)];
+	if (store_set < 0)
+		return;
+
+	// Loads depend on the last store of the set, and stores become it
+	if (uop->getOpcode() == Uinst::OpcodeLoad)
+		uop->store_set_dependence = last_store_table[store_set];
+	else if (uop->getOpcode() == Uinst::OpcodeStore)
+		last_store_table[store_set] = uop->getId();
+}
+
+
+void MemoryDependencePredictor::Update(Uop *store, Uop *load)
+{
+	// Only for the store set predictor
+	if (kind != KindStoreSet)
+		return;
+
+	// Current store sets
+	int &store_set_of_store = store_set_table[getIndex(store)];
+	int &store_set_of_load = store_set_table[getIndex(load)];
+
+	// Allocate a new store set if none of them has one. Otherwise, both
+	// join the store set with the lowest identifier.
+	if (store_set_of_store < 0 && store_set_of_load < 0)
+	{
+		store_set_of_store = next_store_set;
+		store_set_of_load = next_store_set;
+		next_store_set = (next_store_set + 1) % num_store_sets;
+	}
+	else if (store_set_of_store < 0)
+	{
+		store_set_of_store = store_set_of_load;
+	}
+	else if (store_set_of_load < 0 || store_set_of_store < store_set_of_load)
+	{
+		store_set_of_load = store_set_of_store;
+	}
+	else
+	{
+		store_set_of_store = store_set_of_load;
+	}
+}
+
+
+}  // namespace x86
@@ -0,0 +1,147 @@
+/*
+ *  Multi2Sim
+ *  Copyright (C) 2015  Rafael Ubal (ubal@ece.neu.edu)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef ARCH_X86_TIMING_MEMORY_DEPENDENCE_PREDICTOR_H
+#define ARCH_X86_TIMING_MEMORY_DEPENDENCE_PREDICTOR_H
+
+#include <memory>
+#include <string>
+
+#include <lib/cpp/Error.h>
+#include <lib/cpp/IniFile.h>
+
+
+namespace x86
+{
+
+// Forward declaration
+class Uop;
+
+/// Memory dependence predictor deciding which older stores a load must wait
+/// for before it issues. With a store set predictor, each static load or
+/// store is assigned a store set identifier through the store set
+/// identifier table (SSIT), indexed by instruction address. The last
+/// fetched store table (LFST) records the last dispatched store of each
+/// set, and loads wait only for that store.
+class MemoryDependencePredictor
+{
+public:
+
+	/// Policy for loads issuing before older stores are resolved
+	enum Kind
+	{
+		KindInvalid = 0,
+		KindNone,
+		KindConservative,
+		KindSpeculative,
+		KindStoreSet
+	};
+
+	/// String map for values of type Kind
+	static misc::StringMap KindMap;
+
+private:
+
+	//
+	// Static fields
+	//
+
+	// Policy for memory dependences
+	static Kind kind;
+
+	// Latency of a load that obtains its data from the store queue
+	static int store_forward_latency;
+
+	// Number of entries in the store set identifier table
+	static int store_set_table_size;
+
+	// Number of store sets, i.e., entries in the last fetched store table
+	static int num_store_sets;
+
+
+
+
+	//
+	// Class members
+	//
+
+	// Name of the predictor
+	std::string name;
+
+	// Store set identifier table, with -1 for instructions that are not
+	// in any store set
+	std::unique_ptr<int[]> store_set_table;
+
+	// Last fetched store table, with the identifier of the last dispatched
+	// store of each store set, or 0 if none
+	std::unique_ptr<long long[]> last_store_table;
+
+	// Next store set identifier to allocate
+	int next_store_set = 0;
+
+	// Return the index in the store set identifier table for a uop
+	int getIndex(Uop *uop) const;
+
+public:
+
+	/// Exception for the memory dependence predictor
+	class Error : public misc::Error
+	{
+	public:
+
+		Error(const std::string &message) : misc::Error(message)
+		{
+			AppendPrefix("X86 memory dependence predictor");
+		}
+	};
+
+	/// Read configuration from section [Queues]
+	static void ParseConfiguration(misc::IniFile *ini_file);
+
+	/// Return the policy for memory dependences
+	static Kind getKind() { return kind; }
+
+	/// Return the latency of a load that obtains its data from a store in
+	/// the store queue
+	static int getStoreForwardLatency() { return store_forward_latency; }
+
+	/// Return the number of entries in the store set identifier table
+	static int getStoreSetTableSize() { return store_set_table_size; }
+
+	/// Return the number of store sets
+	static int getNumStoreSets() { return num_store_sets; }
+
+	/// Constructor
+	MemoryDependencePredictor(const std::string &name = "");
+
+	/// Record a load or store being dispatched. For a load, field
+	/// \c store_set_dependence of the uop is set to the identifier of the
+	/// store it is predicted to depend on. A store becomes the last
+	/// store of its set.
+	void Dispatch(Uop *uop);
+
+	/// Train the predictor after \a load issued before the older \a store
+	/// writing to the same address, placing both in the same store set.
+	void Update(Uop *store, Uop *load);
+};
+
+
+}  // namespace x86
+
+#endif
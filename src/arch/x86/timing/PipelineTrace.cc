@@ -0,0 +1,356 @@
+/*
+ *  Multi2Sim
+ *  Copyright (C) 2015  Rafael Ubal (ubal@ece.neu.edu)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <algorithm>
+#include <cstring>
+
+#include <arch/x86/emulator/Uinst.h>
+#include <lib/cpp/Misc.h>
+#include <lib/cpp/String.h>
+
+#include "Core.h"
+#include "PipelineTrace.h"
+#include "Thread.h"
+#include "Uop.h"
+
+
+namespace x86
+{
+
+const char PipelineTrace::signature[8] = { 'M', '2', 'S', 'X', 'P', 'T', '0', '2' };
+
+std::string PipelineTrace::path;
+long long PipelineTrace::start_cycle = 0;
+long long PipelineTrace::end_cycle = 0;
+std::string PipelineTrace::konata_path;
+
+
+void PipelineTrace::ProcessOptions()
+{
+	// Check cycle window
+	if (start_cycle < 0 || end_cycle < 0)
+		throw Error("Values for '--x86-pipeline-trace-start' and "
+				"'--x86-pipeline-trace-end' must be greater or "
+				"equal than 0");
+	if (end_cycle && end_cycle < start_cycle)
+		throw Error("Value for '--x86-pipeline-trace-end' must be "
+				"greater or equal than the value for "
+				"'--x86-pipeline-trace-start'");
+
+	// Conversion into the Kanata format
+	if (!konata_path.empty())
+	{
+		if (path.empty())
+			throw Error("Option '--x86-konata' requires option "
+					"'--x86-pipeline-trace' to give the "
+					"trace to convert");
+		ConvertToKonata(path, konata_path);
+		exit(0);
+	}
+}
+
+
+void PipelineTrace::ConvertToKonata(const std::string &trace_path,
+		const std::string &konata_path)
+{
+	// Open binary trace
+	std::ifstream is(trace_path, std::ios::binary);
+	if (!is.good())
+		throw Error(misc::fmt("%s: Cannot open trace file",
+				trace_path.c_str()));
+
+	// Check signature
+	char file_signature[sizeof signature];
+	is.read(file_signature, sizeof file_signature);
+	if (!is || memcmp(file_signature, signature, sizeof signature))
+		throw Error(misc::fmt("%s: Not an x86 pipeline trace",
+				trace_path.c_str()));
+
+	// Read all records
+	std::vector<Record> records;
+	Record record;
+	while (is.read((char *) &record, sizeof record))
+		records.push_back(record);
+
+	// Instructions are numbered in the Kanata file in fetch order
+	std::sort(records.begin(), records.end(),
+			[](const Record &a, const Record &b)
+			{
+				return a.fetch_cycle < b.fetch_cycle ||
+						(a.fetch_cycle == b.fetch_cycle &&
+						a.id < b.id);
+			});
+
+	// Events of each record. Kind 0 creates the instruction, kinds 1 to 5
+	// start a stage, and kind 6 retires or flushes the instruction.
+	struct Event
+	{
+		int64_t cycle;
+		int index;
+		int kind;
+	};
+	static const char *stage_names[] = { "", "F", "Dc", "Ds", "Is", "Wb" };
+	std::vector<Event> events;
+	for (int index = 0; index < (int) records.size(); index++)
+	{
+		Record &record = records[index];
+		int64_t cycles[] =
+		{
+			record.fetch_cycle,
+			record.fetch_cycle,
+			record.decode_cycle,
+			record.dispatch_cycle,
+			record.issue_cycle,
+			record.writeback_cycle
+		};
+
+		// Stages not reached, or reached after the uop was squashed, are
+		// skipped
+		int64_t last_cycle = record.fetch_cycle;
+		for (int kind = 0; kind <= 5; kind++)
+		{
+			if (!cycles[kind] || cycles[kind] < last_cycle ||
+					cycles[kind] > record.retire_cycle)
+				continue;
+			events.push_back({ cycles[kind], index, kind });
+			last_cycle = cycles[kind];
+		}
+		events.push_back({ std::max(record.retire_cycle, last_cycle),
+				index, 6 });
+	}
+	std::stable_sort(events.begin(), events.end(),
+			[](const Event &a, const Event &b)
+			{
+				return a.cycle < b.cycle;
+			});
+
+	// Open output file
+	std::ofstream os(konata_path);
+	if (!os.good())
+		throw Error(misc::fmt("%s: Cannot open Kanata file",
+				konata_path.c_str()));
+
+	// Dump events
+	os << "Kanata\t0004\n";
+	int64_t cycle = events.empty() ? 0 : events.front().cycle;
+	long long num_retired = 0;
+	std::vector<int> stages(records.size());
+	os << "C=\t" << cycle << '\n';
+	for (Event &event : events)
+	{
+		// Advance cycle
+		if (event.cycle > cycle)
+		{
+			os << "C\t" << event.cycle - cycle << '\n';
+			cycle = event.cycle;
+		}
+
+		// Create instruction, with its address and opcode as a label
+		Record &record = records[event.index];
+		if (event.kind == 0)
+		{
+			os << misc::fmt("I\t%d\t%lld\t%lld\n",
+					event.index,
+					(long long) record.id,
+					(long long) record.core * max_ids +
+					record.thread);
+			os << misc::fmt("L\t%d\t0\t%08x.%d %s\n",
+					event.index,
+					record.eip,
+					record.mop_index,
+					Uinst::getInfo((Uinst::Opcode)
+					record.opcode)->name.c_str());
+			os << misc::fmt("L\t%d\t1\tcore %d thread %d "
+					"uop %lld\n",
+					event.index,
+					record.core,
+					record.thread,
+					(long long) record.id);
+			continue;
+		}
+
+		// End the current stage
+		int &stage = stages[event.index];
+		if (stage)
+			os << misc::fmt("E\t%d\t0\t%s\n", event.index,
+					stage_names[stage]);
+
+		// Start a new stage
+		if (event.kind <= 5)
+		{
+			stage = event.kind;
+			os << misc::fmt("S\t%d\t0\t%s\n", event.index,
+					stage_names[stage]);
+			continue;
+		}
+
+		// Retire or flush
+		stage = 0;
+		os << misc::fmt("R\t%d\t%lld\t%d\n",
+				event.index,
+				record.squashed ? 0 : num_retired++,
+				record.squashed ? 1 : 0);
+	}
+}
+
+
+PipelineTrace::PipelineTrace(int num_cores, int num_threads) :
+		os(path, std::ios::binary),
+		buffers(num_cores)
+{
+	// Check identifiers
+	if (num_cores > max_ids || num_threads > max_ids)
+		throw Error(misc::fmt("The pipeline trace supports up to %d "
+				"cores and %d threads per core",
+				max_ids, max_ids));
+
+	// Check file
+	if (!os.good())
+		throw Error(misc::fmt("%s: Cannot open pipeline trace file",
+				path.c_str()));
+	os.write(signature, sizeof signature);
+
+	// Buffers
+	for (auto &buffer : buffers)
+		buffer.reserve(buffer_size);
+
+	// Start writer thread
+	writer = std::thread(&PipelineTrace::Write, this);
+}
+
+
+PipelineTrace::~PipelineTrace()
+{
+	// Hand over records left in the buffers
+	for (int core_id = 0; core_id < (int) buffers.size(); core_id++)
+		if (!buffers[core_id].empty())
+			Submit(core_id);
+
+	// Wait for the writer thread
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		closing = true;
+	}
+	condition.notify_one();
+	writer.join();
+
+	// Report write failures
+	if (write_failed)
+		misc::Warning("%s: Could not write pipeline trace. The trace "
+				"is incomplete.", path.c_str());
+}
+
+
+void PipelineTrace::Write()
+{
+	std::vector<std::vector<Record>> buffers_to_write;
+	std::unique_lock<std::mutex> lock(mutex);
+	for (;;)
+	{
+		// Wait for pending buffers
+		condition.wait(lock, [this]
+		{
+			return closing || !pending_buffers.empty();
+		});
+		if (pending_buffers.empty())
+			return;
+
+		// Write them without holding the lock, unless a previous write
+		// failed
+		buffers_to_write.swap(pending_buffers);
+		bool failed = write_failed;
+		lock.unlock();
+		for (auto &buffer : buffers_to_write)
+		{
+			if (!failed)
+				os.write((const char *) buffer.data(),
+						buffer.size() * sizeof(Record));
+			buffer.clear();
+		}
+		if (!failed)
+			os.flush();
+		lock.lock();
+		if (!os)
+			write_failed = true;
+
+		// Give buffers back
+		for (auto &buffer : buffers_to_write)
+			free_buffers.push_back(std::move(buffer));
+		buffers_to_write.clear();
+	}
+}
+
+
+bool PipelineTrace::Submit(int core_id)
+{
+	bool failed;
+	std::vector<Record> &buffer = buffers[core_id];
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		failed = write_failed;
+		pending_buffers.push_back(std::move(buffer));
+		if (free_buffers.empty())
+		{
+			buffer = std::vector<Record>();
+			buffer.reserve(buffer_size);
+		}
+		else
+		{
+			buffer = std::move(free_buffers.back());
+			free_buffers.pop_back();
+		}
+	}
+	condition.notify_one();
+	return !failed;
+}
+
+
+void PipelineTrace::RecordUop(Uop *uop, long long cycle, bool squashed)
+{
+	// Outside of the cycle window
+	if (uop->fetch_when < start_cycle || (end_cycle && cycle > end_cycle))
+		return;
+
+	// Stages reached
+	Record record = {};
+	record.id = uop->getId();
+	record.fetch_cycle = uop->fetch_when;
+	record.decode_cycle = uop->decode_when;
+	record.dispatch_cycle = uop->dispatch_when;
+	record.issue_cycle = uop->issue_when;
+	record.writeback_cycle = uop->completed ? uop->complete_when : 0;
+	record.retire_cycle = cycle;
+	record.eip = uop->eip;
+	record.opcode = uop->getOpcode();
+	record.core = uop->getCore()->getId();
+	record.thread = uop->getThread()->getIdInCore();
+	record.mop_index = uop->mop_index;
+	record.squashed = squashed;
+
+	// Add to the buffer of the core
+	int core_id = uop->getCore()->getId();
+	std::vector<Record> &buffer = buffers[core_id];
+	buffer.push_back(record);
+	if ((int) buffer.size() >= buffer_size && !Submit(core_id))
+		throw Error(misc::fmt("%s: Cannot write pipeline trace file",
+				path.c_str()));
+}
+
+
+}  // namespace x86
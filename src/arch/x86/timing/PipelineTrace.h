@@ -0,0 +1,221 @@
+/*
+ *  Multi2Sim
+ *  Copyright (C) 2015  Rafael Ubal (ubal@ece.neu.edu)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef ARCH_X86_TIMING_PIPELINE_TRACE_H
+#define ARCH_X86_TIMING_PIPELINE_TRACE_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <lib/cpp/Error.h>
+
+
+namespace x86
+{
+
+// Forward declarations
+class Uop;
+
+
+/// Binary trace of the lifecycle of every uop in the detailed pipeline. One
+/// fixed-size record is written when a uop commits or is squashed, with the
+/// cycles when it went through each pipeline stage. Records are collected in
+/// per-core buffers, and full buffers are written to the file by a
+/// background thread. The trace can be converted into the Kanata log format
+/// used by the Konata pipeline viewer.
+class PipelineTrace
+{
+public:
+
+	/// Record of one uop in the trace file. Cycles of stages that the uop
+	/// did not reach are 0.
+	struct Record
+	{
+		/// Global uop identifier
+		int64_t id;
+
+		/// Cycles when the uop was fetched, decoded (inserted in the
+		/// uop queue), dispatched, issued, and written back
+		int64_t fetch_cycle;
+		int64_t decode_cycle;
+		int64_t dispatch_cycle;
+		int64_t issue_cycle;
+		int64_t writeback_cycle;
+
+		/// Cycle when the uop committed or was squashed
+		int64_t retire_cycle;
+
+		/// Address of the macro-instruction
+		uint32_t eip;
+
+		/// Micro-instruction opcode
+		uint16_t opcode;
+
+		/// Core and hardware thread
+		uint16_t core;
+		uint16_t thread;
+
+		/// Index of the uop within its macro-instruction
+		uint8_t mop_index;
+
+		/// True if the uop was squashed instead of committed
+		uint8_t squashed;
+
+		// Padding to a multiple of 8 bytes
+		uint8_t padding[4];
+	};
+
+private:
+
+	//
+	// Static fields
+	//
+
+	// Signature at the beginning of the trace file
+	static const char signature[8];
+
+	// Number of records in the buffer of each core
+	static const int buffer_size = 4096;
+
+	// Maximum number of cores and of threads per core that fit in a record
+	static const int max_ids = 1 << 16;
+
+
+
+
+	//
+	// Class members
+	//
+
+	// Output file
+	std::ofstream os;
+
+	// Buffer being filled by each core
+	std::vector<std::vector<Record>> buffers;
+
+	// Full buffers waiting to be written by the writer thread
+	std::vector<std::vector<Record>> pending_buffers;
+
+	// Empty buffers that the writer thread gives back
+	std::vector<std::vector<Record>> free_buffers;
+
+	// Protects the pending and free buffer lists
+	std::mutex mutex;
+
+	// Signals the writer thread when a buffer is pending, or when the
+	// trace is being closed
+	std::condition_variable condition;
+
+	// Set when the trace is being closed
+	bool closing = false;
+
+	// Set by the writer thread when writing to the file failed. Buffers
+	// are discarded from then on.
+	bool write_failed = false;
+
+	// Background thread writing buffers to the file
+	std::thread writer;
+
+	// Main function of the writer thread
+	void Write();
+
+	// Hand the buffer of a core over to the writer thread and give the core
+	// an empty buffer. Return false if a previous write to the file failed.
+	bool Submit(int core_id);
+
+public:
+
+	/// File where the trace is written, or empty if disabled
+	static std::string path;
+
+	/// First and last cycle of the traced window, with 0 for no limit
+	static long long start_cycle;
+	static long long end_cycle;
+
+	/// File where the trace given in 'path' is converted into the Kanata
+	/// format, instead of running a simulation
+	static std::string konata_path;
+
+	/// Exception for the pipeline trace
+	class Error : public misc::Error
+	{
+	public:
+
+		Error(const std::string &message) : misc::Error(message)
+		{
+			AppendPrefix("X86 pipeline trace");
+		}
+	};
+
+
+
+
+	//
+	// Static functions
+	//
+
+	/// Return whether the pipeline trace was enabled on the command line
+	static bool isEnabled() { return !path.empty(); }
+
+	/// Check the command-line options of the trace. If a conversion into
+	/// the Kanata format was requested, it is done here and the program
+	/// exits.
+	static void ProcessOptions();
+
+	/// Convert a binary trace into a Kanata log file
+	static void ConvertToKonata(const std::string &trace_path,
+			const std::string &konata_path);
+
+	/// Return the first traced cycle
+	static long long getStartCycle() { return start_cycle; }
+
+	/// Return the last traced cycle, or 0 if the trace has no end
+	static long long getEndCycle() { return end_cycle; }
+
+
+
+
+	//
+	// Class members
+	//
+
+	/// Constructor, opening the trace file. An exception is thrown if
+	/// core or thread identifiers don't fit in a record.
+	PipelineTrace(int num_cores, int num_threads);
+
+	/// Destructor, writing the remaining records and closing the file. A
+	/// warning is shown if the file could not be written.
+	~PipelineTrace();
+
+	/// Record a uop that committed or was squashed in the given cycle. Uops
+	/// fetched before the start of the traced window, or retiring after
+	/// its end, are ignored. Different cores can record uops concurrently.
+	/// An exception is thrown if a previous write to the file failed.
+	void RecordUop(Uop *uop, long long cycle, bool squashed);
+};
+
+
+}  // namespace x86
+
+#endif
@@ -0,0 +1,313 @@
+/*
+ *  Multi2Sim
+ *  Copyright (C) 2012  Rafael Ubal (ubal@ece.neu.edu)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <lib/esim/Engine.h>
+
+#include "Cpu.h"
+#include "RegionOfInterest.h"
+#include "Thread.h"
+#include "Timing.h"
+
+
+namespace x86
+{
+
+const misc::StringMap RegionOfInterest::mode_map =
+{
+	{ "Invalid", ModeInvalid },
+	{ "Detailed", ModeDetailed },
+	{ "Drain", ModeDrain },
+	{ "Functional", ModeFunctional }
+};
+
+bool RegionOfInterest::enabled;
+
+const long long RegionOfInterest::functional_length = 1000000;
+
+
+void RegionOfInterest::ParseConfiguration(misc::IniFile *ini_file)
+{
+	// Section
+	std::string section = "RegionOfInterest";
+
+	// Read variables
+	enabled = ini_file->ReadBool(section, "Enabled", false);
+}
+
+
+void RegionOfInterest::DumpConfiguration(std::ostream &os)
+{
+	os << "[ Config.RegionOfInterest ]\n";
+	os << misc::fmt("Enabled = %s\n", enabled ? "True" : "False");
+	os << '\n';
+}
+
+
+RegionOfInterest::RegionOfInterest(Cpu *cpu) : cpu(cpu)
+{
+	// Run functionally until the region of interest begins
+	if (enabled)
+	{
+		mode = ModeFunctional;
+		next_mode = ModeFunctional;
+		resume_fetch = true;
+		cpu->setFetchStopped(true);
+	}
+	else
+	{
+		mode = ModeDetailed;
+	}
+}
+
+
+RegionOfInterest::Snapshot RegionOfInterest::getSnapshot() const
+{
+	Snapshot snapshot;
+	snapshot.cycle = cpu->getCycle();
+	snapshot.num_instructions = cpu->getNumCommittedInstructions();
+	snapshot.num_uinsts = cpu->getNumCommittedUinsts();
+	snapshot.num_branches = cpu->getNumBranches();
+	snapshot.num_mispredicted_branches = cpu->getNumMispredictedBranches();
+	return snapshot;
+}
+
+
+void RegionOfInterest::ProcessCommands()
+{
+	Emulator *emulator = Emulator::getInstance();
+	esim::Engine *esim_engine = esim::Engine::getInstance();
+	while (emulator->hasMagicCommands() && !esim_engine->hasFinished())
+		ProcessCommand(emulator->ExtractMagicCommand());
+}
+
+
+void RegionOfInterest::ProcessCommand(Emulator::MagicCommand command)
+{
+	// Stats
+	num_commands++;
+
+	switch (command)
+	{
+
+	case Emulator::MagicCommandRoiBegin:
+
+		// Only the first marker counts
+		if (!roi_begun)
+		{
+			roi_begun = true;
+			roi_begin = getSnapshot();
+		}
+		next_mode = ModeDetailed;
+		break;
+
+	case Emulator::MagicCommandRoiEnd:
+
+		// Record end, and stop if the simulation is restricted to the
+		// region of interest
+		roi_ended = true;
+		roi_end = getSnapshot();
+		if (enabled)
+			esim::Engine::getInstance()->Finish("X86RegionOfInterestEnd");
+		break;
+
+	case Emulator::MagicCommandStatsReset:
+
+		stats_start = getSnapshot();
+		break;
+
+	case Emulator::MagicCommandStatsDump:
+	{
+		// Record statistics relative to the last reset
+		Snapshot snapshot = getSnapshot();
+		snapshot.cycle -= stats_start.cycle;
+		snapshot.num_instructions -= stats_start.num_instructions;
+		snapshot.num_uinsts -= stats_start.num_uinsts;
+		snapshot.num_branches -= stats_start.num_branches;
+		snapshot.num_mispredicted_branches -=
+				stats_start.num_mispredicted_branches;
+		stats_dumps.push_back(snapshot);
+		break;
+	}
+
+	case Emulator::MagicCommandSwitchDetailed:
+
+		next_mode = ModeDetailed;
+		break;
+
+	case Emulator::MagicCommandSwitchFunctional:
+
+		next_mode = ModeFunctional;
+		break;
+
+	default:
+
+		throw misc::Panic("Invalid magic command");
+	}
+}
+
+
+void RegionOfInterest::SwitchMode(Mode mode)
+{
+	// Sanity
+	assert(mode == ModeDetailed || mode == ModeFunctional);
+	assert(cpu->isPipelineEmpty());
+
+	// Return to detailed mode. If contexts ran functionally, fetch must
+	// resume from their current state.
+	if (mode == ModeDetailed)
+	{
+		if (this->mode == ModeFunctional)
+			for (int i = 0; i < Cpu::getNumCores(); i++)
+				for (int j = 0; j < Cpu::getNumThreads(); j++)
+					cpu->getThread(i, j)->ResetFetch();
+		if (resume_fetch)
+			cpu->setFetchStopped(false);
+	}
+
+	// Set new mode
+	this->mode = mode;
+}
+
+
+void RegionOfInterest::RunFunctional()
+{
+	// Apply commands of the magic instructions executed so far
+	Emulator *emulator = Emulator::getInstance();
+	if (emulator->hasMagicCommands())
+	{
+		ProcessCommands();
+		SwitchMode(next_mode);
+		return;
+	}
+
+	// If all contexts finished, return to detailed mode, where the CPU
+	// scheduler frees those that are still mapped to hardware threads.
+	if (!emulator->getNumRunningContexts() &&
+			!emulator->getNumSuspendedContexts())
+	{
+		SwitchMode(ModeDetailed);
+		return;
+	}
+
+	// Run until the next magic instruction
+	num_functional_instructions += Timing::getInstance()->RunFunctional(
+			functional_length);
+}
+
+
+void RegionOfInterest::Run()
+{
+	Emulator *emulator = Emulator::getInstance();
+	switch (mode)
+	{
+
+	case ModeDetailed:
+
+		// Nothing to do until a magic instruction is fetched
+		if (!emulator->hasMagicCommands())
+			break;
+
+		// Fetch stopped right after the magic instruction. Wait for
+		// the instructions before it to commit.
+		resume_fetch = !cpu->isFetchStopped();
+		cpu->setFetchStopped(true);
+		mode = ModeDrain;
+		break;
+
+	case ModeDrain:
+
+		// Wait for all uops in flight
+		if (!cpu->isPipelineEmpty())
+			break;
+
+		// Apply commands
+		next_mode = ModeDetailed;
+		ProcessCommands();
+		SwitchMode(next_mode);
+		break;
+
+	case ModeFunctional:
+
+		RunFunctional();
+		break;
+
+	default:
+
+		throw misc::Panic("Invalid simulation mode");
+	}
+}
+
+
+void RegionOfInterest::DumpWindow(std::ostream &os, const Snapshot &begin,
+		const Snapshot &end)
+{
+	long long num_cycles = end.cycle - begin.cycle;
+	long long num_instructions = end.num_instructions
+			- begin.num_instructions;
+	long long num_branches = end.num_branches - begin.num_branches;
+	long long num_mispredicted_branches = end.num_mispredicted_branches
+			- begin.num_mispredicted_branches;
+	os << misc::fmt("Cycles = %lld\n", num_cycles);
+	os << misc::fmt("CommittedInstructions = %lld\n", num_instructions);
+	os << misc::fmt("CommittedMicroInstructions = %lld\n",
+			end.num_uinsts - begin.num_uinsts);
+	os << misc::fmt("CommittedInstructionsPerCycle = %.4g\n", num_cycles ?
+			(double) num_instructions / num_cycles : 0.0);
+	os << misc::fmt("Branches = %lld\n", num_branches);
+	os << misc::fmt("Mispred = %lld\n", num_mispredicted_branches);
+	os << misc::fmt("PredAcc = %.4g\n", num_branches ?
+			(double) (num_branches - num_mispredicted_branches)
+			/ num_branches : 0.0);
+}
+
+
+void RegionOfInterest::DumpReport(std::ostream &os) const
+{
+	// Nothing to report if magic instructions were not used
+	if (!enabled && !num_commands)
+		return;
+
+	// Header
+	os << "; Region of interest\n";
+	os << ";    Begun, Ended - Whether magic instructions marked the region\n";
+	os << ";    MagicCommands - Number of magic instructions processed\n";
+	os << ";    FunctionalInstructions - Instructions run in functional mode\n";
+	os << ";    Cycles, CommittedInstructions, ... - Stats within the region\n";
+	os << "[ RegionOfInterest ]\n";
+
+	// Stats
+	os << misc::fmt("Begun = %s\n", roi_begun ? "True" : "False");
+	os << misc::fmt("Ended = %s\n", roi_ended ? "True" : "False");
+	os << misc::fmt("MagicCommands = %d\n", num_commands);
+	os << misc::fmt("FunctionalInstructions = %lld\n",
+			num_functional_instructions);
+	if (roi_begun)
+		DumpWindow(os, roi_begin, roi_ended ? roi_end : getSnapshot());
+	os << '\n';
+
+	// Statistics dumped by magic instructions
+	for (unsigned i = 0; i < stats_dumps.size(); i++)
+	{
+		os << misc::fmt("[ RegionOfInterest.StatsDump.%d ]\n", i);
+		DumpWindow(os, Snapshot(), stats_dumps[i]);
+		os << '\n';
+	}
+}
+
+}
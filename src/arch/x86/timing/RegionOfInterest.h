@@ -0,0 +1,198 @@
+/*
+ *  Multi2Sim
+ *  Copyright (C) 2012  Rafael Ubal (ubal@ece.neu.edu)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef ARCH_X86_TIMING_REGION_OF_INTEREST_H
+#define ARCH_X86_TIMING_REGION_OF_INTEREST_H
+
+#include <iostream>
+#include <vector>
+
+#include <arch/x86/emulator/Emulator.h>
+#include <lib/cpp/IniFile.h>
+#include <lib/cpp/String.h>
+
+
+namespace x86
+{
+
+// Forward declarations
+class Cpu;
+
+
+/// Processing of the magic instructions executed by guest programs. Each
+/// magic instruction carries a command to mark the beginning or end of the
+/// region of interest, reset or dump statistics, or switch between detailed
+/// and functional simulation. In detailed mode, fetch stops as soon as a
+/// magic instruction is fetched, and the command is applied once the
+/// pipelines drain, so that statistics include exactly the instructions
+/// preceding it.
+class RegionOfInterest
+{
+public:
+
+	/// Simulation modes
+	enum Mode
+	{
+		ModeInvalid = 0,
+		ModeDetailed,
+		ModeDrain,
+		ModeFunctional
+	};
+
+	/// String map for values of type Mode
+	static const misc::StringMap mode_map;
+
+	/// Global statistics at a given point of the simulation
+	struct Snapshot
+	{
+		long long cycle = 0;
+		long long num_instructions = 0;
+		long long num_uinsts = 0;
+		long long num_branches = 0;
+		long long num_mispredicted_branches = 0;
+	};
+
+private:
+
+	//
+	// Static fields
+	//
+
+	// True if the simulation should be restricted to the region of
+	// interest, as set in the configuration file
+	static bool enabled;
+
+	// Maximum number of instructions executed functionally in each
+	// iteration of the functional mode
+	static const long long functional_length;
+
+
+
+
+	//
+	// Class members
+	//
+
+	// CPU that the magic instructions control
+	Cpu *cpu;
+
+	// Current mode
+	Mode mode;
+
+	// Mode requested by the last magic commands processed
+	Mode next_mode = ModeDetailed;
+
+	// True if fetch must restart when returning to detailed mode. Fetch
+	// might have been stopped before by the sampler.
+	bool resume_fetch = false;
+
+	// Statistics when they were last reset
+	Snapshot stats_start;
+
+	// Statistics at the beginning and end of the region of interest
+	bool roi_begun = false;
+	bool roi_ended = false;
+	Snapshot roi_begin;
+	Snapshot roi_end;
+
+	// Statistics recorded by each stats dump command, relative to the
+	// last reset
+	std::vector<Snapshot> stats_dumps;
+
+	// Number of commands processed
+	int num_commands = 0;
+
+	// Number of instructions executed in functional mode
+	long long num_functional_instructions = 0;
+
+	// Return the current global statistics
+	Snapshot getSnapshot() const;
+
+	// Apply all pending magic commands
+	void ProcessCommands();
+
+	// Apply one magic command
+	void ProcessCommand(Emulator::MagicCommand command);
+
+	// Switch to a new mode. The pipelines must be empty.
+	void SwitchMode(Mode mode);
+
+	// Run contexts functionally until the next magic instruction
+	void RunFunctional();
+
+	// Dump statistics between two snapshots
+	static void DumpWindow(std::ostream &os, const Snapshot &begin,
+			const Snapshot &end);
+
+public:
+
+	//
+	// Static functions
+	//
+
+	/// Read the configuration from section [ RegionOfInterest ]
+	static void ParseConfiguration(misc::IniFile *ini_file);
+
+	/// Dump the configuration
+	static void DumpConfiguration(std::ostream &os = std::cout);
+
+	/// Return whether the simulation is restricted to the region of
+	/// interest
+	static bool isEnabled() { return enabled; }
+
+
+
+
+	//
+	// Class members
+	//
+
+	/// Constructor. If the simulation is restricted to the region of
+	/// interest, it starts in functional mode.
+	RegionOfInterest(Cpu *cpu);
+
+	/// Process pending magic commands, and run functionally if in
+	/// functional mode. This function is called once per cycle of the
+	/// detailed simulation, before the CPU runs.
+	void Run();
+
+	/// Return the current mode
+	Mode getMode() const { return mode; }
+
+	/// Return the number of instructions executed in functional mode
+	long long getNumFunctionalInstructions() const
+	{
+		return num_functional_instructions;
+	}
+
+	/// Return whether the region of interest has begun
+	bool hasBegun() const { return roi_begun; }
+
+	/// Return whether the region of interest has ended
+	bool hasEnded() const { return roi_ended; }
+
+	/// Dump statistics in the format of the x86 report. Nothing is dumped
+	/// if the region of interest is not enabled and no magic instruction
+	/// was executed.
+	void DumpReport(std::ostream &os = std::cout) const;
+};
+
+}
+
+#endif
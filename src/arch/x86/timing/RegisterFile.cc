@@ -17,6 +17,8 @@
  *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  */
 
+#include <algorithm>
+
 #include "RegisterFile.h"
 #include "Core.h"
 #include "Thread.h"
@@ -313,6 +315,58 @@ int RegisterFile::RequestXmmRegister()
 }
 
 
+RegisterFile::PhysicalRegister *RegisterFile::getInputRegister(Uop *uop,
+		int dep)
+{
+	int logical_register = uop->getUinst()->getIDep(dep);
+	int physical_register = uop->getInput(dep);
+	if (Uinst::isIntegerDependency(logical_register))
+		return &integer_registers[physical_register];
+	else if (Uinst::isFloatingPointDependency(logical_register))
+		return &floating_point_registers[physical_register];
+	else if (Uinst::isXmmDependency(logical_register))
+		return &xmm_registers[physical_register];
+	else
+		return nullptr;
+}
+
+
+RegisterFile::PhysicalRegister *RegisterFile::getOutputRegister(Uop *uop,
+		int dep)
+{
+	int logical_register = uop->getUinst()->getODep(dep);
+	int physical_register = uop->getOutput(dep);
+	if (Uinst::isIntegerDependency(logical_register))
+		return &integer_registers[physical_register];
+	else if (Uinst::isFloatingPointDependency(logical_register))
+		return &floating_point_registers[physical_register];
+	else if (Uinst::isXmmDependency(logical_register))
+		return &xmm_registers[physical_register];
+	else
+		return nullptr;
+}
+
+
+void RegisterFile::WakeUp(PhysicalRegister *physical_register)
+{
+	for (Uop *uop : physical_register->consumers)
+	{
+		// Uop still waits for other registers
+		assert(uop->num_pending_inputs > 0);
+		uop->num_pending_inputs--;
+		if (uop->num_pending_inputs)
+			continue;
+
+		// Uop is ready. Loads and stores are not issued from the
+		// instruction queue, so they are not added to the ready list.
+		uop->ready = true;
+		if (uop->in_instruction_queue)
+			uop->getThread()->InsertInReadyList(uop);
+	}
+	physical_register->consumers.clear();
+}
+
+
 bool RegisterFile::canRename(Uop *uop)
 {
 	// Detect negative cases
@@ -447,6 +501,20 @@ void RegisterFile::Rename(Uop *uop)
 		}
 	}
 
+	// Record the input registers that are still being computed. The uop
+	// becomes ready when all of them are written back.
+	uop->num_pending_inputs = 0;
+	for (int dep = 0; dep < Uinst::MaxIDeps; dep++)
+	{
+		PhysicalRegister *physical_register = getInputRegister(uop, dep);
+		if (physical_register && physical_register->pending)
+		{
+			physical_register->consumers.push_back(uop);
+			uop->num_pending_inputs++;
+		}
+	}
+	uop->ready = !uop->num_pending_inputs;
+
 	// Rename output int/FP/XMM registers (not flags)
 	int flag_physical_register = -1;
 	int flag_count = 0;
@@ -573,40 +641,10 @@ void RegisterFile::Rename(Uop *uop)
 
 bool RegisterFile::isUopReady(Uop *uop)
 {
-	// If uop is marked as ready, it means that we verified that it is
-	// ready before. The uop ready state can never change from true to
-	// false.
-	if (uop->ready)
-		return true;
-
-	// Traverse dependencies
-	for (int dep = 0; dep < Uinst::MaxIDeps; dep++)
-	{
-		// Get dependencies
-		int logical_register = uop->getUinst()->getIDep(dep);
-		int physical_register = uop->getInput(dep);
-
-		// Integer dependency
-		if (Uinst::isIntegerDependency(logical_register)
-				&& integer_registers[physical_register].pending)
-			return false;
-
-		// Floating-point dependency
-		if (Uinst::isFloatingPointDependency(logical_register)
-				&& floating_point_registers[physical_register].pending)
-			return false;
-
-		// XMM dependency
-		if (Uinst::isXmmDependency(logical_register)
-				&& xmm_registers[physical_register].pending)
-			return false;
-	}
-
-	// At this point, we found that the uop is ready. Save this information
-	// in the 'ready' field of the uop to avoid having to check in the
-	// future.
-	uop->ready = true;
-	return true;
+	// The 'ready' field is set at renaming if no input is pending, or
+	// when the last pending input is written back. The uop ready state
+	// only changes from true to false when the uop is replayed.
+	return uop->ready;
 }
 
 
@@ -615,14 +653,14 @@ void RegisterFile::WriteUop(Uop *uop)
 
 	for (int dep = 0; dep < Uinst::MaxODeps; dep++)
 	{
-		int logical_register = uop->getUinst()->getODep(dep);
-		int physical_register = uop->getOutput(dep);
-		if (Uinst::isIntegerDependency(logical_register))
-			integer_registers[physical_register].pending = false;
-		else if (Uinst::isFloatingPointDependency(logical_register))
-			floating_point_registers[physical_register].pending = false;
-		else if (Uinst::isXmmDependency(logical_register))
-			xmm_registers[physical_register].pending = false;
+		// Several outputs can share the same register (flags)
+		PhysicalRegister *physical_register = getOutputRegister(uop, dep);
+		if (!physical_register || !physical_register->pending)
+			continue;
+
+		// Write it and wake up its consumers
+		physical_register->pending = false;
+		WakeUp(physical_register);
 	}
 }
 
@@ -633,9 +671,23 @@ void RegisterFile::UndoUop(Uop *uop)
 	// Debug
 	debug << "Undo uop " << *uop << '\n';
 
+	// Stop waiting for pending inputs. Consumers are squashed before
+	// their producers, so these registers remain allocated.
+	for (int dep = 0; dep < Uinst::MaxIDeps; dep++)
+	{
+		PhysicalRegister *physical_register = getInputRegister(uop, dep);
+		if (!physical_register || !physical_register->pending)
+			continue;
+		auto &consumers = physical_register->consumers;
+		auto it = std::find(consumers.begin(), consumers.end(), uop);
+		assert(it != consumers.end());
+		consumers.erase(it);
+		uop->num_pending_inputs--;
+	}
+	assert(!uop->num_pending_inputs);
+
 	// Undo mappings in reverse order, in case an instruction has a
 	// duplicated output dependence.
-	assert(uop->speculative_mode);
 	for (int dep = Uinst::MaxODeps - 1; dep >= 0; dep--)
 	{
 		int logical_register = uop->getUinst()->getODep(dep);
@@ -20,6 +20,8 @@
 #ifndef ARCH_X86_TIMING_REGISTER_FILE_H
 #define ARCH_X86_TIMING_REGISTER_FILE_H
 
+#include <vector>
+
 #include <lib/cpp/Debug.h>
 #include <lib/cpp/IniFile.h>
 #include <arch/x86/emulator/Uinst.h>
@@ -80,8 +82,24 @@ private:
 
 		// Number of logical registers mapped to this physical register
 		int busy = 0;
+
+		// Uops renamed while the register was pending, which wait for
+		// it to be written back
+		std::vector<Uop *> consumers;
 	};
 
+	// Return the physical register read by an input dependency of a
+	// renamed uop, or null if the dependency is not a register
+	PhysicalRegister *getInputRegister(Uop *uop, int dep);
+
+	// Return the physical register written by an output dependency of a
+	// renamed uop, or null if the dependency is not a register
+	PhysicalRegister *getOutputRegister(Uop *uop, int dep);
+
+	// Notify the consumers of a physical register that it was written,
+	// and move those with no other pending input to the ready list.
+	void WakeUp(PhysicalRegister *physical_register);
+
 
 
 
@@ -291,7 +309,7 @@ public:
 	void WriteUop(Uop *uop);
 
 	/// Update the state of the register file when an uop is recovered from
-	/// speculative execution
+	/// speculative execution, or replayed
 	void UndoUop(Uop *uop);
 
 	/// Update the state of the register file when an uop commits
@@ -0,0 +1,284 @@
+/*
+ *  Multi2Sim
+ *  Copyright (C) 2012  Rafael Ubal (ubal@ece.neu.edu)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <cmath>
+
+#include <lib/esim/Engine.h>
+
+#include "Cpu.h"
+#include "Sampler.h"
+#include "Thread.h"
+#include "Timing.h"
+
+
+namespace x86
+{
+
+bool Sampler::enabled;
+long long Sampler::functional_length;
+long long Sampler::warmup_length;
+long long Sampler::measure_length;
+double Sampler::confidence;
+double Sampler::target_error;
+int Sampler::min_samples;
+
+
+void Sampler::ParseConfiguration(misc::IniFile *ini_file)
+{
+	// Section
+	std::string section = "Sampling";
+
+	// Read variables
+	enabled = ini_file->ReadBool(section, "Enabled", false);
+	functional_length = ini_file->ReadInt64(section, "FunctionalLength", 1000000);
+	warmup_length = ini_file->ReadInt64(section, "WarmupLength", 2000);
+	measure_length = ini_file->ReadInt64(section, "MeasureLength", 1000);
+	confidence = ini_file->ReadDouble(section, "Confidence", 99.7);
+	target_error = ini_file->ReadDouble(section, "TargetError", 0.03);
+	min_samples = ini_file->ReadInt(section, "MinSamples", 30);
+
+	// Integrity checks
+	if (functional_length < 0)
+		throw Error(misc::fmt("%s: %s: 'FunctionalLength' must be "
+				"greater or equal than 0",
+				ini_file->getPath().c_str(),
+				section.c_str()));
+	if (warmup_length < 0)
+		throw Error(misc::fmt("%s: %s: 'WarmupLength' must be "
+				"greater or equal than 0",
+				ini_file->getPath().c_str(),
+				section.c_str()));
+	if (measure_length < 1)
+		throw Error(misc::fmt("%s: %s: 'MeasureLength' must be "
+				"greater than 0",
+				ini_file->getPath().c_str(),
+				section.c_str()));
+	if (confidence <= 0.0 || confidence >= 100.0)
+		throw Error(misc::fmt("%s: %s: 'Confidence' must be a "
+				"percentage between 0 and 100",
+				ini_file->getPath().c_str(),
+				section.c_str()));
+	if (target_error < 0.0)
+		throw Error(misc::fmt("%s: %s: 'TargetError' must be "
+				"greater or equal than 0",
+				ini_file->getPath().c_str(),
+				section.c_str()));
+	if (min_samples < 2)
+		throw Error(misc::fmt("%s: %s: 'MinSamples' must be "
+				"greater than 1",
+				ini_file->getPath().c_str(),
+				section.c_str()));
+}
+
+
+void Sampler::DumpConfiguration(std::ostream &os)
+{
+	os << "[ Config.Sampling ]\n";
+	os << misc::fmt("Enabled = %s\n", enabled ? "True" : "False");
+	os << misc::fmt("FunctionalLength = %lld\n", functional_length);
+	os << misc::fmt("WarmupLength = %lld\n", warmup_length);
+	os << misc::fmt("MeasureLength = %lld\n", measure_length);
+	os << misc::fmt("Confidence = %.4g\n", confidence);
+	os << misc::fmt("TargetError = %.4g\n", target_error);
+	os << misc::fmt("MinSamples = %d\n", min_samples);
+	os << '\n';
+}
+
+
+double Sampler::getZScore(double confidence)
+{
+	// Upper tail probability for a two-sided interval
+	double p = (1.0 - confidence / 100.0) / 2.0;
+	assert(p > 0.0 && p < 0.5);
+
+	// Rational approximation of the inverse of the normal distribution,
+	// from Abramowitz and Stegun, formula 26.2.23. The absolute error
+	// is below 4.5e-4.
+	double t = std::sqrt(-2.0 * std::log(p));
+	return t - (2.515517 + 0.802853 * t + 0.010328 * t * t) /
+			(1.0 + 1.432788 * t + 0.189269 * t * t +
+			0.001308 * t * t * t);
+}
+
+
+Sampler::Sampler(Cpu *cpu) : cpu(cpu)
+{
+	// The first detailed interval starts with a warmup
+	StartPhase(PhaseWarmup);
+}
+
+
+void Sampler::StartPhase(Phase phase)
+{
+	this->phase = phase;
+	phase_start_instructions = cpu->getNumCommittedInstructions();
+	phase_start_cycle = cpu->getCycle();
+}
+
+
+void Sampler::RecordSample()
+{
+	// Cycles and instructions in the window
+	long long num_instructions = cpu->getNumCommittedInstructions()
+			- phase_start_instructions;
+	long long num_cycles = cpu->getCycle() - phase_start_cycle;
+	AddSample(num_instructions, num_cycles);
+}
+
+
+void Sampler::AddSample(long long num_instructions, long long num_cycles)
+{
+	// Accumulate
+	assert(num_instructions > 0);
+	double cpi = (double) num_cycles / num_instructions;
+	num_samples++;
+	cpi_sum += cpi;
+	cpi_sum_squares += cpi * cpi;
+	num_measured_instructions += num_instructions;
+	num_measured_cycles += num_cycles;
+
+	// Check error bound
+	if (num_samples >= min_samples && getRelativeError() <= target_error)
+		converged = true;
+}
+
+
+void Sampler::RunFunctional()
+{
+	// Run all running contexts functionally. Finished contexts that are
+	// still mapped to hardware threads are freed by the CPU scheduler once
+	// detailed simulation resumes.
+	num_functional_instructions += Timing::getInstance()->RunFunctional(
+			functional_length);
+
+	// Fetch must resume from the current state of each context
+	for (int i = 0; i < Cpu::getNumCores(); i++)
+		for (int j = 0; j < Cpu::getNumThreads(); j++)
+			cpu->getThread(i, j)->ResetFetch();
+}
+
+
+void Sampler::Run()
+{
+	switch (phase)
+	{
+
+	case PhaseWarmup:
+
+		// Start measurement window
+		if (cpu->getNumCommittedInstructions() - phase_start_instructions
+				>= warmup_length)
+			StartPhase(PhaseMeasure);
+		break;
+
+	case PhaseMeasure:
+
+		// Continue until the window is full
+		if (cpu->getNumCommittedInstructions() - phase_start_instructions
+				< measure_length)
+			break;
+
+		// Record sample and stop if the error bound was reached
+		RecordSample();
+		if (converged)
+		{
+			esim::Engine::getInstance()->Finish("X86SamplingConverged");
+			break;
+		}
+
+		// Stop fetching new instructions to drain the pipelines
+		cpu->setFetchStopped(true);
+		StartPhase(PhaseDrain);
+		break;
+
+	case PhaseDrain:
+
+		// Wait for all uops in flight
+		if (!cpu->isPipelineEmpty())
+			break;
+
+		// Run the functional interval and restart fetch
+		RunFunctional();
+		cpu->setFetchStopped(false);
+		StartPhase(PhaseWarmup);
+		break;
+
+	default:
+
+		throw misc::Panic("Invalid sampling phase");
+	}
+}
+
+
+double Sampler::getCpiStdDev() const
+{
+	// Sample standard deviation
+	if (num_samples < 2)
+		return 0.0;
+	double mean = getMeanCpi();
+	double variance = (cpi_sum_squares - num_samples * mean * mean)
+			/ (num_samples - 1);
+	return variance > 0.0 ? std::sqrt(variance) : 0.0;
+}
+
+
+double Sampler::getCpiConfidenceInterval() const
+{
+	if (num_samples < 2)
+		return 0.0;
+	return getZScore(confidence) * getCpiStdDev()
+			/ std::sqrt((double) num_samples);
+}
+
+
+double Sampler::getRelativeError() const
+{
+	double mean = getMeanCpi();
+	return mean > 0.0 ? getCpiConfidenceInterval() / mean : 0.0;
+}
+
+
+void Sampler::DumpReport(std::ostream &os) const
+{
+	// Header
+	os << "; Sampling\n";
+	os << ";    Samples - Number of measurement windows\n";
+	os << ";    CPI.Mean, CPI.StdDev - Statistics of per-window CPI\n";
+	os << ";    CPI.Interval - Half-width of the confidence interval\n";
+	os << ";    CPI.Error - Interval relative to the mean CPI\n";
+	os << "[ Sampling ]\n";
+
+	// Stats
+	double mean = getMeanCpi();
+	os << misc::fmt("Samples = %d\n", num_samples);
+	os << misc::fmt("Converged = %s\n", converged ? "True" : "False");
+	os << misc::fmt("FunctionalInstructions = %lld\n",
+			num_functional_instructions);
+	os << misc::fmt("MeasuredInstructions = %lld\n",
+			num_measured_instructions);
+	os << misc::fmt("MeasuredCycles = %lld\n", num_measured_cycles);
+	os << misc::fmt("CPI.Mean = %.4g\n", mean);
+	os << misc::fmt("CPI.StdDev = %.4g\n", getCpiStdDev());
+	os << misc::fmt("CPI.Interval = %.4g\n", getCpiConfidenceInterval());
+	os << misc::fmt("CPI.Error = %.4g\n", getRelativeError());
+	os << misc::fmt("IPC.Mean = %.4g\n", mean > 0.0 ? 1.0 / mean : 0.0);
+	os << '\n';
+}
+
+}
@@ -0,0 +1,220 @@
+/*
+ *  Multi2Sim
+ *  Copyright (C) 2012  Rafael Ubal (ubal@ece.neu.edu)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef ARCH_X86_TIMING_SAMPLER_H
+#define ARCH_X86_TIMING_SAMPLER_H
+
+#include <iostream>
+
+#include <lib/cpp/Error.h>
+#include <lib/cpp/IniFile.h>
+#include <lib/cpp/String.h>
+
+
+namespace x86
+{
+
+// Forward declarations
+class Cpu;
+
+
+/// Periodic sampling of the detailed simulation. The sampler alternates
+/// between a functional fast-forward interval, a detailed warmup interval,
+/// and a detailed measurement window. Each measurement window produces one
+/// CPI sample. Once the confidence interval of the mean CPI is narrow
+/// enough, the simulation finishes.
+class Sampler
+{
+public:
+
+	/// Sampling phases
+	enum Phase
+	{
+		PhaseInvalid = 0,
+		PhaseWarmup,
+		PhaseMeasure,
+		PhaseDrain
+	};
+
+private:
+
+	//
+	// Static fields
+	//
+
+	// True if sampling was enabled in the configuration file
+	static bool enabled;
+
+	// Number of instructions executed functionally between two
+	// consecutive detailed intervals
+	static long long functional_length;
+
+	// Number of committed instructions in each detailed warmup interval
+	static long long warmup_length;
+
+	// Number of committed instructions in each measurement window
+	static long long measure_length;
+
+	// Confidence level, given as a percentage
+	static double confidence;
+
+	// Target relative error of the mean CPI
+	static double target_error;
+
+	// Minimum number of samples before checking the error bound
+	static int min_samples;
+
+
+
+
+	//
+	// Class members
+	//
+
+	// CPU that the sampler controls
+	Cpu *cpu;
+
+	// Current phase
+	Phase phase = PhaseWarmup;
+
+	// Committed instructions and cycle when the current phase started
+	long long phase_start_instructions = 0;
+	long long phase_start_cycle = 0;
+
+	// Number of measurement windows completed
+	int num_samples = 0;
+
+	// Sum of CPI samples, and sum of their squares
+	double cpi_sum = 0.0;
+	double cpi_sum_squares = 0.0;
+
+	// Totals of instructions and cycles in measurement windows
+	long long num_measured_instructions = 0;
+	long long num_measured_cycles = 0;
+
+	// Number of instructions executed in functional intervals
+	long long num_functional_instructions = 0;
+
+	// True if the error bound was reached
+	bool converged = false;
+
+	// Start a new phase
+	void StartPhase(Phase phase);
+
+	// Record the CPI sample of the measurement window that just ended
+	void RecordSample();
+
+	// Run the functional interval between two detailed intervals
+	void RunFunctional();
+
+public:
+
+	//
+	// Class Error
+	//
+
+	/// Exception for the x86 sampler
+	class Error : public misc::Error
+	{
+	public:
+
+		Error(const std::string &message) : misc::Error(message)
+		{
+			AppendPrefix("X86 sampler");
+		}
+	};
+
+
+
+
+	//
+	// Static functions
+	//
+
+	/// Read the sampling configuration from section [ Sampling ]
+	static void ParseConfiguration(misc::IniFile *ini_file);
+
+	/// Dump the sampling configuration
+	static void DumpConfiguration(std::ostream &os = std::cout);
+
+	/// Return whether sampling is enabled
+	static bool isEnabled() { return enabled; }
+
+	/// Return the quantile of the standard normal distribution matching
+	/// a two-sided confidence level given as a percentage.
+	static double getZScore(double confidence);
+
+
+
+
+	//
+	// Class members
+	//
+
+	/// Constructor
+	Sampler(Cpu *cpu);
+
+	/// Advance the sampling state machine. This function is called once
+	/// per cycle of the detailed simulation, before the CPU runs.
+	void Run();
+
+	/// Add the CPI sample of a measurement window with the given number
+	/// of committed instructions and cycles, and check whether the target
+	/// error bound was reached. This function is called at the end of
+	/// each measurement window.
+	void AddSample(long long num_instructions, long long num_cycles);
+
+	/// Return the current phase
+	Phase getPhase() const { return phase; }
+
+	/// Return the number of CPI samples collected
+	int getNumSamples() const { return num_samples; }
+
+	/// Return the mean CPI across all samples
+	double getMeanCpi() const
+	{
+		return num_samples ? cpi_sum / num_samples : 0.0;
+	}
+
+	/// Return the sample standard deviation of the CPI
+	double getCpiStdDev() const;
+
+	/// Return the half-width of the confidence interval of the mean CPI
+	double getCpiConfidenceInterval() const;
+
+	/// Return the half-width of the confidence interval relative to the
+	/// mean CPI.
+	double getRelativeError() const;
+
+	/// Return whether the target error bound was reached
+	bool hasConverged() const { return converged; }
+
+	/// Return the number of instructions executed in functional intervals
+	long long getNumFunctionalInstructions() const
+	{
+		return num_functional_instructions;
+	}
+
+	/// Dump sampling statistics in the format of the x86 report
+	void DumpReport(std::ostream &os = std::cout) const;
+};
+
+}
+
+#endif
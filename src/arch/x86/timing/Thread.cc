@@ -17,6 +17,8 @@
  *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  */
 
+#include <algorithm>
+
 #include "Cpu.h"
 #include "Timing.h"
 #include "Thread.h"
@@ -33,7 +35,9 @@ const misc::StringMap Thread::fetch_stall_map =
 	{ "Context", FetchStallContext },
 	{ "Suspended", FetchStallSuspended },
 	{ "FetchQueue", FetchStallFetchQueue },
-	{ "InstructionMemory", FetchStallInstructionMemory }
+	{ "InstructionMemory", FetchStallInstructionMemory },
+	{ "Drain", FetchStallDrain },
+	{ "UopCacheSwitch", FetchStallUopCacheSwitch }
 };
 
 
@@ -51,10 +55,38 @@ const misc::StringMap Thread::dispatch_stall_map =
 };
 
 
+const misc::StringMap Thread::cpi_component_map =
+{
+	{ "Base", CpiComponentBase },
+	{ "FrontEnd.ICache", CpiComponentFrontEndICache },
+	{ "FrontEnd.Recovery", CpiComponentFrontEndRecovery },
+	{ "FrontEnd.TraceCache", CpiComponentFrontEndTraceCache },
+	{ "FrontEnd.Other", CpiComponentFrontEndOther },
+	{ "Memory.L1", CpiComponentMemoryL1 },
+	{ "Memory.L2", CpiComponentMemoryL2 },
+	{ "Memory.LLC", CpiComponentMemoryLlc },
+	{ "Memory.DRAM", CpiComponentMemoryDram },
+	{ "Core.FunctionalUnit", CpiComponentCoreFunctionalUnit },
+	{ "Core.Dependency", CpiComponentCoreDependency },
+	{ "Core.Smt", CpiComponentCoreSmt },
+	{ "BadSpeculation", CpiComponentBadSpeculation }
+};
+
+
 Thread::Thread(Core *core,
 		int id_in_core) :
 		core(core),
-		id_in_core(id_in_core)
+		id_in_core(id_in_core),
+		fetch_queue(Cpu::getFetchQueueSize()),
+		uop_queue(Cpu::getUopQueueSize()),
+		replay_queue(Cpu::getUopQueueSize()),
+		reorder_buffer(Cpu::getReorderBufferSize()),
+		instruction_queue(Cpu::getInstructionQueueSize(),
+				&Uop::instruction_queue_position),
+		load_queue(Cpu::getLoadStoreQueueSize(),
+				&Uop::load_queue_position),
+		store_queue(Cpu::getLoadStoreQueueSize(),
+				&Uop::store_queue_position)
 {
 	// Assign name
 	name = misc::fmt("Core %d Thread %d", core->getId(), id_in_core);
@@ -74,8 +106,19 @@ Thread::Thread(Core *core,
 		trace_cache = misc::new_unique<TraceCache>(name +
 				".TraceCache");
 
+	// Initialize uop cache
+	if (UopCache::isPresent())
+		uop_cache = misc::new_unique<UopCache>(name + ".UopCache");
+
 	// Initialize register file
 	register_file = misc::new_unique<RegisterFile>(this);
+
+	// Initialize memory dependence predictor
+	memory_dependence_predictor = misc::new_unique<MemoryDependencePredictor>(
+			name + ".MemoryDependencePredictor");
+
+	// Initialize uop pool
+	uop_pool = misc::new_unique<UopPool>();
 }
 
 
@@ -103,14 +146,14 @@ void Thread::Dump(std::ostream &os) const
 }
 
 
-void Thread::InsertInFetchQueue(std::shared_ptr<Uop> uop)
+void Thread::InsertInFetchQueue(Uop *uop)
 {
 	// Sanity
 	assert(!uop->in_fetch_queue);
 
 	// Insert in queue
 	uop->in_fetch_queue = true;
-	uop->fetch_queue_iterator = fetch_queue.insert(fetch_queue.end(), uop);
+	fetch_queue.PushBack(uop);
 
 	// Increase occupancy of fetch queue or trace queue
 	if (uop->from_trace_cache)
@@ -135,17 +178,12 @@ void Thread::ExtractFromFetchQueue(Uop *uop)
 	// Sanity: uop must be in the fetch queue, and must be either the first
 	// or the last element in it.
 	assert(uop->in_fetch_queue);
-	assert(uop->fetch_queue_iterator != fetch_queue.end());
-	assert(fetch_queue.size() > 0);
-	assert(uop == fetch_queue.front().get() ||
-			uop == fetch_queue.back().get());
-	
-	// Save iterator
-	auto it = uop->fetch_queue_iterator;
+	assert(fetch_queue.getSize() > 0);
+	assert(uop == fetch_queue.Front() ||
+			uop == fetch_queue.Back());
 
 	// Mark uop as extracted
 	uop->in_fetch_queue = false;
-	uop->fetch_queue_iterator = fetch_queue.end();
 
 	// Decrease occupancy of fetch queue or trace queue
 	if (uop->from_trace_cache)
@@ -167,8 +205,11 @@ void Thread::ExtractFromFetchQueue(Uop *uop)
 		}
 	}
 
-	// Extract uop as last step, since uop may be freed here
-	fetch_queue.erase(it);
+	// Extract uop as last step
+	if (uop == fetch_queue.Front())
+		fetch_queue.PopFront();
+	else
+		fetch_queue.PopBack();
 }
 
 
@@ -181,7 +222,7 @@ void Thread::DumpFetchQueue(std::ostream &os) const
 
 	// Dump content
 	int index = 0;
-	for (auto &uop : fetch_queue)
+	for (Uop *uop : fetch_queue)
 	{
 		os << misc::fmt("%3d. ", index);
 		os << *uop << '\n';
@@ -189,7 +230,7 @@ void Thread::DumpFetchQueue(std::ostream &os) const
 	}
 
 	// Empty list
-	if (fetch_queue.empty())
+	if (fetch_queue.isEmpty())
 		os << "-Empty-\n";
 
 	// End
@@ -197,11 +238,12 @@ void Thread::DumpFetchQueue(std::ostream &os) const
 }
 
 
-void Thread::InsertInUopQueue(std::shared_ptr<Uop> uop)
+void Thread::InsertInUopQueue(Uop *uop)
 {
 	assert(!uop->in_uop_queue);
 	uop->in_uop_queue = true;
-	uop->uop_queue_iterator = uop_queue.insert(uop_queue.end(), uop);
+	uop->decode_when = cpu->getCycle();
+	uop_queue.PushBack(uop);
 }
 
 
@@ -210,18 +252,18 @@ void Thread::ExtractFromUopQueue(Uop *uop)
 	// Sanity: uop must be in the uop queue, and must be either the first
 	// or the last element in it.
 	assert(uop->in_uop_queue);
-	assert(uop_queue.size() > 0);
-	assert(uop == uop_queue.front().get() || uop_queue.back().get());
-
-	// Save iterator
-	auto it = uop->uop_queue_iterator;
+	assert(uop_queue.getSize() > 0);
+	assert(uop == uop_queue.Front() ||
+			uop == uop_queue.Back());
 
 	// Mark uop as extracted
 	uop->in_uop_queue = false;
-	uop->uop_queue_iterator = uop_queue.end();
 
-	// Extract uop as last step, since this may free it
-	uop_queue.erase(it);
+	// Extract uop as last step
+	if (uop == uop_queue.Front())
+		uop_queue.PopFront();
+	else
+		uop_queue.PopBack();
 }
 
 
@@ -234,7 +276,7 @@ void Thread::DumpUopQueue(std::ostream &os) const
 
 	// Dump content
 	int index = 0;
-	for (auto &uop : uop_queue)
+	for (Uop *uop : uop_queue)
 	{
 		os << misc::fmt("%3d. ", index);
 		os << *uop << '\n';
@@ -242,7 +284,7 @@ void Thread::DumpUopQueue(std::ostream &os) const
 	}
 
 	// Empty list
-	if (uop_queue.empty())
+	if (uop_queue.isEmpty())
 		os << "-Empty-\n";
 
 	// End
@@ -250,6 +292,20 @@ void Thread::DumpUopQueue(std::ostream &os) const
 }
 
 
+void Thread::RefillUopQueue()
+{
+	while (!replay_queue.isEmpty() &&
+			uop_queue.getSize() < Cpu::getUopQueueSize())
+	{
+		Uop *uop = replay_queue.Front();
+		assert(uop->in_replay_queue);
+		uop->in_replay_queue = false;
+		replay_queue.PopFront();
+		InsertInUopQueue(uop);
+	}
+}
+
+
 bool Thread::canInsertInReorderBuffer()
 {
 	switch (Cpu::getReorderBufferKind())
@@ -260,7 +316,7 @@ bool Thread::canInsertInReorderBuffer()
 		// Return whether the number of instructions in this thread's
 		// ROB is smaller than the ROB size configured by the user,
 		// which is specified as a per-thread ROB size.
-		return (int) reorder_buffer.size() <
+		return (int) reorder_buffer.getSize() <
 				Cpu::getReorderBufferSize();
 
 	case Cpu::ReorderBufferKindShared:
@@ -278,17 +334,20 @@ bool Thread::canInsertInReorderBuffer()
 }
 
 
-void Thread::InsertInReorderBuffer(std::shared_ptr<Uop> uop)
+void Thread::InsertInReorderBuffer(Uop *uop)
 {
 	// Sanity
 	assert(!uop->in_reorder_buffer);
 
 	// Insert into reorder buffer
 	uop->in_reorder_buffer = true;
-	uop->reorder_buffer_iterator = reorder_buffer.insert(reorder_buffer.end(), uop);
+	reorder_buffer.PushBack(uop);
 
 	// Increase per-core counter
 	core->incReorderBufferOccupancy();
+
+	// The front-end delivered the first uop after a recovery
+	recovering = false;
 }
 
 
@@ -297,18 +356,18 @@ void Thread::ExtractFromReorderBuffer(Uop *uop)
 	// Sanity: uop must be in the reorder buffer, and must be either the
 	// first or the last instruction in that queue.
 	assert(uop->in_reorder_buffer);
-	assert(reorder_buffer.size() > 0);
-	assert(uop == reorder_buffer.front().get() || reorder_buffer.back().get());
-
-	// Save iterator
-	auto it = uop->reorder_buffer_iterator;
+	assert(reorder_buffer.getSize() > 0);
+	assert(uop == reorder_buffer.Front() ||
+			uop == reorder_buffer.Back());
 
 	// Mark uop as extracted
 	uop->in_reorder_buffer = false;
-	uop->reorder_buffer_iterator = reorder_buffer.end();
 
-	// Extract uop as last step, since this may free it
-	reorder_buffer.erase(it);
+	// Extract uop as last step
+	if (uop == reorder_buffer.Front())
+		reorder_buffer.PopFront();
+	else
+		reorder_buffer.PopBack();
 
 	// Decrease per-core counter
 	core->decReorderBufferOccupancy();
@@ -327,7 +386,7 @@ void Thread::DumpReorderBuffer(std::ostream &os) const
 
 	// Dump content
 	int index = 0;
-	for (auto &uop : reorder_buffer)
+	for (Uop *uop : reorder_buffer)
 	{
 		// Instruction
 		os << misc::fmt("%3d. ", index);
@@ -360,7 +419,7 @@ void Thread::DumpReorderBuffer(std::ostream &os) const
 	}
 
 	// Empty list
-	if (reorder_buffer.empty())
+	if (reorder_buffer.isEmpty())
 		os << "-Empty-\n";
 
 	// End
@@ -378,7 +437,7 @@ bool Thread::canInsertInInstructionQueue()
 		// Return whether the number of instructions in this thread's IQ
 		// is smaller than the IQ size configured by the user, which is
 		// specified as a per-thread IQ size.
-		return (int) instruction_queue.size() <
+		return (int) instruction_queue.getSize() <
 				Cpu::getInstructionQueueSize();
 
 	case Cpu::InstructionQueueKindShared:
@@ -396,7 +455,7 @@ bool Thread::canInsertInInstructionQueue()
 }
 
 
-void Thread::InsertInInstructionQueue(std::shared_ptr<Uop> uop)
+void Thread::InsertInInstructionQueue(Uop *uop)
 {
 	// Sanity
 	assert(!uop->in_instruction_queue);
@@ -405,8 +464,11 @@ void Thread::InsertInInstructionQueue(std::shared_ptr<Uop> uop)
 
 	// Insert into instruction queue
 	uop->in_instruction_queue = true;
-	uop->instruction_queue_iterator = instruction_queue.insert(
-			instruction_queue.end(), uop);
+	instruction_queue.PushBack(uop);
+
+	// Uops with no pending input can issue right away
+	if (uop->ready)
+		InsertInReadyList(uop);
 
 	// Increase per-core counter
 	core->incInstructionQueueOccupancy();
@@ -420,21 +482,57 @@ void Thread::ExtractFromInstructionQueue(Uop *uop)
 	assert(!uop->in_store_queue);
 	assert(uop->in_instruction_queue);
 
-	// Save iterator
-	auto it = uop->instruction_queue_iterator;
-
 	// Mark uop as not present
 	uop->in_instruction_queue = false;
-	uop->instruction_queue_iterator = instruction_queue.end();
+	if (uop->in_ready_list)
+		ExtractFromReadyList(uop);
 	
-	// Remove from queue as the last step, as this may free the uop
-	instruction_queue.erase(it);
+	// Remove from queue as the last step
+	instruction_queue.Erase(uop);
 
 	// Decrease per-core counter
 	core->decInstructionQueueOccupancy();
 }
 
 
+static bool compareUopAge(const Uop *a, const Uop *b)
+{
+	return a->getId() < b->getId();
+}
+
+
+void Thread::InsertInReadyList(Uop *uop)
+{
+	// Sanity
+	assert(uop->in_instruction_queue);
+	assert(uop->ready);
+	assert(!uop->in_ready_list);
+
+	// Keep list sorted by age. Uops usually become ready in program
+	// order, so the insertion point is most often the tail.
+	auto it = ready_list.end();
+	if (!ready_list.empty() && compareUopAge(uop, ready_list.back()))
+		it = std::upper_bound(ready_list.begin(), ready_list.end(),
+				uop, compareUopAge);
+	ready_list.insert(it, uop);
+	uop->in_ready_list = true;
+}
+
+
+void Thread::ExtractFromReadyList(Uop *uop)
+{
+	// Find uop
+	assert(uop->in_ready_list);
+	auto it = std::lower_bound(ready_list.begin(), ready_list.end(),
+			uop, compareUopAge);
+	assert(it != ready_list.end() && *it == uop);
+
+	// Remove it
+	ready_list.erase(it);
+	uop->in_ready_list = false;
+}
+
+
 void Thread::DumpInstructionQueue(std::ostream &os) const
 {
 	// Title
@@ -444,7 +542,7 @@ void Thread::DumpInstructionQueue(std::ostream &os) const
 
 	// Dump content
 	int index = 0;
-	for (auto &uop : instruction_queue)
+	for (Uop *uop : instruction_queue)
 	{
 		os << misc::fmt("%3d. ", index);
 		os << *uop << '\n';
@@ -452,7 +550,7 @@ void Thread::DumpInstructionQueue(std::ostream &os) const
 	}
 
 	// Empty list
-	if (instruction_queue.empty())
+	if (instruction_queue.isEmpty())
 		os << "-Empty-\n";
 
 	// End
@@ -470,7 +568,7 @@ bool Thread::canInsertInLoadStoreQueue()
 		// Return whether the number of instructions in this thread's
 		// LSQ is smaller than the IQ size configured by the user, which
 		// is specified as a per-thread LSQ size
-		return (int) (load_queue.size() + store_queue.size()) <
+		return (int) (load_queue.getSize() + store_queue.getSize()) <
 				Cpu::getLoadStoreQueueSize();
 
 	case Cpu::LoadStoreQueueKindShared:
@@ -488,7 +586,7 @@ bool Thread::canInsertInLoadStoreQueue()
 }
 
 
-void Thread::InsertInLoadStoreQueue(std::shared_ptr<Uop> uop)
+void Thread::InsertInLoadStoreQueue(Uop *uop)
 {
 	// Sanity
 	assert(!uop->in_load_queue);
@@ -500,13 +598,13 @@ void Thread::InsertInLoadStoreQueue(std::shared_ptr<Uop> uop)
 
 	case Uinst::OpcodeLoad:
 
-		uop->load_queue_iterator = load_queue.insert(load_queue.end(), uop);
+		load_queue.PushBack(uop);
 		uop->in_load_queue = true;
 		break;
 
 	case Uinst::OpcodeStore:
 
-		uop->store_queue_iterator = store_queue.insert(store_queue.end(), uop);
+		store_queue.PushBack(uop);
 		uop->in_store_queue = true;
 		break;
 	
@@ -527,15 +625,11 @@ void Thread::ExtractFromLoadQueue(Uop *uop)
 	assert(!uop->in_store_queue);
 	assert(!uop->in_instruction_queue);
 
-	// Save iterator
-	auto it = uop->load_queue_iterator;
-
 	// Mark as not present in the queue
 	uop->in_load_queue = false;
-	uop->load_queue_iterator = load_queue.end();
 	
-	// Remove from queue as last step, as this may free uop
-	load_queue.erase(it);
+	// Remove from queue as last step
+	load_queue.Erase(uop);
 
 	// Decrease per-core counter
 	core->decLoadStoreQueueOccupancy();
@@ -549,15 +643,11 @@ void Thread::ExtractFromStoreQueue(Uop *uop)
 	assert(!uop->in_load_queue);
 	assert(uop->in_store_queue);
 
-	// Save iterator
-	auto it = uop->store_queue_iterator;
-
 	// Mark as not present in the queue
 	uop->in_store_queue = false;
-	uop->store_queue_iterator = store_queue.end();
 
-	// Remove from queue as last step, as this may free uop
-	store_queue.erase(it);
+	// Remove from queue as last step
+	store_queue.Erase(uop);
 
 	// Decrease per-core counter
 	core->decLoadStoreQueueOccupancy();
@@ -573,7 +663,7 @@ void Thread::DumpLoadStoreQueue(std::ostream &os) const
 
 	// Dump content
 	int index = 0;
-	for (auto &uop : load_queue)
+	for (Uop *uop : load_queue)
 	{
 		os << misc::fmt("%3d. ", index);
 		os << *uop << '\n';
@@ -581,7 +671,7 @@ void Thread::DumpLoadStoreQueue(std::ostream &os) const
 	}
 
 	// Empty list
-	if (load_queue.empty())
+	if (load_queue.isEmpty())
 		os << "-Empty-\n";
 
 	// End
@@ -594,7 +684,7 @@ void Thread::DumpLoadStoreQueue(std::ostream &os) const
 
 	// Dump content
 	index = 0;
-	for (auto &uop : store_queue)
+	for (Uop *uop : store_queue)
 	{
 		os << misc::fmt("%3d. ", index);
 		os << *uop << '\n';
@@ -602,7 +692,7 @@ void Thread::DumpLoadStoreQueue(std::ostream &os) const
 	}
 
 	// Empty list
-	if (store_queue.empty())
+	if (store_queue.isEmpty())
 		os << "-Empty-\n";
 
 	// End
@@ -21,16 +21,24 @@
 #define ARCH_X86_TIMING_THREAD_H
 
 #include <deque>
+#include <functional>
+#include <queue>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 #include <memory/Module.h>
 #include <arch/x86/emulator/Uinst.h>
 #include <arch/x86/emulator/Context.h>
 
 #include "Uop.h"
+#include "UopBuffer.h"
+#include "UopPool.h"
 #include "BranchPredictor.h"
+#include "MemoryDependencePredictor.h"
 #include "RegisterFile.h"
 #include "TraceCache.h"
+#include "UopCache.h"
 
 
 namespace x86
@@ -44,6 +52,33 @@ class Timing;
 /// X86 Thread
 class Thread
 {
+public:
+
+	/// Categories of commit slots in the CPI stack. Every cycle in which
+	/// the thread runs a context accounts for as many slots as the commit
+	/// width. Slots not used by a committed uop are charged to the reason
+	/// why the uop at the head of the reorder buffer could not commit.
+	enum CpiComponent
+	{
+		CpiComponentBase = 0,		// Slot used by a committed uop
+		CpiComponentFrontEndICache,	// Empty ROB, fetch waiting on instruction memory
+		CpiComponentFrontEndRecovery,	// Empty ROB after a mispeculation recovery
+		CpiComponentFrontEndTraceCache,	// Empty ROB after a trace cache miss
+		CpiComponentFrontEndOther,	// Empty ROB for any other reason
+		CpiComponentMemoryL1,		// Load at ROB head waiting on the L1 cache
+		CpiComponentMemoryL2,		// Load waiting on an intermediate cache
+		CpiComponentMemoryLlc,		// Load waiting on the last-level cache
+		CpiComponentMemoryDram,		// Load waiting on main memory
+		CpiComponentCoreFunctionalUnit,	// ROB head ready but not issued
+		CpiComponentCoreDependency,	// ROB head waiting on inputs or executing
+		CpiComponentCoreSmt,		// ROB head completed, slot used by another thread
+		CpiComponentBadSpeculation,	// ROB head on the wrong path
+		CpiComponentCount
+	};
+
+	/// String map for values of type CpiComponent
+	static const misc::StringMap cpi_component_map;
+
 private:
 
 	// Name, assigned in constructor
@@ -77,15 +112,25 @@ private:
 
 
 
+	//
+	// Uop pool
+	//
+
+	// Arena owning the uops of this thread
+	std::unique_ptr<UopPool> uop_pool;
+
+
+
+
 	//
 	// Fetch queue
 	//
 
 	// Fetch queue
-	std::list<std::shared_ptr<Uop>> fetch_queue;
+	UopBuffer fetch_queue;
 
 	// Insert a uop into the tail of the fetch queue
-	void InsertInFetchQueue(std::shared_ptr<Uop> uop);
+	void InsertInFetchQueue(Uop *uop);
 
 	// Extract a uop from the fetch queue. The uop must be located either
 	// at the head or at the tail of the fetch queue.
@@ -102,10 +147,10 @@ private:
 	//
 
 	// Uop queue
-	std::list<std::shared_ptr<Uop>> uop_queue;
+	UopBuffer uop_queue;
 
 	// Insert a uop into the tail of the uop queue
-	void InsertInUopQueue(std::shared_ptr<Uop> uop);
+	void InsertInUopQueue(Uop *uop);
 
 	// Extract a uop from the uop queue. The uop must be located either at
 	// the head or at the tail of the uop queue.
@@ -114,6 +159,15 @@ private:
 	// Dump content of uop queue
 	void DumpUopQueue(std::ostream &os = std::cout) const;
 
+	// Uops removed from the pipeline by a replay, in program order, that
+	// did not fit in the uop queue yet. They are older than any uop in the
+	// fetch queue, so decode stalls until they all entered the uop queue.
+	UopBuffer replay_queue;
+
+	// Move uops from the head of the replay queue into the uop queue,
+	// while the uop queue has free entries
+	void RefillUopQueue();
+
 
 
 
@@ -122,10 +176,10 @@ private:
 	//
 
 	// Reorder buffer
-	std::list<std::shared_ptr<Uop>> reorder_buffer;
+	UopBuffer reorder_buffer;
 
 	// Insert a uop into the tail of the reorder buffer
-	void InsertInReorderBuffer(std::shared_ptr<Uop> uop);
+	void InsertInReorderBuffer(Uop *uop);
 
 	// Determine whether a new uop can be inserted into this thread's
 	// reorder buffer, based on whether it is private or shared among
@@ -148,14 +202,21 @@ private:
 	//
 
 	// Instruction queue
-	std::list<std::shared_ptr<Uop>> instruction_queue;
+	UopBuffer instruction_queue;
 
 	// Insert a uop into the tail of the instruction queue
-	void InsertInInstructionQueue(std::shared_ptr<Uop> uop);
+	void InsertInInstructionQueue(Uop *uop);
 
 	// Remove a uop from the instruction queue. The uop must be currently
 	// present in said queue.
 	void ExtractFromInstructionQueue(Uop *uop);
+
+	// Uops in the instruction queue whose input registers are ready,
+	// sorted by age. The issue stage only traverses this list.
+	std::vector<Uop *> ready_list;
+
+	// Remove a uop from the ready list
+	void ExtractFromReadyList(Uop *uop);
 	
 	// Determine whether a new uop can be inserted into this thread's
 	// instruction queue, based on whether the queue was configured as
@@ -173,10 +234,10 @@ private:
 	//
 	
 	// Load queue
-	std::list<std::shared_ptr<Uop>> load_queue;
+	UopBuffer load_queue;
 
 	// Store queue
-	std::list<std::shared_ptr<Uop>> store_queue;
+	UopBuffer store_queue;
 
 	// Determine whether a new uop can be inserted into this thread's
 	// load-store queue, based on whether the queue was configured as
@@ -186,7 +247,7 @@ private:
 	// Insert a uop into the tail of the load-store queue (it is in fact
 	// inserted either at the tail of the load queue or the store queue,
 	// depending on the uop kind).
-	void InsertInLoadStoreQueue(std::shared_ptr<Uop> uop);
+	void InsertInLoadStoreQueue(Uop *uop);
 
 	// Remove a uop from the load queue. The uop must be currently present
 	// in said queue.
@@ -212,9 +273,15 @@ private:
 	// Trace cache
 	std::unique_ptr<TraceCache> trace_cache;
 
+	// Uop cache
+	std::unique_ptr<UopCache> uop_cache;
+
 	// Physical register file
 	std::unique_ptr<RegisterFile> register_file;
 
+	// Memory dependence predictor
+	std::unique_ptr<MemoryDependencePredictor> memory_dependence_predictor;
+
 
 
 
@@ -253,6 +320,169 @@ private:
 	// Cycle in which last micro-instruction committed
 	long long last_commit_cycle = 0;
 
+	// Set when no micro-instruction committed in a long time
+	bool commit_stalled = false;
+
+	// Set when the commit stage left the eviction of the context to the
+	// CPU, because cores were running in parallel
+	bool eviction_postponed = false;
+
+	// Set when the last fetch missed in the trace cache
+	bool trace_cache_missed = false;
+
+	// Set when the last fetch hit in the uop cache
+	bool uop_cache_hit = false;
+
+	// Fetch stalls until this cycle after switching from the uop cache to
+	// the instruction cache and decoders
+	long long uop_cache_switch_cycle = 0;
+
+	// Set when the pipeline is recovered from mispeculation, and cleared
+	// when the next uop enters the reorder buffer
+	bool recovering = false;
+
+	// Set when the commit stage found a wrong-path uop at the head of the
+	// reorder buffer in the current cycle
+	bool commit_recovered = false;
+
+
+
+
+	//
+	// Functional warming
+	//
+
+	// Physical address of the instruction cache block warmed last
+	unsigned warm_block_address = -1;
+
+
+
+
+	//
+	// Interval core model
+	//
+
+	// Cycle when a value becomes available in the interval core model. It
+	// is the maximum of an absolute cycle and, if the value depends on a
+	// load miss that did not complete yet, the cycle when that load
+	// completes plus a delay. A value depending on several outstanding
+	// misses keeps only the youngest one.
+	struct IntervalTime
+	{
+		// Absolute cycle
+		long long cycle = 0;
+
+		// Identifier of the outstanding load, or 0 if none
+		long long miss = 0;
+
+		// Cycles after the completion of the outstanding load
+		long long delay = 0;
+
+		// Return the later of two times
+		static IntervalTime Max(const IntervalTime &a,
+				const IntervalTime &b);
+
+		// Return the time a number of cycles later
+		IntervalTime Add(long long cycles) const;
+
+		// Replace the dependence on the outstanding load with the
+		// cycle when it completed
+		void Resolve(long long miss_cycle);
+	};
+
+	// Micro-instruction in the front-end or in the instruction window of
+	// the interval core model
+	struct IntervalUop
+	{
+		// Micro-instruction generated by the emulator
+		std::shared_ptr<Uinst> uinst;
+
+		// True for the first micro-instruction of a macro-instruction
+		bool first = false;
+
+		// Size of the macro-instruction, in its first micro-instruction
+		int mop_size = 0;
+
+		// Physical address of a memory micro-instruction
+		unsigned physical_address = 0;
+
+		// Instruction cache access that fetched the micro-instruction
+		long long fetch_access = 0;
+
+		// For loads, cycle when the address is available
+		IntervalTime address_time;
+
+		// Cycle when the result is available, computed at dispatch
+		IntervalTime complete_time;
+
+		// Data cache access of a load missing in the data cache, or 0 if
+		// not issued
+		long long memory_access = 0;
+
+		// For loads that did not complete at dispatch, identifiers of
+		// younger micro-instructions whose completion depends on this
+		// load
+		std::vector<long long> dependents;
+
+		// Uop used to look up and update the branch predictor, only
+		// for control micro-instructions. It is freed when the entry
+		// leaves the window.
+		Uop *uop = nullptr;
+
+		// True for a branch whose next address was mispredicted
+		bool mispredicted = false;
+	};
+
+	// Micro-instructions fetched but not dispatched yet
+	std::deque<IntervalUop> interval_front_end;
+
+	// Instruction window, with micro-instructions in program order until
+	// they commit
+	std::deque<IntervalUop> interval_window;
+
+	// Identifier of the micro-instruction at the head of the window. The
+	// identifiers of the following ones are consecutive, starting at 1.
+	long long interval_window_head = 1;
+
+	// Cycle when the value of each dependence is available
+	IntervalTime interval_dependence_time[Uinst::DepXmmLast + 1];
+
+	// Youngest store in the window writing each physical address
+	std::unordered_map<unsigned, long long> interval_stores;
+
+	// Loads whose data cache access is in flight
+	std::vector<long long> interval_misses;
+
+	// Loads waiting for their address or for a free data cache port or
+	// MSHR entry, as pairs of address cycle and identifier, oldest
+	// address first
+	std::priority_queue<std::pair<long long, long long>,
+			std::vector<std::pair<long long, long long>>,
+			std::greater<std::pair<long long, long long>>>
+			interval_waiting_loads;
+
+	// Number of bytes of macro-instructions in the front-end
+	int interval_fetch_queue_occupancy = 0;
+
+	// Set while a mispredicted branch is waiting to be resolved
+	bool interval_fetch_blocked = false;
+
+	// Cycle when fetch resumes after a mispredicted branch was resolved
+	long long interval_fetch_resume_cycle = 0;
+
+	// The thread has nothing to do before this cycle, unless an
+	// outstanding memory access completes or the scheduler runs
+	long long interval_wakeup_cycle = 0;
+
+	// Return the window entry of a micro-instruction
+	IntervalUop &getIntervalUop(long long id)
+	{
+		assert(id >= interval_window_head && id <
+				interval_window_head + (long long)
+				interval_window.size());
+		return interval_window[id - interval_window_head];
+	}
+
 
 
 
@@ -300,6 +530,23 @@ private:
 	// Number of mis-predicted branch micro-instructions
 	long long num_mispredicted_branches = 0;
 
+	// Number of loads that obtained their data from the store queue
+	long long num_forwarded_loads = 0;
+
+	// Number of loads that issued before an older store to the same
+	// address
+	long long num_memory_order_violations = 0;
+
+	// Number of micro-instructions replayed after memory order violations
+	long long num_replayed_uinsts = 0;
+
+	// Number of commit slots in every category of the CPI stack
+	long long cpi_stack[CpiComponentCount] = { };
+
+	// Number of committed micro-instructions when the CPI stack was last
+	// updated
+	long long cpi_stack_num_committed_uinsts = 0;
+
 
 
 
@@ -348,10 +595,24 @@ public:
 	/// Return true if there is no uop in the pipeline for this thread
 	bool isPipelineEmpty() const
 	{
-		return fetch_queue.empty()
-				&& uop_queue.empty()
-				&& reorder_buffer.empty();
+		return fetch_queue.isEmpty()
+				&& uop_queue.isEmpty()
+				&& replay_queue.isEmpty()
+				&& reorder_buffer.isEmpty()
+				&& interval_front_end.empty()
+				&& interval_window.empty();
 	}
+
+	/// Return true if there is no uop in the load and store queues
+	bool isLoadStoreQueueEmpty() const
+	{
+		return load_queue.isEmpty() && store_queue.isEmpty();
+	}
+
+	/// Insert a uop of the instruction queue into the list of uops that
+	/// are ready to issue. The register file calls this function when the
+	/// last pending input register of the uop is written.
+	void InsertInReadyList(Uop *uop);
 	
 	/// Dump a plain-text representation of the object into the given output
 	/// stream, or into the standard output if argument \a os is committed.
@@ -373,12 +634,21 @@ public:
 	// Register file
 	//
 
+	/// Return the thread's branch predictor
+	BranchPredictor *getBranchPredictor() const { return branch_predictor.get(); }
+
 	/// Return the thread's trace cache
 	TraceCache *getTraceCache() const { return trace_cache.get(); }
 
+	/// Return the thread's uop cache, or null if not present
+	UopCache *getUopCache() const { return uop_cache.get(); }
+
 	/// Return the thread's register file
 	RegisterFile *getRegisterFile() const { return register_file.get(); }
 
+	/// Return the pool owning the thread's uops
+	UopPool *getUopPool() const { return uop_pool.get(); }
+
 	/// Increment the number of writes to integer registers
 	void incNumIntegerRegisterWrites(int count = 1)
 	{
@@ -412,7 +682,9 @@ public:
 		FetchStallContext,		// No context mapped to thread
 		FetchStallSuspended,		// Mapped context is suspended
 		FetchStallFetchQueue,		// Fetch queue is full
-		FetchStallInstructionMemory	// Instruction memory is busy
+		FetchStallInstructionMemory,	// Instruction memory is busy
+		FetchStallDrain,		// Fetch stopped to drain pipeline
+		FetchStallUopCacheSwitch	// Switching from the uop cache
 	};
 
 	/// String map for values of type FetchStall
@@ -422,6 +694,11 @@ public:
 	/// fetch cycle.
 	void setFetchNeip(unsigned fetch_neip) { this->fetch_neip = fetch_neip; }
 
+	/// Restart fetch from the current instruction pointer of the allocated
+	/// context. This is needed after the context ran functionally outside
+	/// of the pipeline.
+	void ResetFetch();
+
 	/// Check whether an instruction can be fetch. If not, return the
 	/// reason why fetch is stalled.
 	FetchStall canFetch();
@@ -435,12 +712,18 @@ public:
 	///	instruction are considered to come from the trace cache (true)
 	///	or from instruction memory (false).
 	///
+	/// \param fetch_from_uop_cache
+	///	Flag indicating whether the uops come from the uop cache, in
+	///	which case they do not wait for the instruction memory access
+	///	and bypass the decoders.
+	///
 	/// \return
 	///	If any of the uops is a branch, the function returns that uop.
 	///	Otherwise, it returns the first uop created, or nullptr if no
 	///	uop was created.
 	///
-	Uop *FetchInstruction(bool fetch_from_trace_cache);
+	Uop *FetchInstruction(bool fetch_from_trace_cache,
+			bool fetch_from_uop_cache = false);
 
 	/// Try to fetch instruction from trace cache.
 	/// Return true if there was a hit and fetching succeeded.
@@ -450,13 +733,37 @@ public:
 	void Fetch();
 
 	/// Get the fetch queue size in number of uops
-	int getFetchQueueSize() const { return fetch_queue.size(); }
+	int getFetchQueueSize() const { return fetch_queue.getSize(); }
 
 	/// Get the fetch queue occupancy
 	int getFetchQueueOccupency() const { return fetch_queue_occupancy; }
 
 	/// Get the uop queue size in number of uops
-	int getUopQueueSize() const { return uop_queue.size(); }
+	int getUopQueueSize() const { return uop_queue.getSize(); }
+
+	/// Get the number of replayed uops waiting for room in the uop queue
+	int getReplayQueueSize() const { return replay_queue.getSize(); }
+
+
+
+
+	//
+	// Functional warming (ThreadWarm.cc)
+	//
+
+	/// Update the instruction and data caches, the branch predictor, and
+	/// the trace cache with an instruction that a context just executed
+	/// functionally, outside of the pipeline. No events are scheduled and
+	/// no statistics are recorded.
+	///
+	/// \param context
+	///	Context that executed the instruction. Its micro-instructions
+	///	are consumed.
+	///
+	/// \param eip
+	///	Address of the instruction
+	///
+	void Warm(Context *context, unsigned eip);
 
 
 
@@ -511,6 +818,12 @@ public:
 	// Issue stage (ThreadIssue.cc)
 	//
 
+	/// Check the older stores in the store queue before issuing \a load.
+	/// Return false if the load must wait for a store. Otherwise, \a store
+	/// is set to the store that forwards its data to the load, or to null
+	/// if the load reads the memory hierarchy.
+	bool canIssueLoad(Uop *load, Uop *&store);
+
 	/// Issue \a quantum instructions for the thread's load queue, returning
 	/// the remaining qunatum.
 	int IssueLoadQueue(int quantum);
@@ -528,6 +841,12 @@ public:
 	/// The function returns the remaining quantum.
 	int IssueInstructionQueue(int quantum);
 
+	/// Check the younger loads of every store resolved since the last
+	/// call. If a load issued before an older store to the same address,
+	/// the load and all younger uops are replayed. The core calls this
+	/// function at the beginning of the issue stage.
+	void CheckMemoryOrder();
+
 
 
 
@@ -544,6 +863,99 @@ public:
 	/// Commit stage for the thread
 	void Commit(int quantum);
 
+	/// Return true if the thread has not committed any instruction in so
+	/// long that the pipeline is most likely in a deadlock
+	bool isCommitStalled() const { return commit_stalled; }
+
+	/// Return the reason why the uop at the head of the reorder buffer
+	/// cannot commit, as a category of the CPI stack.
+	CpiComponent getCommitStall();
+
+	/// Charge the commit slots of \a num_cycles cycles to the CPI stack,
+	/// only the current one by default. The core calls this function
+	/// after the commit stage of all threads.
+	void UpdateCpiStack(long long num_cycles = 1);
+
+	/// Return the CPI stack category of a load waiting for an access to
+	/// \a address, as given by the level of the memory hierarchy starting
+	/// at \a module that is serving it.
+	static CpiComponent getMemoryCpiComponent(mem::Module *module,
+			unsigned address);
+
+
+
+
+	//
+	// Interval core model (ThreadInterval.cc)
+	//
+
+	// In the interval model, the emulator executes instructions as they
+	// are fetched, so only the correct path enters the pipeline. A
+	// mispredicted branch stops fetch until it resolves. Dispatched
+	// micro-instructions enter an instruction window of the size of the
+	// reorder buffer. The completion cycle of each one is computed once at
+	// dispatch, from the completion of its producers and the latency of
+	// its functional unit, or of the data cache for loads that hit.
+	// Loads that miss in the data cache, mispredicted branches, and
+	// instruction cache misses are the events that interrupt the flow of
+	// instructions. Uops depending on an outstanding load miss are
+	// resolved when it completes. Between events, the thread does not
+	// run its stages.
+
+	/// Fetch the instructions of one cache block up to the first taken
+	/// branch, executing them in the emulator
+	void IntervalFetch();
+
+	/// Return whether a micro-instruction can be moved into the window,
+	/// or the reason why not
+	DispatchStall canIntervalDispatch();
+
+	/// Move fetched micro-instructions into the instruction window,
+	/// computing their completion cycle
+	void IntervalDispatch();
+
+	/// Restart fetch if \a entry is a mispredicted branch whose
+	/// completion cycle is known
+	void IntervalResolveBranch(IntervalUop &entry);
+
+	/// Access the data cache for the load with identifier \a id, whose
+	/// address is available. Return false if the cache can't take the
+	/// access in this cycle.
+	bool IntervalIssueLoad(long long id);
+
+	/// Record that the load with identifier \a id obtained its data in
+	/// cycle \a cycle, resolving the uops that depend on it
+	void IntervalCompleteLoad(long long id, long long cycle);
+
+	/// Complete loads whose data cache access finished, and issue loads
+	/// waiting for the data cache
+	void IntervalMemory();
+
+	/// Commit completed micro-instructions from the head of the window.
+	/// Stores access the data cache at this point.
+	void IntervalCommit();
+
+	/// Return the next cycle in which the stages of the thread can make
+	/// progress, not counting the completion of outstanding loads and
+	/// instruction cache accesses
+	long long getIntervalWakeupCycle();
+
+	/// Return the reason why the micro-instruction at the head of the
+	/// window cannot commit, as a category of the CPI stack.
+	CpiComponent getIntervalCommitStall();
+
+	/// Run one cycle of the interval model for the thread
+	void RunInterval();
+
+	/// Return the first cycle in which the thread needs to run in the
+	/// interval model. Until then, it only loses dispatch and commit slots,
+	/// unless a memory access completes.
+	long long getIntervalNextCycle() const;
+
+	/// Account for the dispatch and commit slots lost in \a num_cycles
+	/// cycles following the current one, in which the thread does not run
+	void SkipInterval(long long num_cycles);
+
 
 
 	
@@ -557,6 +969,9 @@ public:
 	/// Squash mispredicted instructions in uop queue
 	void RecoverUopQueue();
 
+	/// Squash mispredicted instructions in the replay queue
+	void RecoverReplayQueue();
+
 	/// Squash mispredicted instructions in instruction queue
 	void RecoverInstructionQueue();
 
@@ -572,6 +987,12 @@ public:
 	/// Recover from mispeculation
 	void Recover();
 
+	/// Replay \a uop and all younger uops after a memory order violation.
+	/// The uops are removed from the pipeline and inserted back at the head
+	/// of the uop queue, where they are dispatched again. Uops that do not
+	/// fit in the uop queue wait in the replay queue.
+	void Replay(Uop *uop);
+
 
 
 
@@ -602,6 +1023,10 @@ public:
 	/// be such a context currently allocated.
 	void EvictContext();
 
+	/// Evict the context if the commit stage postponed its eviction while
+	/// cores were running in parallel.
+	void EvictPostponedContext();
+
 	/// Scheduling actions for all contexts currently mapped to a thread.
 	void Schedule();
 
@@ -681,6 +1106,20 @@ public:
 	/// Return the number of mispredicted branches
 	long long getNumMispredictedBranches() const { return num_mispredicted_branches; }
 
+	/// Return the number of loads that obtained their data from the store
+	/// queue
+	long long getNumForwardedLoads() const { return num_forwarded_loads; }
+
+	/// Return the number of memory order violations
+	long long getNumMemoryOrderViolations() const { return num_memory_order_violations; }
+
+	/// Return the number of uops replayed after memory order violations
+	long long getNumReplayedUinsts() const { return num_replayed_uinsts; }
+
+	/// Return the array of commit slots charged to each category of the
+	/// CPI stack, indexed by values of type CpiComponent
+	const long long *getCpiStack() const { return cpi_stack; }
+
 	/// Return the number of reads in the reorder buffers
 	long long getNumReorderBufferReads() const { return num_reorder_buffer_reads; }
 
@@ -42,33 +42,20 @@ bool Thread::canCommit()
 	if (!context || !context->getState(Context::StateRunning))
 		last_commit_cycle = cycle;
 	if (cycle - last_commit_cycle > 1000000)
-	{
-		// Show warning
-		misc::Warning("[x86] %s: simulation ended due to a commit "
-				"stall.\n\t%s",
-				name.c_str(),
-				commit_stall_error);
-
-		// Print state of the core
-		std::cerr << *core;
-
-		// Finish simulation
-		esim::Engine *esim_engine = esim::Engine::getInstance();
-		esim_engine->Finish("Stall");
-	}
+		commit_stalled = true;
 
 	// If there is no instruction in the reorder buffer, cannot commit
-	if (reorder_buffer.empty())
+	if (reorder_buffer.isEmpty())
 		return false;
 
 	// Get instruction from reorder buffer head
-	assert(reorder_buffer.size());
-	std::shared_ptr<Uop> uop = reorder_buffer.front();
+	assert(reorder_buffer.getSize());
+	Uop *uop = reorder_buffer.Front();
 	assert(uop->getThread() == this);
 
 	// Stores must be ready in order to commit
 	if (uop->getOpcode() == Uinst::OpcodeStore)
-		return register_file->isUopReady(uop.get());
+		return register_file->isUopReady(uop);
 	
 	// Instructions other than stores must be completed
 	return uop->completed;
@@ -84,8 +71,8 @@ void Thread::Commit(int quantum)
 	while (quantum && canCommit())
 	{
 		// Get instruction at the head of the reorder buffer
-		assert(reorder_buffer.size());
-		std::shared_ptr<Uop> uop = reorder_buffer.front();
+		assert(reorder_buffer.getSize());
+		Uop *uop = reorder_buffer.Front();
 		assert(uop->getThread() == this);
 
 		// Recover from mispeculation if this is the first uop of a
@@ -101,6 +88,7 @@ void Thread::Commit(int quantum)
 		{
 			// Clear thread structures
 			Recover();
+			commit_recovered = true;
 
 			// Nothing left to do
 			return;
@@ -108,19 +96,19 @@ void Thread::Commit(int quantum)
 	
 		// Free physical registers
 		assert(!uop->speculative_mode);
-		register_file->CommitUop(uop.get());
+		register_file->CommitUop(uop);
 		
 		// Branches update branch predictor and BTB
 		if (uop->getFlags() & Uinst::FlagCtrl)
 		{
-			branch_predictor->Update(uop.get());
-			branch_predictor->UpdateBtb(uop.get());
+			branch_predictor->Update(uop);
+			branch_predictor->UpdateBtb(uop);
 			num_btb_writes++;
 		}
 
 		// Trace cache
 		if (TraceCache::isPresent())
-			trace_cache->RecordUop(uop.get());
+			trace_cache->RecordUop(uop);
 
 		// Save last commit cycle
 		last_commit_cycle = cpu->getCycle();
@@ -128,9 +116,8 @@ void Thread::Commit(int quantum)
 		// Record committed uops of each kind
 		incNumCommittedUinsts(uop->getOpcode());
 		core->incNumCommittedUinsts(uop->getOpcode());
-		cpu->incNumCommittedUinsts(uop->getOpcode());
 		if (!uop->mop_index)
-			cpu->incNumCommittedInstructions();
+			core->incNumCommittedInstructions();
 
 		// Trace cache statistics
 		if (uop->from_trace_cache)
@@ -142,17 +129,20 @@ void Thread::Commit(int quantum)
 			// Number of branches
 			num_branches++;
 			core->incNumBranches();
-			cpu->incNumBranches();
 
 			// Mispredicted branches
 			if (uop->neip != uop->predicted_neip)
 			{
 				num_mispredicted_branches++;
 				core->incNumMispredictedBranches();
-				cpu->incNumMispredictedBranches();
 			}
 		}
 
+		// Pipeline trace
+		PipelineTrace *pipeline_trace = cpu->getPipelineTrace();
+		if (pipeline_trace)
+			pipeline_trace->RecordUop(uop, cpu->getCycle(), false);
+
 		// Trace
 		if (Timing::trace)
 		{
@@ -169,7 +159,8 @@ void Thread::Commit(int quantum)
 		}
 
 		// Remove uop from reorder buffer
-		ExtractFromReorderBuffer(uop.get());
+		ExtractFromReorderBuffer(uop);
+		uop_pool->FreeIfNotQueued(uop);
 
 		// Consume quantum
 		quantum--;
@@ -180,9 +171,129 @@ void Thread::Commit(int quantum)
 	}
 
 	// If context eviction signal is activated and pipeline is empty,
-	// deallocate context.
+	// deallocate context. Eviction updates the emulator state, so it is
+	// left to the CPU while cores run in parallel.
 	if (context->evict_signal && isPipelineEmpty())
-		EvictContext();
+	{
+		if (cpu->isRunningInParallel())
+			eviction_postponed = true;
+		else
+			EvictContext();
+	}
+}
+
+
+Thread::CpiComponent Thread::getMemoryCpiComponent(mem::Module *module,
+		unsigned address)
+{
+	// Find serving module, which is the module closest to main memory
+	// where the directory entry of the block is locked by an access
+	mem::Module *serving_module = nullptr;
+	for (; module; module = module->getLowModuleServingAddress(address))
+	{
+		int set;
+		int way;
+		int tag;
+		mem::Cache::BlockState state;
+		if (module->FindBlock(address, set, way, tag, state) &&
+				module->getDirectory()->isEntryLocked(set, way))
+			serving_module = module;
+	}
+
+	// The access completed, but the uop did not write back yet
+	if (!serving_module)
+		return Thread::CpiComponentMemoryL1;
+
+	// Main memory
+	if (serving_module->getType() == mem::Module::TypeMainMemory)
+		return Thread::CpiComponentMemoryDram;
+
+	// First-level cache
+	if (serving_module->getLevel() <= 1)
+		return Thread::CpiComponentMemoryL1;
+
+	// Last-level cache, when its lower module is main memory
+	mem::Module *low_module = serving_module->
+			getLowModuleServingAddress(address);
+	if (!low_module || low_module->getType() ==
+			mem::Module::TypeMainMemory)
+		return Thread::CpiComponentMemoryLlc;
+
+	// Intermediate cache
+	return Thread::CpiComponentMemoryL2;
+}
+
+
+Thread::CpiComponent Thread::getCommitStall()
+{
+	// Interval model
+	if (Cpu::getCoreModel() == Cpu::CoreModelInterval)
+		return getIntervalCommitStall();
+
+	// Wrong-path uop found at the head of the reorder buffer in this cycle
+	if (commit_recovered)
+		return CpiComponentBadSpeculation;
+
+	// Empty reorder buffer, the front-end did not deliver any uop
+	if (reorder_buffer.isEmpty())
+	{
+		if (recovering)
+			return CpiComponentFrontEndRecovery;
+		if (instruction_module->isInFlightAccess(fetch_access))
+			return CpiComponentFrontEndICache;
+		if (TraceCache::isPresent() && trace_cache_missed)
+			return CpiComponentFrontEndTraceCache;
+		return CpiComponentFrontEndOther;
+	}
+
+	// Uop at the head of the reorder buffer
+	Uop *uop = reorder_buffer.Front();
+	if (uop->speculative_mode)
+		return CpiComponentBadSpeculation;
+
+	// The uop could commit, but other threads used the commit bandwidth
+	if (uop->completed || (uop->getOpcode() == Uinst::OpcodeStore &&
+			uop->ready))
+		return CpiComponentCoreSmt;
+
+	// Waiting in the instruction queue or load-store queue
+	if (!uop->issued)
+		return uop->ready ? CpiComponentCoreFunctionalUnit :
+				CpiComponentCoreDependency;
+
+	// Load waiting for the memory hierarchy
+	if (uop->getOpcode() == Uinst::OpcodeLoad)
+		return getMemoryCpiComponent(data_module,
+				uop->physical_address);
+
+	// Executing in a functional unit, holding back its dependent uops
+	return CpiComponentCoreDependency;
+}
+
+
+void Thread::UpdateCpiStack(long long num_cycles)
+{
+	// Only cycles running a context are accounted for. A context whose
+	// eviction was postponed is considered evicted already.
+	if (context && context->getState(Context::StateRunning) &&
+			!eviction_postponed)
+	{
+		// Slots used by committed uops
+		int num_used_slots = num_committed_uinsts -
+				cpi_stack_num_committed_uinsts;
+		long long num_slots = Cpu::getCommitWidth() * num_cycles;
+		assert(num_used_slots <= num_slots);
+		cpi_stack[CpiComponentBase] += num_used_slots;
+
+		// Remaining slots
+		if (num_used_slots < num_slots)
+			cpi_stack[getCommitStall()] += num_slots -
+					num_used_slots;
+	}
+
+	// Reset state for the next cycle
+	cpi_stack_num_committed_uinsts = num_committed_uinsts;
+	commit_recovered = false;
 }
 
 }
@@ -27,19 +27,25 @@ namespace x86
 
 void Thread::Decode()
 {
+	// Uops waiting in the replay queue are older than those in the fetch
+	// queue, so they enter the uop queue first
+	RefillUopQueue();
+	if (!replay_queue.isEmpty())
+		return;
+
 	for (int i = 0; i < Cpu::getDecodeWidth(); i++)
 	{
 		// Empty fetch queue
-		if (fetch_queue.size() == 0)
+		if (fetch_queue.getSize() == 0)
 			break;
 
 		// Full uop queue
-		if ((int) uop_queue.size() >= Cpu::getUopQueueSize())
+		if ((int) uop_queue.getSize() >= Cpu::getUopQueueSize())
 			break;
 
 		// Get uop at the head of the fetch queue
-		assert(!fetch_queue.empty());
-		std::shared_ptr<Uop> uop = fetch_queue.front();
+		assert(!fetch_queue.isEmpty());
+		Uop *uop = fetch_queue.Front();
 
 		// If instructions come from the trace cache, i.e., are located
 		// in the trace cache queue, copy all of them into the uop queue
@@ -49,18 +55,18 @@ void Thread::Decode()
 			do
 			{
 				// Extract from fetch queue
-				ExtractFromFetchQueue(uop.get());
+				ExtractFromFetchQueue(uop);
 
 				// Add to uop queue
 				InsertInUopQueue(uop);
 
 				// Done if fetch queue empty
-				if (fetch_queue.empty())
+				if (fetch_queue.isEmpty())
 					break;
 
 				// Next instruction from fetch queue
-				assert(fetch_queue.size());
-				uop = fetch_queue.front();
+				assert(fetch_queue.getSize());
+				uop = fetch_queue.Front();
 
 			} while (uop->from_trace_cache);
 
@@ -68,6 +74,41 @@ void Thread::Decode()
 			break;
 		}
 
+		// Uops coming from the uop cache bypass the decoders. All of
+		// them are copied into the uop queue in one single decode slot,
+		// as long as there is room for them.
+		if (uop->from_uop_cache)
+		{
+			do
+			{
+				// Extract from fetch queue
+				ExtractFromFetchQueue(uop);
+
+				// Add to uop queue
+				InsertInUopQueue(uop);
+
+				// Trace
+				Timing::trace << misc::fmt("x86.inst "
+						"id=%lld "
+						"core=%d "
+						"stg=\"dec\"\n",
+						uop->getIdInCore(),
+						core->getId());
+
+				// Done if fetch queue empty or uop queue full
+				if (fetch_queue.isEmpty() || (int) uop_queue.getSize()
+						>= Cpu::getUopQueueSize())
+					break;
+
+				// Next instruction from fetch queue
+				uop = fetch_queue.Front();
+
+			} while (uop->from_uop_cache);
+
+			// Consume entire decode width
+			break;
+		}
+
 		// Decode one macro-instruction coming from a block in the
 		// instruction cache. If the cache access finished, extract it
 		// from the fetch queue.
@@ -77,11 +118,15 @@ void Thread::Decode()
 			do
 			{
 				// Extract from fetch queue
-				ExtractFromFetchQueue(uop.get());
+				ExtractFromFetchQueue(uop);
 
 				// Add to uop queue
 				InsertInUopQueue(uop);
 
+				// Record the macro-instruction in the uop cache
+				if (UopCache::isPresent() && !uop->mop_index)
+					uop_cache->Record(uop->eip, uop->mop_count);
+
 				// Trace
 				Timing::trace << misc::fmt("x86.inst "
 						"id=%lld "
@@ -91,12 +136,12 @@ void Thread::Decode()
 						core->getId());
 
 				// Done if no more instructions in fetch queue
-				if (fetch_queue.empty())
+				if (fetch_queue.isEmpty())
 					break;
 
 				// Next instruction in fetch queue
-				assert(fetch_queue.size());
-				uop = fetch_queue.front();
+				assert(fetch_queue.getSize());
+				uop = fetch_queue.Front();
 
 			} while (uop->mop_index);
 		}
@@ -28,9 +28,11 @@ namespace x86
 
 Thread::DispatchStall Thread::canDispatch()
 {
-	// Uop queue is empty
-	if (uop_queue.empty())
-		return !context || !context->getState(Context::StateRunning) ?
+	// Uop queue is empty. A context whose eviction was postponed counts
+	// as already evicted.
+	if (uop_queue.isEmpty())
+		return !context || eviction_postponed ||
+				!context->getState(Context::StateRunning) ?
 				DispatchStallContext :
 				DispatchStallUopQueue;
 	
@@ -39,7 +41,7 @@ Thread::DispatchStall Thread::canDispatch()
 		return DispatchStallReorderBuffer;
 
 	// Instruction queue is full
-	Uop *uop = uop_queue.front().get();
+	Uop *uop = uop_queue.Front();
 	if (!(uop->getFlags() & Uinst::FlagMem) && !canInsertInInstructionQueue())
 		return DispatchStallInstructionQueue;
 
@@ -70,19 +72,23 @@ int Thread::Dispatch(int quantum)
 		}
 
 		// Get uop at the head of the uop queue
-		assert(uop_queue.size());
-		std::shared_ptr<Uop> uop = uop_queue.front();
+		assert(uop_queue.getSize());
+		Uop *uop = uop_queue.Front();
 	
 		// Extract uop from uop queue
-		ExtractFromUopQueue(uop.get());
+		ExtractFromUopQueue(uop);
 		
 		// Register renaming
-		register_file->Rename(uop.get());
+		register_file->Rename(uop);
 		
-		// Insert in reorder buffer
+		// Insert in reorder buffer. Replayed uops were already counted
+		// as written into the queues and as dispatched the first time.
 		InsertInReorderBuffer(uop);
-		core->incNumReorderBufferWrites();
-		num_reorder_buffer_writes++;
+		if (!uop->replayed)
+		{
+			core->incNumReorderBufferWrites();
+			num_reorder_buffer_writes++;
+		}
 
 		// Mark instruction as dispatched
 		uop->dispatched = true;
@@ -92,16 +98,23 @@ int Thread::Dispatch(int quantum)
 		if (!(uop->getFlags() & Uinst::FlagMem))
 		{
 			InsertInInstructionQueue(uop);
-			core->incNumInstructionQueueWrites();
-			num_instruction_queue_writes++;
+			if (!uop->replayed)
+			{
+				core->incNumInstructionQueueWrites();
+				num_instruction_queue_writes++;
+			}
 		}
 		
 		// Memory instructions into the load-store queue
 		if ((uop->getFlags() & Uinst::FlagMem))
 		{
+			memory_dependence_predictor->Dispatch(uop);
 			InsertInLoadStoreQueue(uop);
-			core->incNumLoadStoreQueueWrites();
-			num_load_store_queue_writes++;
+			if (!uop->replayed)
+			{
+				core->incNumLoadStoreQueueWrites();
+				num_load_store_queue_writes++;
+			}
 		}
 
 		// Increment dispatch slot
@@ -110,15 +123,14 @@ int Thread::Dispatch(int quantum)
 				DispatchStallUsed, 1);
 
 		// Increment number of dispatched micro-instructions of each
-		// kind
-		incNumDispatchedUinsts(uop->getOpcode());
-		core->incNumDispatchedUinsts(uop->getOpcode());
-		cpu->incNumDispatchedUinsts(uop->getOpcode());
-		
-		// Increment number of dispatched micro-instructions coming from
-		// the trace cache
-		if (uop->from_trace_cache)
-			trace_cache->incNumDispatchedUinsts();
+		// kind, and of those coming from the trace cache
+		if (!uop->replayed)
+		{
+			incNumDispatchedUinsts(uop->getOpcode());
+			core->incNumDispatchedUinsts(uop->getOpcode());
+			if (uop->from_trace_cache)
+				trace_cache->incNumDispatchedUinsts();
+		}
 		
 		// Another instruction dispatched, update quantum
 		quantum--;
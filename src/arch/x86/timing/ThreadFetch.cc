@@ -21,6 +21,7 @@
 #include "Timing.h"
 #include "Thread.h"
 #include "TraceCache.h"
+#include "UopCache.h"
 
 
 namespace x86
@@ -40,15 +41,27 @@ Thread::FetchStall Thread::canFetch()
 	if (context->evict_signal)
 		return FetchStallContext;
 
+	// Fetch is stalled while switching from the uop cache to the decoders
+	if (cpu->getCycle() < uop_cache_switch_cycle)
+		return FetchStallUopCacheSwitch;
+
+	// Fetch must not have been stopped to drain the pipeline, and no
+	// magic instruction must be waiting for the pipeline to drain
+	Emulator *emulator = Emulator::getInstance();
+	if (cpu->isFetchStopped() || emulator->hasMagicCommands())
+		return FetchStallDrain;
+
 	// Fetch queue must have not exceeded the limit of stored bytes to be
 	// able to store new macro-instructions.
 	if (fetch_queue_occupancy >= Cpu::getFetchQueueSize())
 		return FetchStallFetchQueue;
 
 	// If the next fetch address belongs to a new block, cache system
-	// must be accessible to read it.
+	// must be accessible to read it, unless the uops are found in the uop
+	// cache.
 	unsigned block_address = fetch_neip & ~(instruction_module->getBlockSize() - 1);
-	if (block_address != fetch_block_address)
+	if (block_address != fetch_block_address &&
+			!(uop_cache && uop_cache->Contains(fetch_neip)))
 	{
 		mem::Mmu *mmu = context->getMmu();
 		mem::Mmu::Space *mmu_space = context->getMmuSpace();
@@ -64,7 +77,21 @@ Thread::FetchStall Thread::canFetch()
 }
 
 
-Uop *Thread::FetchInstruction(bool fetch_from_trace_cache)
+void Thread::ResetFetch()
+{
+	// Nothing to do if no context is allocated
+	if (!context)
+		return;
+
+	// Next fetch starts at the context's instruction pointer, and accesses
+	// instruction memory again.
+	fetch_neip = context->getRegs().getEip();
+	fetch_block_address = -1;
+}
+
+
+Uop *Thread::FetchInstruction(bool fetch_from_trace_cache,
+		bool fetch_from_uop_cache)
 {
 	// A context must be mapped
 	assert(context);
@@ -105,7 +132,7 @@ Uop *Thread::FetchInstruction(bool fetch_from_trace_cache)
 		std::shared_ptr<Uinst> uinst = context->ExtractUinst();
 
 		// Create uop
-		auto uop = misc::new_shared<Uop>(this,
+		auto uop = uop_pool->NewUop(this,
 				context,
 				uinst);
 
@@ -118,9 +145,11 @@ Uop *Thread::FetchInstruction(bool fetch_from_trace_cache)
 		// Other fields
 		uop->eip = fetch_eip;
 		uop->from_trace_cache = fetch_from_trace_cache;
+		uop->from_uop_cache = fetch_from_uop_cache;
 		uop->speculative_mode = speculative_mode;
 		uop->fetch_address = fetch_address;
-		uop->fetch_access = fetch_access;
+		uop->fetch_access = fetch_from_uop_cache ? 0 : fetch_access;
+		uop->fetch_when = cpu->getCycle();
 		uop->neip = context->getRegs().getEip();
 		uop->predicted_neip = fetch_neip;
 		uop->target_neip = context->getTargetEip();
@@ -176,7 +205,7 @@ Uop *Thread::FetchInstruction(bool fetch_from_trace_cache)
 
 		// Select as returned uop
 		if (!ret_uop || (uop->getFlags() & Uinst::FlagCtrl))
-			ret_uop = uop.get();
+			ret_uop = uop;
 
 		// Insert into fetch queue
 		InsertInFetchQueue(uop);
@@ -186,6 +215,8 @@ Uop *Thread::FetchInstruction(bool fetch_from_trace_cache)
 		num_fetched_uinsts++;
 		if (fetch_from_trace_cache)
 			trace_cache->incNumFetchedUinsts();
+		if (fetch_from_uop_cache)
+			uop_cache->incNumFetchedUinsts();
 
 		// Next micro-instruction
 		uinst_index++;
@@ -232,6 +263,11 @@ bool Thread::FetchFromTraceCache()
 		fetch_neip = entry->getMacroInstruction(i);
 		Uop *uop = FetchInstruction(true);
 
+		// Stop right after a magic instruction. Fetch resumes at the
+		// instruction following it, already set in 'fetch_neip'.
+		if (Emulator::getInstance()->hasMagicCommands())
+			return true;
+
 		// No uop was produced by this macro-instruction
 		if (!uop)
 			continue;
@@ -258,13 +294,44 @@ void Thread::Fetch()
 	assert(context);
 
 	// Try to fetch from trace cache first
-	if (TraceCache::isPresent() && FetchFromTraceCache())
-		return;
+	if (TraceCache::isPresent())
+	{
+		trace_cache_missed = !FetchFromTraceCache();
+		if (!trace_cache_missed)
+			return;
+	}
 	
+	// Look up the uop cache. When fetch switches from the uop cache to the
+	// instruction cache and decoders, it stalls for a few cycles. The
+	// stall is not counted as a lookup, since the uop cache is looked up
+	// again for the same address once the penalty is paid.
+	bool fetch_from_uop_cache = false;
+	if (UopCache::isPresent())
+	{
+		if (uop_cache_hit && !uop_cache->Contains(fetch_neip))
+		{
+			uop_cache->incNumSwitches();
+			uop_cache_hit = false;
+			if (UopCache::getSwitchPenalty())
+			{
+				uop_cache_switch_cycle = cpu->getCycle() +
+						UopCache::getSwitchPenalty();
+				return;
+			}
+		}
+		fetch_from_uop_cache = uop_cache->Lookup(fetch_neip);
+		uop_cache_hit = fetch_from_uop_cache;
+	}
+
 	// If new block to fetch is not the same as the previously fetched (and
-	// stored) block, access the instruction cache.
+	// stored) block, access the instruction cache. Uops found in the uop
+	// cache don't need it, and they make the next fetch from the decoders
+	// access the instruction cache again, since the block might have been
+	// evicted in the meantime.
 	unsigned block_address = fetch_neip & ~(instruction_module->getBlockSize() - 1);
-	if (block_address != fetch_block_address)
+	if (fetch_from_uop_cache)
+		fetch_block_address = -1;
+	else if (block_address != fetch_block_address)
 	{
 		// Translate address
 		mem::Mmu *mmu = context->getMmu();
@@ -288,9 +355,12 @@ void Thread::Fetch()
 	}
 
 	// Fetch all instructions within the block up to the first predict-taken
-	// branch
-	while ((fetch_neip & ~(instruction_module->getBlockSize() - 1))
-			== block_address)
+	// branch. Uops from the uop cache are fetched from one window.
+	unsigned fetch_mask = fetch_from_uop_cache ?
+			~(UopCache::getWindowSize() - 1) :
+			~(instruction_module->getBlockSize() - 1);
+	unsigned fetch_base = fetch_neip & fetch_mask;
+	while ((fetch_neip & fetch_mask) == fetch_base)
 	{
 		// If instruction caused context to suspend or finish
 		if (!context->getState(Context::StateRunning))
@@ -305,11 +375,16 @@ void Thread::Fetch()
 		// point, we use it to decode instruction now and insert uops
 		// into the fetch queue. However, the fetch queue occupancy is
 		// increased with the macro-instruction size.
-		Uop *uop = FetchInstruction(false);
+		Uop *uop = FetchInstruction(false, fetch_from_uop_cache);
 
 		// Invalid x86 instruction, no forward progress in loop
 		if (!context->getInstruction()->getSize())
 			break;
+
+		// Stop right after a magic instruction, so that the pipeline
+		// drains behind it
+		if (Emulator::getInstance()->hasMagicCommands())
+			break;
 		
 		// No uop was produced by this macro-instruction
 		if (!uop)
@@ -0,0 +1,630 @@
+/*
+ *  Multi2Sim
+ *  Copyright (C) 2015  Rafael Ubal (ubal@ece.neu.edu)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <algorithm>
+#include <climits>
+
+#include "Alu.h"
+#include "Cpu.h"
+#include "Thread.h"
+
+
+namespace x86
+{
+
+void Thread::IntervalFetch()
+{
+	// There must be a running context that is not being evicted
+	if (!context || !context->getState(Context::StateRunning) ||
+			context->evict_signal)
+		return;
+
+	// Fetch must not have been stopped to drain the pipeline
+	Emulator *emulator = Emulator::getInstance();
+	if (cpu->isFetchStopped() || emulator->hasMagicCommands())
+		return;
+
+	// A mispredicted branch blocks the front-end until it is resolved in
+	// the window, and the pipeline is refilled after that
+	if (interval_fetch_blocked ||
+			cpu->getCycle() < interval_fetch_resume_cycle)
+		return;
+
+	// Fetch queue full
+	if (interval_fetch_queue_occupancy >= Cpu::getFetchQueueSize())
+		return;
+
+	// Access the instruction cache for a new block
+	mem::Mmu *mmu = context->getMmu();
+	mem::Mmu::Space *mmu_space = context->getMmuSpace();
+	unsigned eip = context->getRegs().getEip();
+	unsigned block_address = eip & ~(instruction_module->getBlockSize() - 1);
+	if (block_address != fetch_block_address)
+	{
+		unsigned physical_address = mmu->TranslateVirtualAddress(
+				mmu_space, eip);
+		if (!instruction_module->canAccess(physical_address))
+			return;
+		fetch_block_address = block_address;
+		fetch_address = physical_address;
+		fetch_access = instruction_module->Access(
+				mem::Module::AccessLoad,
+				physical_address);
+		num_btb_reads++;
+	}
+
+	// Execute instructions of the block up to the first taken branch. The
+	// emulator runs ahead of the timing model, so only the correct path is
+	// fetched.
+	while ((eip & ~(instruction_module->getBlockSize() - 1)) ==
+			block_address &&
+			interval_fetch_queue_occupancy < Cpu::getFetchQueueSize())
+	{
+		// Run emulation
+		context->Execute();
+		int mop_size = context->getInstruction()->getSize();
+		unsigned neip = context->getRegs().getEip();
+
+		// Create the micro-instructions of the macro-instruction. An
+		// instruction that created none is represented by a 'nop'.
+		if (!context->getNumUinsts())
+			context->newUinst(Uinst::OpcodeNop, 0, 0, 0, 0, 0, 0, 0);
+		int num_uinsts = context->getNumUinsts();
+		bool taken = false;
+		for (int uinst_index = 0; context->getNumUinsts(); uinst_index++)
+		{
+			// New entry
+			interval_front_end.emplace_back();
+			IntervalUop &entry = interval_front_end.back();
+			entry.uinst = context->ExtractUinst();
+			entry.first = !uinst_index;
+			entry.mop_size = uinst_index ? 0 : mop_size;
+			entry.fetch_access = fetch_access;
+
+			// Physical address of memory accesses
+			if (entry.uinst->getFlags() & Uinst::FlagMem)
+				entry.physical_address =
+						mmu->TranslateVirtualAddress(
+						mmu_space,
+						entry.uinst->getAddress());
+
+			// Stats
+			cpu->incNumFetchedUinsts();
+			num_fetched_uinsts++;
+
+			// Only control micro-instructions access the branch
+			// predictor
+			if (!(entry.uinst->getFlags() & Uinst::FlagCtrl))
+				continue;
+
+			// Look up BTB and branch predictor with a uop, which is
+			// kept until commit to update the predictor
+			entry.uop = uop_pool->NewUop(this, context, entry.uinst);
+			Uop *uop = entry.uop;
+			uop->mop_count = num_uinsts;
+			uop->mop_size = mop_size;
+			uop->mop_id = uop->getId() - uinst_index;
+			uop->mop_index = uinst_index;
+			uop->eip = eip;
+			uop->neip = neip;
+			uop->target_neip = context->getTargetEip();
+			unsigned target = branch_predictor->LookupBtb(uop);
+			BranchPredictor::Prediction prediction =
+					branch_predictor->Lookup(uop);
+			taken = prediction == BranchPredictor::PredictionTaken
+					&& target;
+			uop->predicted_neip = taken ? target : eip + mop_size;
+
+			// A mispredicted branch stops fetch
+			if (uop->predicted_neip != uop->neip)
+			{
+				entry.mispredicted = true;
+				interval_fetch_blocked = true;
+			}
+		}
+		interval_fetch_queue_occupancy += mop_size;
+		eip = neip;
+
+		// Stop fetching after a taken or mispredicted branch, an invalid
+		// instruction, a magic instruction, or when the context stops
+		// running
+		if (taken || interval_fetch_blocked || !mop_size ||
+				emulator->hasMagicCommands() ||
+				!context->getState(Context::StateRunning))
+			break;
+	}
+}
+
+
+Thread::IntervalTime Thread::IntervalTime::Max(const IntervalTime &a,
+		const IntervalTime &b)
+{
+	IntervalTime time;
+	time.cycle = std::max(a.cycle, b.cycle);
+	if (a.miss == b.miss)
+	{
+		time.miss = a.miss;
+		time.delay = std::max(a.delay, b.delay);
+	}
+	else
+	{
+		const IntervalTime &younger = a.miss > b.miss ? a : b;
+		time.miss = younger.miss;
+		time.delay = younger.delay;
+	}
+	return time;
+}
+
+
+Thread::IntervalTime Thread::IntervalTime::Add(long long cycles) const
+{
+	IntervalTime time = *this;
+	time.cycle += cycles;
+	if (time.miss)
+		time.delay += cycles;
+	return time;
+}
+
+
+void Thread::IntervalTime::Resolve(long long miss_cycle)
+{
+	cycle = std::max(cycle, miss_cycle + delay);
+	miss = 0;
+	delay = 0;
+}
+
+
+void Thread::IntervalResolveBranch(IntervalUop &entry)
+{
+	// A resolved mispredicted branch restarts fetch in the cycle after it
+	// completes, and the front-end refills from the instruction cache
+	if (entry.mispredicted && !entry.complete_time.miss)
+	{
+		interval_fetch_blocked = false;
+		interval_fetch_resume_cycle = entry.complete_time.cycle + 1;
+		fetch_block_address = -1;
+	}
+}
+
+
+bool Thread::IntervalIssueLoad(long long id)
+{
+	// The data cache must accept the access
+	IntervalUop &entry = getIntervalUop(id);
+	assert(!entry.address_time.miss);
+	if (!data_module->canAccess(entry.physical_address))
+		return false;
+
+	// A hit completes after the latency of the data cache. The access
+	// still goes through the memory hierarchy to update its state.
+	int set;
+	int way;
+	int tag;
+	mem::Cache::BlockState state;
+	bool hit = data_module->FindBlock(entry.physical_address, set, way,
+			tag, state) && !data_module->isInFlightAddress(
+			entry.physical_address);
+	long long access = data_module->Access(mem::Module::AccessLoad,
+			entry.physical_address);
+	if (hit)
+	{
+		IntervalCompleteLoad(id, cpu->getCycle() +
+				data_module->getDataLatency());
+		return true;
+	}
+
+	// A miss is a long-latency event, completing when the access finishes
+	entry.memory_access = access;
+	interval_misses.push_back(id);
+	return true;
+}
+
+
+void Thread::IntervalCompleteLoad(long long id, long long cycle)
+{
+	// Completion of the load
+	IntervalUop &entry = getIntervalUop(id);
+	assert(entry.complete_time.miss == id);
+	entry.complete_time.miss = 0;
+	entry.complete_time.cycle = std::max(cycle, entry.address_time.cycle);
+	entry.memory_access = 0;
+	cycle = entry.complete_time.cycle;
+
+	// Dependences produced by this load
+	for (IntervalTime &time : interval_dependence_time)
+	{
+		if (time.miss == id)
+			time.Resolve(cycle);
+	}
+
+	// Micro-instructions that depend on this load. Loads that were
+	// waiting for their address are issued now.
+	std::vector<long long> dependents;
+	dependents.swap(entry.dependents);
+	for (long long dependent_id : dependents)
+	{
+		IntervalUop &dependent = getIntervalUop(dependent_id);
+		if (dependent.complete_time.miss == dependent_id)
+		{
+			assert(dependent.address_time.miss == id);
+			dependent.address_time.Resolve(cycle);
+			interval_waiting_loads.emplace(
+					dependent.address_time.cycle,
+					dependent_id);
+		}
+		else
+		{
+			assert(dependent.complete_time.miss == id);
+			dependent.complete_time.Resolve(cycle);
+			IntervalResolveBranch(dependent);
+		}
+	}
+
+	// The window may make progress
+	interval_wakeup_cycle = cpu->getCycle();
+}
+
+
+Thread::DispatchStall Thread::canIntervalDispatch()
+{
+	// Window full
+	if ((int) interval_window.size() >= Cpu::getReorderBufferSize())
+		return DispatchStallReorderBuffer;
+
+	// The instruction must have been fetched
+	if (interval_front_end.empty() || instruction_module->isInFlightAccess(
+			interval_front_end.front().fetch_access))
+		return context ? DispatchStallUopQueue : DispatchStallContext;
+
+	// Dispatch slot available
+	return DispatchStallUsed;
+}
+
+
+void Thread::IntervalDispatch()
+{
+	long long cycle = cpu->getCycle();
+	for (int quantum = Cpu::getDispatchWidth(); quantum; quantum--)
+	{
+		// Check if we can dispatch
+		DispatchStall stall = canIntervalDispatch();
+		if (stall != DispatchStallUsed)
+		{
+			core->incDispatchStall(stall, quantum);
+			break;
+		}
+
+		// Move to window
+		interval_window.push_back(std::move(interval_front_end.front()));
+		interval_front_end.pop_front();
+		IntervalUop &entry = interval_window.back();
+		long long id = interval_window_head + interval_window.size() - 1;
+		interval_fetch_queue_occupancy -= entry.mop_size;
+
+		// Cycle when all inputs are available
+		Uinst *uinst = entry.uinst.get();
+		IntervalTime time;
+		time.cycle = cycle + 1;
+		for (int j = 0; j < Uinst::MaxIDeps; j++)
+		{
+			int dep = uinst->getIDep(j);
+			if (dep > 0 && dep <= Uinst::DepXmmLast)
+				time = IntervalTime::Max(time,
+						interval_dependence_time[dep]);
+		}
+
+		// Loads obtain their data from the youngest older store to the
+		// same address in the window, if any, or from the data cache
+		// once their address is available. Other uops complete after
+		// the latency of their functional unit. Stores and prefetches
+		// access memory at commit.
+		Uinst::Opcode opcode = uinst->getOpcode();
+		if (opcode == Uinst::OpcodeLoad)
+		{
+			entry.address_time = time;
+			auto it = interval_stores.find(entry.physical_address);
+			if (it != interval_stores.end())
+			{
+				IntervalUop &store = getIntervalUop(it->second);
+				entry.complete_time = IntervalTime::Max(time,
+						store.complete_time).Add(
+						MemoryDependencePredictor::
+						getStoreForwardLatency());
+				num_forwarded_loads++;
+				core->incNumForwardedLoads();
+			}
+			else
+			{
+				entry.complete_time.cycle = time.cycle;
+				entry.complete_time.miss = id;
+				if (time.miss)
+					getIntervalUop(time.miss).dependents
+							.push_back(id);
+				else
+					interval_waiting_loads.emplace(time.cycle,
+							id);
+			}
+		}
+		else
+		{
+			entry.complete_time = time.Add(Alu::getLatency(opcode));
+			if (opcode == Uinst::OpcodeStore)
+				interval_stores[entry.physical_address] = id;
+		}
+
+		// Wait for the outstanding load that the result depends on
+		if (entry.complete_time.miss && entry.complete_time.miss != id)
+			getIntervalUop(entry.complete_time.miss).dependents
+					.push_back(id);
+		IntervalResolveBranch(entry);
+
+		// Become the producer of the output dependences
+		for (int j = 0; j < Uinst::MaxODeps; j++)
+		{
+			int dep = uinst->getODep(j);
+			if (dep > 0 && dep <= Uinst::DepXmmLast)
+				interval_dependence_time[dep] =
+						entry.complete_time;
+		}
+
+		// Stats
+		core->incDispatchStall(DispatchStallUsed, 1);
+		incNumDispatchedUinsts(opcode);
+		core->incNumDispatchedUinsts(opcode);
+		incNumIssuedUinsts(opcode);
+		core->incNumIssuedUinsts(opcode);
+		num_reorder_buffer_writes++;
+		core->incNumReorderBufferWrites();
+	}
+}
+
+
+void Thread::IntervalMemory()
+{
+	// Complete loads whose data cache access finished
+	long long cycle = cpu->getCycle();
+	std::vector<long long> completed;
+	for (unsigned i = 0; i < interval_misses.size();)
+	{
+		long long id = interval_misses[i];
+		if (data_module->isInFlightAccess(getIntervalUop(id)
+				.memory_access))
+		{
+			i++;
+			continue;
+		}
+		completed.push_back(id);
+		interval_misses[i] = interval_misses.back();
+		interval_misses.pop_back();
+	}
+	std::sort(completed.begin(), completed.end());
+	for (long long id : completed)
+		IntervalCompleteLoad(id, cycle);
+
+	// Issue loads whose address is available, in the order in which their
+	// address became available
+	while (!interval_waiting_loads.empty() &&
+			interval_waiting_loads.top().first <= cycle &&
+			IntervalIssueLoad(interval_waiting_loads.top().second))
+		interval_waiting_loads.pop();
+
+	// Dispatch resumes when the instruction cache delivers the block of
+	// the uop at the head of the front-end
+	if (cycle < interval_wakeup_cycle &&
+			canIntervalDispatch() == DispatchStallUsed)
+		interval_wakeup_cycle = cycle;
+}
+
+
+void Thread::IntervalCommit()
+{
+	// Sanity check, as in the detailed model
+	long long cycle = cpu->getCycle();
+	if (!context || !context->getState(Context::StateRunning))
+		last_commit_cycle = cycle;
+	if (cycle - last_commit_cycle > 1000000)
+		commit_stalled = true;
+
+	// Commit completed uops in program order
+	for (int i = 0; i < Cpu::getCommitWidth() && !interval_window.empty();
+			i++)
+	{
+		// Uop at the head must be complete
+		IntervalUop &entry = interval_window.front();
+		if (entry.complete_time.miss || entry.complete_time.cycle > cycle)
+			break;
+
+		// Stores and prefetches access the data cache, without waiting
+		// for the access to complete
+		Uinst::Opcode opcode = entry.uinst->getOpcode();
+		if (opcode == Uinst::OpcodeStore || opcode ==
+				Uinst::OpcodePrefetch)
+		{
+			if (!data_module->canAccess(entry.physical_address))
+				break;
+			data_module->Access(opcode == Uinst::OpcodeStore ?
+					mem::Module::AccessStore :
+					mem::Module::AccessLoad,
+					entry.physical_address);
+		}
+
+		// The store stops forwarding data to younger loads
+		if (opcode == Uinst::OpcodeStore)
+		{
+			auto it = interval_stores.find(entry.physical_address);
+			if (it != interval_stores.end() && it->second ==
+					interval_window_head)
+				interval_stores.erase(it);
+		}
+
+		// Branches update branch predictor and BTB
+		Uop *uop = entry.uop;
+		if (uop)
+		{
+			branch_predictor->Update(uop);
+			branch_predictor->UpdateBtb(uop);
+			num_btb_writes++;
+			num_branches++;
+			core->incNumBranches();
+			if (uop->neip != uop->predicted_neip)
+			{
+				num_mispredicted_branches++;
+				core->incNumMispredictedBranches();
+			}
+			uop_pool->FreeIfNotQueued(uop);
+		}
+
+		// Record committed uops
+		last_commit_cycle = cycle;
+		incNumCommittedUinsts(opcode);
+		core->incNumCommittedUinsts(opcode);
+		if (entry.first)
+			core->incNumCommittedInstructions();
+		num_reorder_buffer_reads++;
+		core->incNumReorderBufferReads();
+
+		// Remove from window
+		interval_window.pop_front();
+		interval_window_head++;
+	}
+
+	// Evict context once the pipeline drained
+	if (context && context->evict_signal && isPipelineEmpty())
+	{
+		EvictContext();
+		fetch_block_address = -1;
+	}
+}
+
+
+long long Thread::getIntervalWakeupCycle()
+{
+	// Commit of the uop at the head of the window, unless it waits for an
+	// outstanding load
+	long long cycle = cpu->getCycle();
+	long long wakeup_cycle = LLONG_MAX;
+	if (!interval_window.empty() &&
+			!interval_window.front().complete_time.miss)
+		wakeup_cycle = std::max(cycle + 1,
+				interval_window.front().complete_time.cycle);
+
+	// Dispatch into a window with free entries, and eviction of the
+	// context. Loads are issued and completed every cycle regardless, and
+	// uops waiting for the instruction cache wake up the thread in
+	// IntervalMemory().
+	if (canIntervalDispatch() == DispatchStallUsed ||
+			(context && context->evict_signal))
+		return cycle + 1;
+
+	// Fetch, unless blocked by a mispredicted branch or by a full fetch
+	// queue, which dispatch drains. A thread without a context is woken up
+	// by the scheduler.
+	if (context && !interval_fetch_blocked &&
+			interval_fetch_queue_occupancy <
+			Cpu::getFetchQueueSize())
+		wakeup_cycle = std::min(wakeup_cycle, std::max(cycle + 1,
+				interval_fetch_resume_cycle));
+	return wakeup_cycle;
+}
+
+
+Thread::CpiComponent Thread::getIntervalCommitStall()
+{
+	// Empty window, the front-end did not deliver any uop
+	if (interval_window.empty())
+	{
+		if (interval_fetch_blocked || cpu->getCycle() <=
+				interval_fetch_resume_cycle)
+			return CpiComponentFrontEndRecovery;
+		if (instruction_module->isInFlightAccess(fetch_access))
+			return CpiComponentFrontEndICache;
+		return CpiComponentFrontEndOther;
+	}
+
+	// Load waiting for the memory hierarchy
+	IntervalUop &entry = interval_window.front();
+	if (entry.complete_time.miss == interval_window_head &&
+			!entry.address_time.miss)
+		return getMemoryCpiComponent(data_module,
+				entry.physical_address);
+
+	// Store waiting for the data cache
+	if (!entry.complete_time.miss && entry.complete_time.cycle <=
+			cpu->getCycle())
+		return CpiComponentMemoryL1;
+
+	// Waiting for inputs or for a functional unit
+	return CpiComponentCoreDependency;
+}
+
+
+void Thread::RunInterval()
+{
+	// Outstanding loads complete in any cycle
+	IntervalMemory();
+
+	// Between events, the state of the pipeline does not change, and the
+	// thread only accounts for the lost dispatch and commit slots
+	if (cpu->getCycle() >= interval_wakeup_cycle)
+	{
+		// Stages in reverse order
+		if (context)
+			IntervalCommit();
+		IntervalDispatch();
+		IntervalFetch();
+		interval_wakeup_cycle = getIntervalWakeupCycle();
+	}
+	else
+	{
+		core->incDispatchStall(canIntervalDispatch(),
+				Cpu::getDispatchWidth());
+	}
+	UpdateCpiStack();
+}
+
+
+long long Thread::getIntervalNextCycle() const
+{
+	// Stages of the thread
+	long long next_cycle = interval_wakeup_cycle;
+
+	// Loads waiting to be issued to the data cache
+	if (!interval_waiting_loads.empty())
+		next_cycle = std::min(next_cycle,
+				interval_waiting_loads.top().first);
+
+	// The CPI stack category of an empty window changes once fetch
+	// resumes after a mispredicted branch
+	if (interval_fetch_resume_cycle >= cpu->getCycle())
+		next_cycle = std::min(next_cycle,
+				interval_fetch_resume_cycle + 1);
+	return next_cycle;
+}
+
+
+void Thread::SkipInterval(long long num_cycles)
+{
+	// The state of the thread does not change in these cycles, so it
+	// loses the same slots as in the current one
+	core->incDispatchStall(canIntervalDispatch(),
+			Cpu::getDispatchWidth() * num_cycles);
+	UpdateCpiStack(num_cycles);
+}
+
+}
@@ -27,6 +27,72 @@
 namespace x86
 {
 
+// Return true if the memory accesses of two uops have any byte in common
+static bool isOverlapping(Uop *a, Uop *b)
+{
+	return a->physical_address < b->physical_address +
+			b->getUinst()->getSize() &&
+			b->physical_address < a->physical_address +
+			a->getUinst()->getSize();
+}
+
+
+// Return true if the memory access of uop 'a' includes all bytes accessed by
+// uop 'b'
+static bool isContained(Uop *a, Uop *b)
+{
+	return a->physical_address <= b->physical_address &&
+			a->physical_address + a->getUinst()->getSize() >=
+			b->physical_address + b->getUinst()->getSize();
+}
+
+
+bool Thread::canIssueLoad(Uop *load, Uop *&store)
+{
+	// Loads ignore older stores
+	store = nullptr;
+	MemoryDependencePredictor::Kind kind =
+			MemoryDependencePredictor::getKind();
+	if (kind == MemoryDependencePredictor::KindNone)
+		return true;
+
+	// Traverse older stores, from oldest to youngest
+	for (Uop *uop : store_queue)
+	{
+		// Done with older stores
+		if (uop->getId() > load->getId())
+			break;
+
+		// The address of a store is resolved when it is ready. A
+		// conservative load waits for all older stores, and a load in a
+		// store set waits for the last store of the set.
+		if (!register_file->isUopReady(uop))
+		{
+			if (kind == MemoryDependencePredictor::KindConservative ||
+					(kind == MemoryDependencePredictor::KindStoreSet &&
+					uop->getId() == load->store_set_dependence))
+				return false;
+			continue;
+		}
+
+		// Youngest resolved store writing to the loaded address
+		if (isOverlapping(uop, load))
+			store = uop;
+	}
+
+	// A store writing only part of the loaded bytes cannot forward them.
+	// The load waits until the store leaves the store queue.
+	if (store && !isContained(store, load))
+	{
+		store = nullptr;
+		return false;
+	}
+
+	// Load can issue
+	return true;
+}
+
+
 int Thread::IssueLoadQueue(int quantum)
 {
 	// List iterators
@@ -37,25 +103,41 @@ int Thread::IssueLoadQueue(int quantum)
 	while (it != e && quantum > 0)
 	{
 		// Get the uop and forward iterator
-		std::shared_ptr<Uop> uop = *it;
+		Uop *uop = *it;
 		++it;
 
 		// If the uop is not ready, skip it
-		if (!register_file->isUopReady(uop.get()))
+		if (!register_file->isUopReady(uop))
+			continue;
+
+		// Check older stores
+		Uop *store;
+		if (!canIssueLoad(uop, store))
 			continue;
 
 		// Check that memory system is accessible
-		if (!data_module->canAccess(uop->physical_address))
+		if (!store && !data_module->canAccess(uop->physical_address))
 			continue;
 
 		// Remove uop from load queue
-		ExtractFromLoadQueue(uop.get());
-
-		// Access memory system
-		cpu->MemoryAccess(data_module,
-				mem::Module::AccessLoad,
-				uop->physical_address,
-				uop);
+		ExtractFromLoadQueue(uop);
+
+		// Take data from the store queue, or access memory system
+		if (store)
+		{
+			uop->forwarding_store = store->getId();
+			core->InsertInEventQueue(uop, MemoryDependencePredictor::
+					getStoreForwardLatency());
+			num_forwarded_loads++;
+			core->incNumForwardedLoads();
+		}
+		else
+		{
+			cpu->MemoryAccess(data_module,
+					mem::Module::AccessLoad,
+					uop->physical_address,
+					uop);
+		}
 
 		// Mark uop as issued
 		uop->issued = true;
@@ -64,7 +146,6 @@ int Thread::IssueLoadQueue(int quantum)
 		// Increment the number of issued instructions of this kind
 		incNumIssuedUinsts(uop->getOpcode());
 		core->incNumIssuedUinsts(uop->getOpcode());
-		cpu->incNumIssuedUinsts(uop->getOpcode());
 
 		// Increment number of reads from load-store-queue
 		num_load_store_queue_reads++;
@@ -112,7 +193,7 @@ int Thread::IssueStoreQueue(int quantum)
 	while (it != e && quantum > 0)
 	{
 		// Get the uop and forward iterator
-		std::shared_ptr<Uop> uop = *it;
+		Uop *uop = *it;
 		++it;
 
 		// Sanity
@@ -127,7 +208,7 @@ int Thread::IssueStoreQueue(int quantum)
 			break;
 
 		// Remove store from store queue
-		ExtractFromStoreQueue(uop.get());
+		ExtractFromStoreQueue(uop);
 
 		// Issue store to memory system
 		cpu->MemoryAccess(data_module,
@@ -142,7 +223,6 @@ int Thread::IssueStoreQueue(int quantum)
 		// Increment the number of issued instructions of this kind
 		incNumIssuedUinsts(uop->getOpcode());
 		core->incNumIssuedUinsts(uop->getOpcode());
-		cpu->incNumIssuedUinsts(uop->getOpcode());
 
 		// Increment number of reads from load-store-queue
 		num_load_store_queue_reads++;
@@ -185,36 +265,34 @@ int Thread::IssueLoadStoreQueue(int quantum)
 
 int Thread::IssueInstructionQueue(int quantum)
 {
-	// List iterators
-	auto it = instruction_queue.begin();
-	auto e = instruction_queue.end();
-
-	// Traverse list
-	while (it != e && quantum > 0)
+	// Traverse the uops of the instruction queue whose inputs are ready,
+	// in the same order as they are found in the instruction queue.
+	unsigned index = 0;
+	while (index < ready_list.size() && quantum > 0)
 	{
-		// Get the uop and forward iterator
-		std::shared_ptr<Uop> uop = *it;
-		++it;
+		// Get the uop
+		Uop *uop = ready_list[index];
 
 		// Sanity
 		assert(!(uop->getFlags() & Uinst::FlagMem));
-
-		// If the uop is not ready, skip it
-		if (!register_file->isUopReady(uop.get()))
-			continue;
+		assert(register_file->isUopReady(uop));
 
 		// Run the instruction in its corresponding functional unit in
 		// the ALU. If the instruction does not require a functional
 		// unit, a latency of 1 is returned by ALU::Reserve(). If there
 		// is no functional unit available, it returns 0.
 		Alu *alu = core->getAlu();
-		int latency = alu->Reserve(uop.get());
+		int latency = alu->Reserve(uop);
 		if (!latency)
+		{
+			index++;
 			continue;
+		}
 
 		// Instruction was successfully issued, remove from instruction
-		// queue.
-		ExtractFromInstructionQueue(uop.get());
+		// queue. This also removes it from the ready list, so the next
+		// uop takes its index.
+		ExtractFromInstructionQueue(uop);
 
 		// Instruction has been issued
 		uop->issued = true;
@@ -227,7 +305,6 @@ int Thread::IssueInstructionQueue(int quantum)
 		// Increment the number of issued instructions of this kind
 		incNumIssuedUinsts(uop->getOpcode());
 		core->incNumIssuedUinsts(uop->getOpcode());
-		cpu->incNumIssuedUinsts(uop->getOpcode());
 
 		// Increment number of reads from instruction queue
 		num_instruction_queue_reads++;
@@ -264,5 +341,63 @@ int Thread::IssueInstructionQueue(int quantum)
 	return quantum;
 }
 
+
+void Thread::CheckMemoryOrder()
+{
+	// Loads only issue before older unresolved stores when speculating
+	MemoryDependencePredictor::Kind kind =
+			MemoryDependencePredictor::getKind();
+	if (kind == MemoryDependencePredictor::KindNone ||
+			kind == MemoryDependencePredictor::KindConservative)
+		return;
+
+	// Stores resolved since the last check, from oldest to youngest
+	for (;;)
+	{
+		// Find next store
+		Uop *store = nullptr;
+		for (Uop *uop : store_queue)
+		{
+			if (!uop->memory_order_checked &&
+					register_file->isUopReady(uop))
+			{
+				store = uop;
+				break;
+			}
+		}
+
+		// No more stores
+		if (!store)
+			break;
+		store->memory_order_checked = true;
+
+		// Find the oldest younger load that issued without the data of
+		// this store, reading either memory or an older store
+		Uop *load = nullptr;
+		for (Uop *uop : reorder_buffer)
+		{
+			if (uop->getId() > store->getId() &&
+					uop->getOpcode() == Uinst::OpcodeLoad &&
+					uop->issued &&
+					uop->forwarding_store < store->getId() &&
+					isOverlapping(store, uop))
+			{
+				load = uop;
+				break;
+			}
+		}
+
+		// No violation
+		if (!load)
+			continue;
+
+		// Train predictor and replay the load
+		num_memory_order_violations++;
+		core->incNumMemoryOrderViolations();
+		memory_dependence_predictor->Update(store, load);
+		Replay(load);
+	}
+}
+
 }
 
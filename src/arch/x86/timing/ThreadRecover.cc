@@ -27,10 +27,10 @@ namespace x86
 void Thread::RecoverFetchQueue()
 {
 	// Keep squashing instructions from tail
-	while (fetch_queue.size())
+	while (fetch_queue.getSize())
 	{
 		// Get uop from the tail
-		std::shared_ptr<Uop> uop = fetch_queue.back();
+		Uop *uop = fetch_queue.Back();
 		assert(uop->getThread() == this);
 
 		// Stop if this uop is not in speculative mode anymore
@@ -38,7 +38,12 @@ void Thread::RecoverFetchQueue()
 			break;
 
 		// Remove from fetch queue
-		ExtractFromFetchQueue(uop.get());
+		ExtractFromFetchQueue(uop);
+
+		// Pipeline trace
+		PipelineTrace *pipeline_trace = cpu->getPipelineTrace();
+		if (pipeline_trace)
+			pipeline_trace->RecordUop(uop, cpu->getCycle(), true);
 
 		// Trace
 		if (Timing::trace)
@@ -54,6 +59,9 @@ void Thread::RecoverFetchQueue()
 			// Keep uop for later
 			cpu->InsertInTraceList(uop);
 		}
+
+		// Free uop
+		uop_pool->FreeIfNotQueued(uop);
 	}
 
 	// Sanity
@@ -65,10 +73,10 @@ void Thread::RecoverFetchQueue()
 void Thread::RecoverUopQueue()
 {
 	// Keep squashing uops from the queue
-	while (uop_queue.size())
+	while (uop_queue.getSize())
 	{
 		// Get uop from the back
-		std::shared_ptr<Uop> uop = uop_queue.back();
+		Uop *uop = uop_queue.Back();
 		assert(uop->getThread() == this);
 
 		// Stop if uop is not in speculative mode
@@ -76,7 +84,12 @@ void Thread::RecoverUopQueue()
 			break;
 
 		// Remove it from uop queue
-		ExtractFromUopQueue(uop.get());
+		ExtractFromUopQueue(uop);
+
+		// Pipeline trace
+		PipelineTrace *pipeline_trace = cpu->getPipelineTrace();
+		if (pipeline_trace)
+			pipeline_trace->RecordUop(uop, cpu->getCycle(), true);
 
 		// Trace
 		if (Timing::trace)
@@ -92,6 +105,52 @@ void Thread::RecoverUopQueue()
 			// Keep uop for later
 			cpu->InsertInTraceList(uop);
 		}
+
+		// Free uop
+		uop_pool->FreeIfNotQueued(uop);
+	}
+}
+
+
+void Thread::RecoverReplayQueue()
+{
+	// Keep squashing uops from the queue
+	while (replay_queue.getSize())
+	{
+		// Get uop from the back
+		Uop *uop = replay_queue.Back();
+		assert(uop->getThread() == this);
+
+		// Stop if uop is not in speculative mode
+		if (!uop->speculative_mode)
+			break;
+
+		// Remove it from replay queue
+		uop->in_replay_queue = false;
+		replay_queue.PopBack();
+
+		// Pipeline trace
+		PipelineTrace *pipeline_trace = cpu->getPipelineTrace();
+		if (pipeline_trace)
+			pipeline_trace->RecordUop(uop, cpu->getCycle(), true);
+
+		// Trace
+		if (Timing::trace)
+		{
+			// Output
+			Timing::trace << misc::fmt("x86.inst "
+					"id=%lld "
+					"core=%d "
+					"stg=\"sq\"\n",
+					uop->getIdInCore(),
+					core->getId());
+
+			// Keep uop for later
+			cpu->InsertInTraceList(uop);
+		}
+
+		// Free uop
+		uop_pool->FreeIfNotQueued(uop);
 	}
 }
 
@@ -104,7 +163,7 @@ void Thread::RecoverInstructionQueue()
 	while (it != e)
 	{
 		// Get instruction
-		Uop *uop = it->get();
+		Uop *uop = *it;
 		++it;
 
 		// Remove if it is a speculative uop
@@ -122,7 +181,7 @@ void Thread::RecoverLoadQueue()
 	while (it != e)
 	{
 		// Get instruction
-		Uop *uop = it->get();
+		Uop *uop = *it;
 		++it;
 
 		// Remove if it is a speculative uop
@@ -140,7 +199,7 @@ void Thread::RecoverStoreQueue()
 	while (it != e)
 	{
 		// Get instruction
-		Uop *uop = it->get();
+		Uop *uop = *it;
 		++it;
 
 		// Remove if it is a speculative uop
@@ -152,15 +211,13 @@ void Thread::RecoverStoreQueue()
 
 void Thread::RecoverEventQueue()
 {
+	// Take uops first, since extracting them reorganizes the queue
+	std::vector<Uop *> uops;
+	core->getEventQueueUops(uops);
+
 	// Traverse event queue
-	auto it = core->getEventQueueBegin();
-	auto e = core->getEventQueueEnd();
-	while (it != e)
+	for (Uop *uop : uops)
 	{
-		// Get instruction
-		Uop *uop = it->get();
-		++it;
-
 		// Remove if it is a speculative uop in the current thread
 		if (uop->getThread() == this && uop->speculative_mode)
 			core->ExtractFromEventQueue(uop);
@@ -170,9 +227,11 @@ void Thread::RecoverEventQueue()
 
 void Thread::Recover()
 {
-	// Remove instructions of this thread in fetch queue, uop queue,
-	// instruction queue, store queue, load queue, and event queue.
+	// Remove instructions of this thread in fetch queue, replay queue,
+	// uop queue, instruction queue, store queue, load queue, and event
+	// queue.
 	RecoverFetchQueue();
+	RecoverReplayQueue();
 	RecoverUopQueue();
 	RecoverInstructionQueue();
 	RecoverLoadQueue();
@@ -181,10 +240,10 @@ void Thread::Recover()
 
 	// Remove instructions from ROB, restoring the state of the physical
 	// register file.
-	while (reorder_buffer.size())
+	while (reorder_buffer.getSize())
 	{
 		// Get instruction at the reorder buffer tail
-		std::shared_ptr<Uop> uop = reorder_buffer.back();
+		Uop *uop = reorder_buffer.Back();
 		assert(uop->getThread() == this);
 
 		// If we already removed all speculative instructions, done
@@ -194,16 +253,20 @@ void Thread::Recover()
 		// Statistics
 		num_squashed_uinsts++;
 		core->incNumSquashedUinsts();
-		cpu->incNumSquashedUinsts();
 		if (uop->from_trace_cache)
 			trace_cache->incNumSquashedUinsts();
 
 		// Finish register renaming if uop didn't complete yet
 		if (!uop->completed)
-			register_file->WriteUop(uop.get());
+			register_file->WriteUop(uop);
 
 		// Undo register renaming
-		register_file->UndoUop(uop.get());
+		register_file->UndoUop(uop);
+
+		// Pipeline trace
+		PipelineTrace *pipeline_trace = cpu->getPipelineTrace();
+		if (pipeline_trace)
+			pipeline_trace->RecordUop(uop, cpu->getCycle(), true);
 
 		// Trace
 		if (Timing::trace)
@@ -221,9 +284,13 @@ void Thread::Recover()
 		}
 
 		// Remove reorder buffer entry
-		ExtractFromReorderBuffer(uop.get());
+		ExtractFromReorderBuffer(uop);
+		uop_pool->FreeIfNotQueued(uop);
 	}
 
+	// Empty reorder buffer cycles are charged to the recovery from now on
+	recovering = true;
+
 	// Check state of fetch stage and mapped context, if still any
 	if (context)
 	{
@@ -236,5 +303,98 @@ void Thread::Recover()
 	}
 }
 
+
+void Thread::Replay(Uop *uop)
+{
+	// Remove uops from the reorder buffer tail down to the given uop,
+	// restoring the state of the physical register file.
+	std::vector<Uop *> uops;
+	for (;;)
+	{
+		// Get instruction at the reorder buffer tail
+		Uop *tail = reorder_buffer.Back();
+		assert(tail->getThread() == this);
+
+		// Remove it from the queue where it waits, or from the event
+		// queue if it is executing. Loads accessing memory are
+		// discarded when the access finishes.
+		if (tail->in_instruction_queue)
+			ExtractFromInstructionQueue(tail);
+		if (tail->in_load_queue)
+			ExtractFromLoadQueue(tail);
+		if (tail->in_store_queue)
+			ExtractFromStoreQueue(tail);
+		if (tail->in_event_queue)
+			core->ExtractFromEventQueue(tail);
+
+		// Statistics
+		num_replayed_uinsts++;
+		core->incNumReplayedUinsts();
+
+		// Finish register renaming if uop didn't complete yet, and
+		// undo it
+		if (!tail->completed)
+			register_file->WriteUop(tail);
+		register_file->UndoUop(tail);
+
+		// Remove reorder buffer entry
+		ExtractFromReorderBuffer(tail);
+		uops.push_back(tail);
+
+		// Done
+		if (tail == uop)
+			break;
+	}
+
+	// Uops currently in the uop queue and the replay queue are younger
+	// than the replayed uops. Take them in program order.
+	std::vector<Uop *> queued_uops;
+	while (uop_queue.getSize())
+	{
+		queued_uops.push_back(uop_queue.Front());
+		ExtractFromUopQueue(uop_queue.Front());
+	}
+	while (replay_queue.getSize())
+	{
+		Uop *queued_uop = replay_queue.Front();
+		queued_uop->in_replay_queue = false;
+		replay_queue.PopFront();
+		queued_uops.push_back(queued_uop);
+	}
+
+	// Insert replayed uops in the replay queue in program order, with the
+	// state they had before being dispatched, followed by the uops taken
+	// from the queues
+	for (auto it = uops.rbegin(); it != uops.rend(); ++it)
+	{
+		Uop *replayed_uop = *it;
+		replayed_uop->dispatched = false;
+		replayed_uop->dispatch_when = 0;
+		replayed_uop->ready = false;
+		replayed_uop->ready_when = 0;
+		replayed_uop->issued = false;
+		replayed_uop->issue_when = 0;
+		replayed_uop->completed = false;
+		replayed_uop->complete_when = 0;
+		replayed_uop->first_alu_cycle = 0;
+		replayed_uop->memory_access = 0;
+		replayed_uop->store_set_dependence = 0;
+		replayed_uop->forwarding_store = 0;
+		replayed_uop->memory_order_checked = false;
+		replayed_uop->replayed = true;
+		replayed_uop->in_replay_queue = true;
+		replay_queue.PushBack(replayed_uop);
+	}
+	for (Uop *queued_uop : queued_uops)
+	{
+		queued_uop->in_replay_queue = true;
+		replay_queue.PushBack(queued_uop);
+	}
+
+	// Move as many uops as fit back into the uop queue. The rest enter it
+	// in the decode stage as entries become free.
+	RefillUopQueue();
+}
+
 }
 
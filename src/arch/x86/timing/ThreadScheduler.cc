@@ -187,7 +187,7 @@ void Thread::EvictContext()
 	assert(context->getState(Context::StateAlloc));
 	assert(context->getState(Context::StateMapped));
 	assert(!context->getState(Context::StateSpecMode));
-	assert(reorder_buffer.empty());
+	assert(reorder_buffer.isEmpty());
 	assert(context->evict_signal);
 
 	// Update context state
@@ -218,8 +218,21 @@ void Thread::EvictContext()
 }
 
 
+void Thread::EvictPostponedContext()
+{
+	if (!eviction_postponed)
+		return;
+	eviction_postponed = false;
+	EvictContext();
+}
+
+
 void Thread::Schedule()
 {
+	// Contexts allocated or evicted below are handled by the interval
+	// model in this cycle
+	interval_wakeup_cycle = 0;
+
 	// Actions for the context allocated to this thread
 	if (context)
 	{
@@ -244,8 +257,9 @@ void Thread::Schedule()
 			EvictContextSignal();
 		}
 
-		// Context lost affinity with the thread
-		if (!context->evict_signal && !context->thread_affinity->Test(id_in_cpu))
+		// Context lost affinity with the thread. The context might have
+		// been evicted right away above if the pipeline was empty.
+		if (context && !context->evict_signal && !context->thread_affinity->Test(id_in_cpu))
 		{
 			// Debug
 			Emulator::context_debug << misc::fmt(
@@ -262,7 +276,7 @@ void Thread::Schedule()
 		}
 
 		// Context quantum expired
-		if (!context->evict_signal && cpu->getCycle()
+		if (context && !context->evict_signal && cpu->getCycle()
 				>= context->allocate_cycle
 				+ Cpu::getContextQuantum())
 		{
@@ -327,7 +341,7 @@ void Thread::Schedule()
 
 		// Context quantum has not expired, but another thread
 		// of higher priority may interrupt it.
-		else if (!context->evict_signal && cpu->getCycle()
+		else if (context && !context->evict_signal && cpu->getCycle()
 				< context->allocate_cycle
 				+ Cpu::getContextQuantum())
 		{
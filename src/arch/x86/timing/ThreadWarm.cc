@@ -0,0 +1,105 @@
+/*
+ *  Multi2Sim
+ *  Copyright (C) 2012  Rafael Ubal (ubal@ece.neu.edu)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "Cpu.h"
+#include "Thread.h"
+#include "TraceCache.h"
+
+
+namespace x86
+{
+
+void Thread::Warm(Context *context, unsigned eip)
+{
+	// Access instruction cache once per block
+	mem::Mmu *mmu = context->getMmu();
+	mem::Mmu::Space *mmu_space = context->getMmuSpace();
+	unsigned block_address = mmu->TranslateVirtualAddress(mmu_space, eip)
+			& ~(instruction_module->getBlockSize() - 1);
+	if (block_address != warm_block_address)
+	{
+		warm_block_address = block_address;
+		instruction_module->Warm(mem::Module::AccessLoad,
+				block_address);
+	}
+
+	// Traverse micro-instructions created by the x86 emulator. An
+	// instruction that created none is recorded as a 'nop' in the trace
+	// cache, as done by the fetch stage.
+	if (!context->getNumUinsts())
+		context->newUinst(Uinst::OpcodeNop, 0, 0, 0, 0, 0, 0, 0);
+	int num_uinsts = context->getNumUinsts();
+	int mop_size = context->getInstruction()->getSize();
+	long long mop_id = 0;
+	for (int uinst_index = 0; context->getNumUinsts(); uinst_index++)
+	{
+		// Get micro-instruction from head of list
+		std::shared_ptr<Uinst> uinst = context->ExtractUinst();
+
+		// Access data cache
+		if (uinst->getFlags() & Uinst::FlagMem)
+		{
+			unsigned physical_address = mmu->TranslateVirtualAddress(
+					mmu_space,
+					uinst->getAddress());
+			data_module->Warm(uinst->getOpcode() ==
+					Uinst::OpcodeStore ?
+					mem::Module::AccessStore :
+					mem::Module::AccessLoad,
+					physical_address);
+		}
+
+		// Only branches and the first micro-instruction of the
+		// macro-instruction need a uop
+		bool is_branch = uinst->getFlags() & Uinst::FlagCtrl;
+		if (!is_branch && uinst_index)
+			continue;
+
+		// Create uop with the information used by the branch predictor
+		// and the trace cache at commit
+		auto uop = uop_pool->NewUop(this, context, uinst);
+		if (!uinst_index)
+			mop_id = uop->getId();
+		uop->mop_count = num_uinsts;
+		uop->mop_size = mop_size;
+		uop->mop_id = mop_id;
+		uop->mop_index = uinst_index;
+		uop->eip = eip;
+		uop->neip = context->getRegs().getEip();
+		uop->predicted_neip = uop->neip;
+		uop->target_neip = context->getTargetEip();
+
+		// Train branch predictor
+		if (is_branch)
+			branch_predictor->Warm(uop);
+
+		// Record instruction in trace cache
+		if (TraceCache::isPresent())
+			trace_cache->RecordUop(uop);
+
+		// Record macro-instruction in uop cache
+		if (UopCache::isPresent() && !uinst_index)
+			uop_cache->Record(eip, num_uinsts);
+
+		// Free uop
+		uop_pool->FreeIfNotQueued(uop);
+	}
+}
+
+}
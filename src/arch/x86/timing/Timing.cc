@@ -17,10 +17,13 @@
  *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  */
 
+#include <climits>
+
 #include <arch/common/Arch.h>
 #include <memory/System.h>
 
 #include "Alu.h"
+#include "PipelineTrace.h"
 #include "Timing.h"
 
 
@@ -47,6 +50,10 @@ comm::Arch::SimKind Timing::sim_kind = comm::Arch::SimFunctional;
 // Report file name
 std::string Timing::report_file;
 
+// CPI stack time series
+std::string Timing::cpi_stack_file;
+long long Timing::cpi_stack_interval = 10000;
+
 // Message to display with '--x86-help'
 const std::string Timing::help_message =
 		"The x86 Cpu configuration file is a plain text INI file, defining\n"
@@ -69,6 +76,18 @@ const std::string Timing::help_message =
 		"  FastForward = <num_inst> (Default = 0)\n"
 		"      Number of x86 instructions to run with a fast functional simulation before\n"
 		"      the architectural simulation starts.\n"
+		"  FunctionalWarming = {t|f} (Default = False)\n"
+		"      If true, instructions run functionally during fast-forward and sampling\n"
+		"      intervals update the state of caches, branch predictors, and trace caches,\n"
+		"      so that the architectural simulation starts from warm state.\n"
+		"  HostThreads = <num_threads> (Default = 1)\n"
+		"      Number of host threads used to simulate the cores in parallel. Stages from\n"
+		"      commit to decode run in parallel, while the fetch stage and the memory\n"
+		"      hierarchy are simulated sequentially. Effects of one core on another within\n"
+		"      the same cycle are applied at the end of the parallel part of the cycle, so\n"
+		"      results can differ slightly from a sequential simulation, but they do not\n"
+		"      depend on the number of host threads. Simulation is sequential while an\n"
+		"      x86 trace or debug information is being generated.\n"
 		"  ContextQuantum = <cycles> (Default = 100k)\n"
 		"      If ContextSwitch is true, maximum number of cycles that a context can occupy\n"
 		"      a Cpu hardware thread before it is replaced by other pending context.\n"
@@ -152,6 +171,21 @@ const std::string Timing::help_message =
 		"      Number of floating-point physical registers (if private, per-thread).\n"
 		"  RfXmmSize = <entries> (Default = 40)\n"
 		"      Number of XMM physical registers (if private, per-thread).\n"
+		"  MemoryDependence = {None|Conservative|Speculative|StoreSet} (Default = None)\n"
+		"      Policy for loads with older stores in the store queue. With 'None', loads\n"
+		"      ignore stores and always read the memory hierarchy. Otherwise, a load\n"
+		"      takes its data from the youngest older store to the same address, and\n"
+		"      waits for all older stores to resolve their addresses (Conservative),\n"
+		"      for none of them (Speculative), or for the last store of its store set\n"
+		"      (StoreSet). Loads that issued before an older store to the same address\n"
+		"      are replayed when the store resolves.\n"
+		"  StoreForwardLatency = <cycles> (Default = 2)\n"
+		"      Latency of a load taking its data from the store queue.\n"
+		"  StoreSetTableSize = <entries> (Default = 1024)\n"
+		"      Number of entries in the store set identifier table, indexed by\n"
+		"      instruction address. Must be a power of 2.\n"
+		"  StoreSetCount = <num_sets> (Default = 128)\n"
+		"      Number of store sets, or entries in the last fetched store table.\n"
 		"\n"
 		"Section '[ TraceCache ]':\n"
 		"\n"
@@ -170,6 +204,28 @@ const std::string Timing::help_message =
 		"  QueueSize = <num_uops> (Default = 32)\n"
 		"      Size of the trace queue size in uops.\n"
 		"\n"
+		"Section '[ UopCache ]':\n"
+		"\n"
+		"  Present = {t|f} (Default = False)\n"
+		"      If true, a cache of decoded uops is included in the model. Uops fetched\n"
+		"      from it don't access the instruction cache, and are copied into the uop\n"
+		"      queue in one decode slot. If false, the rest of the options in this\n"
+		"      section are ignored.\n"
+		"  Sets = <num_sets> (Default = 32)\n"
+		"      Number of sets in the uop cache.\n"
+		"  Assoc = <num_ways> (Default = 8)\n"
+		"      Number of lines in each set.\n"
+		"  WindowSize = <bytes> (Default = 32)\n"
+		"      Size of the aligned fetch windows that index the uop cache.\n"
+		"  UopsPerLine = <num_uops> (Default = 6)\n"
+		"      Maximum number of uops in a line.\n"
+		"  LinesPerWindow = <num_lines> (Default = 3)\n"
+		"      Maximum number of lines holding the uops of one fetch window. Windows\n"
+		"      with more uops are not cached.\n"
+		"  SwitchPenalty = <cycles> (Default = 2)\n"
+		"      Cycles that fetch stalls when switching from the uop cache to the\n"
+		"      instruction cache and decoders.\n"
+		"\n"
 		"Section '[ FunctionalUnits ]':\n"
 		"\n"
 		"  The possible variables in this section follow the format\n"
@@ -213,7 +269,8 @@ const std::string Timing::help_message =
 		"\n"
 		"Section '[ BranchPredictor ]':\n"
 		"\n"
-		"  Kind = {Perfect|Taken|NotTaken|Bimodal|TwoLevel|Combined} (Default = TwoLevel)\n"
+		"  Kind = {Perfect|Taken|NotTaken|Bimodal|TwoLevel|Combined|TAGE|Perceptron}\n"
+		"      (Default = TwoLevel)\n"
 		"      Branch predictor type.\n"
 		"  BTB.Sets = <num_sets> (Default = 256)\n"
 		"      Number of sets in the BTB.\n"
@@ -231,6 +288,64 @@ const std::string Timing::help_message =
 		"      For the two-level adaptive predictor, level 2 size.\n"
 		"  TwoLevel.HistorySize = <size> (Default = 8)\n"
 		"      For the two-level adaptive predictor, level 2 history size.\n"
+		"  TAGE.BaseSize = <entries> (Default = 4096)\n"
+		"      Number of 2-bit counters in the TAGE base predictor.\n"
+		"  TAGE.NumTables = <num> (Default = 7)\n"
+		"      Number of tagged TAGE tables, using geometric history lengths.\n"
+		"  TAGE.TableSize = <entries> (Default = 1024)\n"
+		"      Number of entries in each tagged TAGE table.\n"
+		"  TAGE.TagBits = <bits> (Default = 9)\n"
+		"      Tag width of the TAGE tables, between 2 and 11 bits.\n"
+		"  TAGE.MinHistory = <length> (Default = 4)\n"
+		"  TAGE.MaxHistory = <length> (Default = 200)\n"
+		"      Global history length of the shortest and longest TAGE tables.\n"
+		"  Perceptron.NumTables = <num> (Default = 8)\n"
+		"      Number of weight tables of the hashed perceptron predictor.\n"
+		"  Perceptron.TableSize = <entries> (Default = 1024)\n"
+		"      Number of 6-bit weights in each perceptron table.\n"
+		"  Perceptron.MaxHistory = <length> (Default = 64)\n"
+		"      Global history length of the longest perceptron table.\n"
+		"  Indirect = {BTB|ITTAGE} (Default = BTB)\n"
+		"      Predictor for the targets of indirect jumps and calls. With ITTAGE,\n"
+		"      targets found in the ITTAGE tables override those of the BTB.\n"
+		"  ITTAGE.NumTables = <num> (Default = 5)\n"
+		"  ITTAGE.TableSize = <entries> (Default = 256)\n"
+		"  ITTAGE.TagBits = <bits> (Default = 9)\n"
+		"  ITTAGE.MinHistory = <length> (Default = 4)\n"
+		"  ITTAGE.MaxHistory = <length> (Default = 64)\n"
+		"      Number of tables, entries per table, tag width, and history lengths\n"
+		"      of the ITTAGE indirect target predictor.\n"
+		"\n"
+		"Section '[ Sampling ]':\n"
+		"\n"
+		"  Enabled = {t|f} (Default = False)\n"
+		"      If true, detailed simulation is sampled periodically. Each period runs a\n"
+		"      functional interval, a detailed warmup interval, and a detailed measurement\n"
+		"      window that produces one CPI sample. The pipeline is drained before every\n"
+		"      functional interval.\n"
+		"  FunctionalLength = <num_inst> (Default = 1M)\n"
+		"      Number of x86 instructions executed functionally in each period.\n"
+		"  WarmupLength = <num_inst> (Default = 2000)\n"
+		"      Number of committed x86 instructions in each detailed warmup interval.\n"
+		"  MeasureLength = <num_inst> (Default = 1000)\n"
+		"      Number of committed x86 instructions in each measurement window.\n"
+		"  Confidence = <percent> (Default = 99.7)\n"
+		"      Confidence level of the interval reported for the mean CPI.\n"
+		"  TargetError = <fraction> (Default = 0.03)\n"
+		"      Simulation finishes when the confidence interval relative to the mean CPI\n"
+		"      falls below this value. Use 0 to sample until the program finishes.\n"
+		"  MinSamples = <num> (Default = 30)\n"
+		"      Minimum number of samples before the error bound is checked.\n"
+		"\n"
+		"Section '[ RegionOfInterest ]':\n"
+		"\n"
+		"  Enabled = {t|f} (Default = False)\n"
+		"      If true, the simulation runs functionally until the guest program marks\n"
+		"      the beginning of its region of interest, and finishes when it marks its\n"
+		"      end. Markers are magic instructions 'xchg %bx, %bx', with a command in\n"
+		"      register eax: 1 = region begin, 2 = region end, 3 = stats reset,\n"
+		"      4 = stats dump, 5 = switch to detailed, 6 = switch to functional. Magic\n"
+		"      instructions are processed even if this option is false.\n"
 		"\n";
 
 const char *Timing::error_fast_forward =
@@ -252,6 +367,28 @@ Timing::Timing() : comm::Timing("x86")
 	// Create CPU
 	cpu = misc::new_unique<Cpu>(this);
 
+	// Create sampler
+	if (Sampler::isEnabled())
+		sampler = misc::new_unique<Sampler>(cpu.get());
+
+	// Create magic instruction processing
+	region_of_interest = misc::new_unique<RegionOfInterest>(cpu.get());
+
+	// Open CPI stack time series, with a header naming the columns
+	if (!cpi_stack_file.empty())
+	{
+		cpi_stack_stream.open(cpi_stack_file);
+		if (!cpi_stack_stream.good())
+			throw Error(misc::fmt("%s: Cannot open CPI stack file",
+					cpi_stack_file.c_str()));
+		cpi_stack_stream << "Cycle Core Thread";
+		for (int i = 0; i < Thread::CpiComponentCount; i++)
+			cpi_stack_stream << ' ' << Thread::cpi_component_map[i];
+		cpi_stack_stream << '\n';
+		cpi_stack_last.resize(Cpu::getNumCores() * Cpu::getNumThreads()
+				* Thread::CpiComponentCount);
+	}
+
 	// Create the trace header related to CPU
 	trace.Header(misc::fmt("x86.init version=\"%d.%d\" "
 			"num_cores=%d num_threads=%d\n",
@@ -286,22 +423,47 @@ bool Timing::Run()
 			< Cpu::getNumFastForwardInstructions())
 		FastForward();
 
-	// Stop if maximum number of CPU instructions exceeded
+	// Stop if maximum number of CPU instructions exceeded. With sampling
+	// or functional mode, instructions run functionally count as well.
 	esim::Engine *esim_engine = esim::Engine::getInstance();
+	long long num_instructions = sampler ||
+			region_of_interest->getNumFunctionalInstructions() ?
+			emulator->getNumInstructions() :
+			cpu->getNumCommittedInstructions()
+			+ Cpu::getNumFastForwardInstructions();
 	if (Emulator::getMaxInstructions()
-			&& cpu->getNumCommittedInstructions()
-			>= Emulator::getMaxInstructions()
-			- Cpu::getNumFastForwardInstructions())
+			&& num_instructions >= Emulator::getMaxInstructions())
 		esim_engine->Finish("X86MaxInstructions");
 
 	// Stop if maximum number of cycles exceeded
 	if (Cpu::max_cycles && getCycle() >= Cpu::max_cycles)
 		esim_engine->Finish("X86MaxCycles");
 
+	// Save checkpoint if requested
+	emulator->CheckCheckpoint();
+
 	// Stop if any previous reason met
 	if (esim_engine->hasFinished())
 		return true;
 
+	// Process magic instructions, or run functionally until the next
+	// one in functional mode. Sampling stays on hold until the simulation
+	// returns to detailed mode.
+	region_of_interest->Run();
+	if (esim_engine->hasFinished() || region_of_interest->getMode()
+			== RegionOfInterest::ModeFunctional)
+		return true;
+
+	// Advance sampling phase. This might run a functional interval or
+	// finish the simulation if the target error bound was reached.
+	if (sampler && region_of_interest->getMode()
+			== RegionOfInterest::ModeDetailed)
+	{
+		sampler->Run();
+		if (esim_engine->hasFinished())
+			return true;
+	}
+
 	// Empty uop trace list. This dumps the last trace line for instructions
 	// that were freed in the previous simulation cycle.
 	cpu->EmptyTraceList();
@@ -309,23 +471,81 @@ bool Timing::Run()
 	// Run processor stages
 	cpu->Run();
 
+	// Sample CPI stack time series. The last interval is added when the
+	// report is dumped.
+	if (cpi_stack_stream.is_open())
+	{
+		cpi_stack_cycle = getCycle();
+		if (cpi_stack_cycle % cpi_stack_interval == 0)
+			DumpCpiStackInterval();
+	}
+
 	// Process host threads generating events
 	emulator->ProcessEvents();
 
+	// Skip idle cycles of the interval model
+	if (Cpu::getCoreModel() == Cpu::CoreModelInterval)
+		SkipIntervalCycles();
+
 	// Still simulating
 	return true;
 }
 
 
+void Timing::SkipIntervalCycles()
+{
+	// Cycles are only skipped when nothing but the memory hierarchy and
+	// the interval model needs to run in each cycle: no other timing
+	// simulator, no sampling, and no pending scheduling, magic
+	// instructions, or suspended contexts in the emulator.
+	Emulator *emulator = Emulator::getInstance();
+	comm::ArchPool *arch_pool = comm::ArchPool::getInstance();
+	if (arch_pool->getNumTiming() > 1 || sampler ||
+			emulator->schedule_signal ||
+			emulator->hasMagicCommands() ||
+			emulator->getNumSuspendedContexts())
+		return;
+
+	// Events of the current cycle must be observed in the next one
+	esim::Engine *esim_engine = esim::Engine::getInstance();
+	long long event_time = esim_engine->getNextEventTime();
+	if (event_time <= esim_engine->getTime())
+		return;
+
+	// Next cycle with work to do in the CPU, or with an event in the
+	// memory hierarchy, which the CPU observes from that cycle on
+	long long cycle = getCycle();
+	long long cycle_time = getFrequencyDomain()->getCycleTime();
+	long long next_cycle = cpu->getIntervalNextCycle();
+	if (event_time != LLONG_MAX)
+		next_cycle = std::min(next_cycle, event_time / cycle_time + 1);
+
+	// Maximum number of cycles, and next line of the CPI stack time series
+	if (Cpu::getMaxCycles())
+		next_cycle = std::min(next_cycle, Cpu::getMaxCycles());
+	if (cpi_stack_stream.is_open())
+		next_cycle = std::min(next_cycle, (cycle / cpi_stack_interval
+				+ 1) * cpi_stack_interval);
+
+	// Nothing to skip
+	if (next_cycle <= cycle + 1)
+		return;
+
+	// Account for the skipped cycles and advance the simulation time
+	cpu->SkipInterval(next_cycle - cycle - 1);
+	if (cpi_stack_stream.is_open())
+		cpi_stack_cycle = next_cycle - 1;
+	esim_engine->SkipTo((next_cycle - 1) * cycle_time);
+}
+
+
 void Timing::FastForward()
 {
 	// Fast-forward simulation
 	Emulator *emulator = Emulator::getInstance();
 	esim::Engine *esim_engine = esim::Engine::getInstance();
-	while (emulator->getNumInstructions()
-			< Cpu::getNumFastForwardInstructions()
-			&& !esim_engine->hasFinished())
-		emulator->Run();
+	RunFunctional(Cpu::getNumFastForwardInstructions()
+			- emulator->getNumInstructions());
 
 	// Output warning if simulation finished during fast-forward execution
 	if (esim_engine->hasFinished())
@@ -334,6 +554,75 @@ void Timing::FastForward()
 }
 
 
+long long Timing::RunFunctional(long long num_instructions)
+{
+	Emulator *emulator = Emulator::getInstance();
+	esim::Engine *esim_engine = esim::Engine::getInstance();
+	long long start = emulator->getNumInstructions();
+	while (emulator->getNumInstructions() - start < num_instructions
+			&& emulator->getNumRunningContexts()
+			+ emulator->getNumSuspendedContexts() > 0
+			&& !esim_engine->hasFinished())
+	{
+		// Stop if maximum number of instructions exceeded
+		if (Emulator::getMaxInstructions() &&
+				emulator->getNumInstructions() >=
+				Emulator::getMaxInstructions())
+		{
+			esim_engine->Finish("X86MaxInstructions");
+			break;
+		}
+
+		// Save checkpoint if requested
+		emulator->CheckCheckpoint();
+		if (esim_engine->hasFinished())
+			break;
+
+		// Stop at magic instructions, processed by the caller
+		if (emulator->hasMagicCommands())
+			break;
+
+		// Run one instruction from every running context. During
+		// execution, a context can remove itself from the running list,
+		// so traversing the running list is not an option.
+		for (auto it = emulator->getContextsBegin(),
+				e = emulator->getContextsEnd();
+				it != e;
+				++it)
+		{
+			// Skip if not running
+			Context *context = it->get();
+			if (!context->getState(Context::StateRunning))
+				continue;
+
+			// Run one instruction, and feed it into the
+			// microarchitectural structures if warming is enabled.
+			unsigned eip = context->getRegs().getEip();
+			context->Execute();
+			if (Cpu::getFunctionalWarming())
+				cpu->Warm(context, eip);
+		}
+
+		// Free finished contexts. Those that are still mapped to a
+		// hardware thread are freed by the CPU scheduler.
+		for (auto it = emulator->getFinishedContextsBegin();
+				it != emulator->getFinishedContextsEnd();)
+		{
+			Context *context = *it;
+			++it;
+			if (!context->getState(Context::StateMapped))
+				emulator->FreeContext(context);
+		}
+
+		// Process list of suspended contexts
+		emulator->ProcessEvents();
+	}
+
+	// Return number of instructions executed
+	return emulator->getNumInstructions() - start;
+}
+
+
 void Timing::WriteMemoryConfiguration(misc::IniFile *ini_file)
 {
 	// Cache geometry for L1
@@ -604,6 +893,67 @@ void Timing::RegisterOptions()
 			RegisterFile::debug_file,
 			"Debug information for the register file.");
 
+	// Option --x86-cpi-stack <file>
+	command_line->RegisterString("--x86-cpi-stack <file>", cpi_stack_file,
+			"File to dump a time series of the CPI stack of each hardware "
+			"thread. Every interval, a line is added for each thread with "
+			"the commit slots charged to every category in that interval. "
+			"The total CPI stack is included in the report of option "
+			"'--x86-report'.");
+
+	// Option --x86-cpi-stack-interval <cycles>
+	command_line->RegisterInt64("--x86-cpi-stack-interval <cycles> "
+			"(default = 10000)", cpi_stack_interval,
+			"Number of cycles between lines of the CPI stack time series "
+			"given with option '--x86-cpi-stack'.");
+
+	// Option --x86-core-model <model>
+	command_line->RegisterEnum("--x86-core-model {detailed|interval} "
+			"(default = detailed)",
+			(int &) Cpu::core_model, Cpu::core_model_map,
+			"Timing model of the x86 cores in detailed simulation. The "
+			"detailed model simulates every pipeline stage cycle by "
+			"cycle. The interval model executes instructions in the "
+			"emulator as they are fetched, and computes the cycles "
+			"between miss events (branch mispredictions, cache "
+			"misses) from the dependences and latencies of the "
+			"instructions in a window of the size of the reorder "
+			"buffer. Caches and the network are still simulated in "
+			"detail.");
+
+	// Option --x86-pipeline-trace <file>
+	command_line->RegisterString("--x86-pipeline-trace <file>",
+			PipelineTrace::path,
+			"Binary file to dump a trace of the lifecycle of every "
+			"uop in the detailed pipeline, with the cycles when it "
+			"was fetched, decoded, dispatched, issued, written back, "
+			"and committed or squashed. The trace is much smaller and "
+			"faster to generate than the one given with option "
+			"'--trace', and can be converted for the Konata pipeline "
+			"viewer with option '--x86-konata'.");
+
+	// Option --x86-pipeline-trace-start <cycle>
+	command_line->RegisterInt64("--x86-pipeline-trace-start <cycle> "
+			"(default = 0)", PipelineTrace::start_cycle,
+			"First cycle traced with option '--x86-pipeline-trace'. "
+			"Uops fetched before this cycle are not traced.");
+
+	// Option --x86-pipeline-trace-end <cycle>
+	command_line->RegisterInt64("--x86-pipeline-trace-end <cycle> "
+			"(default = 0)", PipelineTrace::end_cycle,
+			"Last cycle traced with option '--x86-pipeline-trace'. "
+			"Uops committed or squashed after this cycle are not "
+			"traced. A value of 0 traces until the end of the "
+			"simulation.");
+
+	// Option --x86-konata <file>
+	command_line->RegisterString("--x86-konata <file>",
+			PipelineTrace::konata_path,
+			"Convert the binary trace given with option "
+			"'--x86-pipeline-trace' into a file in the Kanata log "
+			"format used by the Konata pipeline viewer, and exit "
+			"without running any simulation.");
+
 	// Option --x86-max-cycles <int>
 	command_line->RegisterInt64("--x86-max-cycles <cycles>", Cpu::max_cycles,
 			"Maximum number of cycles for the timing simulator "
@@ -615,6 +965,10 @@ void Timing::RegisterOptions()
 
 void Timing::ProcessOptions()
 {
+	// Pipeline trace options. This converts a trace and exits if option
+	// '--x86-konata' was given.
+	PipelineTrace::ProcessOptions();
+
 	// Configuration
 	misc::IniFile ini_file;
 	if (!config_file.empty())
@@ -639,6 +993,11 @@ void Timing::ProcessOptions()
 					report_file.c_str()));
 	}
 
+	// Check valid interval in '--x86-cpi-stack-interval'
+	if (cpi_stack_interval < 1)
+		throw Error("Value for '--x86-cpi-stack-interval' must be "
+				"greater than 0");
+
 	// Print x86 configuration INI format
 	if (help)
 	{
@@ -668,15 +1027,27 @@ void Timing::ParseConfiguration(misc::IniFile *ini_file)
 	// Parse register file configuration by their sections
 	RegisterFile::ParseConfiguration(ini_file);
 
+	// Parse memory dependence predictor configuration
+	MemoryDependencePredictor::ParseConfiguration(ini_file);
+
 	// Parse branch predictor configuration by their sections
 	BranchPredictor::ParseConfiguration(ini_file);
 
 	// Parse trace cache configuration by their sections
 	TraceCache::ParseConfiguration(ini_file);
 
+	// Parse uop cache configuration
+	UopCache::ParseConfiguration(ini_file);
+
 	// Parse ALU configuration by their sections
 	Alu::ParseConfiguration(ini_file);
 
+	// Parse sampling configuration
+	Sampler::ParseConfiguration(ini_file);
+
+	// Parse region of interest configuration
+	RegionOfInterest::ParseConfiguration(ini_file);
+
 	// Check the configuration for forbidden variables
 	ini_file->Check();
 }
@@ -730,6 +1101,14 @@ void Timing::DumpSummary(std::ostream &os) const
 			/ cpu->getNumBranches()
 			: 0.0;
 	os << misc::fmt("BranchPredictionAccuracy = %.4g\n", branch_accuracy);
+
+	// Sampled CPI
+	if (sampler)
+	{
+		os << misc::fmt("SampledCPI = %.4g\n", sampler->getMeanCpi());
+		os << misc::fmt("SampledCPIError = %.4g\n",
+				sampler->getRelativeError());
+	}
 }
 
 
@@ -787,8 +1166,85 @@ void Timing::DumpUopReport(std::ostream &os, const long long *uop_stats,
 }
 
 
+void Timing::DumpCpiStack(std::ostream &os,
+		const std::vector<Thread *> &threads) const
+{
+	// Add up commit slots of all threads
+	long long cpi_stack[Thread::CpiComponentCount] = { };
+	for (Thread *thread : threads)
+		for (int i = 0; i < Thread::CpiComponentCount; i++)
+			cpi_stack[i] += thread->getCpiStack()[i];
+
+	// Header
+	os << "; CPI stack (sum = cycles running a context * commit width)\n";
+	os << ";    Base - commit slot used by a uop\n";
+	os << ";    FrontEnd - empty ROB, due to an instruction cache access, the\n";
+	os << ";        recovery from a mispeculation, a trace cache miss, or other\n";
+	os << ";    Memory - load at ROB head waiting for the L1, L2, last-level\n";
+	os << ";        cache, or main memory\n";
+	os << ";    Core - ROB head ready but not issued, waiting for its inputs or\n";
+	os << ";        executing, or completed but commit used by another thread\n";
+	os << ";    BadSpeculation - wrong-path uop at ROB head\n";
+
+	// Stats
+	long long total = 0;
+	for (int i = 0; i < Thread::CpiComponentCount; i++)
+	{
+		os << misc::fmt("CpiStack.%s = %lld\n",
+				Thread::cpi_component_map[i], cpi_stack[i]);
+		total += cpi_stack[i];
+	}
+	os << misc::fmt("CpiStack.Total = %lld\n", total);
+	os << '\n';
+}
+
+
+void Timing::DumpCpiStackInterval() const
+{
+	cpi_stack_dumped_cycle = cpi_stack_cycle;
+	long long *last = cpi_stack_last.data();
+	for (int i = 0; i < Cpu::getNumCores(); i++)
+	{
+		for (int j = 0; j < Cpu::getNumThreads(); j++)
+		{
+			// Slots in the interval
+			Thread *thread = cpu->getThread(i, j);
+			const long long *cpi_stack = thread->getCpiStack();
+			cpi_stack_stream << cpi_stack_cycle << ' ' << i << ' '
+					<< j;
+			for (int k = 0; k < Thread::CpiComponentCount; k++)
+			{
+				cpi_stack_stream << ' ' << cpi_stack[k] - last[k];
+				last[k] = cpi_stack[k];
+			}
+			cpi_stack_stream << '\n';
+
+			// Next thread
+			last += Thread::CpiComponentCount;
+		}
+	}
+}
+
+
+void Timing::FlushCpiStack() const
+{
+	// Nothing to add if there is no time series, or no cycles were
+	// simulated after its last line
+	if (!cpi_stack_stream.is_open() ||
+			cpi_stack_cycle == cpi_stack_dumped_cycle)
+		return;
+
+	// Last interval
+	DumpCpiStackInterval();
+	cpi_stack_stream.flush();
+}
+
+
 void Timing::DumpReport() const
 {
+	// Finish the CPI stack time series
+	FlushCpiStack();
+
 	// Ignore if no report file was specified
 	if (report_file.empty())
 		return;
@@ -818,21 +1274,24 @@ void Timing::DumpReport() const
 	os << misc::fmt("Time = %.2f\n", (double) now / 1e6);
 	os << misc::fmt("CyclesPerSecond = %.0f\n", now ?
 			(double) getCycle() / now * 1e6 : 0.0);
+	if (Cpu::getCoreModel() == Cpu::CoreModelInterval)
+		os << misc::fmt("SkippedCycles = %lld\n",
+				cpu->getNumSkippedCycles());
 	os << '\n';
 	
 	// Dispatch stage
 	os << "; Dispatch stage\n";
-	DumpUopReport(os, cpu->getNumDispatchedUinstArray(),
+	DumpUopReport(os, cpu->getNumDispatchedUinstArray().data(),
 			"Dispatch", Cpu::getDispatchWidth());
 
 	// Issue stage
 	os << "; Issue stage\n";
-	DumpUopReport(os, cpu->getNumIssuedUinstArray(),
+	DumpUopReport(os, cpu->getNumIssuedUinstArray().data(),
 			"Issue", Cpu::getIssueWidth());
 
 	// Commit stage
 	os << "; Commit stage\n";
-	DumpUopReport(os, cpu->getNumCommittedUinstArray(),
+	DumpUopReport(os, cpu->getNumCommittedUinstArray().data(),
 			"Commit", Cpu::getCommitWidth());
 
 	// Committed branches
@@ -850,6 +1309,34 @@ void Timing::DumpReport() const
 			/ cpu->getNumBranches() : 0.0);
 	os << '\n';
 
+	// Memory dependences
+	if (MemoryDependencePredictor::getKind() !=
+			MemoryDependencePredictor::KindNone)
+	{
+		os << "; Memory dependences\n";
+		os << ";    Forwarded - Loads taking their data from the store queue\n";
+		os << ";    Violations - Loads issued before an older store to the same address\n";
+		os << ";    Replayed - Uops replayed after memory order violations\n";
+		os << misc::fmt("LSQ.Forwarded = %lld\n", cpu->getNumForwardedLoads());
+		os << misc::fmt("LSQ.Violations = %lld\n", cpu->getNumMemoryOrderViolations());
+		os << misc::fmt("LSQ.Replayed = %lld\n", cpu->getNumReplayedUinsts());
+		os << '\n';
+	}
+
+	// CPI stack of all threads
+	std::vector<Thread *> threads;
+	for (int i = 0; i < Cpu::getNumCores(); i++)
+		for (int j = 0; j < Cpu::getNumThreads(); j++)
+			threads.push_back(cpu->getThread(i, j));
+	DumpCpiStack(os, threads);
+
+	// Sampling statistics
+	if (sampler)
+		sampler->DumpReport(os);
+
+	// Region of interest statistics
+	region_of_interest->DumpReport(os);
+
 	// Report for each core
 	for (int i = 0; i < Cpu::getNumCores(); i++)
 	{
@@ -910,6 +1397,23 @@ void Timing::DumpReport() const
 				/ core->getNumBranches() : 0.0);
 		os << '\n';
 
+		// Memory dependences
+		if (MemoryDependencePredictor::getKind() !=
+				MemoryDependencePredictor::KindNone)
+		{
+			os << "; Memory dependences\n";
+			os << misc::fmt("LSQ.Forwarded = %lld\n", core->getNumForwardedLoads());
+			os << misc::fmt("LSQ.Violations = %lld\n", core->getNumMemoryOrderViolations());
+			os << misc::fmt("LSQ.Replayed = %lld\n", core->getNumReplayedUinsts());
+			os << '\n';
+		}
+
+		// CPI stack of the threads in the core
+		threads.clear();
+		for (int j = 0; j < Cpu::getNumThreads(); j++)
+			threads.push_back(core->getThread(j));
+		DumpCpiStack(os, threads);
+
 		// Occupancy statistics
 		os << "; Structure statistics (reorder buffer, instruction queue,\n";
 		os << "; load-store queue, and integer/floating-point/XMM register file)\n";
@@ -996,6 +1500,26 @@ void Timing::DumpReport() const
 					/ thread->getNumBranches() : 0.0);
 			os << '\n';
 
+			// Memory dependences
+			if (MemoryDependencePredictor::getKind() !=
+					MemoryDependencePredictor::KindNone)
+			{
+				os << "; Memory dependences\n";
+				os << misc::fmt("LSQ.Forwarded = %lld\n", thread->getNumForwardedLoads());
+				os << misc::fmt("LSQ.Violations = %lld\n", thread->getNumMemoryOrderViolations());
+				os << misc::fmt("LSQ.Replayed = %lld\n", thread->getNumReplayedUinsts());
+				os << '\n';
+			}
+
+			// Branch predictor
+			if (BranchPredictor::getKind() == BranchPredictor::KindTage ||
+					BranchPredictor::getKind() == BranchPredictor::KindPerceptron ||
+					BranchPredictor::getIndirectKind() == BranchPredictor::IndirectKindIttage)
+				thread->getBranchPredictor()->DumpReport(os);
+
+			// CPI stack
+			DumpCpiStack(os, { thread });
+
 			// Occupancy statistics
 			os << "; Structure statistics (reorder buffer, instruction queue,\n";
 			os << "; load-store queue, integer/floating-point/XMM register file,\n";
@@ -1064,6 +1588,11 @@ void Timing::DumpReport() const
 			TraceCache *trace_cache = thread->getTraceCache();
 			if (TraceCache::isPresent() && trace_cache)
 				trace_cache->DumpReport(os);
+
+			// Uop cache statistics
+			UopCache *uop_cache = thread->getUopCache();
+			if (uop_cache)
+				uop_cache->DumpReport(os);
 		}
 	}
 }
@@ -1074,9 +1603,12 @@ void Timing::DumpConfiguration(std::ofstream &os) const
 	// General configuration
 	os << "[ Config.General ]\n";
 	os << misc::fmt("Frequency = %d\n", frequency);
+	os << misc::fmt("CoreModel = %s\n", cpu->core_model_map[cpu->getCoreModel()]);
 	os << misc::fmt("Cores = %d\n", cpu->getNumCores());
 	os << misc::fmt("Threads = %d\n", cpu->getNumThreads());
 	os << misc::fmt("FastForward = %lld\n", cpu->getNumFastForwardInstructions());
+	os << misc::fmt("FunctionalWarming = %s\n", cpu->getFunctionalWarming() ? "True" : "False");
+	os << misc::fmt("HostThreads = %d\n", cpu->getNumHostThreads());
 	os << misc::fmt("ContextQuantum = %d\n", cpu->getContextQuantum());
 	os << misc::fmt("ThreadQuantum = %d\n", cpu->getThreadQuantum());
 	os << misc::fmt("ThreadSwitchPenalty = %d\n", cpu->getThreadSwitchPenalty());
@@ -1111,6 +1643,10 @@ void Timing::DumpConfiguration(std::ofstream &os) const
 	os << misc::fmt("RfIntSize = %d\n", RegisterFile::getIntegerSize());
 	os << misc::fmt("RfFpSize = %d\n", RegisterFile::getFloatingPointSize());
 	os << misc::fmt("RfXmmSize = %d\n", RegisterFile::getXmmSize());
+	os << misc::fmt("MemoryDependence = %s\n", MemoryDependencePredictor::KindMap[MemoryDependencePredictor::getKind()]);
+	os << misc::fmt("StoreForwardLatency = %d\n", MemoryDependencePredictor::getStoreForwardLatency());
+	os << misc::fmt("StoreSetTableSize = %d\n", MemoryDependencePredictor::getStoreSetTableSize());
+	os << misc::fmt("StoreSetCount = %d\n", MemoryDependencePredictor::getNumStoreSets());
 	os << std::endl;
 
 	// Trace Cache
@@ -1123,6 +1659,17 @@ void Timing::DumpConfiguration(std::ofstream &os) const
 	os << misc::fmt("QueueSize = %d\n", TraceCache::getQueueSize());
 	os << misc::fmt("\n");
 
+	// Uop cache
+	os << misc::fmt("[ Config.UopCache ]\n");
+	os << misc::fmt("Present = %s\n", UopCache::isPresent() ? "True" : "False");
+	os << misc::fmt("Sets = %d\n", UopCache::getNumSets());
+	os << misc::fmt("Assoc = %d\n", UopCache::getNumWays());
+	os << misc::fmt("WindowSize = %d\n", UopCache::getWindowSize());
+	os << misc::fmt("UopsPerLine = %d\n", UopCache::getUopsPerLine());
+	os << misc::fmt("LinesPerWindow = %d\n", UopCache::getLinesPerWindow());
+	os << misc::fmt("SwitchPenalty = %d\n", UopCache::getSwitchPenalty());
+	os << misc::fmt("\n");
+
 	// ALU
 	Alu::DumpConfiguration(os);
 
@@ -1138,8 +1685,29 @@ void Timing::DumpConfiguration(std::ofstream &os) const
 	os << misc::fmt("TwoLevel.L2Size = %d\n", BranchPredictor::getTwoLevelL2Size());
 	os << misc::fmt("TwoLevel.L2Height = %d\n", BranchPredictor::getTwoLevelL2Height());
 	os << misc::fmt("TwoLevel.HistorySize = %d\n", BranchPredictor::getTwoLevelHistorySize());
+	os << misc::fmt("TAGE.BaseSize = %d\n", BranchPredictor::getTageBaseSize());
+	os << misc::fmt("TAGE.NumTables = %d\n", BranchPredictor::getTageNumTables());
+	os << misc::fmt("TAGE.TableSize = %d\n", BranchPredictor::getTageTableSize());
+	os << misc::fmt("TAGE.TagBits = %d\n", BranchPredictor::getTageTagBits());
+	os << misc::fmt("TAGE.MinHistory = %d\n", BranchPredictor::getTageMinHistory());
+	os << misc::fmt("TAGE.MaxHistory = %d\n", BranchPredictor::getTageMaxHistory());
+	os << misc::fmt("Perceptron.NumTables = %d\n", BranchPredictor::getPerceptronNumTables());
+	os << misc::fmt("Perceptron.TableSize = %d\n", BranchPredictor::getPerceptronTableSize());
+	os << misc::fmt("Perceptron.MaxHistory = %d\n", BranchPredictor::getPerceptronMaxHistory());
+	os << misc::fmt("Indirect = %s\n", BranchPredictor::IndirectKindMap[BranchPredictor::getIndirectKind()]);
+	os << misc::fmt("ITTAGE.NumTables = %d\n", BranchPredictor::getIttageNumTables());
+	os << misc::fmt("ITTAGE.TableSize = %d\n", BranchPredictor::getIttageTableSize());
+	os << misc::fmt("ITTAGE.TagBits = %d\n", BranchPredictor::getIttageTagBits());
+	os << misc::fmt("ITTAGE.MinHistory = %d\n", BranchPredictor::getIttageMinHistory());
+	os << misc::fmt("ITTAGE.MaxHistory = %d\n", BranchPredictor::getIttageMaxHistory());
 	os << misc::fmt("\n");
 
+	// Sampling
+	Sampler::DumpConfiguration(os);
+
+	// Region of interest
+	RegionOfInterest::DumpConfiguration(os);
+
 	// End of configuration
 	os << '\n';
 }
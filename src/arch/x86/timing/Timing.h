@@ -20,6 +20,8 @@
 #ifndef ARCH_X86_TIMING_TIMING_H
 #define ARCH_X86_TIMING_TIMING_H
 
+#include <fstream>
+
 #include <lib/cpp/String.h>
 #include <lib/cpp/Debug.h>
 #include <lib/cpp/CommandLine.h>
@@ -30,6 +32,8 @@
 
 #include "BranchPredictor.h"
 #include "Cpu.h"
+#include "RegionOfInterest.h"
+#include "Sampler.h"
 #include "TraceCache.h"
 
 
@@ -61,6 +65,12 @@ class Timing : public comm::Timing
 	// Report file name
 	static std::string report_file;
 
+	// File name for the CPI stack time series
+	static std::string cpi_stack_file;
+
+	// Interval in cycles between samples of the CPI stack time series
+	static long long cpi_stack_interval;
+
 	// If true, show a message describing the format for the x86
 	// configuration file. Passed with option --x86-help.
 	static bool help;
@@ -80,13 +90,52 @@ class Timing : public comm::Timing
 	// CPU object
 	std::unique_ptr<Cpu> cpu;
 
+	// Sampler controlling periodic detailed simulation, or null if
+	// sampling is disabled
+	std::unique_ptr<Sampler> sampler;
+
+	// Processing of magic instructions executed by guest programs
+	std::unique_ptr<RegionOfInterest> region_of_interest;
+
 	// List of entry modules to the memory hierarchy
 	std::vector<mem::Module *> entry_modules;
 
+	// Output stream for the CPI stack time series. The last interval,
+	// usually shorter than the others, is added when the report is dumped.
+	mutable std::ofstream cpi_stack_stream;
+
+	// CPI stacks of all threads at the end of the last interval of the
+	// time series, one array of CpiComponentCount elements per thread
+	mutable std::vector<long long> cpi_stack_last;
+
+	// Last cycle when the CPI stacks were updated
+	long long cpi_stack_cycle = 0;
+
+	// Cycle of the last line of the CPI stack time series
+	mutable long long cpi_stack_dumped_cycle = 0;
+
 	// Dump a specific part of a statistics report related with uops.
 	void DumpUopReport(std::ostream &os, const long long *uop_stats,
 			const std::string &prefix, int peak_ipc) const;
 
+	// Dump the CPI stack resulting from adding up the commit slots of the
+	// given threads
+	void DumpCpiStack(std::ostream &os,
+			const std::vector<Thread *> &threads) const;
+
+	// Dump one line per thread to the CPI stack time series, with the
+	// commit slots of the interval that just finished
+	void DumpCpiStackInterval() const;
+
+	// Add the cycles simulated after the last line of the CPI stack time
+	// series, if any
+	void FlushCpiStack() const;
+
+	// In the interval model, advance the simulation time directly to the
+	// next cycle in which any thread has work to do, or in which a memory
+	// access can complete, accounting for the slots lost in between
+	void SkipIntervalCycles();
+
 public:
 
 	//
@@ -116,6 +165,15 @@ public:
 
 	/// Destroy the singleton if allocated.
 	static void Destroy() { instance = nullptr; }
+
+	/// Set the file and interval of the CPI stack time series, as given
+	/// with options '--x86-cpi-stack' and '--x86-cpi-stack-interval'. The
+	/// file is opened when the timing simulator is created.
+	static void setCpiStackFile(const std::string &file, long long interval)
+	{
+		cpi_stack_file = file;
+		cpi_stack_interval = interval;
+	}
 	
 	/// Timing simulator trace
 	static esim::Trace trace;
@@ -140,9 +198,30 @@ public:
 		return cpu.get();
 	}
 
+	/// Return the sampler, or null if sampling is disabled
+	Sampler *getSampler() const { return sampler.get(); }
+
+	/// Return the object processing magic instructions
+	RegionOfInterest *getRegionOfInterest() const
+	{
+		return region_of_interest.get();
+	}
+
 	/// Fast forward instructions set up by the user
 	void FastForward();
 
+	/// Run up to the given number of instructions functionally, outside
+	/// of the pipeline model. If functional warming is enabled, caches,
+	/// branch predictors, and trace caches are updated with the execution
+	/// of each instruction. Finished contexts that are not mapped to a
+	/// hardware thread are freed. Execution stops early after a magic
+	/// instruction.
+	///
+	/// \return
+	///	Number of instructions executed
+	///
+	long long RunFunctional(long long num_instructions);
+
 	/// Run one iteration of the cpu timing simuation.
 	/// \return This function \c true if the iteration had a useful
 	/// timing simulation, and \c false if all timing simulation finished
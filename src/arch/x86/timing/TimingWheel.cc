@@ -0,0 +1,130 @@
+/*
+ *  Multi2Sim
+ *  Copyright (C) 2012  Rafael Ubal (ubal@ece.neu.edu)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <algorithm>
+
+#include <lib/cpp/Error.h>
+
+#include "TimingWheel.h"
+
+
+namespace x86
+{
+
+void TimingWheel::InsertInBucket(std::vector<Uop *> &bucket, Uop *uop)
+{
+	// Uops usually arrive in order, so check the tail first
+	if (bucket.empty() || isEarlier(bucket.back(), uop))
+		bucket.push_back(uop);
+	else
+		bucket.insert(std::upper_bound(bucket.begin(), bucket.end(),
+				uop, isEarlier), uop);
+	num_bucket_uops++;
+}
+
+
+void TimingWheel::Advance()
+{
+	// The current bucket must have been drained
+	assert(buckets[base & (num_buckets - 1)].empty());
+	base++;
+
+	// Bring uops from the overflow heap
+	while (!overflow.empty() && overflow.front()->complete_when <
+			base + num_buckets)
+	{
+		std::pop_heap(overflow.begin(), overflow.end(), isLater);
+		Uop *uop = overflow.back();
+		overflow.pop_back();
+		InsertInBucket(*getBucket(uop->complete_when), uop);
+	}
+}
+
+
+void TimingWheel::Insert(Uop *uop)
+{
+	std::vector<Uop *> *bucket = getBucket(uop->complete_when);
+	if (bucket)
+	{
+		InsertInBucket(*bucket, uop);
+	}
+	else
+	{
+		overflow.push_back(uop);
+		std::push_heap(overflow.begin(), overflow.end(), isLater);
+	}
+}
+
+
+void TimingWheel::Erase(Uop *uop)
+{
+	// Uop in a bucket
+	std::vector<Uop *> *bucket = getBucket(uop->complete_when);
+	if (bucket)
+	{
+		for (auto it = bucket->begin(); it != bucket->end(); ++it)
+		{
+			if (*it == uop)
+			{
+				bucket->erase(it);
+				num_bucket_uops--;
+				return;
+			}
+		}
+		throw misc::Panic("Uop not found in its bucket");
+	}
+
+	// Uop in the overflow heap
+	auto it = std::find(overflow.begin(), overflow.end(), uop);
+	if (it == overflow.end())
+		throw misc::Panic("Uop not found in overflow heap");
+	*it = overflow.back();
+	overflow.pop_back();
+	std::make_heap(overflow.begin(), overflow.end(), isLater);
+}
+
+
+Uop *TimingWheel::Front()
+{
+	// Sanity
+	assert(!isEmpty());
+
+	// Skip empty buckets. If all buckets are empty, jump straight to the
+	// cycle of the earliest uop in the overflow heap.
+	while (buckets[base & (num_buckets - 1)].empty())
+	{
+		if (!num_bucket_uops)
+			base = overflow.front()->complete_when - 1;
+		Advance();
+	}
+
+	// Earliest uop in current bucket
+	return buckets[base & (num_buckets - 1)].front();
+}
+
+
+void TimingWheel::getUops(std::vector<Uop *> &uops) const
+{
+	for (auto &bucket : buckets)
+		uops.insert(uops.end(), bucket.begin(), bucket.end());
+	uops.insert(uops.end(), overflow.begin(), overflow.end());
+}
+
+
+}
@@ -0,0 +1,116 @@
+/*
+ *  Multi2Sim
+ *  Copyright (C) 2012  Rafael Ubal (ubal@ece.neu.edu)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef ARCH_X86_TIMING_TIMING_WHEEL_H
+#define ARCH_X86_TIMING_TIMING_WHEEL_H
+
+#include <cassert>
+#include <vector>
+
+#include "Uop.h"
+
+
+namespace x86
+{
+
+/// Queue of issued uops sorted by completion cycle (field 'complete_when'),
+/// and by identifier for uops completing in the same cycle. Uops completing
+/// within the next 'num_buckets' cycles are kept in one bucket per cycle.
+/// Uops with longer latencies wait in an overflow heap until their cycle
+/// enters the wheel.
+class TimingWheel
+{
+	// Number of buckets, must be a power of two
+	static const int num_buckets = 256;
+
+	// Buckets, each sorted by completion cycle and identifier. Bucket
+	// 'base % num_buckets' also holds uops inserted with a completion
+	// cycle earlier than 'base'.
+	std::vector<Uop *> buckets[num_buckets];
+
+	// Uops completing at or after cycle 'base + num_buckets', stored as a
+	// heap with the earliest uop at the top
+	std::vector<Uop *> overflow;
+
+	// First cycle covered by the wheel. It never moves past a non-empty
+	// bucket.
+	long long base = 0;
+
+	// Number of uops in the buckets
+	int num_bucket_uops = 0;
+
+	// Return true if uop 'a' completes before uop 'b'
+	static bool isEarlier(Uop *a, Uop *b)
+	{
+		return a->complete_when != b->complete_when ?
+				a->complete_when < b->complete_when :
+				a->getId() < b->getId();
+	}
+
+	// Comparison for the overflow heap, placing the earliest uop first
+	static bool isLater(Uop *a, Uop *b)
+	{
+		return isEarlier(b, a);
+	}
+
+	// Return the bucket where a uop with the given completion cycle is
+	// stored, or null if it belongs to the overflow heap.
+	std::vector<Uop *> *getBucket(long long cycle)
+	{
+		if (cycle < base)
+			cycle = base;
+		if (cycle >= base + num_buckets)
+			return nullptr;
+		return &buckets[cycle & (num_buckets - 1)];
+	}
+
+	// Insert a uop into its sorted position in a bucket
+	void InsertInBucket(std::vector<Uop *> &bucket, Uop *uop);
+
+	// Move the wheel to the next cycle, and bring uops of the overflow
+	// heap that now fall in the wheel into their buckets.
+	void Advance();
+
+public:
+
+	/// Insert a uop, using its completion cycle
+	void Insert(Uop *uop);
+
+	/// Extract a uop from any position
+	void Erase(Uop *uop);
+
+	/// Return the uop with the earliest completion. The wheel must not be
+	/// empty.
+	Uop *Front();
+
+	/// Return the number of uops
+	int getSize() const { return num_bucket_uops + overflow.size(); }
+
+	/// Return whether there is no uop in the wheel
+	bool isEmpty() const { return getSize() == 0; }
+
+	/// Add all uops in the wheel to the given vector, in no particular
+	/// order
+	void getUops(std::vector<Uop *> &uops) const;
+};
+
+
+}
+
+#endif
@@ -265,59 +265,51 @@ public:
 	/// True if the instruction is currently in the fetch queue
 	bool in_fetch_queue = false;
 
-	/// Position of the uop in the thread's fetch queue
-	std::list<std::shared_ptr<Uop>>::iterator fetch_queue_iterator;
-
 	/// True if the instruction is currently in the uop queue
 	bool in_uop_queue = false;
 
-	/// Position of the uop in the thread's uop queue
-	std::list<std::shared_ptr<Uop>>::iterator uop_queue_iterator;
+	/// True if the instruction was replayed and is waiting for room in
+	/// the uop queue
+	bool in_replay_queue = false;
 
 	/// True if the instruction is currently in the core's event queue
 	bool in_event_queue = false;
 
-	/// Position of the uop in the core's event queue, or past-the-end
-	/// iterator to this queue if not present.
-	std::list<std::shared_ptr<Uop>>::iterator event_queue_iterator;
-
 	/// True if the instruction is currently present in the thread's
 	/// reorder buffer
 	bool in_reorder_buffer = false;
 
-	/// Position of the uop in the reorder buffer, if present
-	std::list<std::shared_ptr<Uop>>::iterator reorder_buffer_iterator;
-
 	/// True if the instruction is currently present in the thread's
 	/// instruction queue
 	bool in_instruction_queue = false;
 
-	/// Position of the uop in the thread's instruction queue, or past-the-
-	/// end iterator to this queue if not present.
-	std::list<std::shared_ptr<Uop>>::iterator instruction_queue_iterator;
+	/// Position of the uop in the thread's instruction queue, if present
+	long long instruction_queue_position = 0;
+
+	/// True if the instruction is in the thread's list of uops of the
+	/// instruction queue that are ready to issue
+	bool in_ready_list = false;
 
 	/// True if the instruction is currently present in the thread's
 	/// load queue
 	bool in_load_queue = false;
 
-	/// Position of the uop in the thread's load queue, or past-the-end
-	/// iterator to this queue if not present.
-	std::list<std::shared_ptr<Uop>>::iterator load_queue_iterator;
+	/// Position of the uop in the thread's load queue, if present
+	long long load_queue_position = 0;
 
 	/// True if the instruction is currently present in the thread's
 	/// store queue
 	bool in_store_queue = false;
 
-	/// Position of the uop in the thread's store queue, or past-the-end
-	/// iterator to this queue if not present.
-	std::list<std::shared_ptr<Uop>>::iterator store_queue_iterator;
+	/// Position of the uop in the thread's store queue, if present
+	long long store_queue_position = 0;
 
 	/// True if the instruction is currently present in the uop trace list
 	/// of the CPU
 	bool in_trace_list = false;
 
 	/// Position of the uop in the CPU's trace list, if present
-	std::list<std::shared_ptr<Uop>>::iterator trace_list_iterator;
+	std::list<Uop *>::iterator trace_list_iterator;
 
 
 
@@ -360,6 +352,9 @@ public:
 
 	/// Flag indicating whether the uop was fetched from the trace cache
 	bool from_trace_cache = false;
+
+	/// Flag indicating whether the uop was fetched from the uop cache
+	bool from_uop_cache = false;
 	
 	/// Physical address that this uop was fetched from
 	unsigned fetch_address = 0;
@@ -370,9 +365,20 @@ public:
 	// For memory uops, unique identifier of memory access
 	long long memory_access = 0;
 
+	/// Number of memory accesses in flight for this uop. The uop is not
+	/// freed while it is not zero.
+	int num_memory_accesses = 0;
+
 	/// Access identifier for instruction fetch
 	long long fetch_access = 0;
 
+	/// Cycle when the uop was fetched
+	long long fetch_when = 0;
+
+	/// Cycle when the uop was inserted in the uop queue, or 0 if it
+	/// was not decoded yet
+	long long decode_when = 0;
+
 
 
 
@@ -413,10 +419,69 @@ public:
 
 	/// Prediction in the combined branch predictor
 	BranchPredictor::Prediction choice_prediction = BranchPredictor::PredictionNotTaken;
+
+	/// Indices of the TAGE or perceptron tables read for the prediction
+	uint16_t predictor_indices[BranchPredictor::MaxTables] = {};
+
+	/// Tags computed for the TAGE tables
+	uint16_t predictor_tags[BranchPredictor::MaxTables] = {};
+
+	/// Index of the TAGE base predictor
+	int tage_base_index = 0;
+
+	/// TAGE table providing the prediction, or -1 if it comes from the
+	/// base predictor
+	int tage_provider = -1;
+
+	/// Prediction of the TAGE provider table
+	BranchPredictor::Prediction tage_provider_prediction = BranchPredictor::PredictionNotTaken;
+
+	/// Alternate TAGE prediction, given by the next table with a matching
+	/// tag, or by the base predictor
+	BranchPredictor::Prediction tage_alternate_prediction = BranchPredictor::PredictionNotTaken;
+
+	/// Output of the perceptron predictor
+	int perceptron_output = 0;
+
+	/// Indices of the ITTAGE tables read for the prediction
+	uint16_t ittage_indices[BranchPredictor::MaxTables] = {};
+
+	/// Tags computed for the ITTAGE tables
+	uint16_t ittage_tags[BranchPredictor::MaxTables] = {};
+
+	/// ITTAGE table providing the target, or -1 if none
+	int ittage_provider = -1;
+
+	/// Target predicted by the ITTAGE predictor, or 0 if none
+	unsigned ittage_target = 0;
 	
 	
 	
 	
+	//
+	// Memory dependences
+	//
+
+	/// For loads, identifier of the older store that the memory dependence
+	/// predictor expects to write the same address, or 0 if none
+	long long store_set_dependence = 0;
+
+	/// For loads, identifier of the store that provided the data through
+	/// the store queue, or 0 if the data was read from memory
+	long long forwarding_store = 0;
+
+	/// For stores, true once younger loads were checked for memory order
+	/// violations after the store was resolved
+	bool memory_order_checked = false;
+
+	/// True if the uop was removed from the pipeline by a replay after a
+	/// memory order violation. Dispatching it again does not count as a
+	/// new dispatched uop in the statistics.
+	bool replayed = false;
+
+
+
+
 	//
 	// State
 	//
@@ -430,6 +495,10 @@ public:
 	/// True if uop is ready to be issued
 	bool ready = false;
 
+	/// Number of input registers that were pending when the uop was
+	/// renamed, and have not been written back yet
+	int num_pending_inputs = 0;
+
 	/// Cycle when uop was made ready, or 0 if not ready yet
 	long long ready_when = 0;
 
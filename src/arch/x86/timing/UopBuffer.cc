@@ -0,0 +1,79 @@
+/*
+ *  Multi2Sim
+ *  Copyright (C) 2012  Rafael Ubal (ubal@ece.neu.edu)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "UopBuffer.h"
+
+
+namespace x86
+{
+
+UopBuffer::UopBuffer(int capacity, long long Uop::*position_field) :
+		position_field(position_field)
+{
+	Rebuild(capacity);
+}
+
+
+void UopBuffer::Rebuild(int capacity)
+{
+	// Round up to a power of two
+	int num_entries = 1;
+	while (num_entries < capacity)
+		num_entries <<= 1;
+
+	// Move uops in order, skipping holes
+	std::vector<Uop *> new_entries(num_entries);
+	long long position = 0;
+	for (long long i = head; i < tail; i++)
+	{
+		Uop *uop = entries[i & mask];
+		if (!uop)
+			continue;
+		if (position_field)
+			uop->*position_field = position;
+		new_entries[position] = uop;
+		position++;
+	}
+	assert(position == size);
+
+	// New state
+	entries = std::move(new_entries);
+	mask = num_entries - 1;
+	head = 0;
+	tail = position;
+}
+
+
+void UopBuffer::Erase(Uop *uop)
+{
+	// Sanity
+	assert(position_field);
+	long long position = uop->*position_field;
+	assert(position >= head && position < tail);
+	assert(entries[position & mask] == uop);
+
+	// Leave a hole. Only holes at the head are trimmed, so that positions
+	// of iterators in use remain valid.
+	entries[position & mask] = nullptr;
+	size--;
+	TrimHead();
+}
+
+
+}
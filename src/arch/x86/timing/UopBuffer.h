@@ -0,0 +1,210 @@
+/*
+ *  Multi2Sim
+ *  Copyright (C) 2012  Rafael Ubal (ubal@ece.neu.edu)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef ARCH_X86_TIMING_UOP_BUFFER_H
+#define ARCH_X86_TIMING_UOP_BUFFER_H
+
+#include <cassert>
+#include <vector>
+
+#include "Uop.h"
+
+
+namespace x86
+{
+
+/// Circular buffer holding the uops of a pipeline queue in program order.
+/// Its entries are allocated once with the configured queue size. Uops are
+/// inserted at the tail, and extracted from the head or the tail. Queues
+/// that release uops out of order (instruction queue, load-store queue)
+/// provide a uop field where the buffer stores the position of each uop.
+/// Extracting a uop by its position leaves a hole, which iterators skip,
+/// and which is reclaimed when the tail reaches the end of the buffer. The
+/// buffer does not own its uops, which belong to the thread's uop pool.
+class UopBuffer
+{
+	// Entries, with a power-of-two size
+	std::vector<Uop *> entries;
+
+	// Mask applied to a position to obtain an index in 'entries'
+	long long mask = 0;
+
+	// Position of the head entry and past the tail entry. Positions grow
+	// monotonically until the buffer is rebuilt.
+	long long head = 0;
+	long long tail = 0;
+
+	// Number of uops in the buffer, not counting holes
+	int size = 0;
+
+	// Uop field where the buffer stores the position of each uop, or
+	// null if uops can only be extracted from the head or tail
+	long long Uop::*position_field;
+
+	// Move all uops to the beginning of a new set of entries with the
+	// given size, discarding holes and updating uop positions.
+	void Rebuild(int capacity);
+
+	// Skip holes at the head
+	void TrimHead()
+	{
+		while (head < tail && !entries[head & mask])
+			head++;
+	}
+
+public:
+
+	/// Iterator to a uop in the buffer
+	class Iterator
+	{
+		// Only the buffer can create an iterator
+		friend class UopBuffer;
+
+		// Buffer that the iterator traverses
+		const UopBuffer *buffer;
+
+		// Position in the buffer
+		long long position;
+
+		// Constructor
+		Iterator(const UopBuffer *buffer, long long position) :
+				buffer(buffer),
+				position(position)
+		{
+		}
+
+	public:
+
+		/// Compare two iterators
+		bool operator!=(const Iterator &right) const
+		{
+			return position != right.position;
+		}
+
+		/// Compare two iterators
+		bool operator==(const Iterator &right) const
+		{
+			return position == right.position;
+		}
+
+		/// Advance to the next uop, skipping holes
+		const Iterator &operator++()
+		{
+			assert(position < buffer->tail);
+			do
+			{
+				position++;
+			} while (position < buffer->tail &&
+					!buffer->entries[position & buffer->mask]);
+			return *this;
+		}
+
+		/// Return the uop pointed to by the iterator
+		Uop *operator*() const
+		{
+			assert(buffer->entries[position & buffer->mask]);
+			return buffer->entries[position & buffer->mask];
+		}
+	};
+
+	/// Constructor
+	///
+	/// \param capacity
+	///	Number of entries allocated initially. The buffer grows if more
+	///	uops are inserted, as it happens with queues whose size is not
+	///	given in uops.
+	///
+	/// \param position_field
+	///	Uop field where the position of each uop is stored, needed to
+	///	extract uops with Erase().
+	///
+	UopBuffer(int capacity, long long Uop::*position_field = nullptr);
+
+	/// Return the number of uops in the buffer
+	int getSize() const { return size; }
+
+	/// Return whether the buffer contains no uop
+	bool isEmpty() const { return size == 0; }
+
+	/// Return an iterator to the head uop. Iterators remain valid when
+	/// other uops are extracted, but not when a uop is inserted.
+	Iterator begin() const { return Iterator(this, head); }
+
+	/// Return a past-the-end iterator
+	Iterator end() const { return Iterator(this, tail); }
+
+	/// Return the uop at the head
+	Uop *Front() const
+	{
+		assert(size > 0);
+		return entries[head & mask];
+	}
+
+	/// Return the uop at the tail
+	Uop *Back() const
+	{
+		assert(size > 0);
+		assert(entries[(tail - 1) & mask]);
+		return entries[(tail - 1) & mask];
+	}
+
+	/// Insert a uop at the tail
+	void PushBack(Uop *uop)
+	{
+		if (tail - head == (long long) entries.size())
+			Rebuild(size < (int) entries.size() ?
+					entries.size() :
+					entries.size() * 2);
+		if (position_field)
+			uop->*position_field = tail;
+		entries[tail & mask] = uop;
+		tail++;
+		size++;
+	}
+
+	/// Extract the uop at the head
+	void PopFront()
+	{
+		assert(size > 0);
+		entries[head & mask] = nullptr;
+		size--;
+		TrimHead();
+	}
+
+	/// Extract the uop at the tail
+	void PopBack()
+	{
+		assert(size > 0);
+		assert(entries[(tail - 1) & mask]);
+		entries[(tail - 1) & mask] = nullptr;
+		tail--;
+		size--;
+		while (tail > head && !entries[(tail - 1) & mask])
+			tail--;
+	}
+
+	/// Extract a uop from any position, using the position stored in the
+	/// uop when inserted.
+	void Erase(Uop *uop);
+};
+
+
+}
+
+#endif
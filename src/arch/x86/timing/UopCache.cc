@@ -0,0 +1,216 @@
+/*
+ *  Multi2Sim
+ *  Copyright (C) 2015  Rafael Ubal (ubal@ece.neu.edu)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <lib/cpp/Misc.h>
+#include <lib/cpp/String.h>
+
+#include "UopCache.h"
+
+
+namespace x86
+{
+
+bool UopCache::present;
+int UopCache::num_sets;
+int UopCache::num_ways;
+int UopCache::window_size;
+int UopCache::uops_per_line;
+int UopCache::lines_per_window;
+int UopCache::switch_penalty;
+
+
+void UopCache::ParseConfiguration(misc::IniFile *ini_file)
+{
+	// Section
+	std::string section = "UopCache";
+
+	// Read variables
+	present = ini_file->ReadBool(section, "Present", false);
+	num_sets = ini_file->ReadInt(section, "Sets", 32);
+	num_ways = ini_file->ReadInt(section, "Assoc", 8);
+	window_size = ini_file->ReadInt(section, "WindowSize", 32);
+	uops_per_line = ini_file->ReadInt(section, "UopsPerLine", 6);
+	lines_per_window = ini_file->ReadInt(section, "LinesPerWindow", 3);
+	switch_penalty = ini_file->ReadInt(section, "SwitchPenalty", 2);
+
+	// Integrity checks
+	if ((num_sets & (num_sets - 1)) || !num_sets)
+		throw Error(misc::fmt("%s: 'Sets' must be a power of 2 greater than 0", section.c_str()));
+	if (num_ways < 1)
+		throw Error(misc::fmt("%s: 'Assoc' must be greater than 0", section.c_str()));
+	if ((window_size & (window_size - 1)) || window_size < 16)
+		throw Error(misc::fmt("%s: 'WindowSize' must be a power of 2 greater or equal than 16", section.c_str()));
+	if (uops_per_line < 1)
+		throw Error(misc::fmt("%s: 'UopsPerLine' must be greater than 0", section.c_str()));
+	if (lines_per_window < 1 || lines_per_window > num_ways)
+		throw Error(misc::fmt("%s: 'LinesPerWindow' must be between 1 and 'Assoc'", section.c_str()));
+	if (switch_penalty < 0)
+		throw Error(misc::fmt("%s: 'SwitchPenalty' must be greater or equal than 0", section.c_str()));
+}
+
+
+void UopCache::DumpConfiguration(std::ostream &os)
+{
+	os << "; Uop cache - parameters\n";
+	os << misc::fmt("UopCache.Sets = %d\n", num_sets);
+	os << misc::fmt("UopCache.Assoc = %d\n", num_ways);
+	os << misc::fmt("UopCache.WindowSize = %d\n", window_size);
+	os << misc::fmt("UopCache.UopsPerLine = %d\n", uops_per_line);
+	os << misc::fmt("UopCache.LinesPerWindow = %d\n", lines_per_window);
+	os << misc::fmt("UopCache.SwitchPenalty = %d\n", switch_penalty);
+	os << '\n';
+}
+
+
+UopCache::UopCache(const std::string &name) :
+		name(name)
+{
+	lines = misc::new_unique_array<Line>(num_sets * num_ways);
+}
+
+
+bool UopCache::Contains(unsigned eip) const
+{
+	unsigned window = getWindow(eip);
+	Line *set = &lines[(window / window_size) % num_sets * num_ways];
+	for (int way = 0; way < num_ways; way++)
+		if (set[way].valid && set[way].tag == window)
+			return true;
+	return false;
+}
+
+
+bool UopCache::Lookup(unsigned eip)
+{
+	// Update all lines of the window
+	unsigned window = getWindow(eip);
+	Line *set = &lines[(window / window_size) % num_sets * num_ways];
+	bool hit = false;
+	access_counter++;
+	for (int way = 0; way < num_ways; way++)
+	{
+		Line &line = set[way];
+		if (line.valid && line.tag == window)
+		{
+			line.counter = access_counter;
+			hit = true;
+		}
+	}
+
+	// Statistics
+	num_accesses++;
+	if (hit)
+		num_hits++;
+	return hit;
+}
+
+
+void UopCache::Fill()
+{
+	// Nothing decoded, or window already present
+	if (!fill_num_uops || Contains(fill_window))
+		return;
+
+	// Windows with too many uops are not cached
+	int num_lines = (fill_num_uops + uops_per_line - 1) / uops_per_line;
+	if (num_lines > lines_per_window)
+	{
+		num_uncacheable++;
+		return;
+	}
+
+	// Insert lines, replacing the least recently used ones. All lines of a
+	// window are evicted together.
+	Line *set = &lines[(fill_window / window_size) % num_sets * num_ways];
+	access_counter++;
+	for (int i = 0; i < num_lines; i++)
+	{
+		// Find victim
+		Line *victim = &set[0];
+		for (int way = 0; way < num_ways; way++)
+		{
+			Line &line = set[way];
+			if (!line.valid)
+			{
+				victim = &line;
+				break;
+			}
+			if (line.counter < victim->counter)
+				victim = &line;
+		}
+
+		// Evict the window in the victim line
+		if (victim->valid)
+		{
+			unsigned tag = victim->tag;
+			for (int way = 0; way < num_ways; way++)
+				if (set[way].valid && set[way].tag == tag)
+					set[way].valid = false;
+		}
+
+		// Insert line
+		victim->tag = fill_window;
+		victim->valid = true;
+		victim->counter = access_counter;
+	}
+
+	// Statistics
+	num_fills++;
+}
+
+
+void UopCache::Record(unsigned eip, int num_uops)
+{
+	// Start a new window
+	unsigned window = getWindow(eip);
+	if (window != fill_window || eip <= fill_last_eip)
+	{
+		Fill();
+		fill_window = window;
+		fill_num_uops = 0;
+	}
+
+	// Add uops
+	fill_num_uops += num_uops;
+	fill_last_eip = eip;
+}
+
+
+void UopCache::DumpReport(std::ostream &os) const
+{
+	// Dump the configuration
+	DumpConfiguration(os);
+
+	// Statistics
+	os << "; Uop cache - statistics\n";
+	os << misc::fmt("UopCache.Accesses = %lld\n", num_accesses);
+	os << misc::fmt("UopCache.Hits = %lld\n", num_hits);
+	os << misc::fmt("UopCache.HitRatio = %.4g\n", num_accesses ?
+			(double) num_hits / num_accesses : 0.0);
+	os << misc::fmt("UopCache.Fetched = %lld\n", num_fetched_uinsts);
+	os << misc::fmt("UopCache.Switches = %lld\n", num_switches);
+	os << misc::fmt("UopCache.Fills = %lld\n", num_fills);
+	os << misc::fmt("UopCache.Uncacheable = %lld\n", num_uncacheable);
+
+	// Done
+	os << '\n';
+}
+
+
+}  // namespace x86
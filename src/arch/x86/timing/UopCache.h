@@ -0,0 +1,235 @@
+/*
+ *  Multi2Sim
+ *  Copyright (C) 2015  Rafael Ubal (ubal@ece.neu.edu)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef ARCH_X86_TIMING_UOP_CACHE_H
+#define ARCH_X86_TIMING_UOP_CACHE_H
+
+#include <iostream>
+#include <memory>
+#include <string>
+
+#include <lib/cpp/Error.h>
+#include <lib/cpp/IniFile.h>
+
+
+namespace x86
+{
+
+/// Cache of decoded uops, indexed by the address of the aligned fetch window
+/// that the macro-instructions come from. The uops of one window are stored
+/// in up to a given number of lines of the same set, each holding a limited
+/// number of uops. Windows are filled by the decoders, and fetch hits let
+/// the uops bypass the instruction cache and the decode width.
+class UopCache
+{
+	// Line in the uop cache
+	struct Line
+	{
+		// Address of the fetch window
+		unsigned tag = 0;
+
+		// True if the line contains uops
+		bool valid = false;
+
+		// Value of the access counter in the last access, used for the
+		// LRU replacement policy
+		long long counter = 0;
+	};
+
+	//
+	// Static fields
+	//
+
+	// Flag indicating whether the uop cache is present
+	static bool present;
+
+	// Number of sets
+	static int num_sets;
+
+	// Number of lines per set
+	static int num_ways;
+
+	// Size of a fetch window in bytes
+	static int window_size;
+
+	// Maximum number of uops in a line
+	static int uops_per_line;
+
+	// Maximum number of lines holding the uops of a window
+	static int lines_per_window;
+
+	// Cycles lost when fetch switches from the uop cache to the
+	// instruction cache and decoders
+	static int switch_penalty;
+
+
+
+
+	//
+	// Class members
+	//
+
+	// Name of the uop cache
+	std::string name;
+
+	// Lines, with 'num_ways' consecutive lines in each set
+	std::unique_ptr<Line[]> lines;
+
+	// Counter incremented in every access
+	long long access_counter = 0;
+
+	// Window being filled by the decoders, and number of uops decoded for
+	// it so far
+	unsigned fill_window = 0;
+	int fill_num_uops = 0;
+
+	// Address of the last macro-instruction decoded for the window being
+	// filled
+	unsigned fill_last_eip = 0;
+
+	// Insert the window being filled in the cache
+	void Fill();
+
+
+
+
+	//
+	// Statistics
+	//
+
+	// Number of lookups
+	long long num_accesses = 0;
+
+	// Number of lookups that hit
+	long long num_hits = 0;
+
+	// Number of uops fetched from the uop cache
+	long long num_fetched_uinsts = 0;
+
+	// Number of switches from the uop cache to the decoders
+	long long num_switches = 0;
+
+	// Number of windows inserted
+	long long num_fills = 0;
+
+	// Number of windows decoded that had too many uops to be inserted
+	long long num_uncacheable = 0;
+
+public:
+
+	/// Exception for the x86 uop cache
+	class Error : public misc::Error
+	{
+	public:
+
+		Error(const std::string &message) : misc::Error(message)
+		{
+			AppendPrefix("X86 uop cache");
+		}
+	};
+
+
+
+
+	//
+	// Static functions
+	//
+
+	/// Read uop cache configuration from section [ UopCache ]
+	static void ParseConfiguration(misc::IniFile *ini_file);
+
+	/// Dump configuration
+	static void DumpConfiguration(std::ostream &os = std::cout);
+
+	/// Return whether the uop cache was configured as present
+	static bool isPresent() { return present; }
+
+	/// Return the number of sets
+	static int getNumSets() { return num_sets; }
+
+	/// Return the number of lines per set
+	static int getNumWays() { return num_ways; }
+
+	/// Return the size of a fetch window in bytes
+	static int getWindowSize() { return window_size; }
+
+	/// Return the maximum number of uops in a line
+	static int getUopsPerLine() { return uops_per_line; }
+
+	/// Return the maximum number of lines used by a window
+	static int getLinesPerWindow() { return lines_per_window; }
+
+	/// Return the cycles lost when switching from the uop cache to the
+	/// decoders
+	static int getSwitchPenalty() { return switch_penalty; }
+
+	/// Return the address of the fetch window containing an address
+	static unsigned getWindow(unsigned address)
+	{
+		return address & ~(window_size - 1);
+	}
+
+
+
+
+	//
+	// Class members
+	//
+
+	/// Constructor
+	UopCache(const std::string &name = "");
+
+	/// Look up the window containing the given instruction address. The
+	/// return value is true on a hit.
+	bool Lookup(unsigned eip);
+
+	/// Record a macro-instruction that went through the decoders,
+	/// producing the given number of uops. The window containing it is
+	/// inserted in the cache once all its instructions were decoded, that
+	/// is, when a macro-instruction outside of the window, or at a lower
+	/// address within it, is recorded.
+	void Record(unsigned eip, int num_uops);
+
+	/// Return true if the window containing the given address is in the
+	/// cache, without updating the replacement state or statistics
+	bool Contains(unsigned eip) const;
+
+	/// Increment the number of uops fetched from the uop cache
+	void incNumFetchedUinsts() { num_fetched_uinsts++; }
+
+	/// Increment the number of switches from the uop cache to the decoders
+	void incNumSwitches() { num_switches++; }
+
+	/// Return the number of lookups
+	long long getNumAccesses() const { return num_accesses; }
+
+	/// Return the number of lookups that hit
+	long long getNumHits() const { return num_hits; }
+
+	/// Return the number of uops fetched from the uop cache
+	long long getNumFetchedUinsts() const { return num_fetched_uinsts; }
+
+	/// Dump the uop cache report
+	void DumpReport(std::ostream &os = std::cout) const;
+};
+
+
+}  // namespace x86
+
+#endif
@@ -0,0 +1,85 @@
+/*
+ *  Multi2Sim
+ *  Copyright (C) 2012  Rafael Ubal (ubal@ece.neu.edu)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <algorithm>
+
+#include "UopPool.h"
+
+
+namespace x86
+{
+
+UopPool::~UopPool()
+{
+	// Destroy blocks that are not in the free list
+	std::sort(free_blocks.begin(), free_blocks.end());
+	for (auto &chunk : chunks)
+	{
+		for (int i = 0; i < chunk_size; i++)
+		{
+			void *block = chunk.get() + i * block_size;
+			if (!std::binary_search(free_blocks.begin(),
+					free_blocks.end(), block))
+				static_cast<Uop *>(block)->~Uop();
+		}
+	}
+}
+
+
+Uop *UopPool::NewUop(Thread *thread, Context *context,
+		std::shared_ptr<Uinst> uinst)
+{
+	// Allocate a new chunk if there is no free block
+	if (free_blocks.empty())
+	{
+		char *chunk = new char[block_size * chunk_size];
+		chunks.emplace_back(chunk);
+		for (int i = chunk_size - 1; i >= 0; i--)
+			free_blocks.push_back(chunk + i * block_size);
+	}
+
+	// Construct uop in a block taken from the free list
+	void *block = free_blocks.back();
+	free_blocks.pop_back();
+	return new (block) Uop(thread, context, std::move(uinst));
+}
+
+
+void UopPool::FreeIfNotQueued(Uop *uop)
+{
+	// Uop still in use
+	if (uop->in_fetch_queue ||
+			uop->in_uop_queue ||
+			uop->in_replay_queue ||
+			uop->in_event_queue ||
+			uop->in_reorder_buffer ||
+			uop->in_instruction_queue ||
+			uop->in_load_queue ||
+			uop->in_store_queue ||
+			uop->in_trace_list ||
+			uop->num_memory_accesses)
+		return;
+
+	// Destroy it and release its block
+	uop->~Uop();
+	free_blocks.push_back(uop);
+}
+
+
+}
@@ -0,0 +1,80 @@
+/*
+ *  Multi2Sim
+ *  Copyright (C) 2012  Rafael Ubal (ubal@ece.neu.edu)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef ARCH_X86_TIMING_UOP_POOL_H
+#define ARCH_X86_TIMING_UOP_POOL_H
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "Uop.h"
+
+
+namespace x86
+{
+
+/// Arena owning the uops of a hardware thread. Every fetched instruction
+/// creates uops, which are released when they leave the pipeline. The pool
+/// allocates uops in chunks and keeps released blocks in a free list, so
+/// that creating a uop does not go through the system allocator. Pipeline
+/// queues refer to uops with plain pointers. A uop is destroyed by
+/// FreeIfNotQueued() when it is not present in any queue and has no memory
+/// access in flight.
+class UopPool
+{
+	// Number of uops allocated at once when the free list is empty
+	static const int chunk_size = 256;
+
+	// Size of each block, a multiple of the alignment of a uop
+	static const std::size_t block_size = (sizeof(Uop) + alignof(Uop) - 1)
+			/ alignof(Uop) * alignof(Uop);
+
+	// Memory chunks
+	std::vector<std::unique_ptr<char[]>> chunks;
+
+	// Released blocks
+	std::vector<void *> free_blocks;
+
+public:
+
+	/// Destructor. Uops still allocated are destroyed.
+	~UopPool();
+
+	/// Create a uop in the pool. The arguments are the same as in the
+	/// constructor of class Uop.
+	Uop *NewUop(Thread *thread, Context *context,
+			std::shared_ptr<Uinst> uinst);
+
+	/// Destroy the uop and return its block to the pool, unless it is
+	/// still present in a queue of the pipeline or the CPU trace list,
+	/// or waits for a memory access. This function must be called each
+	/// time a uop leaves its last queue.
+	void FreeIfNotQueued(Uop *uop);
+
+	/// Return the number of blocks allocated in chunks
+	int getNumBlocks() const { return chunks.size() * chunk_size; }
+
+	/// Return the number of blocks in the free list
+	int getNumFreeBlocks() const { return free_blocks.size(); }
+};
+
+}
+
+#endif
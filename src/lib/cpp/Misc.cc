@@ -215,5 +215,30 @@ std::string getBaseName(const std::string &path)
 	return path.substr(0, dot_index);
 }
 
+
+
+
+
+//
+// Binary serialization
+//
+
+void WriteBinaryString(std::ostream &os, const std::string &s)
+{
+	unsigned size = s.size();
+	WriteBinary(os, size);
+	os.write(s.data(), size);
+}
+
+
+std::string ReadBinaryString(std::istream &is)
+{
+	unsigned size = 0;
+	ReadBinary(is, size);
+	std::string s(size, '\0');
+	is.read(&s[0], size);
+	return s;
+}
+
 }  // namespace Misc
 
@@ -245,6 +245,34 @@ template<typename T> std::unique_ptr<T[]>new_unique_array(int size)
 
 
 
+//
+// Binary serialization
+//
+
+/// Write the raw binary representation of a value into an output stream.
+/// The type must not contain pointers, since the value is meant to be read
+/// back by another process with ReadBinary().
+template<typename T> void WriteBinary(std::ostream &os, const T &value)
+{
+	os.write((const char *) &value, sizeof(T));
+}
+
+/// Read a value written with WriteBinary() from an input stream.
+template<typename T> void ReadBinary(std::istream &is, T &value)
+{
+	is.read((char *) &value, sizeof(T));
+}
+
+/// Write a string into an output stream, preceded by its length.
+void WriteBinaryString(std::ostream &os, const std::string &s);
+
+/// Read a string written with WriteBinaryString() from an input stream.
+std::string ReadBinaryString(std::istream &is);
+
+
+
+
+
 } // namespace misc
 
 #endif
@@ -0,0 +1,158 @@
+/*
+ *  Multi2Sim
+ *  Copyright (C) 2015  Rafael Ubal (ubal@ece.neu.edu)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ThreadPool.h"
+
+
+namespace misc
+{
+
+// Number of times that an idle thread checks for new work before going to
+// sleep. Calls to Run() are usually separated by a short sequential part of
+// the simulation, so workers should not sleep between them. After the first
+// few checks, the thread yields the host CPU between checks, in case there
+// are more threads than host CPUs.
+static const int spin_count = 1 << 14;
+static const int busy_spin_count = 1 << 8;
+
+
+ThreadPool::ThreadPool(int num_threads) :
+		next_index(0),
+		num_busy_workers(0),
+		generation(0)
+{
+	for (int i = 1; i < num_threads; i++)
+		workers.emplace_back(&ThreadPool::Work, this);
+}
+
+
+ThreadPool::~ThreadPool()
+{
+	// Wake up workers to exit
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		exiting = true;
+		generation++;
+	}
+	condition.notify_all();
+
+	// Wait for them
+	for (auto &worker : workers)
+		worker.join();
+}
+
+
+void ThreadPool::RunIndices()
+{
+	for (;;)
+	{
+		// Take next index
+		int index = next_index.fetch_add(1, std::memory_order_relaxed);
+		if (index >= count)
+			break;
+
+		// Run function, keeping the first exception
+		try
+		{
+			(*function)(index);
+		}
+		catch (...)
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (!exception)
+				exception = std::current_exception();
+		}
+	}
+}
+
+
+void ThreadPool::Work()
+{
+	unsigned last_generation = 0;
+	for (;;)
+	{
+		// Wait for a new call to Run(), spinning first
+		for (int i = 0; i < spin_count; i++)
+		{
+			if (generation.load(std::memory_order_acquire) !=
+					last_generation)
+				break;
+			if (i >= busy_spin_count)
+				std::this_thread::yield();
+		}
+		if (generation.load(std::memory_order_acquire) ==
+				last_generation)
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			condition.wait(lock, [this, last_generation]
+			{
+				return generation.load() != last_generation;
+			});
+		}
+		last_generation = generation.load(std::memory_order_acquire);
+
+		// Destructor was called
+		if (exiting)
+			return;
+
+		// Process indices
+		RunIndices();
+		num_busy_workers.fetch_sub(1, std::memory_order_release);
+	}
+}
+
+
+void ThreadPool::Run(int count, const std::function<void(int)> &function)
+{
+	// No workers
+	if (workers.empty())
+	{
+		for (int i = 0; i < count; i++)
+			function(i);
+		return;
+	}
+
+	// Publish work
+	this->function = &function;
+	this->count = count;
+	next_index.store(0, std::memory_order_relaxed);
+	num_busy_workers.store(workers.size(), std::memory_order_relaxed);
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		generation.fetch_add(1, std::memory_order_release);
+	}
+	condition.notify_all();
+
+	// Take indices as well, then wait for workers
+	RunIndices();
+	for (int i = 0; num_busy_workers.load(std::memory_order_acquire); i++)
+		if (i >= busy_spin_count)
+			std::this_thread::yield();
+
+	// Rethrow exception from any thread
+	if (exception)
+	{
+		std::exception_ptr e = exception;
+		exception = nullptr;
+		std::rethrow_exception(e);
+	}
+}
+
+
+}  // namespace misc
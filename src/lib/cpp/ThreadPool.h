@@ -0,0 +1,106 @@
+/*
+ *  Multi2Sim
+ *  Copyright (C) 2015  Rafael Ubal (ubal@ece.neu.edu)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef LIB_CPP_THREAD_POOL_H
+#define LIB_CPP_THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+namespace misc
+{
+
+/// Pool of host threads used to simulate independent components in parallel.
+/// A call to Run() invokes a function once for each index in a range,
+/// distributing indices among the host threads, and returns when all
+/// invocations have finished. Since Run() is typically called once per
+/// simulated cycle, idle workers spin for a short time before going to
+/// sleep.
+class ThreadPool
+{
+	// Worker threads. The thread calling Run() also takes indices, so
+	// there is one worker less than the number of host threads.
+	std::vector<std::thread> workers;
+
+	// Function invoked for each index in the current call to Run()
+	const std::function<void(int)> *function = nullptr;
+
+	// Number of indices in the current call to Run()
+	int count = 0;
+
+	// Next index to be taken by a thread
+	std::atomic<int> next_index;
+
+	// Number of workers that did not finish the current call to Run()
+	std::atomic<int> num_busy_workers;
+
+	// Incremented on each call to Run() to wake up the workers
+	std::atomic<unsigned> generation;
+
+	// Set by the destructor to stop the workers
+	bool exiting = false;
+
+	// Lock and condition variable for sleeping workers
+	std::mutex mutex;
+	std::condition_variable condition;
+
+	// First exception thrown by the function in the current call to Run(),
+	// rethrown by the caller
+	std::exception_ptr exception;
+
+	// Take indices and invoke the function until there are none left
+	void RunIndices();
+
+	// Main loop of a worker thread
+	void Work();
+
+public:
+
+	/// Constructor
+	///
+	/// \param num_threads
+	///	Number of host threads running the function, including the
+	///	thread that calls Run(). A value of 1 runs everything in the
+	///	calling thread.
+	///
+	explicit ThreadPool(int num_threads);
+
+	/// Destructor, stops all workers
+	~ThreadPool();
+
+	/// Return the number of host threads, including the caller's
+	int getNumThreads() const { return workers.size() + 1; }
+
+	/// Invoke \a function for every index between 0 and \a count - 1, in
+	/// no particular order and possibly concurrently. If any invocation
+	/// throws an exception, the first one is rethrown here once all
+	/// indices have been processed.
+	void Run(int count, const std::function<void(int)> &function);
+};
+
+
+}  // namespace misc
+
+#endif
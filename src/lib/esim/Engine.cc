@@ -17,6 +17,7 @@
  *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  */
 
+#include <climits>
 #include <csignal>
 
 #include <lib/cpp/IniFile.h>
@@ -255,6 +256,27 @@ void Engine::ProcessEvents()
 }
 
 
+long long Engine::getNextEventTime() const
+{
+	return heap.empty() ? LLONG_MAX : heap.top()->time;
+}
+
+
+void Engine::SkipTo(long long time)
+{
+	// Cycle right before the first one starting at 'time' or later
+	assert(shortest_cycle_time);
+	long long skip_time = (time + shortest_cycle_time - 1) /
+			shortest_cycle_time * shortest_cycle_time -
+			shortest_cycle_time;
+	if (skip_time <= current_time)
+		return;
+
+	// Events are not skipped
+	assert(getNextEventTime() >= skip_time);
+	current_time = skip_time;
+}
+
 FrequencyDomain *Engine::RegisterFrequencyDomain(const std::string &name,
 		int frequency)
 {
@@ -186,6 +186,17 @@ public:
 	/// and advances the event-driven simulation time.
 	void ProcessEvents();
 
+	/// Return the simulated time in picoseconds of the earliest scheduled
+	/// event, or LLONG_MAX if the heap is empty.
+	long long getNextEventTime() const;
+
+	/// Advance the simulated time without processing any event, so that
+	/// the next call to ProcessEvents() moves it to the first cycle of the
+	/// fastest frequency domain starting at \a time or later. This is used
+	/// by timing simulators to skip cycles in which they have no work to
+	/// do. No event can be scheduled before the skipped cycles.
+	void SkipTo(long long time);
+
 	/// Function invoked after the main simulation loop has finished. The
 	/// function processes all events remaining in the heap and then runs
 	/// all events that were scheduled for the end of the simulation with
@@ -193,6 +193,12 @@ void LoadProgram(const std::vector<std::string> &arguments,
 // Load programs from context configuration file
 void LoadPrograms()
 {
+	// Restore x86 contexts from a checkpoint. This must happen before
+	// other programs are loaded, since contexts keep their original IDs.
+	if (!x86::Emulator::getCheckpointLoadFile().empty())
+		x86::Emulator::getInstance()->LoadCheckpoint(
+				x86::Emulator::getCheckpointLoadFile());
+
 	// Load command-line program
 	misc::CommandLine *command_line = misc::CommandLine::getInstance();
 	LoadProgram(command_line->getArguments());
@@ -21,6 +21,7 @@
 #include <cassert>
 #include <cstring>
 #include <fstream>
+#include <zlib.h>
 
 #include <lib/cpp/Misc.h>
 #include <lib/cpp/String.h>
@@ -40,6 +41,18 @@ bool Memory::safe_mode = true;
 
 Memory::Page *Memory::getPage(unsigned address)
 {
+	// In thread-safe mode, pages are looked up in the page directory
+	if (thread_safe)
+	{
+		unsigned index = address >> LogPageSize;
+		std::atomic<Page *> *table = directory[index /
+				DirectoryTableSize].load(
+				std::memory_order_acquire);
+		return table ? table[index % DirectoryTableSize].load(
+				std::memory_order_acquire) : nullptr;
+	}
+
+	// Look up the page table
 	unsigned tag = address & ~(PageSize - 1);
 	auto it = pages.find(tag);
 	return it == pages.end() ? nullptr : it->second.get();
@@ -92,11 +105,83 @@ Memory::Page *Memory::newPage(unsigned address, unsigned perm)
 	auto it = ret.first;
 	Page *page = it->second.get();
 
+	// In thread-safe mode, the page data is allocated right away so that
+	// it does not change while other threads access the page
+	if (thread_safe)
+	{
+		page->AllocateData();
+		setDirectoryEntry(tag, page);
+	}
+
 	// Return it
 	return page;
 }
 
 
+void Memory::setDirectoryEntry(unsigned tag, Page *page)
+{
+	// Allocate the second-level table if needed
+	unsigned index = tag >> LogPageSize;
+	std::atomic<Page *> *table = directory[index / DirectoryTableSize].load(
+			std::memory_order_relaxed);
+	if (!table)
+	{
+		if (!page)
+			return;
+		directory_tables.emplace_back(misc::new_unique_array<
+				std::atomic<Page *>>(DirectoryTableSize));
+		table = directory_tables.back().get();
+		directory[index / DirectoryTableSize].store(table,
+				std::memory_order_release);
+	}
+
+	// Set entry
+	table[index % DirectoryTableSize].store(page,
+			std::memory_order_release);
+}
+
+
+void Memory::setThreadSafe(bool thread_safe)
+{
+	// Mode not changing
+	if (this->thread_safe == thread_safe)
+		return;
+
+	// Discard the page directory
+	this->thread_safe = thread_safe;
+	directory.reset();
+	directory_tables.clear();
+	if (!thread_safe)
+		return;
+
+	// Build the page directory, allocating the data of all pages
+	directory = misc::new_unique_array<std::atomic<std::atomic<Page *> *>>(
+			(1u << (32 - LogPageSize)) / DirectoryTableSize);
+	for (auto &it : pages)
+	{
+		Page *page = it.second.get();
+		page->AllocateData();
+		setDirectoryEntry(page->getTag(), page);
+	}
+}
+
+
+void Memory::Clear()
+{
+	// Remove pages
+	pages.clear();
+
+	// Remove them from the page directory
+	if (thread_safe)
+	{
+		for (unsigned i = 0; i < (1u << (32 - LogPageSize)) /
+				DirectoryTableSize; i++)
+			directory[i].store(nullptr);
+		directory_tables.clear();
+	}
+}
+
+
 void Memory::Copy(unsigned dest, unsigned src, unsigned size)
 {
 	// Restrictions. No overlapping allowed.
@@ -137,6 +222,64 @@ void Memory::Copy(unsigned dest, unsigned src, unsigned size)
 }
 
 
+void Memory::CopyFrom(unsigned dest, Memory *memory, unsigned src,
+		unsigned size)
+{
+	// When the destination region follows an overlapping source region in
+	// the same memory, copy from the end, so that source bytes are read
+	// before they are overwritten
+	bool backward = memory == this && dest > src && dest - src < size;
+
+	// Copy
+	while (size)
+	{
+		// Take the largest chunk not crossing a page boundary in either
+		// the source or the destination region
+		unsigned src_address = src;
+		unsigned dest_address = dest;
+		unsigned chunk_size;
+		if (backward)
+		{
+			chunk_size = std::min({ size,
+					((src + size - 1) & (PageSize - 1)) + 1,
+					((dest + size - 1) & (PageSize - 1)) + 1 });
+			src_address = src + size - chunk_size;
+			dest_address = dest + size - chunk_size;
+		}
+		else
+		{
+			chunk_size = std::min({ size,
+					PageSize - (src & (PageSize - 1)),
+					PageSize - (dest & (PageSize - 1)) });
+			src += chunk_size;
+			dest += chunk_size;
+		}
+		size -= chunk_size;
+
+		// Source data, or nullptr if its content is all zeros
+		Page *src_page = memory->getPageForAccess(src_address,
+				AccessRead);
+		char *src_data = src_page ? src_page->getData() : nullptr;
+
+		// Copy into the destination page, which only needs its data
+		// allocated if the source data is not all zeros
+		Page *dest_page = getPageForAccess(dest_address, AccessWrite);
+		unsigned offset = dest_address & (PageSize - 1);
+		if (src_data)
+		{
+			dest_page->AllocateData();
+			memmove(dest_page->getData() + offset, src_data +
+					(src_address & (PageSize - 1)),
+					chunk_size);
+		}
+		else if (dest_page->getData())
+		{
+			memset(dest_page->getData() + offset, 0, chunk_size);
+		}
+	}
+}
+
+
 char *Memory::getBuffer(unsigned address, unsigned size, AccessType access)
 {
 	// Get page offset and check page bounds
@@ -159,48 +302,63 @@ char *Memory::getBuffer(unsigned address, unsigned size, AccessType access)
 }
 
 
-void Memory::AccessAtPageBoundary(unsigned address, unsigned size,
-		char *buffer, AccessType access)
+Memory::Page *Memory::getPageForAccess(unsigned address, AccessType access)
 {
-	// Find memory page and compute offset.
-	Page *page = getPage(address);
-	unsigned offset = address & (PageSize - 1);
-	assert(offset + size <= PageSize);
-
 	// On nonexistent page, raise segmentation fault in safe mode,
 	// or create page with full privileges for writes in unsafe mode.
+	Page *page = getPage(address);
 	if (!page)
 	{
 		if (safe)
 			throw Error(misc::fmt("[0x%x] Segmentation fault in "
 					"guest program", address));
 		if (access == AccessRead || access == AccessExec)
-		{
-			memset(buffer, 0, size);
-			return;
-		}
+			return nullptr;
 		if (access == AccessWrite || access == AccessInit)
 		{
-			page = newPage(address, AccessRead |
-				AccessWrite | AccessExec |
-				AccessInit);
+			// In thread-safe mode, another thread could have
+			// created the page since it was looked up
+			std::unique_lock<std::mutex> lock(mutex,
+					std::defer_lock);
+			if (thread_safe)
+			{
+				lock.lock();
+				page = getPage(address);
+			}
+			if (!page)
+				page = newPage(address, AccessRead |
+					AccessWrite | AccessExec |
+					AccessInit);
 		}
 	}
 	assert(page);
 
 	// If it is a write access, set the 'modified' flag in the page
 	// attributes (perm). This is not done for 'initialize' access.
-	if (access == AccessWrite)
+	if (access == AccessWrite && !(page->getPerm() & AccessModified))
 		page->addPerm(AccessModified);
 
 	// Check permissions in safe mode
 	if (safe && (page->getPerm() & access) != access)
 		throw Error(misc::fmt("[0x%x] Permission denied", address));
 
+	// Return it
+	return page;
+}
+
+
+void Memory::AccessAtPageBoundary(unsigned address, unsigned size,
+		char *buffer, AccessType access)
+{
+	// Find memory page and compute offset.
+	Page *page = getPageForAccess(address, access);
+	unsigned offset = address & (PageSize - 1);
+	assert(offset + size <= PageSize);
+
 	// Read/execute access
 	if (access == AccessRead || access == AccessExec)
 	{
-		if (page->getData())
+		if (page && page->getData())
 			memcpy(buffer, page->getData() + offset, size);
 		else
 			memset(buffer, 0, size);
@@ -223,7 +381,6 @@ void Memory::AccessAtPageBoundary(unsigned address, unsigned size,
 void Memory::Access(unsigned address, unsigned size, char *buf,
 			AccessType access)
 {
-	last_address = address;
 	while (size)
 	{
 		unsigned offset = address & (PageSize - 1);
@@ -364,7 +521,11 @@ void Memory::Unmap(unsigned address, unsigned size)
 
 	// Deallocate pages
 	for (unsigned tag = tag1; tag <= tag2; tag += PageSize)
+	{
+		if (thread_safe)
+			setDirectoryEntry(tag, nullptr);
 		pages.erase(tag);
+	}
 }
 
 
@@ -503,5 +664,89 @@ void Memory::Clone(const Memory &memory)
 }
 
 
+void Memory::SaveCheckpoint(std::ostream &os) const
+{
+	// Memory attributes
+	misc::WriteBinary(os, safe);
+	misc::WriteBinary(os, heap_break);
+	unsigned num_pages = pages.size();
+	misc::WriteBinary(os, num_pages);
+
+	// Pages
+	uLongf max_size = compressBound(PageSize);
+	auto buffer = misc::new_unique_array<Bytef>(max_size);
+	for (auto &it : pages)
+	{
+		// Page attributes
+		Page *page = it.second.get();
+		misc::WriteBinary(os, page->getTag());
+		misc::WriteBinary(os, page->getPerm());
+
+		// Pages with no data or with all zeros are saved with size 0
+		const char *data = page->getData();
+		bool zero = !data || std::all_of(data, data + PageSize,
+				[](char c) { return !c; });
+		if (zero)
+		{
+			unsigned size = 0;
+			misc::WriteBinary(os, size);
+			continue;
+		}
+
+		// Compress page content
+		uLongf size = max_size;
+		if (compress2(buffer.get(), &size, (const Bytef *) data,
+				PageSize, Z_BEST_SPEED) != Z_OK)
+			throw Error("Cannot compress memory page");
+		unsigned compressed_size = size;
+		misc::WriteBinary(os, compressed_size);
+		os.write((const char *) buffer.get(), compressed_size);
+	}
+}
+
+
+void Memory::LoadCheckpoint(std::istream &is)
+{
+	// Clear current content
+	Clear();
+
+	// Memory attributes
+	unsigned num_pages = 0;
+	misc::ReadBinary(is, safe);
+	misc::ReadBinary(is, heap_break);
+	misc::ReadBinary(is, num_pages);
+
+	// Pages
+	auto buffer = misc::new_unique_array<Bytef>(compressBound(PageSize));
+	for (unsigned i = 0; i < num_pages; i++)
+	{
+		// Page attributes
+		unsigned tag = 0;
+		unsigned perm = 0;
+		unsigned compressed_size = 0;
+		misc::ReadBinary(is, tag);
+		misc::ReadBinary(is, perm);
+		misc::ReadBinary(is, compressed_size);
+		if (!is || (tag & ~PageMask) ||
+				compressed_size > compressBound(PageSize))
+			throw Error("Corrupted memory checkpoint");
+		Page *page = newPage(tag, perm);
+
+		// Zero page, data is allocated lazily
+		if (!compressed_size)
+			continue;
+
+		// Decompress page content
+		is.read((char *) buffer.get(), compressed_size);
+		page->AllocateData();
+		uLongf size = PageSize;
+		if (!is || uncompress((Bytef *) page->getData(), &size,
+				buffer.get(), compressed_size) != Z_OK ||
+				size != PageSize)
+			throw Error("Corrupted memory checkpoint");
+	}
+}
+
+
 } // namespace mem
 
@@ -20,10 +20,13 @@
 #ifndef MEMORY_MEMORY_H
 #define MEMORY_MEMORY_H
 
+#include <atomic>
 #include <cassert>
 #include <iostream>
 #include <memory>
+#include <mutex>
 #include <unordered_map>
+#include <vector>
 
 #include <lib/cpp/Error.h>
 #include <lib/cpp/Misc.h>
@@ -77,8 +80,9 @@ public:
 		// in the page.
 		unsigned tag;
 
-		// Page permissions
-		unsigned perm;
+		// Page permissions, updated atomically since the 'modified'
+		// flag can be set by several host threads at once
+		std::atomic<unsigned> perm;
 
 		// The page data
 		std::unique_ptr<char[]> data;
@@ -115,11 +119,11 @@ public:
 
 		/// Set the page permissions, given as a bitmap of flags of
 		/// type AccessType.
-		void setPerm(unsigned perm) { this->perm = perm; }
+		void setPerm(unsigned perm) { this->perm.store(perm); }
 
 		/// Add a flag to the page permissions, given as a bitmap of
 		/// flags of type AccessType.
-		void addPerm(unsigned perm) { this->perm |= perm; }
+		void addPerm(unsigned perm) { this->perm.fetch_or(perm); }
 	};
 
 private:
@@ -137,13 +141,40 @@ private:
 	/// Heap break for CPU contexts
 	unsigned heap_break = 0;
 
-	/// Last accessed address
-	unsigned last_address = 0;
+	// Number of entries in each second-level table of the page directory
+	static const unsigned DirectoryTableSize = 1024;
+
+	// Thread-safe mode
+	bool thread_safe = false;
+
+	// Page directory used in thread-safe mode. The first level has one
+	// entry for every 'DirectoryTableSize' pages, pointing to a
+	// second-level table with one entry per page. Entries are published
+	// atomically, so that pages can be looked up without locking while
+	// another host thread creates pages.
+	std::unique_ptr<std::atomic<std::atomic<Page *> *>[]> directory;
+
+	// Second-level tables of the page directory
+	std::vector<std::unique_ptr<std::atomic<Page *>[]>> directory_tables;
+
+	// Lock serializing the creation of pages in thread-safe mode
+	std::mutex mutex;
 
 	/// Create a new page and add it to the page table. The value given in
 	/// \a perm is an *or*'ed bitmap of AccessType flags.
 	Page *newPage(unsigned address, unsigned perm);
 
+	// Set the entry of the page directory for the page with the given
+	// tag. This function must be called with the lock held, or while no
+	// other host thread can access the memory.
+	void setDirectoryEntry(unsigned tag, Page *page);
+
+	// Return the page to access at the given address, checking its
+	// permissions in safe mode and creating it for writes in unsafe mode.
+	// The function returns nullptr for reads of a nonexistent page in
+	// unsafe mode, whose content is all zeros.
+	Page *getPageForAccess(unsigned address, AccessType access);
+
 	// Access memory without exceeding page boundaries
 	void AccessAtPageBoundary(unsigned address, unsigned size, char *buffer,
 			AccessType access);
@@ -168,8 +199,20 @@ public:
 	/// Return whether the safe mode is on
 	bool getSafe() const { return safe; }
 
+	/// Set the thread-safe mode. A memory in thread-safe mode can be
+	/// accessed with Read(), Write(), and Access() from several host
+	/// threads at once, including accesses that create new pages in
+	/// unsafe mode. Page data is allocated as soon as a page is created,
+	/// and pages are found through a page directory that does not need a
+	/// lock. Functions changing the memory map must still be called while
+	/// no other thread accesses the memory.
+	void setThreadSafe(bool thread_safe);
+
+	/// Return whether the thread-safe mode is on
+	bool getThreadSafe() const { return thread_safe; }
+
 	/// Clear content of memory
-	void Clear() { pages.clear(); }
+	void Clear();
 
 	/// Return the memory page corresponding to an address, or `nullptr` if
 	/// there is currently no page allocated for that address.
@@ -275,6 +318,33 @@ public:
 	///	region does not have write permissions.
 	void Copy(unsigned dest, unsigned src, unsigned size);
 
+	/// Copy a region of another memory object into this memory, with no
+	/// alignment or size restrictions. Data is copied page by page between
+	/// the page buffers of both memories, with no intermediate buffer.
+	/// Source pages without data are not allocated in the destination,
+	/// since their content is all zeros. The effect is the same as reading
+	/// the source region into a buffer and writing it into the destination,
+	/// also when both regions overlap in the same memory object.
+	///
+	/// \param dest
+	///	Destination address in this memory
+	///
+	/// \param memory
+	///	Source memory, which can be this same object
+	///
+	/// \param src
+	///	Source address in \a memory
+	///
+	/// \param size
+	///	Number of bytes to copy
+	///
+	/// \throw
+	///	A Memory::Error is thrown if either memory is in safe mode and
+	///	its pages are not allocated, or do not have read permissions in
+	///	the source or write permissions in the destination.
+	void CopyFrom(unsigned dest, Memory *memory, unsigned src,
+			unsigned size);
+
  	/// Access memory at any address and size, without page boundary
 	/// restrictions.
 	///
@@ -450,6 +520,18 @@ public:
 	/// Copy the content and attributes from another memory object
 	void Clone(const Memory &memory);
 
+	/// Save the complete memory image into a checkpoint stream, including
+	/// page permissions and the heap break. Pages whose content is all
+	/// zeros are saved without data, and the rest are compressed.
+	void SaveCheckpoint(std::ostream &os) const;
+
+	/// Load a memory image previously saved with SaveCheckpoint(),
+	/// replacing the current content of the memory.
+	///
+	/// \throw
+	///	A Memory::Error is thrown if the checkpoint data is corrupted.
+	void LoadCheckpoint(std::istream &is);
+
 };
 
 
@@ -251,7 +251,44 @@ private:
 	// List of next-level modules, closer to main memory
 	std::vector<Module *> low_modules;
 
-	
+
+
+
+	//
+	// Functional warming (ModuleWarm.cc)
+	//
+
+	// Return the higher-level module with the given sharer index, i.e.,
+	// the given node index in the high network.
+	Module *getSharerModule(int index) const;
+
+	// Bring the block containing \a address into the module on behalf of
+	// \a high_module, with exclusive permission if \a exclusive is set.
+	// The directory is updated with \a high_module as a sharer or owner,
+	// and conflicting copies in other higher-level modules are
+	// invalidated or downgraded. Argument \a high_module is null for an
+	// access coming directly from the processor. The function returns
+	// whether the block is shared with other higher-level modules.
+	bool WarmRequest(Module *high_module, bool exclusive, unsigned address);
+
+	// Invalidate all higher-level copies of the block at the given set and
+	// way. Return true if any of them contained modified data.
+	bool WarmInvalidateSharers(int set_id, int way_id);
+
+	// Invalidate the block containing \a address, together with all its
+	// higher-level copies. Return true if the block contained modified
+	// data.
+	bool WarmInvalidate(unsigned address);
+
+	// Downgrade the block containing \a address to the shared state,
+	// together with all its higher-level copies.
+	void WarmDowngrade(unsigned address);
+
+	// Evict the block at the given set and way, updating the directory of
+	// the lower-level module.
+	void WarmEvict(int set_id, int way_id);
+
+
 
 
 	//
@@ -759,6 +796,14 @@ public:
 	/// This function is invoked internally by RecursiveFlush().
 	void FlushCache();
 
+	/// Update the state of the cache and directories along the memory
+	/// hierarchy as if an access to \a address had completed instantly.
+	/// No event is scheduled, no latency is modeled, and no statistics
+	/// are recorded. This is used to warm up the memory hierarchy while
+	/// a processor model runs functional simulation. Blocks involved in
+	/// in-flight accesses are left untouched.
+	void Warm(AccessType access_type, unsigned address);
+
 	/// Return an iterator to the first element of the access list.
 	std::list<Frame *>::iterator getAccessListBegin()
 	{
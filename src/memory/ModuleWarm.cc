@@ -0,0 +1,363 @@
+/*
+ *  Multi2Sim
+ *  Copyright (C) 2015  Rafael Ubal (ubal@ece.neu.edu)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// This file implements functional warming of the memory hierarchy. The
+// functions below apply the final state transitions of the NMOESI protocol
+// implemented in SystemEvents.cc, but atomically and without modeling any
+// latency, network traffic, or contention:
+//
+//   - A load brings the block into every level on its way down, with state
+//     E if no other higher-level module shares it, or S otherwise. The
+//     current owner of the block, if any, is downgraded to S.
+//
+//   - A store obtains the block in state E in every level below the first
+//     one, or M if that level already held dirty data, invalidating all
+//     other higher-level copies, and sets the block in the first level
+//     to M.
+//
+//   - A victim block is evicted after invalidating all its higher-level
+//     copies. Its lower-level directory entry stops listing it as a
+//     sharer, and the lower-level block becomes M if dirty data was
+//     written back.
+//
+// Directory entries that are locked by in-flight accesses are never
+// modified, so warming can coexist with an idle timing model.
+
+#include "Module.h"
+#include "System.h"
+
+
+namespace mem
+{
+
+static bool isDirtyState(Cache::BlockState state)
+{
+	return state == Cache::BlockModified ||
+			state == Cache::BlockOwned ||
+			state == Cache::BlockNonCoherent;
+}
+
+
+Module *Module::getSharerModule(int index) const
+{
+	assert(high_network);
+	net::Node *node = high_network->getNode(index);
+	Module *module = (Module *) node->getUserData();
+	assert(module);
+	return module;
+}
+
+
+void Module::Warm(AccessType access_type, unsigned address)
+{
+	// Local memories are not part of a coherent hierarchy
+	if (type == TypeLocalMemory)
+		return;
+
+	// Skip blocks with in-flight accesses
+	if (isInFlightAddress(address))
+		return;
+
+	// Access from the processor
+	WarmRequest(nullptr, access_type != AccessLoad, address);
+}
+
+
+bool Module::WarmRequest(Module *high_module, bool exclusive, unsigned address)
+{
+	// Look for block
+	int set_id;
+	int way_id;
+	int tag;
+	Cache::BlockState state;
+	bool hit = FindBlock(address, set_id, way_id, tag, state);
+
+	// Miss
+	if (!hit)
+	{
+		// Find a victim
+		way_id = cache->ReplaceBlock(set_id);
+		if (directory->isEntryLocked(set_id, way_id))
+			return true;
+		WarmEvict(set_id, way_id);
+
+		// Bring block from the lower level. In main memory, a miss is
+		// just a miss in the directory, and the block is already here.
+		if (type == TypeMainMemory)
+		{
+			state = Cache::BlockExclusive;
+		}
+		else
+		{
+			Module *low_module = getLowModuleServingAddress(tag);
+			bool shared = low_module->WarmRequest(this, exclusive, tag);
+			state = shared && !exclusive ? Cache::BlockShared :
+					Cache::BlockExclusive;
+		}
+		cache->setBlock(set_id, way_id, tag, state);
+	}
+	else if (directory->isEntryLocked(set_id, way_id))
+	{
+		// Block busy in the timing model
+		return true;
+	}
+	else if (exclusive && state != Cache::BlockModified &&
+			state != Cache::BlockExclusive)
+	{
+		// Upgrade block in state O/S/N. A block in state O or N holds
+		// dirty data, so it becomes M to write it back on eviction.
+		if (type != TypeMainMemory)
+		{
+			Module *low_module = getLowModuleServingAddress(tag);
+			low_module->WarmRequest(this, true, tag);
+		}
+		state = isDirtyState(state) ? Cache::BlockModified :
+				Cache::BlockExclusive;
+		cache->setBlock(set_id, way_id, tag, state);
+	}
+
+	// Update LRU order
+	cache->AccessBlock(set_id, way_id);
+
+	// Access from the processor. A store leaves the block modified.
+	if (!high_module)
+	{
+		if (exclusive)
+			cache->setBlock(set_id, way_id, tag, Cache::BlockModified);
+		return false;
+	}
+
+	// Update directory entries for the sub-blocks covered by the block
+	// of the higher-level module.
+	int high_index = getSharerIndex(high_module);
+	bool shared = false;
+	for (int z = 0; z < directory->getNumSubBlocks(); z++)
+	{
+		// Skip sub-blocks not requested
+		unsigned directory_entry_tag = tag + z * sub_block_size;
+		if (directory_entry_tag < address || directory_entry_tag >=
+				address + high_module->getBlockSize())
+			continue;
+
+		// Invalidate other sharers on exclusive requests, or downgrade
+		// other owners on shared requests.
+		Directory::Entry *entry = directory->getEntry(set_id, way_id, z);
+		for (int i = 0; i < directory->getNumNodes(); i++)
+		{
+			// Skip non-sharers and the requester
+			if (i == high_index ||
+					!directory->isSharer(set_id, way_id, z, i))
+				continue;
+
+			// Shared request to a non-owner
+			Module *sharer = getSharerModule(i);
+			if (!exclusive && entry->getOwner() != i)
+				continue;
+
+			// Invalidate or downgrade, once per higher-level block
+			if (!(directory_entry_tag % sharer->getBlockSize()))
+			{
+				if (exclusive)
+					sharer->WarmInvalidate(directory_entry_tag);
+				else
+					sharer->WarmDowngrade(directory_entry_tag);
+			}
+
+			// Update directory
+			if (exclusive)
+				directory->clearSharer(set_id, way_id, z, i);
+			if (entry->getOwner() == i)
+				directory->setOwner(set_id, way_id, z,
+						Directory::NoOwner);
+		}
+
+		// Set requester as sharer
+		directory->setSharer(set_id, way_id, z, high_index);
+		if (entry->getNumSharers() > 1 ||
+				state == Cache::BlockOwned ||
+				state == Cache::BlockNonCoherent ||
+				state == Cache::BlockShared)
+			shared = true;
+	}
+
+	// Set requester as owner if no other module shares the block
+	if (exclusive || !shared)
+	{
+		for (int z = 0; z < directory->getNumSubBlocks(); z++)
+		{
+			unsigned directory_entry_tag = tag + z * sub_block_size;
+			if (directory_entry_tag < address || directory_entry_tag >=
+					address + high_module->getBlockSize())
+				continue;
+			directory->setOwner(set_id, way_id, z, high_index);
+		}
+	}
+
+	// Done
+	return shared && !exclusive;
+}
+
+
+bool Module::WarmInvalidateSharers(int set_id, int way_id)
+{
+	// No higher-level modules
+	if (!high_network)
+		return false;
+
+	// Get block tag
+	unsigned tag;
+	Cache::BlockState state;
+	cache->getBlock(set_id, way_id, tag, state);
+
+	// Invalidate all sharers
+	bool dirty = false;
+	for (int z = 0; z < directory->getNumSubBlocks(); z++)
+	{
+		unsigned directory_entry_tag = tag + z * sub_block_size;
+		for (int i = 0; i < directory->getNumNodes(); i++)
+		{
+			// Skip non-sharers
+			if (!directory->isSharer(set_id, way_id, z, i))
+				continue;
+
+			// Invalidate once per higher-level block
+			Module *sharer = getSharerModule(i);
+			if (!(directory_entry_tag % sharer->getBlockSize()) &&
+					sharer->WarmInvalidate(directory_entry_tag))
+				dirty = true;
+		}
+
+		// Clear directory entry
+		directory->clearAllSharers(set_id, way_id, z);
+		directory->setOwner(set_id, way_id, z, Directory::NoOwner);
+	}
+
+	// Done
+	return dirty;
+}
+
+
+bool Module::WarmInvalidate(unsigned address)
+{
+	// Look for block
+	int set_id;
+	int way_id;
+	int tag;
+	Cache::BlockState state;
+	if (!FindBlock(address, set_id, way_id, tag, state) ||
+			directory->isEntryLocked(set_id, way_id))
+		return false;
+
+	// Invalidate higher-level copies first
+	bool dirty = WarmInvalidateSharers(set_id, way_id);
+	dirty |= isDirtyState(state);
+
+	// Invalidate block
+	cache->setBlock(set_id, way_id, 0, Cache::BlockInvalid);
+	return dirty;
+}
+
+
+void Module::WarmDowngrade(unsigned address)
+{
+	// Look for block
+	int set_id;
+	int way_id;
+	int tag;
+	Cache::BlockState state;
+	if (!FindBlock(address, set_id, way_id, tag, state) ||
+			directory->isEntryLocked(set_id, way_id))
+		return;
+
+	// Downgrade higher-level owners first
+	for (int z = 0; high_network && z < directory->getNumSubBlocks(); z++)
+	{
+		// Skip entries with no owner
+		Directory::Entry *entry = directory->getEntry(set_id, way_id, z);
+		int owner = entry->getOwner();
+		if (owner == Directory::NoOwner)
+			continue;
+
+		// Downgrade once per higher-level block
+		unsigned directory_entry_tag = tag + z * sub_block_size;
+		Module *owner_module = getSharerModule(owner);
+		if (!(directory_entry_tag % owner_module->getBlockSize()))
+			owner_module->WarmDowngrade(directory_entry_tag);
+		directory->setOwner(set_id, way_id, z, Directory::NoOwner);
+	}
+
+	// Set block to S
+	cache->setBlock(set_id, way_id, tag, Cache::BlockShared);
+}
+
+
+void Module::WarmEvict(int set_id, int way_id)
+{
+	// Nothing to do for an invalid block
+	unsigned tag;
+	Cache::BlockState state;
+	cache->getBlock(set_id, way_id, tag, state);
+	if (!state)
+		return;
+
+	// Invalidate higher-level copies and the block itself
+	bool dirty = WarmInvalidateSharers(set_id, way_id);
+	dirty |= isDirtyState(state);
+	cache->setBlock(set_id, way_id, 0, Cache::BlockInvalid);
+
+	// Main memory has no lower level
+	if (type == TypeMainMemory)
+		return;
+
+	// Find block in lower-level module
+	Module *low_module = getLowModuleServingAddress(tag);
+	Directory *low_directory = low_module->getDirectory();
+	int low_set_id;
+	int low_way_id;
+	int low_tag;
+	Cache::BlockState low_state;
+	if (!low_module->FindBlock(tag, low_set_id, low_way_id, low_tag,
+			low_state) || low_directory->isEntryLocked(low_set_id,
+			low_way_id))
+		return;
+
+	// Remove module from sharers of the lower-level directory entries
+	int index = low_module->getSharerIndex(this);
+	for (int z = 0; z < low_directory->getNumSubBlocks(); z++)
+	{
+		unsigned directory_entry_tag = low_tag +
+				z * low_module->getSubBlockSize();
+		if (directory_entry_tag < tag || directory_entry_tag >=
+				tag + (unsigned) block_size)
+			continue;
+		low_directory->clearSharer(low_set_id, low_way_id, z, index);
+		Directory::Entry *entry = low_directory->getEntry(low_set_id,
+				low_way_id, z);
+		if (entry->getOwner() == index)
+			low_directory->setOwner(low_set_id, low_way_id, z,
+					Directory::NoOwner);
+	}
+
+	// Written back data leaves the lower-level block modified
+	if (dirty && low_state == Cache::BlockExclusive)
+		low_module->getCache()->setBlock(low_set_id, low_way_id,
+				low_tag, Cache::BlockModified);
+}
+
+}  // namespace mem
@@ -0,0 +1,109 @@
+/*
+ *  Multi2Sim
+ *  Copyright (C) 2015  Rafael Ubal (ubal@ece.neu.edu)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <algorithm>
+#include <sstream>
+
+#include <gtest/gtest.h>
+#include <lib/cpp/Error.h>
+
+#include "ObjectPool.h"
+
+
+namespace SI
+{
+
+// Decode the instruction at 'pc' from the instruction memory of the
+// ND-range, as a wavefront does for instructions not decoded in advance
+static std::string DecodeOnTheFly(NDRange *ndrange, unsigned pc, int &size)
+{
+	char buffer[8] = {};
+	unsigned buffer_size = std::min((unsigned) sizeof buffer,
+			ndrange->getInstructionBufferSize() - pc);
+	ndrange->getInstructionMemory()->Read(pc, buffer_size, buffer);
+	Instruction instruction;
+	instruction.Decode(buffer, pc);
+	size = instruction.getSize();
+	std::ostringstream os;
+	instruction.Dump(os);
+	return os.str();
+}
+
+
+// Tests that the instructions decoded once by the ND-range match those that
+// wavefronts decode on the fly, including instructions with a literal
+// constant at the end of the instruction memory
+TEST(TestNDRangeDecode, literal_constants)
+{
+	// Environment
+	ObjectPool pool;
+	NDRange ndrange;
+
+	// Instructions
+	unsigned words[] =
+	{
+		// s_mov_b32 s0, 0x12345678
+		0xbe8003ff, 0x12345678,
+		// v_mov_b32 v1, s0
+		0x7e020200,
+		// v_add_f32 v2, 1.0, v1
+		0x060402ff, 0x3f800000,
+		// s_endpgm
+		0xbf810000,
+		// s_mov_b32 s1, 0xcafef00d, with the literal constant in the
+		// last word of the instruction memory
+		0xbe8103ff, 0xcafef00d
+	};
+	ndrange.SetupInstructionMemory((const char *) words, sizeof words, 0);
+
+	// Instructions start at these offsets
+	unsigned offsets[] = { 0, 8, 12, 20, 24 };
+	int sizes[] = { 8, 4, 8, 4, 8 };
+	for (int i = 0; i < 5; i++)
+	{
+		// Decoded in advance
+		unsigned pc = offsets[i];
+		Instruction *instruction = ndrange.getInstruction(pc);
+		ASSERT_TRUE(instruction != nullptr);
+		std::ostringstream os;
+		instruction->Dump(os);
+
+		// Same as decoding on the fly
+		int size;
+		std::string dump = DecodeOnTheFly(&ndrange, pc, size);
+		EXPECT_EQ(sizes[i], instruction->getSize());
+		EXPECT_EQ(size, instruction->getSize());
+		EXPECT_EQ(dump, os.str());
+	}
+
+	// The last literal constant was decoded
+	std::ostringstream os;
+	ndrange.getInstruction(24)->Dump(os);
+	EXPECT_NE(std::string::npos, os.str().find("cafef00d")) << os.str();
+
+	// No instruction starts at literal constants or unaligned addresses,
+	// or outside of the instruction memory
+	EXPECT_TRUE(ndrange.getInstruction(4) == nullptr);
+	EXPECT_TRUE(ndrange.getInstruction(16) == nullptr);
+	EXPECT_TRUE(ndrange.getInstruction(28) == nullptr);
+	EXPECT_TRUE(ndrange.getInstruction(2) == nullptr);
+	EXPECT_TRUE(ndrange.getInstruction(sizeof words) == nullptr);
+}
+
+}
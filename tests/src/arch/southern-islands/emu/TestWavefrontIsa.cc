@@ -0,0 +1,215 @@
+/*
+ *  Multi2Sim
+ *  Copyright (C) 2015  Rafael Ubal (ubal@ece.neu.edu)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <random>
+
+#include <gtest/gtest.h>
+#include <lib/cpp/Error.h>
+
+#include "ObjectPool.h"
+
+
+namespace SI
+{
+
+// State of a wavefront after executing an instruction
+struct WavefrontState
+{
+	// Exception thrown by the instruction
+	bool failed = false;
+
+	// Vector registers, 64 values per register
+	std::vector<unsigned> vregs;
+
+	// VCC
+	unsigned vcc[2];
+
+	// Register access counters of the work-group
+	long long sreg_reads;
+	long long sreg_writes;
+	long long vreg_reads;
+	long long vreg_writes;
+};
+
+
+// Execute one instruction in a wavefront with the given number of work-items
+// and random register values. If 'debug' is true, the ISA debug output is
+// enabled, which forces every work-item to execute the instruction
+// individually.
+static WavefrontState ExecuteInstruction(unsigned word, unsigned literal,
+		int num_work_items, unsigned seed, bool debug)
+{
+	// Environment
+	ObjectPool pool;
+	NDRange ndrange;
+	unsigned global_size[1] = { (unsigned) num_work_items };
+	unsigned local_size[1] = { (unsigned) num_work_items };
+	ndrange.SetupSize(global_size, local_size, 1);
+
+	// Instruction followed by s_endpgm
+	unsigned words[3] = { word, literal, 0xbf810000 };
+	ndrange.SetupInstructionMemory((const char *) words, sizeof words, 0);
+
+	// Wavefront
+	WorkGroup work_group(&ndrange, 0);
+	Wavefront *wavefront = work_group.getWavefront(0);
+
+	// Random registers. Half of the vector registers contain small
+	// floating-point values, and a few values are special.
+	std::mt19937 random(seed);
+	std::uniform_real_distribution<float> distribution(-100.0f, 100.0f);
+	for (int vreg = 0; vreg < 256; vreg++)
+	{
+		for (int lane = 0; lane < Wavefront::MaxWorkItems; lane++)
+		{
+			Instruction::Register value;
+			value.as_uint = random();
+			if (vreg % 2)
+				value.as_float = distribution(random);
+			if (lane % 16 == 3)
+				value.as_uint = 0;
+			wavefront->setVregUint(vreg, lane, value.as_uint);
+		}
+	}
+	for (int sreg = 0; sreg < 128; sreg++)
+		if (sreg != 104 && sreg != 105 && sreg != 125)
+			wavefront->setSregUint(sreg, random());
+	wavefront->setSregUint(Instruction::RegisterM0, random() % 8);
+	wavefront->setSregUint(Instruction::RegisterVcc, random());
+	wavefront->setSregUint(Instruction::RegisterVcc + 1, random());
+	wavefront->setSregUint(Instruction::RegisterExec, random());
+	wavefront->setSregUint(Instruction::RegisterExec + 1, random());
+
+	// Execute
+	WavefrontState state;
+	Emulator::isa_debug.setPath(debug ? "/dev/null" : "");
+	try
+	{
+		wavefront->Execute();
+	}
+	catch (misc::Exception &e)
+	{
+		state.failed = true;
+	}
+	Emulator::isa_debug.setPath("");
+
+	// Save state
+	for (int vreg = 0; vreg < 256; vreg++)
+		for (int lane = 0; lane < Wavefront::MaxWorkItems; lane++)
+			state.vregs.push_back(wavefront->getVregUint(vreg, lane));
+	state.vcc[0] = wavefront->getSregUint(Instruction::RegisterVcc);
+	state.vcc[1] = wavefront->getSregUint(Instruction::RegisterVcc + 1);
+	state.sreg_reads = work_group.getSregReadCount();
+	state.sreg_writes = work_group.getSregWriteCount();
+	state.vreg_reads = work_group.getVregReadCount();
+	state.vreg_writes = work_group.getVregWriteCount();
+	return state;
+}
+
+
+// This test checks that vector ALU instructions executed for the whole
+// wavefront at once produce the same registers and statistics as when each
+// work-item executes them. All opcodes of the VOP1, VOP2, and VOPC encodings
+// are tried with vector, scalar, literal, and VCC source operands.
+TEST(TestWavefrontIsa, vector_alu)
+{
+	// Source operands: v1, s2, literal constant, inline constant 1, VCC
+	const unsigned sources[] = { 257, 2, 0xff, 129, 106 };
+
+	// Encodings, with the position of the opcode field
+	struct Encoding
+	{
+		Instruction::Format format;
+		unsigned word;
+		int op_shift;
+		int num_ops;
+	};
+	const Encoding encodings[] =
+	{
+		// VOP1 - v3 <= src0
+		{ Instruction::FormatVOP1, 0x7e000000 | 3 << 17, 9, 256 },
+
+		// VOP2 - v3 <= src0, v4
+		{ Instruction::FormatVOP2, 3 << 17 | 4 << 9, 25, 64 },
+
+		// VOPC - vcc <= src0, v4
+		{ Instruction::FormatVOPC, 0x7c000000 | 4 << 9, 17, 256 }
+	};
+
+	int num_checked = 0;
+	for (const Encoding &encoding : encodings)
+	{
+		for (int op = 0; op < encoding.num_ops; op++)
+		{
+			// Skip undefined opcodes
+			unsigned word = encoding.word | op << encoding.op_shift;
+			Instruction instruction;
+			try
+			{
+				instruction.Decode((const char *) &word, 0);
+			}
+			catch (misc::Exception &e)
+			{
+				continue;
+			}
+			if (instruction.getFormat() != encoding.format)
+				continue;
+
+			// Shift amounts given as literals must be lower than 32
+			unsigned literal = 17;
+
+			// Compare
+			for (unsigned src0 : sources)
+			{
+				for (int num_work_items : { 64, 40 })
+				{
+					unsigned seed = op * 1000 + src0 + num_work_items;
+					WavefrontState expected = ExecuteInstruction(
+							word | src0, literal,
+							num_work_items, seed, true);
+					WavefrontState state = ExecuteInstruction(
+							word | src0, literal,
+							num_work_items, seed, false);
+					SCOPED_TRACE(instruction.getName());
+					SCOPED_TRACE(src0);
+					// Instructions that are not implemented,
+					// or that cannot be dumped for the debug
+					// output, are skipped
+					if (expected.failed)
+						continue;
+					ASSERT_FALSE(state.failed);
+					EXPECT_TRUE(expected.vregs == state.vregs);
+					EXPECT_EQ(expected.vcc[0], state.vcc[0]);
+					EXPECT_EQ(expected.vcc[1], state.vcc[1]);
+					EXPECT_EQ(expected.sreg_reads, state.sreg_reads);
+					EXPECT_EQ(expected.sreg_writes, state.sreg_writes);
+					EXPECT_EQ(expected.vreg_reads, state.vreg_reads);
+					EXPECT_EQ(expected.vreg_writes, state.vreg_writes);
+					num_checked++;
+				}
+			}
+		}
+	}
+
+	// Make sure that instructions were actually executed
+	EXPECT_GT(num_checked, 100);
+}
+
+
+}  // namespace SI
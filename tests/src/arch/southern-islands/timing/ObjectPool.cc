@@ -0,0 +1,169 @@
+/*
+ *  Multi2Sim
+ *  Copyright (C) 2015  Rafael Ubal (ubal@ece.neu.edu)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <cstdlib>
+
+#include <lib/cpp/IniFile.h>
+#include <lib/esim/Engine.h>
+#include <memory/System.h>
+#include <network/System.h>
+
+#include "ObjectPool.h"
+
+namespace SI
+{
+
+// Configuration restoring the default values of the variables that tests
+// change, since values not given in a configuration file keep their
+// previous value
+static const char *default_config =
+		"[ Device ]\n"
+		"Frequency = 1000\n"
+		"NumComputeUnits = 32\n"
+		"[ ComputeUnit ]\n"
+		"NumWavefrontPools = 4\n"
+		"MaxWorkGroupsPerWavefrontPool = 10\n"
+		"MaxWavefrontsPerWavefrontPool = 10\n"
+		"MaxActiveWavefronts = 4\n"
+		"[ VectorMemUnit ]\n"
+		"CoalesceGranularity = 64\n";
+
+
+const std::vector<unsigned> ObjectPool::endpgm_code = { 0xbf810000 };
+
+
+void ObjectPool::Cleanup()
+{
+	esim::Engine::Destroy();
+	Timing::Destroy();
+	Emulator::Destroy();
+	net::System::Destroy();
+	mem::System::Destroy();
+	comm::ArchPool::Destroy();
+}
+
+
+ObjectPool::ObjectPool(const std::string &config)
+{
+	// Cleanup singleton instances
+	Cleanup();
+
+	// Random retry latencies of the memory system start from the same
+	// seed as in a new simulator process
+	srandom(1);
+
+	// Timing configuration
+	misc::IniFile default_ini_file;
+	default_ini_file.LoadFromString(default_config);
+	Timing::ParseConfiguration(&default_ini_file);
+	misc::IniFile ini_file;
+	ini_file.LoadFromString(config);
+	Timing::ParseConfiguration(&ini_file);
+
+	// Emulator and timing simulator
+	emulator = Emulator::getInstance();
+	timing = Timing::getInstance();
+
+	// Default memory hierarchy
+	misc::IniFile mem_ini_file;
+	timing->WriteMemoryConfiguration(&mem_ini_file);
+	mem::System::getInstance()->ReadConfiguration(&mem_ini_file);
+}
+
+
+ObjectPool::~ObjectPool()
+{
+	// Finish in-flight memory accesses, so that their events don't fire
+	// after the memory system is destroyed
+	esim::Engine::getInstance()->ProcessAllEvents();
+	Cleanup();
+}
+
+
+NDRange *ObjectPool::newNDRange(const std::vector<unsigned> &code,
+		unsigned global_size, unsigned local_size)
+{
+	// Sizes
+	NDRange *ndrange = emulator->addNDRange();
+	ndrange->SetupSize(&global_size, &local_size, 1);
+
+	// Kernel, using few registers
+	ndrange->SetupInstructionMemory((const char *) code.data(),
+			code.size() * sizeof(unsigned), 0);
+	ndrange->setNumVgprUsed(8);
+	ndrange->setNumSgprUsed(16);
+
+	// Address space
+	ndrange->address_space = getGpu()->getMmu()->newSpace(
+			"Southern Islands");
+
+	// All work-groups wait to be dispatched
+	for (unsigned id = 0; id < global_size / local_size; id++)
+		ndrange->AddWorkgroupIdToWaitingList(id);
+	return ndrange;
+}
+
+
+WorkGroup *ObjectPool::MapWorkGroup(NDRange *ndrange, int compute_unit_index)
+{
+	// Map the ND-range
+	Gpu *gpu = getGpu();
+	if (!gpu->isNDRangeMapped(ndrange))
+		gpu->MapNDRange(ndrange);
+
+	// Map the work-group
+	WorkGroup *work_group = ndrange->ScheduleWorkGroup(
+			ndrange->GetWaitingWorkGroup());
+	if (ndrange->isWaitingWorkGroupsEmpty())
+		ndrange->setLastWorkgroupSent(true);
+	gpu->getComputeUnit(compute_unit_index)->MapWorkGroup(work_group);
+	return work_group;
+}
+
+
+long long ObjectPool::Run()
+{
+	esim::Engine *engine = esim::Engine::getInstance();
+	long long start_cycle = timing->getCycle();
+	while (true)
+	{
+		// Check if all ND-ranges finished
+		bool finished = true;
+		for (auto it = emulator->getNDRangesBegin(),
+				e = emulator->getNDRangesEnd();
+				it != e;
+				++it)
+		{
+			NDRange *ndrange = it->get();
+			if (!ndrange->isWaitingWorkGroupsEmpty() ||
+					!ndrange->isRunningWorkGroupsEmpty())
+				finished = false;
+		}
+		if (finished)
+			break;
+
+		// Next cycle
+		timing->Run();
+		engine->ProcessEvents();
+	}
+	return timing->getCycle() - start_cycle;
+}
+
+
+} // namespace SI
@@ -0,0 +1,102 @@
+/*
+ *  Multi2Sim
+ *  Copyright (C) 2015  Rafael Ubal (ubal@ece.neu.edu)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef SRC_ARCH_SOUTHERN_ISLANDS_TIMING_OBJECTPOOL_H
+#define SRC_ARCH_SOUTHERN_ISLANDS_TIMING_OBJECTPOOL_H
+
+#include <string>
+#include <vector>
+
+#include <arch/southern-islands/emulator/Emulator.h>
+#include <arch/southern-islands/emulator/NDRange.h>
+#include <arch/southern-islands/emulator/Wavefront.h>
+#include <arch/southern-islands/emulator/WorkGroup.h>
+#include <arch/southern-islands/timing/ComputeUnit.h>
+#include <arch/southern-islands/timing/Gpu.h>
+#include <arch/southern-islands/timing/Timing.h>
+
+namespace SI
+{
+
+// ObjectPool creates a Southern Islands GPU with the default memory hierarchy,
+// and ND-ranges running kernels given as a list of instruction words. The
+// singletons are destroyed when the object pool is destroyed.
+class ObjectPool
+{
+	// Timing simulator
+	Timing *timing;
+
+	// Emulator
+	Emulator *emulator;
+
+	// Destroy all singletons
+	static void Cleanup();
+
+public:
+
+	/// Kernel with one instruction, s_endpgm
+	static const std::vector<unsigned> endpgm_code;
+
+	/// Constructor, with the timing configuration given in the INI format.
+	/// Variables not given take their default values.
+	ObjectPool(const std::string &config = "");
+
+	/// Destructor
+	~ObjectPool();
+
+	/// Create an ND-range with one dimension running the given kernel. All
+	/// its work-groups are waiting to be dispatched.
+	NDRange *newNDRange(const std::vector<unsigned> &code,
+			unsigned global_size, unsigned local_size);
+
+	/// Map the next waiting work-group of the ND-range to the given
+	/// compute unit, mapping the ND-range to the GPU if it was not yet
+	WorkGroup *MapWorkGroup(NDRange *ndrange, int compute_unit_index);
+
+	/// Run the timing simulation until all work-groups of all ND-ranges
+	/// finished, and return the number of cycles simulated
+	long long Run();
+
+
+
+
+	//
+	// Getters
+	//
+
+	/// Return the timing simulator
+	Timing *getTiming() const { return timing; }
+
+	/// Return the GPU
+	Gpu *getGpu() const { return timing->getGpu(); }
+
+	/// Return the emulator
+	Emulator *getEmulator() const { return emulator; }
+
+	/// Return a compute unit
+	ComputeUnit *getComputeUnit(int index) const
+	{
+		return getGpu()->getComputeUnit(index);
+	}
+};
+
+
+} // namespace SI
+
+#endif
@@ -0,0 +1,153 @@
+/*
+ *  Multi2Sim
+ *  Copyright (C) 2015  Rafael Ubal (ubal@ece.neu.edu)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <gtest/gtest.h>
+
+#include <arch/southern-islands/timing/Uop.h>
+#include <arch/southern-islands/timing/VectorMemoryUnit.h>
+
+#include "ObjectPool.h"
+
+namespace SI
+{
+
+// Coalesce the accesses of the 64 work-items of a wavefront of a new
+// ND-range, or of the given ND-range, where work-item 'i' accesses 'size'
+// bytes at address 'base + i * stride'. Work-items whose bit in 'exec' is
+// clear are inactive.
+static std::vector<Uop::BlockAccess> Coalesce(ObjectPool &pool,
+		unsigned base, unsigned stride, unsigned size,
+		unsigned long long exec = ~0ull, NDRange *ndrange = nullptr)
+{
+	// Wavefront in compute unit 0
+	if (!ndrange)
+		ndrange = pool.newNDRange(ObjectPool::endpgm_code, 64, 64);
+	WorkGroup *work_group = pool.MapWorkGroup(ndrange, 0);
+	Wavefront *wavefront = work_group->getWavefront(0);
+	wavefront->setSregUint(Instruction::RegisterExec, exec);
+	wavefront->setSregUint(Instruction::RegisterExec + 1, exec >> 32);
+
+	// Uop with the accesses of each work-item
+	Uop uop(wavefront, wavefront->getWavefrontPoolEntry(), 0,
+			work_group, 0);
+	for (int i = 0; i < WorkGroup::WavefrontSize; i++)
+	{
+		Uop::WorkItemInfo &work_item_info = uop.work_item_info_list[i];
+		work_item_info.global_memory_access_address = base + i * stride;
+		work_item_info.global_memory_access_size = size;
+	}
+
+	// Coalesce
+	pool.getComputeUnit(0)->getVectorMemoryUnit()->Coalesce(&uop);
+	EXPECT_TRUE(uop.coalesced);
+	return uop.block_accesses;
+}
+
+
+// Tests that consecutive 4-byte accesses fall into as many blocks as the
+// coalescing granularity allows
+TEST(TestCoalesce, consecutive)
+{
+	// 256 bytes in 64-byte blocks
+	ObjectPool pool;
+	std::vector<Uop::BlockAccess> blocks = Coalesce(pool, 0x1000, 4, 4);
+	ASSERT_EQ(4u, blocks.size());
+	for (int i = 0; i < 4; i++)
+		EXPECT_EQ(0x1000u + i * 64, blocks[i].virtual_address);
+	EXPECT_EQ(64, pool.getComputeUnit(0)->getVectorMemoryUnit()->
+			num_work_item_accesses);
+
+	// The 64 work-items share one 256-byte block
+	ObjectPool pool_256("[ VectorMemUnit ]\nCoalesceGranularity = 256\n");
+	blocks = Coalesce(pool_256, 0x1000, 4, 4);
+	ASSERT_EQ(1u, blocks.size());
+	EXPECT_EQ(0x1000u, blocks[0].virtual_address);
+}
+
+
+// Tests the number of blocks of strided accesses
+TEST(TestCoalesce, strided)
+{
+	// Two work-items per block
+	ObjectPool pool;
+	std::vector<Uop::BlockAccess> blocks = Coalesce(pool, 0x2000, 32, 4);
+	ASSERT_EQ(32u, blocks.size());
+	for (int i = 0; i < 32; i++)
+		EXPECT_EQ(0x2000u + i * 64, blocks[i].virtual_address);
+
+	// One block per work-item
+	blocks = Coalesce(pool, 0x2000, 128, 4);
+	ASSERT_EQ(64u, blocks.size());
+	for (int i = 0; i < 64; i++)
+		EXPECT_EQ(0x2000u + i * 128, blocks[i].virtual_address);
+
+	// Inactive work-items don't access memory. Only the even work-items
+	// are active, each in its own block.
+	blocks = Coalesce(pool, 0x2000, 32, 4, 0x5555555555555555ull);
+	ASSERT_EQ(32u, blocks.size());
+}
+
+
+// Tests accesses that span two blocks
+TEST(TestCoalesce, spanning_blocks)
+{
+	// 8-byte accesses starting 4 bytes before a block boundary, each in two
+	// blocks, with the next work-item starting in the second block
+	ObjectPool pool;
+	std::vector<Uop::BlockAccess> blocks = Coalesce(pool, 0x3000 + 60,
+			64, 8);
+	ASSERT_EQ(65u, blocks.size());
+	for (int i = 0; i < 65; i++)
+		EXPECT_EQ(0x3000u + i * 64, blocks[i].virtual_address);
+
+	// A single work-item accessing two blocks
+	blocks = Coalesce(pool, 0x3000 + 62, 0, 4, 1);
+	ASSERT_EQ(2u, blocks.size());
+	EXPECT_EQ(0x3000u, blocks[0].virtual_address);
+	EXPECT_EQ(0x3040u, blocks[1].virtual_address);
+}
+
+
+// Tests the translation of blocks in two pages that are not contiguous in
+// physical memory
+TEST(TestCoalesce, page_crossing)
+{
+	// Create the physical page of the second virtual page first
+	ObjectPool pool;
+	NDRange *ndrange = pool.newNDRange(ObjectPool::endpgm_code, 64, 64);
+	mem::Mmu *mmu = pool.getGpu()->getMmu();
+	unsigned second_page = mmu->TranslateVirtualAddress(
+			ndrange->address_space, 0x5000);
+
+	// Blocks around the boundary between pages 0x4000 and 0x5000
+	std::vector<Uop::BlockAccess> blocks = Coalesce(pool, 0x5000 - 128,
+			4, 4, ~0ull, ndrange);
+	unsigned first_page = mmu->TranslateVirtualAddress(
+			ndrange->address_space, 0x4000);
+	EXPECT_NE(second_page, first_page + mem::Mmu::PageSize);
+	ASSERT_EQ(4u, blocks.size());
+	EXPECT_EQ(0x4f80u, blocks[0].virtual_address);
+	EXPECT_EQ(first_page + 0xf80, blocks[0].physical_address);
+	EXPECT_EQ(first_page + 0xfc0, blocks[1].physical_address);
+	EXPECT_EQ(0x5000u, blocks[2].virtual_address);
+	EXPECT_EQ(second_page, blocks[2].physical_address);
+	EXPECT_EQ(second_page + 0x40, blocks[3].physical_address);
+}
+
+}
@@ -0,0 +1,186 @@
+/*
+ *  Multi2Sim
+ *  Copyright (C) 2015  Rafael Ubal (ubal@ece.neu.edu)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <gtest/gtest.h>
+
+#include "ObjectPool.h"
+
+namespace SI
+{
+
+// Return the work-groups running on each compute unit, as a string per
+// compute unit with the letter of the ND-range ('A' for the first one in
+// the list) followed by the work-group identifier
+static std::vector<std::string> getPlacement(ObjectPool &pool,
+		const std::vector<NDRange *> &ndranges)
+{
+	std::vector<std::string> placement(Gpu::num_compute_units);
+	for (unsigned i = 0; i < ndranges.size(); i++)
+	{
+		for (auto it = ndranges[i]->WorkGroupBegin(),
+				e = ndranges[i]->WorkGroupEnd();
+				it != e;
+				++it)
+		{
+			WorkGroup *work_group = it->get();
+			int index = work_group->wavefront_pool->getComputeUnit()->
+					getIndex();
+			placement[index] += misc::fmt("%c%d", 'A' + i,
+					work_group->getId());
+		}
+	}
+	return placement;
+}
+
+
+// Map two ND-ranges with 4 work-groups each to a GPU with 4 compute units
+// that fit one work-group each, and dispatch work-groups following the
+// given policy
+static std::vector<std::string> Dispatch(const std::string &policy)
+{
+	ObjectPool pool("[ Device ]\n"
+			"NumComputeUnits = 4\n"
+			"DispatchPolicy = " + policy + "\n"
+			"[ ComputeUnit ]\n"
+			"NumWavefrontPools = 1\n"
+			"MaxWorkGroupsPerWavefrontPool = 1\n");
+	std::vector<NDRange *> ndranges = {
+		pool.newNDRange(ObjectPool::endpgm_code, 256, 64),
+		pool.newNDRange(ObjectPool::endpgm_code, 256, 64)
+	};
+	for (NDRange *ndrange : ndranges)
+		pool.getGpu()->MapNDRange(ndrange);
+	pool.getGpu()->DispatchWorkGroups();
+	return getPlacement(pool, ndranges);
+}
+
+
+// Tests that work-groups of two ND-ranges mapped to the same compute unit
+// share the resources of its wavefront pool
+TEST(TestDispatch, shared_compute_unit_resources)
+{
+	// One wavefront pool with room for 4 wavefronts and the default 2048
+	// scalar registers
+	ObjectPool pool("[ ComputeUnit ]\n"
+			"NumWavefrontPools = 1\n"
+			"MaxWavefrontsPerWavefrontPool = 4\n");
+	ASSERT_EQ(2048, Gpu::num_scalar_registers);
+
+	// ND-range A, with 2 wavefronts and 512 scalar registers per
+	// work-group
+	NDRange *ndrange_a = pool.newNDRange(ObjectPool::endpgm_code, 256, 128);
+	ndrange_a->setNumSgprUsed(256);
+
+	// ND-range B, with 1 wavefront and 1024 scalar registers per
+	// work-group
+	NDRange *ndrange_b = pool.newNDRange(ObjectPool::endpgm_code, 256, 64);
+	ndrange_b->setNumSgprUsed(1024);
+
+	// Resources of each work-group
+	Gpu *gpu = pool.getGpu();
+	gpu->MapNDRange(ndrange_a);
+	gpu->MapNDRange(ndrange_b);
+	EXPECT_EQ(2, gpu->getWorkGroupResources(ndrange_a).num_wavefronts);
+	EXPECT_EQ(512, gpu->getWorkGroupResources(ndrange_a)
+			.num_scalar_registers);
+	EXPECT_EQ(1, gpu->getWorkGroupResources(ndrange_b).num_wavefronts);
+	EXPECT_EQ(1024, gpu->getWorkGroupResources(ndrange_b)
+			.num_scalar_registers);
+
+	// A work-group of A leaves room for work-groups of both
+	ComputeUnit *compute_unit = pool.getComputeUnit(0);
+	WorkGroup *work_group_a = pool.MapWorkGroup(ndrange_a, 0);
+	EXPECT_TRUE(compute_unit->canMapWorkGroup(ndrange_a));
+	EXPECT_TRUE(compute_unit->canMapWorkGroup(ndrange_b));
+
+	// With a work-group of B next to it, 3 wavefronts and 1536 scalar
+	// registers are taken. Another work-group of A exceeds the wavefront
+	// limit, and another one of B the scalar register limit.
+	WorkGroup *work_group_b = pool.MapWorkGroup(ndrange_b, 0);
+	EXPECT_EQ(work_group_a->wavefront_pool, work_group_b->wavefront_pool);
+	EXPECT_FALSE(compute_unit->canMapWorkGroup(ndrange_a));
+	EXPECT_FALSE(compute_unit->canMapWorkGroup(ndrange_b));
+	EXPECT_FALSE(gpu->isComputeUnitAvailable(compute_unit));
+
+	// Other compute units are not affected
+	EXPECT_TRUE(pool.getComputeUnit(1)->canMapWorkGroup(ndrange_a));
+
+	// Unmapping the work-group of A releases its resources
+	compute_unit->UnmapWorkGroup(work_group_a);
+	EXPECT_TRUE(compute_unit->canMapWorkGroup(ndrange_a));
+	EXPECT_TRUE(compute_unit->canMapWorkGroup(ndrange_b));
+	EXPECT_TRUE(gpu->isComputeUnitAvailable(compute_unit));
+}
+
+
+// Tests that the 'Fifo' policy dispatches all work-groups of the first
+// ND-range before those of the second
+TEST(TestDispatch, fifo)
+{
+	std::vector<std::string> placement = Dispatch("Fifo");
+	EXPECT_EQ((std::vector<std::string> { "A0", "A1", "A2", "A3" }),
+			placement);
+}
+
+
+// Tests that the 'RoundRobin' policy alternates between ND-ranges
+TEST(TestDispatch, round_robin)
+{
+	std::vector<std::string> placement = Dispatch("RoundRobin");
+	EXPECT_EQ((std::vector<std::string> { "A0", "B0", "A1", "B1" }),
+			placement);
+}
+
+
+// Tests that the 'Partition' policy gives each ND-range half of the
+// compute units
+TEST(TestDispatch, partition)
+{
+	std::vector<std::string> placement = Dispatch("Partition");
+	EXPECT_EQ((std::vector<std::string> { "A0", "A1", "B0", "B1" }),
+			placement);
+}
+
+
+// Tests that the 'Fifo' policy fills the slots left by the first ND-range
+// with work-groups of the second one, sharing compute units
+TEST(TestDispatch, fifo_shared_compute_unit)
+{
+	// 2 compute units with room for 2 work-groups each
+	ObjectPool pool("[ Device ]\n"
+			"NumComputeUnits = 2\n"
+			"[ ComputeUnit ]\n"
+			"NumWavefrontPools = 1\n"
+			"MaxWorkGroupsPerWavefrontPool = 2\n");
+	std::vector<NDRange *> ndranges = {
+		pool.newNDRange(ObjectPool::endpgm_code, 64, 64),
+		pool.newNDRange(ObjectPool::endpgm_code, 256, 64)
+	};
+	for (NDRange *ndrange : ndranges)
+		pool.getGpu()->MapNDRange(ndrange);
+	pool.getGpu()->DispatchWorkGroups();
+
+	// Compute units that still have room are moved to the end of the list
+	// of available compute units
+	std::vector<std::string> placement = getPlacement(pool, ndranges);
+	EXPECT_EQ((std::vector<std::string> { "A0B1", "B0B2" }), placement);
+	EXPECT_EQ(1u, ndranges[1]->getNumWaitingWorkgroups());
+}
+
+}
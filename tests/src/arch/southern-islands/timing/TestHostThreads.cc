@@ -0,0 +1,168 @@
+/*
+ *  Multi2Sim
+ *  Copyright (C) 2015  Rafael Ubal (ubal@ece.neu.edu)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <sstream>
+
+#include <gtest/gtest.h>
+#include <memory/System.h>
+
+#include "ObjectPool.h"
+
+namespace SI
+{
+
+// Address of the buffer that all work-groups load from and store into
+static const unsigned buffer_address = 0x10000;
+
+// Kernel where every work-item increments the word at 'buffer_address + 4 *
+// id' 3 times. Work-items with the same local identifier in different
+// work-groups increment the same word without synchronization, so the final
+// buffer depends on the order of the global memory accesses.
+static const std::vector<unsigned> code =
+{
+	// s_mov_b32 s4, 0x10000 ; buffer descriptor in s[4:7]
+	0xbe8403ff, buffer_address,
+	// s_mov_b32 s5, 0
+	0xbe850380,
+	// s_mov_b32 s6, -1
+	0xbe8603c1,
+	// s_mov_b32 s7, 0
+	0xbe870380,
+	// s_mov_b32 s8, 3
+	0xbe880383,
+	// v_lshlrev_b32 v1, 2, v0
+	0x34020082,
+// loop:
+	// s_buffer_load_dword s9, s[4:7], 0x0
+	0xc2048500,
+	// buffer_load_dword v3, v1, s[4:7], 0 offen
+	0xe0301000, 0x80010301,
+	// s_waitcnt vmcnt(0) lgkmcnt(0)
+	0xbf8c0070,
+	// v_add_i32 v3, vcc, 1, v3
+	0x4a060681,
+	// buffer_store_dword v3, v1, s[4:7], 0 offen
+	0xe0701000, 0x80010301,
+	// s_sub_i32 s8, s8, 1
+	0x81888108,
+	// s_cmp_eq_i32 s8, 0
+	0xbf008008,
+	// s_cbranch_scc0 loop
+	0xbf84fff6,
+	// s_waitcnt vmcnt(0) lgkmcnt(0)
+	0xbf8c0070,
+	// s_endpgm
+	0xbf810000
+};
+
+
+// Run the kernel with 32 work-groups on 8 compute units, emulating
+// instructions on the given number of host threads. Return a dump of the
+// cycles, the statistics of every compute unit and cache, and the buffer.
+static std::string RunKernel(int num_host_threads)
+{
+	// GPU
+	Emulator::setNumHostThreads(num_host_threads);
+	ObjectPool pool("[ Device ]\n"
+			"NumComputeUnits = 8\n");
+
+	// Buffer, initially zero
+	mem::Memory *memory = pool.getEmulator()->getGlobalMemory();
+	memory->Map(buffer_address, mem::Memory::PageSize,
+			mem::Memory::AccessRead | mem::Memory::AccessWrite);
+	for (unsigned i = 0; i < 64; i++)
+	{
+		unsigned zero = 0;
+		memory->Write(buffer_address + i * 4, 4, (const char *) &zero);
+	}
+
+	// Run
+	pool.newNDRange(code, 64 * 32, 64);
+	std::ostringstream os;
+	os << "Cycles = " << pool.Run() << '\n';
+	Emulator::setNumHostThreads(1);
+
+	// Statistics of every compute unit
+	Emulator *emulator = pool.getEmulator();
+	os << "Instructions = " << emulator->getNumInstructions() << '\n';
+	for (int i = 0; i < Gpu::num_compute_units; i++)
+	{
+		ComputeUnit *compute_unit = pool.getComputeUnit(i);
+		os << "ComputeUnit " << i
+				<< " work_groups "
+				<< compute_unit->num_mapped_work_groups
+				<< " instructions "
+				<< compute_unit->num_total_instructions
+				<< " scalar_memory "
+				<< compute_unit->num_scalar_memory_instructions
+				<< " vector_memory "
+				<< compute_unit->num_vector_memory_instructions
+				<< " block_accesses "
+				<< compute_unit->getVectorMemoryUnit()->
+						num_block_accesses
+				<< " memory_stalls "
+				<< compute_unit->num_memory_stalls
+				<< " issue_stalls "
+				<< compute_unit->num_issue_stalls
+				<< " states";
+		for (int j = 0; j < ComputeUnit::WavefrontStateCount; j++)
+			os << ' ' << compute_unit->wavefront_states[j];
+		os << '\n';
+	}
+
+	// Statistics of the caches
+	mem::System *memory_system = mem::System::getInstance();
+	for (int i = 0; i < Gpu::num_compute_units; i++)
+		memory_system->getModule(misc::fmt("si-vector-l1-%d", i))->
+				DumpReport(os);
+	for (int i = 0; i < Gpu::num_compute_units / 4; i++)
+		memory_system->getModule(misc::fmt("si-scalar-l1-%d", i))->
+				DumpReport(os);
+
+	// Buffer
+	for (unsigned i = 0; i < 64; i++)
+	{
+		unsigned value;
+		memory->Read(buffer_address + i * 4, 4, (char *) &value);
+		os << value << ' ';
+	}
+	os << '\n';
+	return os.str();
+}
+
+
+// Tests that emulating instructions of compute units on several host
+// threads gives the same cycles, statistics and results as sequential mode
+TEST(TestSITimingHostThreads, parallel_matches_sequential)
+{
+	std::string sequential = RunKernel(1);
+	std::string parallel = RunKernel(4);
+
+	// All compute units ran work-groups
+	EXPECT_EQ(std::string::npos, sequential.find(" work_groups 0 "))
+			<< sequential;
+	EXPECT_NE(std::string::npos, sequential.find(
+			"ComputeUnit 7 work_groups 4 "))
+			<< sequential;
+
+	// Same results
+	EXPECT_EQ(sequential, parallel);
+}
+
+}
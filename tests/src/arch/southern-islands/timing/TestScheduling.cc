@@ -0,0 +1,277 @@
+/*
+ *  Multi2Sim
+ *  Copyright (C) 2015  Rafael Ubal (ubal@ece.neu.edu)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <gtest/gtest.h>
+
+#include <arch/southern-islands/timing/Uop.h>
+#include <lib/cpp/Misc.h>
+
+#include "ObjectPool.h"
+
+namespace SI
+{
+
+// Return the configuration of a GPU with one wavefront pool per compute unit
+// and the given scheduling policy
+static std::string getConfig(const std::string &policy)
+{
+	return "[ ComputeUnit ]\n"
+			"NumWavefrontPools = 1\n"
+			"MaxActiveWavefronts = 2\n"
+			"SchedulingPolicy = " + policy + "\n";
+}
+
+
+// Map 8 wavefronts to the wavefront pool of compute unit 0, and return the
+// pool. The first 4 entries hold wavefronts 8 to 11, and the next 4 entries
+// hold the older wavefronts 4 to 7, so that the age of the wavefronts
+// doesn't follow the order of the entries.
+static WavefrontPool *MapWavefronts(ObjectPool &pool)
+{
+	NDRange *ndrange = pool.newNDRange(ObjectPool::endpgm_code, 768, 256);
+	WorkGroup *work_group = pool.MapWorkGroup(ndrange, 0);
+	pool.MapWorkGroup(ndrange, 0);
+	pool.getComputeUnit(0)->UnmapWorkGroup(work_group);
+	return pool.MapWorkGroup(ndrange, 0)->wavefront_pool;
+}
+
+
+// Return the wavefront with the given identifier in the wavefront pool
+static Wavefront *getWavefront(WavefrontPool *wavefront_pool, int id)
+{
+	for (auto &entry : *wavefront_pool)
+		if (entry->getWavefront() && entry->getWavefront()->getId() == id)
+			return entry->getWavefront();
+	return nullptr;
+}
+
+
+// Return the identifiers of the wavefronts in the wavefront pool, in the
+// order in which compute unit 0 fetches from them
+static std::vector<int> getFetchOrder(ObjectPool &pool,
+		WavefrontPool *wavefront_pool)
+{
+	std::vector<WavefrontPoolEntry *> candidates;
+	for (auto &entry : *wavefront_pool)
+		if (entry->getWavefront())
+			candidates.push_back(entry.get());
+	pool.getComputeUnit(0)->SortFetchCandidates(wavefront_pool, candidates);
+	std::vector<int> order;
+	for (WavefrontPoolEntry *entry : candidates)
+		order.push_back(entry->getWavefront()->getId());
+	return order;
+}
+
+
+// Return the identifiers of the wavefronts in the active set of the
+// two-level scheduling policy, in the order of their entries
+static std::vector<int> getActiveWavefronts(WavefrontPool *wavefront_pool)
+{
+	std::vector<int> active;
+	for (auto &entry : *wavefront_pool)
+		if (entry->active)
+			active.push_back(entry->getWavefront()->getId());
+	return active;
+}
+
+
+// Return a new uop of the wavefront with the given identifier
+static std::unique_ptr<Uop> newUop(WavefrontPool *wavefront_pool, int id)
+{
+	Wavefront *wavefront = getWavefront(wavefront_pool, id);
+	return misc::new_unique<Uop>(wavefront,
+			wavefront->getWavefrontPoolEntry(), 0,
+			wavefront->getWorkGroup(), 0);
+}
+
+
+// Tests that the 'Fixed' policy fetches in the order of the entries, and
+// issues the oldest wavefront first
+TEST(TestScheduling, fixed)
+{
+	ObjectPool pool(getConfig("Fixed"));
+	WavefrontPool *wavefront_pool = MapWavefronts(pool);
+	ComputeUnit *compute_unit = pool.getComputeUnit(0);
+	ASSERT_EQ(ComputeUnit::SchedulingPolicyFixed,
+			compute_unit->getSchedulingPolicy());
+
+	// Fetch
+	wavefront_pool->setLastFetchedEntry(5);
+	EXPECT_EQ((std::vector<int> { 8, 9, 10, 11, 4, 5, 6, 7 }),
+			getFetchOrder(pool, wavefront_pool));
+
+	// Issue
+	FetchBuffer *fetch_buffer = compute_unit->getFetchBuffer(0);
+	fetch_buffer->setLastIssuedWavefrontId(5);
+	std::unique_ptr<Uop> uop_4 = newUop(wavefront_pool, 4);
+	std::unique_ptr<Uop> uop_8 = newUop(wavefront_pool, 8);
+	EXPECT_TRUE(compute_unit->isPreferredUop(uop_4.get(), uop_8.get(),
+			fetch_buffer));
+	EXPECT_FALSE(compute_unit->isPreferredUop(uop_8.get(), uop_4.get(),
+			fetch_buffer));
+}
+
+
+// Tests that the 'LooseRoundRobin' policy starts after the last wavefront
+// that an instruction was fetched or issued from
+TEST(TestScheduling, loose_round_robin)
+{
+	ObjectPool pool(getConfig("LooseRoundRobin"));
+	WavefrontPool *wavefront_pool = MapWavefronts(pool);
+	ComputeUnit *compute_unit = pool.getComputeUnit(0);
+
+	// Nothing fetched yet, so the order of the entries is kept
+	EXPECT_EQ((std::vector<int> { 8, 9, 10, 11, 4, 5, 6, 7 }),
+			getFetchOrder(pool, wavefront_pool));
+
+	// Entries following entry 5 go first, wrapping around
+	wavefront_pool->setLastFetchedEntry(5);
+	EXPECT_EQ((std::vector<int> { 6, 7, 8, 9, 10, 11, 4, 5 }),
+			getFetchOrder(pool, wavefront_pool));
+
+	// Wavefronts following wavefront 5 issue first, then the others
+	FetchBuffer *fetch_buffer = compute_unit->getFetchBuffer(0);
+	fetch_buffer->setLastIssuedWavefrontId(5);
+	std::unique_ptr<Uop> uop_4 = newUop(wavefront_pool, 4);
+	std::unique_ptr<Uop> uop_5 = newUop(wavefront_pool, 5);
+	std::unique_ptr<Uop> uop_6 = newUop(wavefront_pool, 6);
+	std::unique_ptr<Uop> uop_8 = newUop(wavefront_pool, 8);
+	EXPECT_TRUE(compute_unit->isPreferredUop(uop_6.get(), uop_8.get(),
+			fetch_buffer));
+	EXPECT_TRUE(compute_unit->isPreferredUop(uop_8.get(), uop_4.get(),
+			fetch_buffer));
+	EXPECT_TRUE(compute_unit->isPreferredUop(uop_4.get(), uop_5.get(),
+			fetch_buffer));
+	EXPECT_FALSE(compute_unit->isPreferredUop(uop_5.get(), uop_6.get(),
+			fetch_buffer));
+}
+
+
+// Tests that the 'GreedyThenOldest' policy keeps the last wavefront first,
+// followed by the others from oldest to youngest
+TEST(TestScheduling, greedy_then_oldest)
+{
+	ObjectPool pool(getConfig("GreedyThenOldest"));
+	WavefrontPool *wavefront_pool = MapWavefronts(pool);
+	ComputeUnit *compute_unit = pool.getComputeUnit(0);
+
+	// Fetch, with wavefront 10 in entry 2
+	wavefront_pool->setLastFetchedEntry(2);
+	EXPECT_EQ((std::vector<int> { 10, 4, 5, 6, 7, 8, 9, 11 }),
+			getFetchOrder(pool, wavefront_pool));
+
+	// Issue
+	FetchBuffer *fetch_buffer = compute_unit->getFetchBuffer(0);
+	fetch_buffer->setLastIssuedWavefrontId(9);
+	std::unique_ptr<Uop> uop_4 = newUop(wavefront_pool, 4);
+	std::unique_ptr<Uop> uop_8 = newUop(wavefront_pool, 8);
+	std::unique_ptr<Uop> uop_9 = newUop(wavefront_pool, 9);
+	EXPECT_TRUE(compute_unit->isPreferredUop(uop_9.get(), uop_4.get(),
+			fetch_buffer));
+	EXPECT_TRUE(compute_unit->isPreferredUop(uop_4.get(), uop_8.get(),
+			fetch_buffer));
+	EXPECT_FALSE(compute_unit->isPreferredUop(uop_8.get(), uop_9.get(),
+			fetch_buffer));
+}
+
+
+// Tests that the 'TwoLevel' policy demotes wavefronts waiting for memory,
+// at a barrier or finished, and promotes the oldest pending wavefronts
+TEST(TestScheduling, two_level)
+{
+	ObjectPool pool(getConfig("TwoLevel"));
+	WavefrontPool *wavefront_pool = MapWavefronts(pool);
+	ComputeUnit *compute_unit = pool.getComputeUnit(0);
+	WavefrontPoolEntry *entry_4 = getWavefront(wavefront_pool, 4)->
+			getWavefrontPoolEntry();
+	WavefrontPoolEntry *entry_5 = getWavefront(wavefront_pool, 5)->
+			getWavefrontPoolEntry();
+	WavefrontPoolEntry *entry_6 = getWavefront(wavefront_pool, 6)->
+			getWavefrontPoolEntry();
+
+	// The two oldest wavefronts are promoted
+	compute_unit->UpdateActiveWavefronts(wavefront_pool);
+	EXPECT_EQ((std::vector<int> { 4, 5 }),
+			getActiveWavefronts(wavefront_pool));
+
+	// Wavefront 4 waits for memory, and is replaced by wavefront 6
+	entry_4->mem_wait = true;
+	entry_4->vm_cnt = 1;
+	compute_unit->UpdateActiveWavefronts(wavefront_pool);
+	EXPECT_EQ((std::vector<int> { 5, 6 }),
+			getActiveWavefronts(wavefront_pool));
+
+	// Wavefront 4 is done waiting, but the active set is full
+	entry_4->vm_cnt = 0;
+	compute_unit->UpdateActiveWavefronts(wavefront_pool);
+	EXPECT_EQ((std::vector<int> { 5, 6 }),
+			getActiveWavefronts(wavefront_pool));
+
+	// Wavefront 5 waits at a barrier, and is replaced by the oldest
+	// pending wavefront 4
+	entry_5->wait_for_barrier = true;
+	compute_unit->UpdateActiveWavefronts(wavefront_pool);
+	EXPECT_EQ((std::vector<int> { 4, 6 }),
+			getActiveWavefronts(wavefront_pool));
+
+	// Wavefront 6 finishes, and is replaced by wavefront 7
+	entry_6->wavefront_finished = true;
+	compute_unit->UpdateActiveWavefronts(wavefront_pool);
+	EXPECT_EQ((std::vector<int> { 4, 7 }),
+			getActiveWavefronts(wavefront_pool));
+
+	// Wavefronts take turns as in the loose round-robin policy
+	wavefront_pool->setLastFetchedEntry(5);
+	EXPECT_EQ((std::vector<int> { 6, 7, 8, 9, 10, 11, 4, 5 }),
+			getFetchOrder(pool, wavefront_pool));
+}
+
+
+// Tests that the 'MemoryAware' policy puts wavefronts with outstanding
+// vector memory accesses last
+TEST(TestScheduling, memory_aware)
+{
+	ObjectPool pool(getConfig("MemoryAware"));
+	WavefrontPool *wavefront_pool = MapWavefronts(pool);
+	ComputeUnit *compute_unit = pool.getComputeUnit(0);
+
+	// Fetch, oldest first among wavefronts with and without accesses
+	getWavefront(wavefront_pool, 4)->getWavefrontPoolEntry()->vm_cnt = 1;
+	getWavefront(wavefront_pool, 9)->getWavefrontPoolEntry()->vm_cnt = 2;
+	EXPECT_EQ((std::vector<int> { 5, 6, 7, 8, 10, 11, 4, 9 }),
+			getFetchOrder(pool, wavefront_pool));
+
+	// Issue
+	FetchBuffer *fetch_buffer = compute_unit->getFetchBuffer(0);
+	std::unique_ptr<Uop> uop_4 = newUop(wavefront_pool, 4);
+	std::unique_ptr<Uop> uop_5 = newUop(wavefront_pool, 5);
+	std::unique_ptr<Uop> uop_8 = newUop(wavefront_pool, 8);
+	std::unique_ptr<Uop> uop_9 = newUop(wavefront_pool, 9);
+	EXPECT_TRUE(compute_unit->isPreferredUop(uop_8.get(), uop_4.get(),
+			fetch_buffer));
+	EXPECT_TRUE(compute_unit->isPreferredUop(uop_5.get(), uop_8.get(),
+			fetch_buffer));
+	EXPECT_TRUE(compute_unit->isPreferredUop(uop_4.get(), uop_9.get(),
+			fetch_buffer));
+	EXPECT_FALSE(compute_unit->isPreferredUop(uop_9.get(), uop_4.get(),
+			fetch_buffer));
+}
+
+}
+
@@ -104,4 +104,117 @@ TEST(TestTiming, config_section_device_frequency_1)
 }
 
 
+// This test checks to see if the correct error message is returned when
+// the coalescing granularity of the vector memory unit is not a power of 2
+TEST(TestTiming, config_section_vector_mem_unit_coalesce_granularity)
+{
+	// Cleanup singleton instances
+	Cleanup();
+
+	// Create config file
+	std::string config =
+		"[ Device ]\n"
+		"Frequency = 1000\n"
+		"[ VectorMemUnit ]\n"
+		"CoalesceGranularity = 48";
+
+	// Load config file
+	misc::IniFile ini_file;
+	ini_file.LoadFromString(config);
+
+	// Try ParseConfiguration for invalid granularity
+	std::string message;
+	try
+	{
+		Timing::ParseConfiguration(&ini_file);
+	}
+	catch(misc::Error &error)
+	{
+		message = error.getMessage();
+	}
+
+	// Check error message
+	EXPECT_REGEX_MATCH(misc::fmt(".*%s: The value for "
+			"'CoalesceGranularity' must be a power of 2 no greater "
+			"than the page size.\n.*",
+			ini_file.getPath().c_str()).c_str(),
+			message.c_str());
+}
+
+
+// This test checks to see if the correct error message is returned when
+// the policy to dispatch work-groups of concurrent ND-ranges is not valid
+TEST(TestTiming, config_section_device_dispatch_policy)
+{
+	// Cleanup singleton instances
+	Cleanup();
+
+	// Create config file
+	std::string config =
+		"[ Device ]\n"
+		"Frequency = 1000\n"
+		"DispatchPolicy = Random";
+
+	// Load config file
+	misc::IniFile ini_file;
+	ini_file.LoadFromString(config);
+
+	// Try ParseConfiguration for invalid policy
+	std::string message;
+	try
+	{
+		Timing::ParseConfiguration(&ini_file);
+	}
+	catch(misc::Error &error)
+	{
+		message = error.getMessage();
+	}
+
+	// Check error message
+	EXPECT_REGEX_MATCH(misc::fmt(".*%s: Section \\[Device\\], variable "
+			"'DispatchPolicy', invalid value 'Random'\n.*",
+			ini_file.getPath().c_str()).c_str(),
+			message.c_str());
+}
+
+
+// This test checks to see if the correct error message is returned when
+// the wavefront scheduling policy given for one compute unit is not valid
+TEST(TestTiming, config_section_compute_unit_scheduling_policy)
+{
+	// Cleanup singleton instances
+	Cleanup();
+
+	// Create config file
+	std::string config =
+		"[ Device ]\n"
+		"Frequency = 1000\n"
+		"[ ComputeUnit ]\n"
+		"SchedulingPolicy = TwoLevel\n"
+		"[ ComputeUnit 3 ]\n"
+		"SchedulingPolicy = Random";
+
+	// Load config file
+	misc::IniFile ini_file;
+	ini_file.LoadFromString(config);
+
+	// Try ParseConfiguration for invalid policy
+	std::string message;
+	try
+	{
+		Timing::ParseConfiguration(&ini_file);
+	}
+	catch(misc::Error &error)
+	{
+		message = error.getMessage();
+	}
+
+	// Check error message
+	EXPECT_REGEX_MATCH(misc::fmt(".*%s: Section \\[ComputeUnit 3\\], "
+			"variable 'SchedulingPolicy', invalid value 'Random'\n.*",
+			ini_file.getPath().c_str()).c_str(),
+			message.c_str());
+}
+
+
 } // namespace SI
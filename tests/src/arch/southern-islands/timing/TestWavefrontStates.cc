@@ -0,0 +1,185 @@
+/*
+ *  Multi2Sim
+ *  Copyright (C) 2015  Rafael Ubal (ubal@ece.neu.edu)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <gtest/gtest.h>
+
+#include <arch/southern-islands/timing/Uop.h>
+#include <lib/cpp/Misc.h>
+
+#include "ObjectPool.h"
+
+namespace SI
+{
+
+// Configuration with one wavefront pool of 10 entries per compute unit
+static const std::string config =
+		"[ ComputeUnit ]\n"
+		"NumWavefrontPools = 1\n";
+
+
+// Map a work-group with the given number of wavefronts to compute unit 0,
+// after running one cycle of the compute unit without work-groups
+static WorkGroup *MapWorkGroup(ObjectPool &pool, int num_wavefronts)
+{
+	pool.getComputeUnit(0)->Run();
+	NDRange *ndrange = pool.newNDRange(ObjectPool::endpgm_code,
+			num_wavefronts * 64, num_wavefronts * 64);
+	return pool.MapWorkGroup(ndrange, 0);
+}
+
+
+// Add a uop of the given wavefront to fetch buffer 0, completing fetch in
+// the given cycle
+static void AddUop(ObjectPool &pool, Wavefront *wavefront, long long cycle)
+{
+	auto uop = misc::new_unique<Uop>(wavefront,
+			wavefront->getWavefrontPoolEntry(), 0,
+			wavefront->getWorkGroup(), 0);
+	uop->fetch_ready = cycle;
+	pool.getComputeUnit(0)->getFetchBuffer(0)->addUop(std::move(uop));
+}
+
+
+// Tests the state of a wavefront pool entry in each situation
+TEST(TestWavefrontStates, get_wavefront_state)
+{
+	ObjectPool pool(config);
+	WorkGroup *work_group = MapWorkGroup(pool, 1);
+	ComputeUnit *compute_unit = pool.getComputeUnit(0);
+	Wavefront *wavefront = work_group->getWavefront(0);
+	WavefrontPoolEntry *entry = wavefront->getWavefrontPoolEntry();
+	const ComputeUnit::WavefrontState none =
+			ComputeUnit::WavefrontStateCount;
+
+	// Entry without wavefront
+	WavefrontPoolEntry *empty_entry = nullptr;
+	for (auto &other : *work_group->wavefront_pool)
+		if (!other->getWavefront())
+			empty_entry = other.get();
+	ASSERT_TRUE(empty_entry);
+	EXPECT_EQ(ComputeUnit::WavefrontStateNoWavefront,
+			compute_unit->getWavefrontState(empty_entry, none));
+
+	// Ready to fetch, or with an instruction in the fetch buffer
+	EXPECT_EQ(ComputeUnit::WavefrontStateFetchBufferEmpty,
+			compute_unit->getWavefrontState(entry, none));
+	EXPECT_EQ(ComputeUnit::WavefrontStateExecutionUnitBusy,
+			compute_unit->getWavefrontState(entry,
+			ComputeUnit::WavefrontStateExecutionUnitBusy));
+
+	// Previous instruction executing
+	entry->ready = false;
+	EXPECT_EQ(ComputeUnit::WavefrontStateInFlight,
+			compute_unit->getWavefrontState(entry, none));
+
+	// Issued in this cycle, regardless of the fetch buffer
+	entry->issue_cycle = pool.getTiming()->getCycle();
+	EXPECT_EQ(ComputeUnit::WavefrontStateIssued,
+			compute_unit->getWavefrontState(entry,
+			ComputeUnit::WavefrontStateExecutionUnitBusy));
+	entry->issue_cycle = -1;
+
+	// Waiting for memory, charged to the memory with the longest latency
+	entry->mem_wait = true;
+	entry->lgkm_cnt = 2;
+	entry->lds_cnt = 2;
+	EXPECT_EQ(ComputeUnit::WavefrontStateLds,
+			compute_unit->getWavefrontState(entry, none));
+	entry->lgkm_cnt = 3;
+	EXPECT_EQ(ComputeUnit::WavefrontStateScalarMemory,
+			compute_unit->getWavefrontState(entry, none));
+	entry->vm_cnt = 1;
+	EXPECT_EQ(ComputeUnit::WavefrontStateVectorMemory,
+			compute_unit->getWavefrontState(entry, none));
+
+	// Outstanding accesses without a wait instruction
+	entry->mem_wait = false;
+	EXPECT_EQ(ComputeUnit::WavefrontStateInFlight,
+			compute_unit->getWavefrontState(entry, none));
+
+	// Waiting at a barrier
+	entry->wait_for_barrier = true;
+	EXPECT_EQ(ComputeUnit::WavefrontStateBarrier,
+			compute_unit->getWavefrontState(entry, none));
+	entry->wait_for_barrier = false;
+
+	// Finished, waiting for its memory accesses and then for the rest of
+	// the work-group
+	entry->wavefront_finished = true;
+	EXPECT_EQ(ComputeUnit::WavefrontStateVectorMemory,
+			compute_unit->getWavefrontState(entry, none));
+	entry->vm_cnt = 0;
+	entry->lgkm_cnt = 0;
+	entry->lds_cnt = 0;
+	EXPECT_EQ(ComputeUnit::WavefrontStateFinished,
+			compute_unit->getWavefrontState(entry, none));
+}
+
+
+// Tests the statistics added for all entries in a cycle
+TEST(TestWavefrontStates, record_wavefront_states)
+{
+	// The cycle run before mapping the work-group found all entries
+	// empty
+	ObjectPool pool(config);
+	WorkGroup *work_group = MapWorkGroup(pool, 5);
+	ComputeUnit *compute_unit = pool.getComputeUnit(0);
+	long long cycle = pool.getTiming()->getCycle();
+	EXPECT_EQ(1, compute_unit->num_accounted_cycles);
+	EXPECT_EQ(10, compute_unit->wavefront_states[
+			ComputeUnit::WavefrontStateNoWavefront]);
+	EXPECT_EQ(0, compute_unit->num_resident_wavefronts);
+	long long occupancy_limit = compute_unit->num_occupancy_limit;
+
+	// Wavefront 0 is ready to fetch, 1 has its previous instruction
+	// executing, 2 waits at a barrier, 3 has an instruction ready to
+	// issue, and 4 has an instruction still being fetched
+	work_group->getWavefront(1)->getWavefrontPoolEntry()->ready = false;
+	work_group->getWavefront(2)->getWavefrontPoolEntry()->
+			wait_for_barrier = true;
+	work_group->getWavefront(3)->getWavefrontPoolEntry()->ready = false;
+	AddUop(pool, work_group->getWavefront(3), cycle);
+	work_group->getWavefront(4)->getWavefrontPoolEntry()->ready = false;
+	AddUop(pool, work_group->getWavefront(4), cycle + 1);
+
+	// Record the cycle
+	std::fill(compute_unit->wavefront_states,
+			compute_unit->wavefront_states +
+			ComputeUnit::WavefrontStateCount, 0);
+	compute_unit->RecordWavefrontStates();
+	long long expected[ComputeUnit::WavefrontStateCount] = { };
+	expected[ComputeUnit::WavefrontStateFetchBufferEmpty] = 2;
+	expected[ComputeUnit::WavefrontStateInFlight] = 1;
+	expected[ComputeUnit::WavefrontStateBarrier] = 1;
+	expected[ComputeUnit::WavefrontStateExecutionUnitBusy] = 1;
+	expected[ComputeUnit::WavefrontStateNoWavefront] = 5;
+	for (int i = 0; i < ComputeUnit::WavefrontStateCount; i++)
+		EXPECT_EQ(expected[i], compute_unit->wavefront_states[i])
+				<< ComputeUnit::wavefront_state_map[i];
+
+	// Occupancy
+	EXPECT_EQ(2, compute_unit->num_accounted_cycles);
+	EXPECT_EQ(5, compute_unit->num_resident_wavefronts);
+	EXPECT_EQ(occupancy_limit + pool.getGpu()->
+			getMaxWavefrontsPerComputeUnit(),
+			compute_unit->num_occupancy_limit);
+}
+
+}
+
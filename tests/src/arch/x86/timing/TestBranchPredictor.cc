@@ -593,8 +593,184 @@ TEST(TestBranchPredictor, test_combined_branch_predictor_1)
 }
 
 
+TEST(TestBranchPredictor, test_warm_branch_predictor_1)
+{
+	// Setup configuration file for branch predictor
+	std::string config =
+			"[ BranchPredictor ]\n"
+			"Kind = Bimodal\n"
+			"Bimod.Size = 512";
+
+	// Set up INI file
+	misc::IniFile ini_file;
+	ini_file.LoadFromString(config);
+
+	// Set ini file in Timing
+	Timing::ParseConfiguration(&ini_file);
+	BranchPredictor::ParseConfiguration(&ini_file);
+
+	// Local variable declaration
+	unsigned int branch_addr = 0x1000;
+	unsigned int branch_inst_size = 4;
+	unsigned int branch_target = 0x2000;
+	ObjectPool *object_pool = ObjectPool::getInstance();
+
+	// Create a branch predictor instance
+	BranchPredictor branch_predictor;
+
+	// Taken branch, executed functionally twice
+	auto uinst = misc::new_shared<Uinst>(Uinst::OpcodeBranch);
+	for (int i = 0; i < 2; i++)
+	{
+		auto uop = misc::new_unique<Uop>(
+				object_pool->getThread(),
+				object_pool->getContext(),
+				uinst);
+		uop->eip = branch_addr;
+		uop->neip = branch_target;
+		uop->mop_size = branch_inst_size;
+		branch_predictor.Warm(uop.get());
+	}
+
+	// Weakly Taken -> Strongly Taken -> Strongly Taken
+	EXPECT_EQ(3, (int) branch_predictor.getBimodStatus(
+			branch_addr & (BranchPredictor::getBimodSize() - 1)));
+
+	// The BTB now holds the target of the branch
+	auto uop = misc::new_unique<Uop>(
+			object_pool->getThread(),
+			object_pool->getContext(),
+			uinst);
+	uop->eip = branch_addr;
+	uop->mop_size = branch_inst_size;
+	EXPECT_EQ(branch_target, branch_predictor.LookupBtb(uop.get()));
+}
+
+
+// Runs a branch with a repeating taken-taken-not-taken pattern through a
+// predictor using global history, and returns the number of mispredictions
+// in the last iterations, once the predictor is trained.
+static int RunRepeatingPattern(const std::string &kind)
+{
+	// Setup configuration file for branch predictor
+	std::string config =
+			"[ BranchPredictor ]\n"
+			"Kind = " + kind + "\n";
+	misc::IniFile ini_file;
+	ini_file.LoadFromString(config);
+	Timing::ParseConfiguration(&ini_file);
+	BranchPredictor::ParseConfiguration(&ini_file);
+
+	// Local variable declaration
+	unsigned int branch_addr = 0x1000;
+	unsigned int branch_inst_size = 4;
+	unsigned int branch_target = 0x2000;
+	ObjectPool *object_pool = ObjectPool::getInstance();
+
+	// Create a branch predictor instance
+	BranchPredictor branch_predictor;
+
+	// Predict and update as the fetch and commit stages would do
+	auto uinst = misc::new_shared<Uinst>(Uinst::OpcodeBranch);
+	int num_mispredictions = 0;
+	for (int i = 0; i < 3000; i++)
+	{
+		auto uop = misc::new_unique<Uop>(
+				object_pool->getThread(),
+				object_pool->getContext(),
+				uinst);
+		bool taken = i % 3 != 2;
+		uop->eip = branch_addr;
+		uop->neip = taken ? branch_target : branch_addr + branch_inst_size;
+		uop->mop_size = branch_inst_size;
+		BranchPredictor::Prediction prediction =
+				branch_predictor.Lookup(uop.get());
+		if (i >= 2700 && (prediction == BranchPredictor::PredictionTaken) != taken)
+			num_mispredictions++;
+		branch_predictor.Update(uop.get());
+	}
+
+	// Statistics cover all conditional branches
+	EXPECT_EQ(3000, branch_predictor.getNumConditionalBranches());
+	EXPECT_GE(branch_predictor.getNumMispredictedConditionalBranches(),
+			num_mispredictions);
+	return num_mispredictions;
+}
+
+
+TEST(TestBranchPredictor, test_tage_branch_predictor_1)
+{
+	EXPECT_EQ(0, RunRepeatingPattern("TAGE"));
 }
 
 
+TEST(TestBranchPredictor, test_perceptron_branch_predictor_1)
+{
+	EXPECT_EQ(0, RunRepeatingPattern("Perceptron"));
+}
+
+
+TEST(TestBranchPredictor, test_ittage_predictor_1)
+{
+	// Setup configuration file for branch predictor
+	std::string config =
+			"[ BranchPredictor ]\n"
+			"Kind = Bimodal\n"
+			"Indirect = ITTAGE";
+	misc::IniFile ini_file;
+	ini_file.LoadFromString(config);
+	Timing::ParseConfiguration(&ini_file);
+	BranchPredictor::ParseConfiguration(&ini_file);
+
+	// Local variable declaration
+	unsigned int branch_addr = 0x1000;
+	unsigned int jump_addr = 0x3000;
+	unsigned int inst_size = 4;
+	unsigned int jump_targets[2] = { 0x4000, 0x5000 };
+	ObjectPool *object_pool = ObjectPool::getInstance();
+
+	// Create a branch predictor instance
+	BranchPredictor branch_predictor;
+
+	// A conditional branch alternates between taken and not taken, and
+	// is followed by an indirect jump whose target depends on it. The BTB
+	// alone mispredicts every jump.
+	auto branch_uinst = misc::new_shared<Uinst>(Uinst::OpcodeBranch);
+	auto jump_uinst = misc::new_shared<Uinst>(Uinst::OpcodeJump);
+	jump_uinst->setIDep(0, Uinst::DepEax);
+	int num_mispredictions = 0;
+	for (int i = 0; i < 1000; i++)
+	{
+		// Conditional branch
+		bool taken = i % 2;
+		auto uop = misc::new_unique<Uop>(
+				object_pool->getThread(),
+				object_pool->getContext(),
+				branch_uinst);
+		uop->eip = branch_addr;
+		uop->neip = taken ? jump_addr : branch_addr + inst_size;
+		uop->mop_size = inst_size;
+		branch_predictor.Warm(uop.get());
+
+		// Indirect jump
+		uop = misc::new_unique<Uop>(
+				object_pool->getThread(),
+				object_pool->getContext(),
+				jump_uinst);
+		uop->eip = jump_addr;
+		uop->neip = jump_targets[taken];
+		uop->mop_size = inst_size;
+		uop->predicted_neip = branch_predictor.LookupBtb(uop.get());
+		branch_predictor.Lookup(uop.get());
+		if (i >= 900 && uop->predicted_neip != uop->neip)
+			num_mispredictions++;
+		branch_predictor.Update(uop.get());
+		branch_predictor.UpdateBtb(uop.get());
+	}
 
+	// Targets are predicted correctly once the predictor is trained
+	EXPECT_EQ(0, num_mispredictions);
+	EXPECT_EQ(1000, branch_predictor.getNumIndirectBranches());
+}
 
+}
@@ -0,0 +1,221 @@
+/*
+ *  Multi2Sim
+ *  Copyright (C) 2015  Rafael Ubal (ubal@ece.neu.edu)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <unistd.h>
+
+#include "gtest/gtest.h"
+
+#include <lib/cpp/IniFile.h>
+#include <lib/cpp/Error.h>
+#include <lib/esim/Engine.h>
+#include <memory/System.h>
+#include <memory/Manager.h>
+#include <arch/x86/emulator/Emulator.h>
+#include <arch/x86/timing/Timing.h>
+#include <arch/x86/timing/Cpu.h>
+#include <arch/x86/timing/Thread.h>
+
+namespace x86
+{
+
+static void Cleanup()
+{
+	esim::Engine::Destroy();
+	Timing::Destroy();
+	Emulator::Destroy();
+	mem::System::Destroy();
+	comm::ArchPool::Destroy();
+}
+
+
+// Map a context running a loop of 100 iterations to thread 0 of core 0,
+// with instructions fetched from main memory, and return its context
+static Context *MapLoop()
+{
+	// CPU configuration
+	misc::IniFile config_ini;
+	config_ini.LoadFromString("[ General ]\n");
+	Timing::ParseConfiguration(&config_ini);
+	Emulator *emulator = Emulator::getInstance();
+	Timing *timing = Timing::getInstance();
+
+	// Memory configuration, with instructions fetched from main memory
+	std::string mem_config_string =
+			"[ General ]\n"
+			"[ Module mod-mm ]\n"
+			"Type = MainMemory\n"
+			"Latency = 10\n"
+			"BlockSize = 64\n"
+			"[ Entry core-1 ]\n"
+			"Arch = x86\n"
+			"Core = 0\n"
+			"Thread = 0\n"
+			"Module = mod-mm\n";
+	misc::IniFile mem_config_ini;
+	mem_config_ini.LoadFromString(mem_config_string);
+	mem::System::getInstance()->ReadConfiguration(&mem_config_ini);
+
+	// Code to execute
+	// mov ecx, 100
+	// l: dec ecx
+	// jnz l
+	// mov eax, 1
+	// int 0x80
+	unsigned char code[] = {
+		0xB9, 0x64, 0x00, 0x00, 0x00, 0x49, 0x75, 0xFD,
+		0xB8, 0x01, 0x00, 0x00, 0x00, 0xCD, 0x80
+	};
+
+	// Create a context
+	Context *context = emulator->newContext();
+	context->Initialize();
+	mem::Memory *memory = context->getMemory();
+	memory->setHeapBreak(misc::RoundUp(memory->getHeapBreak(),
+				mem::Memory::PageSize));
+
+	// Allocate memory and save the instructions into memory
+	mem::Manager manager(memory);
+	unsigned eip = manager.Allocate(sizeof(code), 128);
+	memory->Write(eip, sizeof(code), (const char *)code);
+
+	// Update context status, including eip
+	context->setUinstActive(true);
+	context->setState(Context::StateRunning);
+	context->getRegs().setEip(eip);
+
+	// Map the thread onto cpu hardware
+	Cpu *cpu = timing->getCpu();
+	Thread *thread = cpu->getThread(0, 0);
+	thread->MapContext(context);
+	thread->Schedule();
+	thread->setFetchNeip(eip);
+	return context;
+}
+
+
+// Tests that every commit slot of a running thread is charged to one
+// category of the CPI stack
+TEST(TestX86TimingCpiStack, commit_slots)
+{
+	// Cleanup the environment
+	Cleanup();
+
+	// Thread running the loop
+	Context *context = MapLoop();
+	Timing *timing = Timing::getInstance();
+	Thread *thread = timing->getCpu()->getThread(0, 0);
+
+	// Run while the loop is still executing
+	esim::Engine *engine = esim::Engine::getInstance();
+	int num_cycles = 40;
+	for (int i = 0; i < num_cycles; i++)
+	{
+		timing->Run();
+		engine->ProcessEvents();
+	}
+	ASSERT_TRUE(context->getState(Context::StateRunning));
+
+	// All slots are accounted for, and used slots match committed uops
+	const long long *cpi_stack = thread->getCpiStack();
+	long long total = 0;
+	for (int i = 0; i < Thread::CpiComponentCount; i++)
+		total += cpi_stack[i];
+	EXPECT_EQ(num_cycles * Cpu::getCommitWidth(), total);
+	EXPECT_EQ(thread->getNumCommittedUinsts(),
+			cpi_stack[Thread::CpiComponentBase]);
+	EXPECT_GT(cpi_stack[Thread::CpiComponentBase], 0);
+
+	// The first cycles wait for the instruction fetch from main memory
+	EXPECT_GE(cpi_stack[Thread::CpiComponentFrontEndICache],
+			10 * Cpu::getCommitWidth());
+
+	// No data accesses
+	EXPECT_EQ(0, cpi_stack[Thread::CpiComponentMemoryL1]);
+	EXPECT_EQ(0, cpi_stack[Thread::CpiComponentMemoryDram]);
+
+	Cleanup();
+}
+
+
+// Tests that the lines of the CPI stack time series, including the last
+// partial interval, add up to the CPI stack of the thread
+TEST(TestX86TimingCpiStack, time_series)
+{
+	// Cleanup the environment
+	Cleanup();
+
+	// Time series with an interval not dividing the simulated cycles
+	std::string path = misc::fmt("/tmp/m2s-test-cpi-stack-%d", getpid());
+	Timing::setCpiStackFile(path, 16);
+	MapLoop();
+	Timing *timing = Timing::getInstance();
+	Thread *thread = timing->getCpu()->getThread(0, 0);
+
+	// Run, and finish the time series
+	esim::Engine *engine = esim::Engine::getInstance();
+	for (int i = 0; i < 40; i++)
+	{
+		timing->Run();
+		engine->ProcessEvents();
+	}
+	timing->DumpReport();
+
+	// Read the time series, skipping the header, and add up its lines
+	std::ifstream is(path);
+	std::string line;
+	std::getline(is, line);
+	long long cpi_stack[Thread::CpiComponentCount] = { };
+	std::vector<long long> cycles;
+	while (std::getline(is, line))
+	{
+		std::istringstream line_stream(line);
+		long long cycle;
+		int core;
+		int thread_id;
+		line_stream >> cycle >> core >> thread_id;
+		cycles.push_back(cycle);
+		for (int i = 0; i < Thread::CpiComponentCount; i++)
+		{
+			long long value;
+			line_stream >> value;
+			cpi_stack[i] += value;
+		}
+	}
+	is.close();
+	remove(path.c_str());
+	Timing::setCpiStackFile("", 10000);
+
+	// Two full intervals and a last partial one ending in cycle 40
+	ASSERT_EQ(3u, cycles.size());
+	EXPECT_EQ(16, cycles[0]);
+	EXPECT_EQ(32, cycles[1]);
+	EXPECT_EQ(40, cycles[2]);
+
+	// Same totals as the CPI stack of the report
+	for (int i = 0; i < Thread::CpiComponentCount; i++)
+		EXPECT_EQ(thread->getCpiStack()[i], cpi_stack[i])
+				<< Thread::cpi_component_map[i];
+
+	Cleanup();
+}
+
+}
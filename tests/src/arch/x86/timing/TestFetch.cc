@@ -177,6 +177,123 @@ TEST(TestX86TimingFetchStage, pipeline_flush)
 	Cleanup();
 }
 
+TEST(TestX86TimingFetchStage, magic_instruction)
+{
+	// Cleanup the environment
+	Cleanup();
+
+	// CPU configuration file
+	std::string config_string =
+			"[ General ]\n"
+			"[ TraceCache ]\n"
+			"Present = f";
+	misc::IniFile config_ini;
+	config_ini.LoadFromString(config_string);
+	try
+	{
+		Timing::ParseConfiguration(&config_ini);
+	}
+	catch (misc::Exception &e)
+	{
+		std::cerr << "Exception in reading x86 configuration" <<
+				e.getMessage() << "\n";
+		ASSERT_TRUE(false);
+	}
+
+	// Get instance of Timing, register emulator and timing simulator in
+	// the arch_pool
+	Emulator *emulator = Emulator::getInstance();
+	Timing *timing = Timing::getInstance();
+
+	// Memory configuration file
+	std::string mem_config_string =
+			"[ General ]\n"
+			"[ Module mod-mm ]\n"
+			"Type = MainMemory\n"
+			"Latency = 10\n"
+			"BlockSize = 64\n"
+			"[ Entry core-1 ]\n"
+			"Arch = x86\n"
+			"Core = 0\n"
+			"Thread = 0\n"
+			"Module = mod-mm\n";
+	misc::IniFile mem_config_ini;
+	mem_config_ini.LoadFromString(mem_config_string);
+
+	// Configure
+	try
+	{
+		mem::System::getInstance()->ReadConfiguration(&mem_config_ini);
+	}
+	catch (misc::Exception &e)
+	{
+		std::cerr << "Exception in reading mem configuration" <<
+				e.getMessage() << "\n";
+		ASSERT_TRUE(false);
+	}
+
+	// Code to execute
+	// mov eax, 3
+	// xchg bx, bx
+	// nop
+	// mov eax, 1
+	// int 0x80
+	unsigned char code[] = {
+		0xB8, 0x03, 0x00, 0x00, 0x00, 0x66, 0x87, 0xDB,
+		0x90, 0xB8, 0x01, 0x00, 0x00, 0x00, 0xCD, 0x80
+	};
+
+	// Create a context
+	Context *context = emulator->newContext();
+	context->Initialize();
+	mem::Memory *memory = context->getMemory();
+	memory->setHeapBreak(misc::RoundUp(memory->getHeapBreak(),
+				mem::Memory::PageSize));
+
+	// Allocate memory and save the instructions into memory
+	mem::Manager manager(memory);
+	unsigned eip = manager.Allocate(sizeof(code), 128);
+	memory->Write(eip, sizeof(code), (const char *)code);
+
+	// Update context status, including eip
+	context->setUinstActive(true);
+	context->setState(Context::StateRunning);
+	context->getRegs().setEip(eip);
+
+	// Map the thread onto cpu hardware
+	Cpu *cpu = Timing::getInstance()->getCpu();
+	Thread *thread = cpu->getThread(0, 0);
+	thread->MapContext(context);
+	thread->Schedule();
+	thread->setFetchNeip(eip);
+
+	// Fetch stops right after the magic instruction, even though the rest
+	// of the code is in the same block.
+	esim::Engine *engine = esim::Engine::getInstance();
+	timing->Run();
+	engine->ProcessEvents();
+	EXPECT_EQ(2, thread->getFetchQueueSize());
+	EXPECT_EQ(8, thread->getFetchQueueOccupency());
+	EXPECT_TRUE(emulator->hasMagicCommands());
+
+	// The command is processed once the pipeline drains, and fetch
+	// resumes in detailed mode.
+	RegionOfInterest *region_of_interest = timing->getRegionOfInterest();
+	for (int i = 0; i < 100 && emulator->hasMagicCommands(); i++)
+	{
+		timing->Run();
+		engine->ProcessEvents();
+		EXPECT_LE(cpu->getNumCommittedInstructions(), 2);
+	}
+	EXPECT_FALSE(emulator->hasMagicCommands());
+	EXPECT_EQ(2, cpu->getNumCommittedInstructions());
+	EXPECT_EQ(RegionOfInterest::ModeDetailed,
+			region_of_interest->getMode());
+	EXPECT_FALSE(cpu->isFetchStopped());
+
+	Cleanup();
+}
+
 /*
 TEST(TestX86TimingFetchStage, simple_fetch)
 {
@@ -0,0 +1,248 @@
+/*
+ *  Multi2Sim
+ *  Copyright (C) 2015  Rafael Ubal (ubal@ece.neu.edu)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <sstream>
+
+#include "gtest/gtest.h"
+
+#include <lib/cpp/IniFile.h>
+#include <lib/cpp/Error.h>
+#include <lib/esim/Engine.h>
+#include <memory/System.h>
+#include <memory/Manager.h>
+#include <arch/x86/emulator/Emulator.h>
+#include <arch/x86/timing/Timing.h>
+#include <arch/x86/timing/Cpu.h>
+#include <arch/x86/timing/Core.h>
+#include <arch/x86/timing/Thread.h>
+
+namespace x86
+{
+
+static void Cleanup()
+{
+	Timing::Destroy();
+	Emulator::Destroy();
+	mem::System::Destroy();
+	comm::ArchPool::Destroy();
+}
+
+
+// Number of cores, each running one context
+static const int num_cores = 4;
+
+
+// Simulate the same loop on every core for a fixed number of cycles, running
+// cores on the given number of host threads. Return a dump of the statistics
+// of every thread and every cache.
+static std::string RunCores(int num_host_threads)
+{
+	// Cleanup the environment
+	Cleanup();
+
+	// CPU configuration
+	std::string config_string = misc::fmt(
+			"[ General ]\n"
+			"Cores = %d\n"
+			"HostThreads = %d\n",
+			num_cores, num_host_threads);
+	misc::IniFile config_ini;
+	config_ini.LoadFromString(config_string);
+	Timing::ParseConfiguration(&config_ini);
+	Emulator *emulator = Emulator::getInstance();
+	Timing *timing = Timing::getInstance();
+
+	// Memory configuration, with private L1 caches sharing an L2 cache
+	std::string mem_config_string =
+			"[ General ]\n"
+			"[ CacheGeometry geo-l1 ]\n"
+			"Sets = 16\n"
+			"Assoc = 2\n"
+			"BlockSize = 64\n"
+			"Latency = 2\n"
+			"[ CacheGeometry geo-l2 ]\n"
+			"Sets = 32\n"
+			"Assoc = 4\n"
+			"BlockSize = 64\n"
+			"Latency = 10\n"
+			"[ Network net-l1-l2 ]\n"
+			"DefaultInputBufferSize = 1024\n"
+			"DefaultOutputBufferSize = 1024\n"
+			"DefaultBandwidth = 256\n"
+			"[ Network net-l2-mm ]\n"
+			"DefaultInputBufferSize = 1024\n"
+			"DefaultOutputBufferSize = 1024\n"
+			"DefaultBandwidth = 256\n"
+			"[ Module mod-l2 ]\n"
+			"Type = Cache\n"
+			"Geometry = geo-l2\n"
+			"HighNetwork = net-l1-l2\n"
+			"LowNetwork = net-l2-mm\n"
+			"LowModules = mod-mm\n"
+			"[ Module mod-mm ]\n"
+			"Type = MainMemory\n"
+			"Latency = 50\n"
+			"BlockSize = 64\n"
+			"HighNetwork = net-l2-mm\n";
+	for (int i = 0; i < num_cores; i++)
+		mem_config_string += misc::fmt(
+				"[ Module mod-l1-%d ]\n"
+				"Type = Cache\n"
+				"Geometry = geo-l1\n"
+				"LowNetwork = net-l1-l2\n"
+				"LowModules = mod-l2\n"
+				"[ Entry core-%d ]\n"
+				"Arch = x86\n"
+				"Core = %d\n"
+				"Thread = 0\n"
+				"Module = mod-l1-%d\n",
+				i, i, i, i);
+	misc::IniFile mem_config_ini;
+	mem_config_ini.LoadFromString(mem_config_string);
+	mem::System *memory_system = mem::System::getInstance();
+	memory_system->ReadConfiguration(&mem_config_ini);
+
+	// Code to execute, incrementing one word in each block of a buffer
+	// pointed to by 'esi', and then spinning forever
+	// mov ecx, 200
+	// l: mov eax, [esi]
+	// add eax, 1
+	// mov [esi], eax
+	// add esi, 64
+	// dec ecx
+	// jnz l
+	// jmp $
+	unsigned char code[] = {
+		0xB9, 0xC8, 0x00, 0x00, 0x00,
+		0x8B, 0x06,
+		0x83, 0xC0, 0x01,
+		0x89, 0x06,
+		0x83, 0xC6, 0x40,
+		0x49,
+		0x75, 0xF3,
+		0xEB, 0xFE
+	};
+
+	// One context on each core
+	Cpu *cpu = timing->getCpu();
+	for (int i = 0; i < num_cores; i++)
+	{
+		// Create context
+		Context *context = emulator->newContext();
+		context->Initialize();
+		mem::Memory *memory = context->getMemory();
+		memory->setHeapBreak(misc::RoundUp(memory->getHeapBreak(),
+				mem::Memory::PageSize));
+
+		// Code and data buffer, with a different size per core so
+		// that cores contend differently in the L2 cache
+		mem::Manager manager(memory);
+		unsigned eip = manager.Allocate(sizeof(code), 128);
+		memory->Write(eip, sizeof(code), (const char *) code);
+		unsigned data = manager.Allocate(200 * 64 + i * 4096, 64);
+
+		// Initial state
+		context->setUinstActive(true);
+		context->setState(Context::StateRunning);
+		context->getRegs().setEip(eip);
+		context->getRegs().setEsi(data);
+
+		// Map context
+		Thread *thread = cpu->getThread(i, 0);
+		thread->MapContext(context);
+		thread->Schedule();
+	}
+
+	// Run a fixed number of cycles
+	esim::Engine *engine = esim::Engine::getInstance();
+	long long start_cycle = cpu->getCycle();
+	for (int cycle = 0; cycle < 5000; cycle++)
+	{
+		timing->Run();
+		engine->ProcessEvents();
+	}
+
+	// Statistics of every thread
+	std::ostringstream os;
+	// The simulation time is not reset between runs
+	os << "Cycles = " << cpu->getCycle() - start_cycle << '\n';
+	os << "Committed = " << cpu->getNumCommittedInstructions() << '\n';
+	for (int i = 0; i < num_cores; i++)
+	{
+		Thread *thread = cpu->getThread(i, 0);
+		os << "Thread " << i
+				<< " dispatched " << thread->getNumDispatchedUinsts()
+				<< " issued " << thread->getNumIssuedUinsts()
+				<< " committed " << thread->getNumCommittedUinsts()
+				<< " squashed " << thread->getNumSquashedUinsts()
+				<< " branches " << thread->getNumBranches()
+				<< " mispredicted "
+				<< thread->getNumMispredictedBranches()
+				<< " forwarded " << thread->getNumForwardedLoads()
+				<< " rob_reads "
+				<< thread->getNumReorderBufferReads()
+				<< " lsq_reads "
+				<< thread->getNumLoadStoreQueueReads()
+				<< " cpi";
+		const long long *cpi_stack = thread->getCpiStack();
+		for (int j = 0; j < Thread::CpiComponentCount; j++)
+			os << ' ' << cpi_stack[j];
+		os << '\n';
+	}
+
+	// Statistics of every cache
+	for (int i = 0; i < num_cores; i++)
+		memory_system->getModule(misc::fmt("mod-l1-%d", i))
+				->DumpReport(os);
+	memory_system->getModule("mod-l2")->DumpReport(os);
+
+	// Finish in-flight memory accesses, so that their events don't fire
+	// after the memory system is destroyed
+	engine->ProcessAllEvents();
+
+	// Restore the default number of cores for other tests
+	Cleanup();
+	misc::IniFile default_config_ini;
+	default_config_ini.LoadFromString("[ General ]\n"
+			"Cores = 1\n"
+			"HostThreads = 1\n");
+	Timing::ParseConfiguration(&default_config_ini);
+	return os.str();
+}
+
+
+// Tests that simulating cores on several host threads produces the same
+// cycle counts and statistics as simulating them sequentially
+TEST(TestX86TimingHostThreads, parallel_matches_sequential)
+{
+	std::string sequential = RunCores(1);
+	std::string parallel_2 = RunCores(2);
+	std::string parallel_4 = RunCores(4);
+
+	// The loop ran on all cores
+	EXPECT_NE(std::string::npos, sequential.find(
+			"Thread 3 dispatched"));
+	EXPECT_EQ(std::string::npos, sequential.find(" committed 0 "));
+
+	// Same results
+	EXPECT_EQ(sequential, parallel_2);
+	EXPECT_EQ(sequential, parallel_4);
+}
+
+}
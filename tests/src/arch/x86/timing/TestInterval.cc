@@ -0,0 +1,271 @@
+/*
+ *  Multi2Sim
+ *  Copyright (C) 2015  Rafael Ubal (ubal@ece.neu.edu)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "gtest/gtest.h"
+
+#include <lib/cpp/IniFile.h>
+#include <lib/cpp/Error.h>
+#include <memory/System.h>
+#include <memory/Manager.h>
+#include <arch/x86/emulator/Emulator.h>
+#include <arch/x86/timing/Timing.h>
+#include <arch/x86/timing/Cpu.h>
+#include <arch/x86/timing/Thread.h>
+
+namespace x86
+{
+
+static void Cleanup()
+{
+	Timing::Destroy();
+	Emulator::Destroy();
+	mem::System::Destroy();
+	comm::ArchPool::Destroy();
+}
+
+
+// Tests that the interval model commits the instructions executed by the
+// emulator, overlapping the iterations of a loop
+TEST(TestX86TimingInterval, loop)
+{
+	// Cleanup the environment
+	Cleanup();
+
+	// CPU configuration, with the interval model
+	Cpu::core_model = Cpu::CoreModelInterval;
+	misc::IniFile config_ini;
+	config_ini.LoadFromString("[ General ]\n");
+	Timing::ParseConfiguration(&config_ini);
+	Emulator *emulator = Emulator::getInstance();
+	Timing *timing = Timing::getInstance();
+
+	// Memory configuration, with instructions fetched from main memory
+	std::string mem_config_string =
+			"[ General ]\n"
+			"[ Module mod-mm ]\n"
+			"Type = MainMemory\n"
+			"Latency = 10\n"
+			"BlockSize = 64\n"
+			"[ Entry core-1 ]\n"
+			"Arch = x86\n"
+			"Core = 0\n"
+			"Thread = 0\n"
+			"Module = mod-mm\n";
+	misc::IniFile mem_config_ini;
+	mem_config_ini.LoadFromString(mem_config_string);
+	mem::System::getInstance()->ReadConfiguration(&mem_config_ini);
+
+	// Code to execute
+	// mov ecx, 100
+	// l: dec ecx
+	// jnz l
+	// mov eax, 1
+	// int 0x80
+	unsigned char code[] = {
+		0xB9, 0x64, 0x00, 0x00, 0x00, 0x49, 0x75, 0xFD,
+		0xB8, 0x01, 0x00, 0x00, 0x00, 0xCD, 0x80
+	};
+
+	// Create a context
+	Context *context = emulator->newContext();
+	context->Initialize();
+	mem::Memory *memory = context->getMemory();
+	memory->setHeapBreak(misc::RoundUp(memory->getHeapBreak(),
+				mem::Memory::PageSize));
+
+	// Allocate memory and save the instructions into memory
+	mem::Manager manager(memory);
+	unsigned eip = manager.Allocate(sizeof(code), 128);
+	memory->Write(eip, sizeof(code), (const char *)code);
+
+	// Update context status, including eip
+	context->setUinstActive(true);
+	context->setState(Context::StateRunning);
+	context->getRegs().setEip(eip);
+
+	// Map the thread onto cpu hardware
+	Cpu *cpu = timing->getCpu();
+	Thread *thread = cpu->getThread(0, 0);
+	thread->MapContext(context);
+	thread->Schedule();
+
+	// Run until the loop finished. Idle cycles may be skipped.
+	esim::Engine *engine = esim::Engine::getInstance();
+	long long start_cycle = cpu->getCycle();
+	while (thread->getNumBranches() < 100 &&
+			cpu->getCycle() - start_cycle < 1000)
+	{
+		timing->Run();
+		engine->ProcessEvents();
+	}
+	long long num_cycles = cpu->getCycle() - start_cycle;
+
+	// Instructions of the loop committed in order, with a 2-uop
+	// iteration every cycle once the loop branch is predicted correctly
+	EXPECT_EQ(100, thread->getNumBranches());
+	EXPECT_GE(cpu->getNumCommittedInstructions(), 201);
+	EXPECT_LE(cpu->getNumCommittedInstructions(), 203);
+	EXPECT_LE(thread->getNumMispredictedBranches(), 5);
+	EXPECT_LT(num_cycles, 300);
+	EXPECT_GE(emulator->getNumInstructions(),
+			cpu->getNumCommittedInstructions());
+
+	// Cycles waiting for instruction fetch are skipped, and all their
+	// commit slots are accounted for in the CPI stack
+	EXPECT_GT(cpu->getNumSkippedCycles(), 0);
+	const long long *cpi_stack = thread->getCpiStack();
+	long long total = 0;
+	for (int i = 0; i < Thread::CpiComponentCount; i++)
+		total += cpi_stack[i];
+	EXPECT_EQ(num_cycles * Cpu::getCommitWidth(), total);
+	EXPECT_EQ(thread->getNumCommittedUinsts(),
+			cpi_stack[Thread::CpiComponentBase]);
+
+	Cpu::core_model = Cpu::CoreModelDetailed;
+	Cleanup();
+}
+
+
+// Run a loop adding the words of an array with the given core model, with a
+// data cache in front of a slow main memory, until all its branches
+// committed. Return the number of cycles.
+static long long RunArraySum(Cpu::CoreModel core_model)
+{
+	// Cleanup the environment
+	Cleanup();
+
+	// CPU configuration
+	Cpu::core_model = core_model;
+	misc::IniFile config_ini;
+	config_ini.LoadFromString("[ General ]\n");
+	Timing::ParseConfiguration(&config_ini);
+	Emulator *emulator = Emulator::getInstance();
+	Timing *timing = Timing::getInstance();
+
+	// Memory configuration
+	std::string mem_config_string =
+			"[ General ]\n"
+			"[ CacheGeometry geo-l1 ]\n"
+			"Sets = 16\n"
+			"Assoc = 2\n"
+			"BlockSize = 64\n"
+			"Latency = 2\n"
+			"[ Network net-l1-mm ]\n"
+			"DefaultInputBufferSize = 1024\n"
+			"DefaultOutputBufferSize = 1024\n"
+			"DefaultBandwidth = 256\n"
+			"[ Module mod-l1 ]\n"
+			"Type = Cache\n"
+			"Geometry = geo-l1\n"
+			"LowNetwork = net-l1-mm\n"
+			"LowModules = mod-mm\n"
+			"[ Module mod-mm ]\n"
+			"Type = MainMemory\n"
+			"Latency = 100\n"
+			"BlockSize = 64\n"
+			"HighNetwork = net-l1-mm\n"
+			"[ Entry core-0 ]\n"
+			"Arch = x86\n"
+			"Core = 0\n"
+			"Thread = 0\n"
+			"Module = mod-l1\n";
+	misc::IniFile mem_config_ini;
+	mem_config_ini.LoadFromString(mem_config_string);
+	mem::System::getInstance()->ReadConfiguration(&mem_config_ini);
+
+	// Code to execute
+	// mov ecx, 512
+	// xor eax, eax
+	// l: add eax, [esi]
+	// add esi, 16
+	// dec ecx
+	// jnz l
+	// mov eax, 1
+	// int 0x80
+	unsigned char code[] = {
+		0xB9, 0x00, 0x02, 0x00, 0x00, 0x31, 0xC0, 0x03,
+		0x06, 0x83, 0xC6, 0x10, 0x49, 0x75, 0xF8, 0xB8,
+		0x01, 0x00, 0x00, 0x00, 0xCD, 0x80
+	};
+
+	// Create a context
+	Context *context = emulator->newContext();
+	context->Initialize();
+	mem::Memory *memory = context->getMemory();
+	memory->setHeapBreak(misc::RoundUp(memory->getHeapBreak(),
+				mem::Memory::PageSize));
+
+	// Code and array
+	mem::Manager manager(memory);
+	unsigned eip = manager.Allocate(sizeof(code), 128);
+	memory->Write(eip, sizeof(code), (const char *) code);
+	unsigned data = manager.Allocate(512 * 16, 64);
+
+	// Update context status
+	context->setUinstActive(true);
+	context->setState(Context::StateRunning);
+	context->getRegs().setEip(eip);
+	context->getRegs().setEsi(data);
+
+	// Map the thread onto cpu hardware
+	Cpu *cpu = timing->getCpu();
+	Thread *thread = cpu->getThread(0, 0);
+	thread->MapContext(context);
+	thread->Schedule();
+	thread->setFetchNeip(eip);
+
+	// Run until the loop finished
+	esim::Engine *engine = esim::Engine::getInstance();
+	long long start_cycle = cpu->getCycle();
+	while (thread->getNumBranches() < 512 &&
+			cpu->getCycle() - start_cycle < 100000)
+	{
+		timing->Run();
+		engine->ProcessEvents();
+	}
+	EXPECT_EQ(512, thread->getNumBranches());
+	long long num_cycles = cpu->getCycle() - start_cycle;
+
+	// The interval model skips most cycles, waiting for misses
+	if (core_model == Cpu::CoreModelInterval)
+		EXPECT_GT(cpu->getNumSkippedCycles(), num_cycles / 2);
+
+	// Finish in-flight memory accesses and restore the default model
+	engine->ProcessAllEvents();
+	Cpu::core_model = Cpu::CoreModelDetailed;
+	Cleanup();
+	return num_cycles;
+}
+
+
+// Tests that the interval model estimates the execution time of the detailed
+// model for a loop with data cache misses
+TEST(TestX86TimingInterval, matches_detailed)
+{
+	long long detailed_cycles = RunArraySum(Cpu::CoreModelDetailed);
+	long long interval_cycles = RunArraySum(Cpu::CoreModelInterval);
+
+	// One miss every four iterations dominates the execution time, with
+	// several of the 128 misses overlapping in the window
+	EXPECT_GT(detailed_cycles, 128 * 100 / 4);
+	EXPECT_LT(detailed_cycles, 128 * 100);
+	EXPECT_NEAR(detailed_cycles, interval_cycles, detailed_cycles / 10);
+}
+
+}
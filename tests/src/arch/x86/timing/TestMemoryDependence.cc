@@ -0,0 +1,214 @@
+/*
+ *  Multi2Sim
+ *  Copyright (C) 2015  Rafael Ubal (ubal@ece.neu.edu)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <cstring>
+
+#include "gtest/gtest.h"
+
+#include <lib/cpp/IniFile.h>
+#include <lib/cpp/Error.h>
+#include <memory/System.h>
+#include <memory/Manager.h>
+#include <arch/x86/emulator/Emulator.h>
+#include <arch/x86/timing/Timing.h>
+#include <arch/x86/timing/Cpu.h>
+#include <arch/x86/timing/Thread.h>
+
+namespace x86
+{
+
+static void Cleanup()
+{
+	Timing::Destroy();
+	Emulator::Destroy();
+	mem::System::Destroy();
+	comm::ArchPool::Destroy();
+}
+
+
+// Run a loop where every iteration stores the result of a division and loads
+// it back right away, using the given memory dependence policy and uop queue
+// size. Return the thread running the program.
+static Thread *RunStoreLoadLoop(const std::string &memory_dependence,
+		int num_cycles, int uop_queue_size = 32)
+{
+	// Cleanup the environment
+	Cleanup();
+
+	// CPU configuration
+	misc::IniFile config_ini;
+	config_ini.LoadFromString(
+			"[ General ]\n"
+			"[ Queues ]\n"
+			"MemoryDependence = " + memory_dependence + "\n" +
+			misc::fmt("UopQueueSize = %d\n", uop_queue_size));
+	Timing::ParseConfiguration(&config_ini);
+	Emulator *emulator = Emulator::getInstance();
+	Timing *timing = Timing::getInstance();
+
+	// Memory configuration
+	std::string mem_config_string =
+			"[ General ]\n"
+			"[ Module mod-mm ]\n"
+			"Type = MainMemory\n"
+			"Latency = 10\n"
+			"BlockSize = 64\n"
+			"[ Entry core-1 ]\n"
+			"Arch = x86\n"
+			"Core = 0\n"
+			"Thread = 0\n"
+			"Module = mod-mm\n";
+	misc::IniFile mem_config_ini;
+	mem_config_ini.LoadFromString(mem_config_string);
+	mem::System::getInstance()->ReadConfiguration(&mem_config_ini);
+
+	// Code to execute
+	// mov ecx, 100
+	// mov ebx, 3
+	// l: mov eax, ecx
+	// xor edx, edx
+	// div ebx
+	// mov [data], eax
+	// mov esi, [data]
+	// dec ecx
+	// jnz l
+	// mov eax, 1
+	// int 0x80
+	unsigned char code[] = {
+		0xB9, 0x64, 0x00, 0x00, 0x00, 0xBB, 0x03, 0x00,
+		0x00, 0x00, 0x89, 0xC8, 0x31, 0xD2, 0xF7, 0xF3,
+		0xA3, 0x00, 0x00, 0x00, 0x00, 0x8B, 0x35, 0x00,
+		0x00, 0x00, 0x00, 0x49, 0x75, 0xEC, 0xB8, 0x01,
+		0x00, 0x00, 0x00, 0xCD, 0x80
+	};
+
+	// Create a context
+	Context *context = emulator->newContext();
+	context->Initialize();
+	mem::Memory *memory = context->getMemory();
+	memory->setHeapBreak(misc::RoundUp(memory->getHeapBreak(),
+				mem::Memory::PageSize));
+
+	// Allocate memory for the data and the instructions, and patch the
+	// data address into the code
+	mem::Manager manager(memory);
+	unsigned data = manager.Allocate(4, 64);
+	unsigned eip = manager.Allocate(sizeof(code), 128);
+	memcpy(code + 17, &data, 4);
+	memcpy(code + 23, &data, 4);
+	memory->Write(eip, sizeof(code), (const char *)code);
+
+	// Update context status, including eip
+	context->setUinstActive(true);
+	context->setState(Context::StateRunning);
+	context->getRegs().setEip(eip);
+
+	// Map the thread onto cpu hardware
+	Cpu *cpu = timing->getCpu();
+	Thread *thread = cpu->getThread(0, 0);
+	thread->MapContext(context);
+	thread->Schedule();
+	thread->setFetchNeip(eip);
+
+	// Run
+	esim::Engine *engine = esim::Engine::getInstance();
+	for (int i = 0; i < num_cycles; i++)
+	{
+		timing->Run();
+		engine->ProcessEvents();
+	}
+	return thread;
+}
+
+
+// Loads ignore the store queue
+TEST(TestX86TimingMemoryDependence, none)
+{
+	Thread *thread = RunStoreLoadLoop("None", 1000);
+	EXPECT_GT(thread->getNumCommittedUinsts(), 0);
+	EXPECT_EQ(0, thread->getNumForwardedLoads());
+	EXPECT_EQ(0, thread->getNumMemoryOrderViolations());
+	Cleanup();
+}
+
+
+// Loads wait for older stores and take their data from them
+TEST(TestX86TimingMemoryDependence, conservative)
+{
+	Thread *thread = RunStoreLoadLoop("Conservative", 1000);
+	EXPECT_GT(thread->getNumForwardedLoads(), 0);
+	EXPECT_EQ(0, thread->getNumMemoryOrderViolations());
+	EXPECT_EQ(0, thread->getNumReplayedUinsts());
+	Cleanup();
+}
+
+
+// Loads issue before the stores resolve, and get replayed
+TEST(TestX86TimingMemoryDependence, speculative)
+{
+	Thread *thread = RunStoreLoadLoop("Speculative", 1000);
+	long long num_violations = thread->getNumMemoryOrderViolations();
+	EXPECT_GT(num_violations, 1);
+	EXPECT_GE(thread->getNumReplayedUinsts(), num_violations);
+	EXPECT_GT(thread->getNumCommittedUinsts(), 0);
+
+	// The store set predictor learns the dependence after the first
+	// violation
+	thread = RunStoreLoadLoop("StoreSet", 1000);
+	EXPECT_GT(thread->getNumMemoryOrderViolations(), 0);
+	EXPECT_LT(thread->getNumMemoryOrderViolations(), num_violations);
+	EXPECT_GT(thread->getNumForwardedLoads(), 0);
+	Cleanup();
+}
+
+
+// Replayed uops don't overflow the uop queue, and are not counted again as
+// dispatched uops
+TEST(TestX86TimingMemoryDependence, replay_statistics)
+{
+	// Run the loop until it finishes. While replayed uops wait for room,
+	// the uop queue stays within its size.
+	int uop_queue_size = 4;
+	Thread *thread = RunStoreLoadLoop("Speculative", 0, uop_queue_size);
+	Timing *timing = Timing::getInstance();
+	esim::Engine *engine = esim::Engine::getInstance();
+	int num_waiting_cycles = 0;
+	for (int i = 0; i < 5000; i++)
+	{
+		timing->Run();
+		engine->ProcessEvents();
+		if (thread->getReplayQueueSize())
+		{
+			ASSERT_LE(thread->getUopQueueSize(), uop_queue_size);
+			num_waiting_cycles++;
+		}
+	}
+	EXPECT_GT(num_waiting_cycles, 0);
+	EXPECT_TRUE(thread->isPipelineEmpty());
+
+	// Every dispatched uop either committed or was squashed once
+	EXPECT_EQ(thread->getNumCommittedUinsts() +
+			thread->getNumSquashedUinsts(),
+			thread->getNumDispatchedUinsts());
+	EXPECT_EQ(thread->getNumDispatchedUinsts(),
+			thread->getNumReorderBufferWrites());
+	Cleanup();
+}
+
+}
@@ -0,0 +1,236 @@
+/*
+ *  Multi2Sim
+ *  Copyright (C) 2015  Rafael Ubal (ubal@ece.neu.edu)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include <lib/cpp/IniFile.h>
+#include <lib/cpp/Error.h>
+#include <memory/System.h>
+#include <memory/Manager.h>
+#include <arch/x86/emulator/Emulator.h>
+#include <arch/x86/timing/Timing.h>
+#include <arch/x86/timing/Cpu.h>
+#include <arch/x86/timing/PipelineTrace.h>
+#include <arch/x86/timing/Thread.h>
+
+namespace x86
+{
+
+static void Cleanup()
+{
+	Timing::Destroy();
+	Emulator::Destroy();
+	mem::System::Destroy();
+	comm::ArchPool::Destroy();
+}
+
+
+// Create a CPU with the pipeline trace written to 'trace_path', running a
+// loop with the given number of iterations. Return the thread running it.
+static Thread *CreateLoop(const std::string &trace_path, int num_iterations)
+{
+	// Cleanup the environment
+	Cleanup();
+
+	// CPU configuration, with the pipeline trace enabled
+	PipelineTrace::path = trace_path;
+	misc::IniFile config_ini;
+	config_ini.LoadFromString("[ General ]\n");
+	Timing::ParseConfiguration(&config_ini);
+	Emulator *emulator = Emulator::getInstance();
+	Timing *timing = Timing::getInstance();
+
+	// Memory configuration, with instructions fetched from main memory
+	std::string mem_config_string =
+			"[ General ]\n"
+			"[ Module mod-mm ]\n"
+			"Type = MainMemory\n"
+			"Latency = 10\n"
+			"BlockSize = 64\n"
+			"[ Entry core-1 ]\n"
+			"Arch = x86\n"
+			"Core = 0\n"
+			"Thread = 0\n"
+			"Module = mod-mm\n";
+	misc::IniFile mem_config_ini;
+	mem_config_ini.LoadFromString(mem_config_string);
+	mem::System::getInstance()->ReadConfiguration(&mem_config_ini);
+
+	// Code to execute
+	// mov ecx, num_iterations
+	// l: dec ecx
+	// jnz l
+	// mov eax, 1
+	// int 0x80
+	unsigned char code[] = {
+		0xB9, 0x00, 0x00, 0x00, 0x00, 0x49, 0x75, 0xFD,
+		0xB8, 0x01, 0x00, 0x00, 0x00, 0xCD, 0x80
+	};
+	memcpy(code + 1, &num_iterations, 4);
+
+	// Create a context
+	Context *context = emulator->newContext();
+	context->Initialize();
+	mem::Memory *memory = context->getMemory();
+	memory->setHeapBreak(misc::RoundUp(memory->getHeapBreak(),
+				mem::Memory::PageSize));
+
+	// Allocate memory and save the instructions into memory
+	mem::Manager manager(memory);
+	unsigned eip = manager.Allocate(sizeof(code), 128);
+	memory->Write(eip, sizeof(code), (const char *)code);
+
+	// Update context status, including eip
+	context->setUinstActive(true);
+	context->setState(Context::StateRunning);
+	context->getRegs().setEip(eip);
+
+	// Map the thread onto cpu hardware
+	Cpu *cpu = timing->getCpu();
+	Thread *thread = cpu->getThread(0, 0);
+	thread->MapContext(context);
+	thread->Schedule();
+	thread->setFetchNeip(eip);
+	return thread;
+}
+
+
+// Tests that the pipeline trace has one record per committed or squashed
+// uop, with increasing stage cycles, and that it converts into the Kanata
+// format
+TEST(TestX86TimingPipelineTrace, loop)
+{
+	// Run until the loop finished
+	std::string trace_path = "x86-pipeline-trace-test.bin";
+	std::string konata_path = "x86-pipeline-trace-test.log";
+	Thread *thread = CreateLoop(trace_path, 100);
+	Timing *timing = Timing::getInstance();
+	esim::Engine *engine = esim::Engine::getInstance();
+	for (int i = 0; i < 1000 && thread->getNumBranches() < 100; i++)
+	{
+		timing->Run();
+		engine->ProcessEvents();
+	}
+	ASSERT_EQ(100, thread->getNumBranches());
+	long long num_committed_uinsts = thread->getNumCommittedUinsts();
+
+	// Destroying the CPU writes the remaining records
+	Cleanup();
+	PipelineTrace::path.clear();
+
+	// Read trace
+	std::ifstream is(trace_path, std::ios::binary);
+	ASSERT_TRUE(is.good());
+	char signature[8];
+	is.read(signature, sizeof signature);
+	std::vector<PipelineTrace::Record> records;
+	PipelineTrace::Record record;
+	while (is.read((char *) &record, sizeof record))
+		records.push_back(record);
+
+	// Committed uops went through all stages in order
+	long long num_committed = 0;
+	long long num_squashed = 0;
+	for (auto &record : records)
+	{
+		if (record.squashed)
+		{
+			num_squashed++;
+			EXPECT_GE(record.retire_cycle, record.fetch_cycle);
+			continue;
+		}
+		num_committed++;
+		EXPECT_GT(record.fetch_cycle, 0);
+		EXPECT_GT(record.decode_cycle, record.fetch_cycle);
+		EXPECT_GT(record.dispatch_cycle, record.decode_cycle);
+		EXPECT_GE(record.issue_cycle, record.dispatch_cycle);
+		EXPECT_GT(record.writeback_cycle, record.issue_cycle);
+		EXPECT_GE(record.retire_cycle, record.writeback_cycle);
+	}
+	EXPECT_EQ(num_committed_uinsts, num_committed);
+	EXPECT_GT(num_squashed, 0);
+
+	// Convert into the Kanata format, with one retire or flush command per
+	// record
+	PipelineTrace::ConvertToKonata(trace_path, konata_path);
+	std::ifstream konata(konata_path);
+	std::string line;
+	std::getline(konata, line);
+	EXPECT_EQ("Kanata\t0004", line);
+	int num_retired = 0;
+	while (std::getline(konata, line))
+		if (line[0] == 'R')
+			num_retired++;
+	EXPECT_EQ((int) records.size(), num_retired);
+
+	// Remove files
+	std::remove(trace_path.c_str());
+	std::remove(konata_path.c_str());
+}
+
+
+
+// Tests that a failure to write the trace file is reported while the
+// simulation runs
+TEST(TestX86TimingPipelineTrace, write_failure)
+{
+	// Writes to this file fail with no space left on the device
+	Thread *thread = CreateLoop("/dev/full", 100000);
+	Timing *timing = Timing::getInstance();
+	esim::Engine *engine = esim::Engine::getInstance();
+	bool failed = false;
+	try
+	{
+		for (int i = 0; i < 100000 && !failed; i++)
+		{
+			timing->Run();
+			engine->ProcessEvents();
+		}
+	}
+	catch (PipelineTrace::Error &e)
+	{
+		failed = true;
+	}
+	EXPECT_TRUE(failed);
+	EXPECT_LT(thread->getNumBranches(), 100000);
+
+	// Destroying the CPU only shows a warning
+	engine->ProcessAllEvents();
+	Cleanup();
+	PipelineTrace::path.clear();
+}
+
+
+// Tests that configurations whose identifiers don't fit in a record are
+// rejected
+TEST(TestX86TimingPipelineTrace, too_many_cores)
+{
+	PipelineTrace::path = "x86-pipeline-trace-test.bin";
+	EXPECT_THROW(PipelineTrace(1 << 17, 1), PipelineTrace::Error);
+	EXPECT_THROW(PipelineTrace(1, 1 << 17), PipelineTrace::Error);
+	std::remove(PipelineTrace::path.c_str());
+	PipelineTrace::path.clear();
+}
+
+}
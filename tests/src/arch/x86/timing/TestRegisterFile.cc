@@ -821,6 +821,60 @@ TEST(TestRegisterFile, write_uop_0)
 	EXPECT_TRUE(register_file->isUopReady(uop_0.get()));
 }
 
+// Tests WriteUop() with a uop that depends on two uops. The consumer must
+// become ready only after both producers invoked WriteUop(), in any order.
+TEST(TestRegisterFile, write_uop_1)
+{
+	// Cleanup singleton instances
+	ObjectPool::Destroy();
+
+	// Get object pool instance
+	ObjectPool *object_pool = ObjectPool::getInstance();
+
+	// Create uinsts
+	auto uinst_0 = misc::new_shared<Uinst>(Uinst::OpcodeAdd);
+	auto uinst_1 = misc::new_shared<Uinst>(Uinst::OpcodeAdd);
+	auto uinst_2 = misc::new_shared<Uinst>(Uinst::OpcodeAdd);
+
+	// Set uinst dependencies. Input 1 of uop_0 is given twice.
+	uinst_0->setIDep(0, 1);
+	uinst_0->setIDep(1, 2);
+	uinst_0->setIDep(2, 2);
+	uinst_1->setODep(0, 1);
+	uinst_2->setODep(0, 2);
+
+	// Create uops
+	auto uop_0 = misc::new_unique<Uop>(object_pool->getThread(),
+			object_pool->getContext(),
+			uinst_0);
+	auto uop_1 = misc::new_unique<Uop>(object_pool->getThread(),
+			object_pool->getContext(),
+			uinst_1);
+	auto uop_2 = misc::new_unique<Uop>(object_pool->getThread(),
+			object_pool->getContext(),
+			uinst_2);
+
+	// Get register file
+	auto register_file = object_pool->getThread()->getRegisterFile();
+
+	// Rename producers first, then the consumer
+	register_file->Rename(uop_1.get());
+	register_file->Rename(uop_2.get());
+	register_file->Rename(uop_0.get());
+	EXPECT_EQ(3, uop_0->num_pending_inputs);
+	EXPECT_FALSE(register_file->isUopReady(uop_0.get()));
+
+	// Write the second producer
+	register_file->WriteUop(uop_2.get());
+	EXPECT_EQ(1, uop_0->num_pending_inputs);
+	EXPECT_FALSE(register_file->isUopReady(uop_0.get()));
+
+	// Write the first producer
+	register_file->WriteUop(uop_1.get());
+	EXPECT_EQ(0, uop_0->num_pending_inputs);
+	EXPECT_TRUE(register_file->isUopReady(uop_0.get()));
+}
+
 
 
 
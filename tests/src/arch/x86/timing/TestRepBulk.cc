@@ -0,0 +1,279 @@
+/*
+ *  Multi2Sim
+ *  Copyright (C) 2015  Rafael Ubal (ubal@ece.neu.edu)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include <lib/cpp/Error.h>
+#include <memory/Memory.h>
+#include <memory/System.h>
+#include <arch/x86/emulator/Context.h>
+#include <arch/x86/emulator/Emulator.h>
+#include <arch/x86/timing/Timing.h>
+
+
+namespace x86
+{
+
+static void Cleanup()
+{
+	Timing::Destroy();
+	Emulator::Destroy();
+	mem::System::Destroy();
+	comm::ArchPool::Destroy();
+}
+
+
+// Addresses of the code, the source buffer, and the destination buffer
+static const unsigned code_address = 0x1000;
+static const unsigned src_address = 0x10000;
+static const unsigned dst_address = 0x20000;
+
+// Size of each buffer
+static const unsigned buffer_size = 0x3000;
+
+// Encodings of 'rep movsd' and 'rep stosd'
+static const char rep_movsd[] = { '\xf3', '\xa5' };
+static const char rep_stosd[] = { '\xf3', '\xab' };
+
+
+// Outcome of running a string instruction
+struct RepResult
+{
+	unsigned ecx;
+	unsigned esi;
+	unsigned edi;
+	long long num_instructions;
+	int num_calls;
+	bool fault;
+	std::vector<char> dst;
+};
+
+
+// Run the 2-byte string instruction in 'code' until it completes or causes
+// a memory fault, with bulk execution enabled if 'bulk' is true. Only the
+// first 'dst_size' bytes of the destination buffer are mapped.
+static RepResult RunRep(const char *code, bool bulk, bool backward,
+		unsigned ecx, unsigned esi, unsigned edi,
+		unsigned dst_size = buffer_size)
+{
+	// Fresh environment
+	Cleanup();
+	Emulator *emulator = Emulator::getInstance();
+	Context *context = emulator->newContext();
+	context->Initialize();
+	mem::Memory *memory = context->getMemory();
+
+	// Producing micro-instructions disables bulk execution
+	context->setUinstActive(!bulk);
+
+	// Code
+	memory->Map(code_address, mem::Memory::PageSize,
+			mem::Memory::AccessInit | mem::Memory::AccessRead |
+			mem::Memory::AccessExec);
+	memory->Init(code_address, 2, code);
+
+	// Source buffer with a known pattern
+	std::vector<char> src(buffer_size);
+	for (unsigned i = 0; i < buffer_size; i++)
+		src[i] = i * 7 + 3;
+	memory->Map(src_address, buffer_size,
+			mem::Memory::AccessRead | mem::Memory::AccessWrite);
+	memory->Write(src_address, buffer_size, src.data());
+
+	// Destination buffer
+	memory->Map(dst_address, dst_size,
+			mem::Memory::AccessRead | mem::Memory::AccessWrite);
+
+	// Registers
+	Regs &regs = context->getRegs();
+	regs.setEip(code_address);
+	regs.setEax(0xdeadbeef);
+	regs.setEcx(ecx);
+	regs.setEsi(esi);
+	regs.setEdi(edi);
+	if (backward)
+		regs.setFlag(Instruction::FlagDF);
+	else
+		regs.clearFlag(Instruction::FlagDF);
+
+	// Execute
+	RepResult result;
+	result.fault = false;
+	result.num_calls = 0;
+	try
+	{
+		while (regs.getEip() == code_address)
+		{
+			result.num_calls++;
+			context->Execute();
+		}
+	}
+	catch (mem::Memory::Error &e)
+	{
+		result.fault = true;
+	}
+
+	// Outcome
+	result.ecx = regs.getEcx();
+	result.esi = regs.getEsi();
+	result.edi = regs.getEdi();
+	result.num_instructions = emulator->getNumInstructions();
+	result.dst.resize(dst_size);
+	memory->Read(dst_address, dst_size, result.dst.data());
+	return result;
+}
+
+
+// Check that the bulk and per-iteration executions of the same string
+// instruction leave the same state.
+static void ExpectSameResult(const RepResult &bulk, const RepResult &ref)
+{
+	EXPECT_EQ(ref.fault, bulk.fault);
+	EXPECT_EQ(ref.ecx, bulk.ecx);
+	EXPECT_EQ(ref.esi, bulk.esi);
+	EXPECT_EQ(ref.edi, bulk.edi);
+	EXPECT_EQ(ref.num_instructions, bulk.num_instructions);
+	EXPECT_TRUE(ref.dst == bulk.dst);
+}
+
+
+TEST(TestX86RepBulk, movsd_forward)
+{
+	// Copy 0x2400 bytes, crossing two page boundaries
+	unsigned count = 0x900;
+	RepResult bulk = RunRep(rep_movsd, true, false, count,
+			src_address, dst_address);
+	RepResult ref = RunRep(rep_movsd, false, false, count,
+			src_address, dst_address);
+	ExpectSameResult(bulk, ref);
+
+	// One call per iteration in the regular path. In bulk mode, the first
+	// call runs all iterations across page boundaries, and the second one
+	// finds ECX = 0.
+	EXPECT_EQ((int) count + 1, ref.num_calls);
+	EXPECT_EQ(2, bulk.num_calls);
+
+	// Final state
+	EXPECT_FALSE(bulk.fault);
+	EXPECT_EQ(0u, bulk.ecx);
+	EXPECT_EQ(src_address + count * 4, bulk.esi);
+	EXPECT_EQ(dst_address + count * 4, bulk.edi);
+	// One instruction per iteration, plus the final one with ECX = 0
+	EXPECT_EQ(count + 1, bulk.num_instructions);
+	for (unsigned i = 0; i < count * 4; i++)
+		ASSERT_EQ((char) (i * 7 + 3), bulk.dst[i]);
+
+	Cleanup();
+}
+
+
+TEST(TestX86RepBulk, movsd_backward)
+{
+	// Copy with DF=1 from the last element of both buffers down
+	unsigned count = 0x900;
+	unsigned esi = src_address + buffer_size - 4;
+	unsigned edi = dst_address + buffer_size - 4;
+	RepResult bulk = RunRep(rep_movsd, true, true, count, esi, edi);
+	RepResult ref = RunRep(rep_movsd, false, true, count, esi, edi);
+	ExpectSameResult(bulk, ref);
+
+	// Final state
+	EXPECT_FALSE(bulk.fault);
+	EXPECT_EQ(0u, bulk.ecx);
+	EXPECT_EQ(esi - count * 4, bulk.esi);
+	EXPECT_EQ(edi - count * 4, bulk.edi);
+	// One instruction per iteration, plus the final one with ECX = 0
+	EXPECT_EQ(count + 1, bulk.num_instructions);
+	for (unsigned i = buffer_size - count * 4; i < buffer_size; i++)
+		ASSERT_EQ((char) (i * 7 + 3), bulk.dst[i]);
+
+	Cleanup();
+}
+
+
+TEST(TestX86RepBulk, stosd_backward)
+{
+	// Fill with DF=1, starting in the middle of a page
+	unsigned count = 0x500;
+	unsigned edi = dst_address + 0x2800;
+	RepResult bulk = RunRep(rep_stosd, true, true, count, 0, edi);
+	RepResult ref = RunRep(rep_stosd, false, true, count, 0, edi);
+	ExpectSameResult(bulk, ref);
+
+	// Final state
+	EXPECT_FALSE(bulk.fault);
+	EXPECT_EQ(0u, bulk.ecx);
+	EXPECT_EQ(edi - count * 4, bulk.edi);
+	// One instruction per iteration, plus the final one with ECX = 0
+	EXPECT_EQ(count + 1, bulk.num_instructions);
+	unsigned value;
+	memcpy(&value, &bulk.dst[0x2800 - (count - 1) * 4], 4);
+	EXPECT_EQ(0xdeadbeef, value);
+
+	Cleanup();
+}
+
+
+TEST(TestX86RepBulk, movsd_unmapped_page)
+{
+	// Only the first destination page is mapped. Bulk execution stops at
+	// the page boundary and the regular path raises the fault on the first
+	// element of the unmapped page.
+	unsigned count = 0x800;
+	unsigned dst_size = mem::Memory::PageSize;
+	RepResult bulk = RunRep(rep_movsd, true, false, count,
+			src_address, dst_address, dst_size);
+	RepResult ref = RunRep(rep_movsd, false, false, count,
+			src_address, dst_address, dst_size);
+	ExpectSameResult(bulk, ref);
+
+	// Faulting state
+	unsigned done = dst_size / 4;
+	EXPECT_TRUE(bulk.fault);
+	EXPECT_EQ(count - done, bulk.ecx);
+	EXPECT_EQ(dst_address + dst_size, bulk.edi);
+	EXPECT_EQ(done, bulk.num_instructions);
+
+	Cleanup();
+}
+
+
+TEST(TestX86RepBulk, stosd_unmapped_page_backward)
+{
+	// Fill downwards from the second destination page into an unmapped
+	// page below the buffer
+	unsigned count = 0x600;
+	unsigned edi = dst_address + 0x1000 + 0x100;
+	RepResult bulk = RunRep(rep_stosd, true, true, count, 0, edi);
+	RepResult ref = RunRep(rep_stosd, false, true, count, 0, edi);
+	ExpectSameResult(bulk, ref);
+
+	// Faulting state, after filling 0x1104 bytes
+	unsigned done = (0x1100 + 4) / 4;
+	EXPECT_TRUE(bulk.fault);
+	EXPECT_EQ(count - done, bulk.ecx);
+	EXPECT_EQ(dst_address - 4, bulk.edi);
+	EXPECT_EQ(done, bulk.num_instructions);
+
+	Cleanup();
+}
+
+}
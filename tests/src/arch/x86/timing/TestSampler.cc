@@ -0,0 +1,226 @@
+/*
+ *  Multi2Sim
+ *  Copyright (C) 2015  Rafael Ubal (ubal@ece.neu.edu)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <cmath>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include <lib/cpp/IniFile.h>
+#include <lib/cpp/Error.h>
+#include <lib/esim/Engine.h>
+#include <memory/System.h>
+#include <memory/Manager.h>
+#include <arch/x86/emulator/Emulator.h>
+#include <arch/x86/timing/Timing.h>
+#include <arch/x86/timing/Cpu.h>
+#include <arch/x86/timing/Sampler.h>
+#include <arch/x86/timing/Thread.h>
+
+namespace x86
+{
+
+static void Cleanup()
+{
+	esim::Engine::Destroy();
+	Timing::Destroy();
+	Emulator::Destroy();
+	mem::System::Destroy();
+	comm::ArchPool::Destroy();
+}
+
+
+// Create the timing simulator with the given sampling configuration, and
+// return its sampler
+static Sampler *CreateSampler(const std::string &config)
+{
+	misc::IniFile config_ini;
+	config_ini.LoadFromString("[ General ]\n"
+			"[ Sampling ]\n"
+			"Enabled = t\n" + config);
+	Timing::ParseConfiguration(&config_ini);
+	return Timing::getInstance()->getSampler();
+}
+
+
+// Restore the default configuration, with sampling disabled, for other
+// tests
+static void RestoreConfiguration()
+{
+	misc::IniFile default_ini;
+	default_ini.LoadFromString("[ General ]\n");
+	Timing::ParseConfiguration(&default_ini);
+}
+
+
+// Tests the quantiles of the normal distribution for common confidence
+// levels
+TEST(TestX86TimingSampler, z_score)
+{
+	EXPECT_NEAR(1.645, Sampler::getZScore(90.0), 1e-3);
+	EXPECT_NEAR(1.960, Sampler::getZScore(95.0), 1e-3);
+	EXPECT_NEAR(2.576, Sampler::getZScore(99.0), 1e-3);
+	EXPECT_NEAR(2.968, Sampler::getZScore(99.7), 1e-3);
+}
+
+
+// Tests the statistics of fixed CPI samples, and that the error bound is
+// only checked after the minimum number of samples
+TEST(TestX86TimingSampler, confidence_interval)
+{
+	// Cleanup the environment
+	Cleanup();
+
+	// Sampler with a 95% confidence level
+	Sampler *sampler = CreateSampler("Confidence = 95\n"
+			"TargetError = 0.6\n"
+			"MinSamples = 4\n");
+	ASSERT_TRUE(sampler != nullptr);
+	EXPECT_EQ(0.0, sampler->getCpiConfidenceInterval());
+
+	// Samples with a CPI of 1, 2, and 3. The relative error is below
+	// the target, but there are not enough samples.
+	for (int i = 1; i <= 3; i++)
+		sampler->AddSample(100, i * 100);
+	EXPECT_EQ(3, sampler->getNumSamples());
+	EXPECT_DOUBLE_EQ(2.0, sampler->getMeanCpi());
+	EXPECT_DOUBLE_EQ(1.0, sampler->getCpiStdDev());
+	EXPECT_NEAR(1.960 / std::sqrt(3.0),
+			sampler->getCpiConfidenceInterval(), 1e-3);
+	EXPECT_NEAR(0.566, sampler->getRelativeError(), 1e-3);
+	EXPECT_FALSE(sampler->hasConverged());
+
+	// Sample with a CPI of 4 reaches the minimum number of samples
+	sampler->AddSample(50, 200);
+	EXPECT_DOUBLE_EQ(2.5, sampler->getMeanCpi());
+	EXPECT_NEAR(std::sqrt(5.0 / 3.0), sampler->getCpiStdDev(), 1e-9);
+	EXPECT_NEAR(1.960 * std::sqrt(5.0 / 3.0) / 2.0,
+			sampler->getCpiConfidenceInterval(), 1e-3);
+	EXPECT_NEAR(0.506, sampler->getRelativeError(), 1e-3);
+	EXPECT_TRUE(sampler->hasConverged());
+
+	RestoreConfiguration();
+	Cleanup();
+}
+
+
+// Tests that a loop goes through warmup, measurement, and drain phases
+// followed by functional intervals, until the error bound is reached
+TEST(TestX86TimingSampler, phases)
+{
+	// Cleanup the environment
+	Cleanup();
+
+	// Sampler converging after 3 samples of a loop with constant CPI
+	Sampler *sampler = CreateSampler("FunctionalLength = 100\n"
+			"WarmupLength = 40\n"
+			"MeasureLength = 40\n"
+			"TargetError = 0.5\n"
+			"MinSamples = 3\n");
+	ASSERT_TRUE(sampler != nullptr);
+	Emulator *emulator = Emulator::getInstance();
+	Timing *timing = Timing::getInstance();
+
+	// Memory configuration, with instructions fetched from main memory
+	std::string mem_config_string =
+			"[ General ]\n"
+			"[ Module mod-mm ]\n"
+			"Type = MainMemory\n"
+			"Latency = 10\n"
+			"BlockSize = 64\n"
+			"[ Entry core-1 ]\n"
+			"Arch = x86\n"
+			"Core = 0\n"
+			"Thread = 0\n"
+			"Module = mod-mm\n";
+	misc::IniFile mem_config_ini;
+	mem_config_ini.LoadFromString(mem_config_string);
+	mem::System::getInstance()->ReadConfiguration(&mem_config_ini);
+
+	// Code to execute
+	// mov ecx, 10000
+	// l: dec ecx
+	// jnz l
+	// mov eax, 1
+	// int 0x80
+	unsigned char code[] = {
+		0xB9, 0x10, 0x27, 0x00, 0x00, 0x49, 0x75, 0xFD,
+		0xB8, 0x01, 0x00, 0x00, 0x00, 0xCD, 0x80
+	};
+
+	// Create a context
+	Context *context = emulator->newContext();
+	context->Initialize();
+	mem::Memory *memory = context->getMemory();
+	memory->setHeapBreak(misc::RoundUp(memory->getHeapBreak(),
+				mem::Memory::PageSize));
+
+	// Allocate memory and save the instructions into memory
+	mem::Manager manager(memory);
+	unsigned eip = manager.Allocate(sizeof(code), 128);
+	memory->Write(eip, sizeof(code), (const char *)code);
+
+	// Update context status, including eip
+	context->setUinstActive(true);
+	context->setState(Context::StateRunning);
+	context->getRegs().setEip(eip);
+
+	// Map the thread onto cpu hardware
+	Cpu *cpu = timing->getCpu();
+	Thread *thread = cpu->getThread(0, 0);
+	thread->MapContext(context);
+	thread->Schedule();
+	thread->setFetchNeip(eip);
+
+	// Run until sampling finishes the simulation, recording the sequence
+	// of phases
+	esim::Engine *engine = esim::Engine::getInstance();
+	std::vector<Sampler::Phase> phases = { sampler->getPhase() };
+	for (int i = 0; i < 10000 && !engine->hasFinished(); i++)
+	{
+		timing->Run();
+		engine->ProcessEvents();
+		if (sampler->getPhase() != phases.back())
+			phases.push_back(sampler->getPhase());
+	}
+	ASSERT_TRUE(engine->hasFinished());
+	EXPECT_EQ("X86SamplingConverged", engine->getFinishReason());
+
+	// Three samples, with a functional interval after the first two
+	std::vector<Sampler::Phase> expected_phases =
+	{
+		Sampler::PhaseWarmup, Sampler::PhaseMeasure,
+		Sampler::PhaseDrain, Sampler::PhaseWarmup,
+		Sampler::PhaseMeasure, Sampler::PhaseDrain,
+		Sampler::PhaseWarmup, Sampler::PhaseMeasure
+	};
+	EXPECT_EQ(expected_phases, phases);
+	EXPECT_EQ(3, sampler->getNumSamples());
+	EXPECT_TRUE(sampler->hasConverged());
+	EXPECT_EQ(200, sampler->getNumFunctionalInstructions());
+	EXPECT_GT(sampler->getMeanCpi(), 0.0);
+
+	// The loop is still running
+	EXPECT_TRUE(context->getState(Context::StateRunning));
+
+	RestoreConfiguration();
+	Cleanup();
+}
+
+}
@@ -0,0 +1,123 @@
+/*
+ *  Multi2Sim
+ *  Copyright (C) 2015  Rafael Ubal (ubal@ece.neu.edu)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "gtest/gtest.h"
+
+#include <vector>
+
+#include <lib/cpp/IniFile.h>
+#include <arch/x86/emulator/Uinst.h>
+#include <arch/x86/timing/Timing.h>
+#include <arch/x86/timing/TimingWheel.h>
+#include <arch/x86/timing/Uop.h>
+
+#include "ObjectPool.h"
+
+namespace x86
+{
+
+// Create a set of uops for the default thread, completing at the given
+// cycles. Uops are created in order, so their identifiers are increasing.
+static std::vector<std::unique_ptr<Uop>> CreateUops(
+		const std::vector<long long> &cycles)
+{
+	ObjectPool *object_pool = ObjectPool::getInstance();
+	std::vector<std::unique_ptr<Uop>> uops;
+	for (long long cycle : cycles)
+	{
+		auto uop = misc::new_unique<Uop>(object_pool->getThread(),
+				object_pool->getContext(),
+				misc::new_shared<Uinst>(Uinst::OpcodeAdd));
+		uop->complete_when = cycle;
+		uops.push_back(std::move(uop));
+	}
+	return uops;
+}
+
+
+// Extract all uops from the wheel in order
+static std::vector<Uop *> Drain(TimingWheel &wheel)
+{
+	std::vector<Uop *> uops;
+	while (!wheel.isEmpty())
+	{
+		Uop *uop = wheel.Front();
+		uops.push_back(uop);
+		wheel.Erase(uop);
+	}
+	return uops;
+}
+
+
+// Tests ordering by completion cycle and identifier, including uops that wait
+// in the overflow heap
+TEST(TestTimingWheel, order)
+{
+	// Cleanup singleton instances
+	ObjectPool::Destroy();
+	misc::IniFile ini_file;
+	Timing::ParseConfiguration(&ini_file);
+
+	// Uops
+	auto uops = CreateUops({ 5, 1000, 3, 5, 300, 2000, 1000 });
+	TimingWheel wheel;
+	wheel.Insert(uops[6].get());
+	wheel.Insert(uops[3].get());
+	for (int i : { 0, 1, 2, 4, 5 })
+		wheel.Insert(uops[i].get());
+	EXPECT_EQ(7, wheel.getSize());
+
+	// Extract in order
+	EXPECT_EQ(std::vector<Uop *>({ uops[2].get(), uops[0].get(),
+			uops[3].get(), uops[4].get(), uops[1].get(),
+			uops[6].get(), uops[5].get() }), Drain(wheel));
+}
+
+
+// Tests extraction from any position and insertion of uops that complete
+// before the current position of the wheel
+TEST(TestTimingWheel, erase)
+{
+	// Cleanup singleton instances
+	ObjectPool::Destroy();
+	misc::IniFile ini_file;
+	Timing::ParseConfiguration(&ini_file);
+
+	// Uops
+	auto uops = CreateUops({ 10, 20, 900, 950, 15 });
+	TimingWheel wheel;
+	for (int i = 0; i < 4; i++)
+		wheel.Insert(uops[i].get());
+
+	// Extract from a bucket and from the overflow heap
+	wheel.Erase(uops[1].get());
+	wheel.Erase(uops[2].get());
+	EXPECT_EQ(2, wheel.getSize());
+
+	// Move the wheel ahead to cycle 950
+	wheel.Erase(wheel.Front());
+	EXPECT_EQ(uops[3].get(), wheel.Front());
+
+	// A uop completing in an earlier cycle comes first
+	wheel.Insert(uops[4].get());
+	EXPECT_EQ(std::vector<Uop *>({ uops[4].get(), uops[3].get() }),
+			Drain(wheel));
+}
+
+}
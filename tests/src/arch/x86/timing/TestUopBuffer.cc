@@ -0,0 +1,183 @@
+/*
+ *  Multi2Sim
+ *  Copyright (C) 2015  Rafael Ubal (ubal@ece.neu.edu)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "gtest/gtest.h"
+
+#include <vector>
+
+#include <lib/cpp/IniFile.h>
+#include <arch/x86/emulator/Uinst.h>
+#include <arch/x86/timing/Timing.h>
+#include <arch/x86/timing/Uop.h>
+#include <arch/x86/timing/UopBuffer.h>
+#include <arch/x86/timing/UopPool.h>
+
+#include "ObjectPool.h"
+
+namespace x86
+{
+
+// Create a set of uops for the default thread
+static std::vector<std::unique_ptr<Uop>> CreateUops(int count)
+{
+	ObjectPool *object_pool = ObjectPool::getInstance();
+	std::vector<std::unique_ptr<Uop>> uops;
+	for (int i = 0; i < count; i++)
+		uops.push_back(misc::new_unique<Uop>(object_pool->getThread(),
+				object_pool->getContext(),
+				misc::new_shared<Uinst>(Uinst::OpcodeAdd)));
+	return uops;
+}
+
+
+// Return the uops in the buffer, in order
+static std::vector<Uop *> getUops(const UopBuffer &buffer)
+{
+	std::vector<Uop *> uops;
+	for (Uop *uop : buffer)
+		uops.push_back(uop);
+	return uops;
+}
+
+
+// Tests insertion and extraction at both ends across wrap-arounds
+TEST(TestUopBuffer, push_pop)
+{
+	// Cleanup singleton instances
+	ObjectPool::Destroy();
+	misc::IniFile ini_file;
+	Timing::ParseConfiguration(&ini_file);
+
+	// Uops
+	auto uops = CreateUops(6);
+	UopBuffer buffer(4);
+	EXPECT_TRUE(buffer.isEmpty());
+
+	// Fill buffer, and keep moving it along its entries
+	for (int i = 0; i < 4; i++)
+		buffer.PushBack(uops[i].get());
+	buffer.PopFront();
+	buffer.PopFront();
+	buffer.PushBack(uops[4].get());
+	buffer.PushBack(uops[5].get());
+	EXPECT_EQ(4, buffer.getSize());
+	EXPECT_EQ(uops[2].get(), buffer.Front());
+	EXPECT_EQ(uops[5].get(), buffer.Back());
+
+	// Extract from the tail
+	buffer.PopBack();
+	EXPECT_EQ(uops[4].get(), buffer.Back());
+	EXPECT_EQ(std::vector<Uop *>({ uops[2].get(), uops[3].get(),
+			uops[4].get() }), getUops(buffer));
+
+	// Inserting beyond the initial capacity grows the buffer
+	buffer.PushBack(uops[5].get());
+	buffer.PushBack(uops[0].get());
+	EXPECT_EQ(5, buffer.getSize());
+	EXPECT_EQ(std::vector<Uop *>({ uops[2].get(), uops[3].get(),
+			uops[4].get(), uops[5].get(), uops[0].get() }),
+			getUops(buffer));
+}
+
+
+// Tests extraction of uops from the middle of the buffer
+TEST(TestUopBuffer, erase)
+{
+	// Cleanup singleton instances
+	ObjectPool::Destroy();
+	misc::IniFile ini_file;
+	Timing::ParseConfiguration(&ini_file);
+
+	// Uops
+	auto uops = CreateUops(6);
+	UopBuffer buffer(4, &Uop::instruction_queue_position);
+	for (int i = 0; i < 4; i++)
+		buffer.PushBack(uops[i].get());
+
+	// Erase while traversing, as done by the issue stage
+	for (auto it = buffer.begin(), e = buffer.end(); it != e; )
+	{
+		Uop *uop = *it;
+		++it;
+		if (uop == uops[1].get() || uop == uops[2].get())
+			buffer.Erase(uop);
+	}
+	EXPECT_EQ(2, buffer.getSize());
+	EXPECT_EQ(std::vector<Uop *>({ uops[0].get(), uops[3].get() }),
+			getUops(buffer));
+
+	// New uops reclaim the holes without growing the buffer, keeping the
+	// order of insertion.
+	buffer.PushBack(uops[4].get());
+	buffer.PushBack(uops[5].get());
+	EXPECT_EQ(4, buffer.getSize());
+	EXPECT_EQ(std::vector<Uop *>({ uops[0].get(), uops[3].get(),
+			uops[4].get(), uops[5].get() }), getUops(buffer));
+
+	// Positions are still valid after compacting
+	buffer.Erase(uops[3].get());
+	buffer.Erase(uops[0].get());
+	EXPECT_EQ(uops[4].get(), buffer.Front());
+	EXPECT_EQ(std::vector<Uop *>({ uops[4].get(), uops[5].get() }),
+			getUops(buffer));
+}
+
+
+// Tests that released uops are recycled by the pool
+TEST(TestUopBuffer, pool)
+{
+	// Cleanup singleton instances
+	ObjectPool::Destroy();
+	misc::IniFile ini_file;
+	Timing::ParseConfiguration(&ini_file);
+	ObjectPool *object_pool = ObjectPool::getInstance();
+
+	// Allocate uops
+	auto uinst = misc::new_shared<Uinst>(Uinst::OpcodeAdd);
+	auto pool = misc::new_unique<UopPool>();
+	Uop *uop_0 = pool->NewUop(object_pool->getThread(),
+			object_pool->getContext(), uinst);
+	Uop *uop_1 = pool->NewUop(object_pool->getThread(),
+			object_pool->getContext(), uinst);
+	int num_blocks = pool->getNumBlocks();
+	EXPECT_EQ(num_blocks - 2, pool->getNumFreeBlocks());
+
+	// Uops in a queue or with a memory access in flight are not freed
+	uop_0->in_reorder_buffer = true;
+	uop_1->num_memory_accesses = 1;
+	pool->FreeIfNotQueued(uop_0);
+	pool->FreeIfNotQueued(uop_1);
+	EXPECT_EQ(num_blocks - 2, pool->getNumFreeBlocks());
+
+	// Release a uop and allocate a new one in its place
+	uop_0->in_reorder_buffer = false;
+	pool->FreeIfNotQueued(uop_0);
+	EXPECT_EQ(num_blocks - 1, pool->getNumFreeBlocks());
+	Uop *uop_2 = pool->NewUop(object_pool->getThread(),
+			object_pool->getContext(), uinst);
+	EXPECT_EQ(uop_0, uop_2);
+	EXPECT_EQ(num_blocks, pool->getNumBlocks());
+	EXPECT_EQ(3, uinst.use_count());
+
+	// Uops still allocated are destroyed with the pool
+	pool = nullptr;
+	EXPECT_EQ(1, uinst.use_count());
+}
+
+}
@@ -0,0 +1,303 @@
+/*
+ *  Multi2Sim
+ *  Copyright (C) 2015  Rafael Ubal (ubal@ece.neu.edu)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "gtest/gtest.h"
+
+#include <lib/cpp/IniFile.h>
+#include <lib/cpp/Error.h>
+#include <memory/System.h>
+#include <memory/Manager.h>
+#include <arch/x86/emulator/Emulator.h>
+#include <arch/x86/timing/Timing.h>
+#include <arch/x86/timing/Cpu.h>
+#include <arch/x86/timing/Thread.h>
+#include <arch/x86/timing/UopCache.h>
+
+namespace x86
+{
+
+static void Cleanup()
+{
+	Timing::Destroy();
+	Emulator::Destroy();
+	mem::System::Destroy();
+	comm::ArchPool::Destroy();
+}
+
+
+// Tests that a window is inserted once all its instructions were decoded,
+// and that windows with too many uops are not cached
+TEST(TestX86TimingUopCache, fill)
+{
+	misc::IniFile ini_file;
+	ini_file.LoadFromString(
+			"[ UopCache ]\n"
+			"Present = t\n"
+			"Sets = 2\n"
+			"Assoc = 4\n"
+			"WindowSize = 32\n"
+			"UopsPerLine = 6\n"
+			"LinesPerWindow = 3\n");
+	UopCache::ParseConfiguration(&ini_file);
+	UopCache uop_cache;
+
+	// Window still being decoded
+	uop_cache.Record(0x1000, 2);
+	uop_cache.Record(0x1004, 3);
+	EXPECT_FALSE(uop_cache.Lookup(0x1000));
+
+	// Decoding moves to the next window
+	uop_cache.Record(0x1020, 1);
+	EXPECT_TRUE(uop_cache.Lookup(0x1000));
+	EXPECT_TRUE(uop_cache.Lookup(0x101f));
+	EXPECT_FALSE(uop_cache.Lookup(0x1020));
+
+	// Jumping back within the window ends it as well
+	uop_cache.Record(0x1024, 1);
+	uop_cache.Record(0x1020, 1);
+	EXPECT_TRUE(uop_cache.Lookup(0x1020));
+
+	// Window with 19 uops does not fit in 3 lines of 6 uops
+	uop_cache.Record(0x2000, 10);
+	uop_cache.Record(0x2008, 9);
+	uop_cache.Record(0x3000, 1);
+	EXPECT_FALSE(uop_cache.Lookup(0x2000));
+
+	// Statistics
+	EXPECT_EQ(6, uop_cache.getNumAccesses());
+	EXPECT_EQ(3, uop_cache.getNumHits());
+}
+
+
+// Tests that all lines of a window are replaced together, and that the least
+// recently used window is replaced
+TEST(TestX86TimingUopCache, replacement)
+{
+	misc::IniFile ini_file;
+	ini_file.LoadFromString(
+			"[ UopCache ]\n"
+			"Present = t\n"
+			"Sets = 1\n"
+			"Assoc = 4\n"
+			"WindowSize = 32\n"
+			"UopsPerLine = 6\n"
+			"LinesPerWindow = 3\n");
+	UopCache::ParseConfiguration(&ini_file);
+	UopCache uop_cache;
+
+	// Two windows with 2 lines each fill the set
+	uop_cache.Record(0x1000, 12);
+	uop_cache.Record(0x2000, 7);
+	uop_cache.Record(0x3000, 1);
+	EXPECT_TRUE(uop_cache.Contains(0x1000));
+	EXPECT_TRUE(uop_cache.Contains(0x2000));
+
+	// Access the first window, so that the second one is replaced by a
+	// window with 1 line. Its other line stays invalid.
+	EXPECT_TRUE(uop_cache.Lookup(0x1000));
+	uop_cache.Record(0x4000, 1);
+	EXPECT_TRUE(uop_cache.Contains(0x1000));
+	EXPECT_FALSE(uop_cache.Contains(0x2000));
+	EXPECT_TRUE(uop_cache.Contains(0x3000));
+
+	// A window with 3 lines takes the invalid line, and replaces the
+	// first window, which is now the least recently used
+	uop_cache.Record(0x4004, 17);
+	uop_cache.Record(0x5000, 1);
+	EXPECT_FALSE(uop_cache.Contains(0x1000));
+	EXPECT_TRUE(uop_cache.Contains(0x3000));
+	EXPECT_TRUE(uop_cache.Contains(0x4000));
+}
+
+
+// Create a CPU with the given configuration, with instructions fetched from
+// main memory, and map a context running the given code to thread 0 of
+// core 0. The address of the code, aligned to 128 bytes, is returned in
+// 'eip'.
+static Thread *MapCode(const std::string &config,
+		const unsigned char *code, unsigned size, unsigned &eip)
+{
+	// CPU configuration
+	misc::IniFile config_ini;
+	config_ini.LoadFromString(config);
+	Timing::ParseConfiguration(&config_ini);
+	Emulator *emulator = Emulator::getInstance();
+	Timing *timing = Timing::getInstance();
+
+	// Memory configuration, with instructions fetched from main memory
+	std::string mem_config_string =
+			"[ General ]\n"
+			"[ Module mod-mm ]\n"
+			"Type = MainMemory\n"
+			"Latency = 10\n"
+			"BlockSize = 64\n"
+			"[ Entry core-1 ]\n"
+			"Arch = x86\n"
+			"Core = 0\n"
+			"Thread = 0\n"
+			"Module = mod-mm\n";
+	misc::IniFile mem_config_ini;
+	mem_config_ini.LoadFromString(mem_config_string);
+	mem::System::getInstance()->ReadConfiguration(&mem_config_ini);
+
+	// Create a context
+	Context *context = emulator->newContext();
+	context->Initialize();
+	mem::Memory *memory = context->getMemory();
+	memory->setHeapBreak(misc::RoundUp(memory->getHeapBreak(),
+				mem::Memory::PageSize));
+
+	// Allocate memory and save the instructions into memory
+	mem::Manager manager(memory);
+	eip = manager.Allocate(size, 128);
+	memory->Write(eip, size, (const char *) code);
+
+	// Update context status, including eip
+	context->setUinstActive(true);
+	context->setState(Context::StateRunning);
+	context->getRegs().setEip(eip);
+
+	// Map the thread onto cpu hardware
+	Cpu *cpu = timing->getCpu();
+	Thread *thread = cpu->getThread(0, 0);
+	thread->MapContext(context);
+	thread->Schedule();
+	thread->setFetchNeip(eip);
+	return thread;
+}
+
+
+// Tests that the iterations of a loop are fetched from the uop cache after
+// the first one went through the decoders
+TEST(TestX86TimingUopCache, loop)
+{
+	// Cleanup the environment
+	Cleanup();
+
+	// Code to execute
+	// mov ecx, 100
+	// l: dec ecx
+	// jnz l
+	// mov eax, 1
+	// int 0x80
+	unsigned char code[] = {
+		0xB9, 0x64, 0x00, 0x00, 0x00, 0x49, 0x75, 0xFD,
+		0xB8, 0x01, 0x00, 0x00, 0x00, 0xCD, 0x80
+	};
+
+	// CPU with a uop cache
+	unsigned eip;
+	Thread *thread = MapCode("[ General ]\n"
+			"[ UopCache ]\n"
+			"Present = t\n", code, sizeof(code), eip);
+	Timing *timing = Timing::getInstance();
+
+	// Run until the loop finished
+	esim::Engine *engine = esim::Engine::getInstance();
+	for (int i = 0; i < 1000 && thread->getNumBranches() < 100; i++)
+	{
+		timing->Run();
+		engine->ProcessEvents();
+	}
+	EXPECT_EQ(100, thread->getNumBranches());
+
+	// Most iterations hit in the uop cache
+	UopCache *uop_cache = thread->getUopCache();
+	ASSERT_TRUE(uop_cache != nullptr);
+	EXPECT_GE(uop_cache->getNumHits(), 90);
+	EXPECT_GE(uop_cache->getNumFetchedUinsts(), 180);
+
+	// Disable the uop cache for other tests
+	misc::IniFile default_ini;
+	default_ini.LoadFromString("[ General ]\n");
+	UopCache::ParseConfiguration(&default_ini);
+	Cleanup();
+}
+
+
+// Tests that a switch from the uop cache to the decoders counts a single
+// lookup, and that the instruction cache is accessed again after uops were
+// fetched from the uop cache
+TEST(TestX86TimingUopCache, switch_to_decoders)
+{
+	// Cleanup the environment
+	Cleanup();
+
+	// Code to execute, 32 times 'mov eax, ebx' filling two fetch windows
+	// of 32 bytes in one instruction cache block of 64 bytes
+	unsigned char code[64];
+	for (unsigned i = 0; i < sizeof(code); i += 2)
+	{
+		code[i] = 0x89;
+		code[i + 1] = 0xD8;
+	}
+
+	// CPU with a uop cache and a fetch queue holding both windows
+	unsigned eip;
+	Thread *thread = MapCode("[ General ]\n"
+			"[ Queues ]\n"
+			"FetchQueueSize = 128\n"
+			"[ UopCache ]\n"
+			"Present = t\n"
+			"SwitchPenalty = 2\n", code, sizeof(code), eip);
+	UopCache *uop_cache = thread->getUopCache();
+	ASSERT_TRUE(uop_cache != nullptr);
+
+	// Only the first window is in the uop cache
+	for (unsigned i = 0; i < 32; i += 2)
+		uop_cache->Record(eip + i, 1);
+	uop_cache->Record(eip + 64, 1);
+	ASSERT_TRUE(uop_cache->Contains(eip));
+	ASSERT_FALSE(uop_cache->Contains(eip + 32));
+
+	// The second window goes through the decoders, accessing the
+	// instruction cache
+	thread->setFetchNeip(eip + 32);
+	thread->Fetch();
+	EXPECT_EQ(1, uop_cache->getNumAccesses());
+	EXPECT_EQ(1, thread->getNumBtbReads());
+
+	// The first window hits in the uop cache
+	thread->setFetchNeip(eip);
+	thread->Fetch();
+	EXPECT_EQ(2, uop_cache->getNumAccesses());
+	EXPECT_EQ(1, uop_cache->getNumHits());
+	EXPECT_EQ(1, thread->getNumBtbReads());
+
+	// Fetch continues in the second window, switching to the decoders.
+	// The stall does not count as a lookup.
+	thread->Fetch();
+	EXPECT_EQ(2, uop_cache->getNumAccesses());
+
+	// After the penalty, the second window misses once and accesses the
+	// instruction cache again, even though it is in the block read last
+	// from the instruction cache
+	thread->Fetch();
+	EXPECT_EQ(3, uop_cache->getNumAccesses());
+	EXPECT_EQ(1, uop_cache->getNumHits());
+	EXPECT_EQ(2, thread->getNumBtbReads());
+
+	// Restore the default configuration for other tests
+	misc::IniFile default_ini;
+	default_ini.LoadFromString("[ General ]\n");
+	Timing::ParseConfiguration(&default_ini);
+	Cleanup();
+}
+
+}
@@ -0,0 +1,120 @@
+/*
+ *  Multi2Sim
+ *  Copyright (C) 2015  Rafael Ubal (ubal@ece.neu.edu)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include <lib/cpp/Error.h>
+#include <lib/cpp/ThreadPool.h>
+
+
+namespace misc
+{
+
+// Tests that every index is processed exactly once in each call to Run(),
+// for several numbers of threads and indices
+TEST(TestThreadPool, run_all_indices)
+{
+	for (int num_threads : { 1, 2, 4, 7 })
+	{
+		ThreadPool pool(num_threads);
+		EXPECT_EQ(num_threads, pool.getNumThreads());
+		for (int count : { 0, 1, 3, 64, 1000 })
+		{
+			for (int iteration = 0; iteration < 20; iteration++)
+			{
+				std::vector<std::atomic<int>> hits(count);
+				for (auto &hit : hits)
+					hit = 0;
+				pool.Run(count, [&hits](int index)
+				{
+					hits[index]++;
+				});
+
+				// Run() returns after all invocations finished
+				for (int i = 0; i < count; i++)
+					ASSERT_EQ(1, hits[i].load()) << "threads = "
+							<< num_threads << ", count = "
+							<< count << ", index = " << i;
+			}
+		}
+	}
+}
+
+
+// Tests that a pool with one thread runs everything in the caller, in order
+TEST(TestThreadPool, single_thread)
+{
+	ThreadPool pool(1);
+	std::thread::id caller = std::this_thread::get_id();
+	std::vector<int> indices;
+	pool.Run(5, [&](int index)
+	{
+		EXPECT_EQ(caller, std::this_thread::get_id());
+		indices.push_back(index);
+	});
+	EXPECT_EQ(std::vector<int>({ 0, 1, 2, 3, 4 }), indices);
+}
+
+
+// Tests that several host threads take part in a call to Run()
+TEST(TestThreadPool, concurrency)
+{
+	// Each invocation waits until all threads are running one, which is
+	// only possible if they run concurrently
+	const int num_threads = 4;
+	ThreadPool pool(num_threads);
+	std::atomic<int> num_waiting(0);
+	pool.Run(num_threads, [&num_waiting](int index)
+	{
+		num_waiting++;
+		while (num_waiting.load() < num_threads)
+			std::this_thread::yield();
+	});
+	EXPECT_EQ(num_threads, num_waiting.load());
+}
+
+
+// Tests that an exception thrown by an invocation is rethrown by Run() once
+// all other indices are processed, and that the pool is still usable
+TEST(TestThreadPool, exception)
+{
+	ThreadPool pool(4);
+	std::atomic<int> num_processed(0);
+	EXPECT_THROW(pool.Run(100, [&num_processed](int index)
+	{
+		num_processed++;
+		if (index == 10)
+			throw Panic("index 10");
+	}), Panic);
+	EXPECT_EQ(100, num_processed.load());
+
+	// Next call runs normally
+	num_processed = 0;
+	pool.Run(100, [&num_processed](int index)
+	{
+		num_processed++;
+	});
+	EXPECT_EQ(100, num_processed.load());
+}
+
+}
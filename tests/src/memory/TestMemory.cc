@@ -0,0 +1,170 @@
+/*
+ *  Multi2Sim
+ *  Copyright (C) 2015  Rafael Ubal (ubal@ece.neu.edu)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include <memory/Memory.h>
+
+namespace mem
+{
+
+TEST(TestMemory, test_checkpoint_round_trip)
+{
+	// Memory with a written page, a zero page, and a page with no data
+	Memory memory;
+	memory.Map(0x1000, 3 * Memory::PageSize,
+			Memory::AccessRead | Memory::AccessWrite);
+	memory.Map(0x8000, Memory::PageSize, Memory::AccessRead);
+	memory.WriteString(0x1ff0, "checkpoint");
+	memory.Zero(0x2000, Memory::PageSize);
+	memory.setHeapBreak(0x4000);
+
+	// Save and load
+	std::stringstream stream;
+	memory.SaveCheckpoint(stream);
+	Memory restored;
+	restored.LoadCheckpoint(stream);
+
+	// Check attributes
+	EXPECT_EQ(0x4000u, restored.getHeapBreak());
+	for (unsigned address : { 0x1000u, 0x2000u, 0x3000u, 0x8000u })
+	{
+		ASSERT_TRUE(restored.getPage(address) != nullptr);
+		EXPECT_EQ(memory.getPage(address)->getPerm(),
+				restored.getPage(address)->getPerm());
+	}
+	EXPECT_EQ(nullptr, restored.getPage(0x4000));
+
+	// Zero pages are restored without data
+	EXPECT_EQ(nullptr, restored.getPage(0x2000)->getData());
+	EXPECT_EQ(nullptr, restored.getPage(0x8000)->getData());
+
+	// Check content
+	EXPECT_EQ("checkpoint", restored.ReadString(0x1ff0));
+}
+
+TEST(TestMemory, test_checkpoint_corrupted)
+{
+	// Truncated checkpoint
+	Memory memory;
+	memory.Map(0x1000, Memory::PageSize,
+			Memory::AccessRead | Memory::AccessWrite);
+	memory.WriteString(0x1000, "checkpoint");
+	std::stringstream stream;
+	memory.SaveCheckpoint(stream);
+	std::string data = stream.str();
+	std::stringstream truncated(data.substr(0, data.size() - 4));
+
+	// Loading must fail
+	Memory restored;
+	EXPECT_THROW(restored.LoadCheckpoint(truncated), Memory::Error);
+}
+
+TEST(TestMemory, test_thread_safe)
+{
+	// Unsafe memory with one mapped page without data
+	Memory memory;
+	memory.setSafe(false);
+	memory.Map(0x10000, Memory::PageSize,
+			Memory::AccessRead | Memory::AccessWrite);
+	memory.setThreadSafe(true);
+	ASSERT_TRUE(memory.getPage(0x10000)->getData() != nullptr);
+
+	// Several threads write interleaved words in the mapped page and in
+	// new pages, which are created concurrently
+	const int num_threads = 4;
+	const unsigned num_words = 4 * Memory::PageSize / 4;
+	std::vector<std::thread> threads;
+	for (int id = 0; id < num_threads; id++)
+	{
+		threads.emplace_back([&memory, id, num_words]()
+		{
+			for (unsigned i = id; i < num_words; i += num_threads)
+			{
+				unsigned value = i * 3;
+				memory.Write(0x10000 + i * 4, 4, (char *) &value);
+			}
+		});
+	}
+	for (auto &thread : threads)
+		thread.join();
+
+	// Check content
+	for (unsigned i = 0; i < num_words; i++)
+	{
+		unsigned value = 0;
+		memory.Read(0x10000 + i * 4, 4, (char *) &value);
+		EXPECT_EQ(i * 3, value);
+	}
+	ASSERT_TRUE(memory.getPage(0x13000) != nullptr);
+	EXPECT_TRUE(memory.getPage(0x13000)->getPerm() &
+			Memory::AccessModified);
+
+	// Pages removed in thread-safe mode are no longer found
+	memory.Unmap(0x12000, Memory::PageSize);
+	EXPECT_EQ(nullptr, memory.getPage(0x12000));
+	memory.Clear();
+	EXPECT_EQ(nullptr, memory.getPage(0x10000));
+}
+
+TEST(TestMemory, test_copy_from)
+{
+	// Source memory with data crossing a page boundary, and a mapped page
+	// without data
+	Memory src;
+	src.Map(0x1000, 3 * Memory::PageSize,
+			Memory::AccessRead | Memory::AccessWrite);
+	std::vector<char> data(Memory::PageSize + 100);
+	for (unsigned i = 0; i < data.size(); i++)
+		data[i] = i * 7 + 1;
+	src.Write(0x1f00, data.size(), data.data());
+
+	// Copy into another memory at a different page offset
+	Memory dest;
+	dest.Map(0x10000, 3 * Memory::PageSize,
+			Memory::AccessRead | Memory::AccessWrite);
+	dest.CopyFrom(0x10010, &src, 0x1f00, data.size());
+	std::vector<char> result(data.size());
+	dest.Read(0x10010, result.size(), result.data());
+	EXPECT_TRUE(data == result);
+	EXPECT_TRUE(dest.getPage(0x11000)->getPerm() &
+			Memory::AccessModified);
+
+	// Zero pages are not allocated in the destination
+	dest.CopyFrom(0x12000, &src, 0x3000, Memory::PageSize);
+	EXPECT_EQ(nullptr, dest.getPage(0x12000)->getData());
+
+	// Overlapping regions in the same memory, in both directions
+	src.CopyFrom(0x1f10, &src, 0x1f00, data.size());
+	src.Read(0x1f10, result.size(), result.data());
+	EXPECT_TRUE(data == result);
+	src.CopyFrom(0x1f00, &src, 0x1f10, data.size());
+	src.Read(0x1f00, result.size(), result.data());
+	EXPECT_TRUE(data == result);
+
+	// Unmapped regions fail in safe mode
+	EXPECT_THROW(dest.CopyFrom(0x10000, &src, 0x8000, 4), Memory::Error);
+	EXPECT_THROW(dest.CopyFrom(0x8000, &src, 0x1000, 4), Memory::Error);
+}
+
+}  // namespace mem
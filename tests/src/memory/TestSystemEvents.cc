@@ -4767,12 +4767,174 @@ TEST(TestSystemEvents, test_flood)
 // TODO: Add find_and_lock, find_and_lock_port, find_and_lock_action, and
 // find_and_lock_finish tests.
 
+// Set up configuration 0 for functional warming tests
+static System *SetupWarm()
+{
+	Cleanup();
+
+	// Load configuration files
+	misc::IniFile ini_file_mem;
+	misc::IniFile ini_file_x86;
+	misc::IniFile ini_file_net;
+	ini_file_mem.LoadFromString(mem_config_0);
+	ini_file_x86.LoadFromString(x86_config);
+	ini_file_net.LoadFromString(net_config);
+
+	// Set up x86 timing simulator
+	x86::Timing::ParseConfiguration(&ini_file_x86);
+	x86::Timing::getInstance();
+
+	// Set up network system
+	net::System *network_system = net::System::getInstance();
+	network_system->ParseConfiguration(&ini_file_net);
+
+	// Set up memory system
+	System *memory_system = System::getInstance();
+	memory_system->ReadConfiguration(&ini_file_mem);
+	return memory_system;
 }
 
 
+// Return the state of the block containing an address in a module
+static Cache::BlockState getWarmState(Module *module, unsigned address)
+{
+	int set_id;
+	int way_id;
+	int tag;
+	Cache::BlockState state;
+	module->FindBlock(address, set_id, way_id, tag, state);
+	return state;
+}
 
 
+// l1_0 loads address 0 with no sharers (miss fill), then l1_1 loads it
+// (shared), then l1_1 stores it (upgrade)
+TEST(TestSystemEvents, warm_load_store)
+{
+	try
+	{
+		System *memory_system = SetupWarm();
+		Module *module_l1_0 = memory_system->getModule("mod-l1-0");
+		Module *module_l1_1 = memory_system->getModule("mod-l1-1");
+		Module *module_l2_0 = memory_system->getModule("mod-l2-0");
+		Module *module_mm = memory_system->getModule("mod-mm");
 
+		// Miss fill brings the block in E in all levels
+		module_l1_0->Warm(Module::AccessLoad, 0x0);
+		int set_id;
+		int way_id;
+		int mm_set_id;
+		int mm_way_id;
+		int tag;
+		Cache::BlockState state;
+		ASSERT_TRUE(module_l2_0->FindBlock(0x0, set_id, way_id, tag, state));
+		ASSERT_TRUE(module_mm->FindBlock(0x0, mm_set_id, mm_way_id, tag,
+				state));
+		EXPECT_EQ(Cache::BlockExclusive, getWarmState(module_l1_0, 0x0));
+		EXPECT_EQ(Cache::BlockExclusive, getWarmState(module_l2_0, 0x0));
+		EXPECT_EQ(Cache::BlockExclusive, getWarmState(module_mm, 0x0));
+		EXPECT_EQ(1, module_l2_0->getNumSharers(set_id, way_id, 0));
+		EXPECT_EQ(module_l1_0, module_l2_0->getOwner(set_id, way_id, 0));
+		EXPECT_EQ(module_l2_0, module_mm->getOwner(mm_set_id, mm_way_id, 0));
+
+		// A second reader gets the block in S and downgrades the owner
+		module_l1_1->Warm(Module::AccessLoad, 0x0);
+		EXPECT_EQ(Cache::BlockShared, getWarmState(module_l1_0, 0x0));
+		EXPECT_EQ(Cache::BlockShared, getWarmState(module_l1_1, 0x0));
+		EXPECT_EQ(2, module_l2_0->getNumSharers(set_id, way_id, 0));
+		EXPECT_EQ(nullptr, module_l2_0->getOwner(set_id, way_id, 0));
+
+		// A store upgrades the block and invalidates the other copy
+		module_l1_1->Warm(Module::AccessStore, 0x0);
+		EXPECT_EQ(Cache::BlockInvalid, getWarmState(module_l1_0, 0x0));
+		EXPECT_EQ(Cache::BlockModified, getWarmState(module_l1_1, 0x0));
+		EXPECT_EQ(Cache::BlockExclusive, getWarmState(module_l2_0, 0x0));
+		EXPECT_EQ(1, module_l2_0->getNumSharers(set_id, way_id, 0));
+		EXPECT_TRUE(module_l2_0->isSharer(set_id, way_id, 0, module_l1_1));
+		EXPECT_EQ(module_l1_1, module_l2_0->getOwner(set_id, way_id, 0));
+	}
+	catch (misc::Exception &e)
+	{
+		e.Dump();
+		FAIL();
+	}
+}
 
 
+// l2_0 has address 0 in O and l1_0 has it in S. l1_0 stores it, which
+// upgrades the dirty block in l2_0 to M.
+TEST(TestSystemEvents, warm_upgrade_dirty)
+{
+	try
+	{
+		System *memory_system = SetupWarm();
+		Module *module_l1_0 = memory_system->getModule("mod-l1-0");
+		Module *module_l2_0 = memory_system->getModule("mod-l2-0");
+		Module *module_mm = memory_system->getModule("mod-mm");
+
+		// Set block states
+		module_l1_0->getCache()->getBlock(0, 0)->setStateTag(Cache::BlockShared, 0x0);
+		module_l2_0->getCache()->getBlock(0, 0)->setStateTag(Cache::BlockOwned, 0x0);
+		module_mm->getCache()->getBlock(0, 0)->setStateTag(Cache::BlockExclusive, 0x0);
+		module_l2_0->setSharer(0, 0, 0, module_l1_0);
+		module_mm->setOwner(0, 0, 0, module_l2_0);
+		module_mm->setSharer(0, 0, 0, module_l2_0);
 
+		// Store
+		module_l1_0->Warm(Module::AccessStore, 0x0);
+		EXPECT_EQ(Cache::BlockModified, getWarmState(module_l1_0, 0x0));
+		EXPECT_EQ(Cache::BlockModified, getWarmState(module_l2_0, 0x0));
+		EXPECT_EQ(module_l1_0, module_l2_0->getOwner(0, 0, 0));
+	}
+	catch (misc::Exception &e)
+	{
+		e.Dump();
+		FAIL();
+	}
+}
+
+
+// l1_1 has address 0 in M. l1_0 loads four other blocks mapped to set 0 of
+// l2_0, which evicts address 0 from l2_0 and from its sharer l1_1, and
+// leaves the block modified in main memory.
+TEST(TestSystemEvents, warm_evict_with_sharers)
+{
+	try
+	{
+		System *memory_system = SetupWarm();
+		Module *module_l1_0 = memory_system->getModule("mod-l1-0");
+		Module *module_l1_1 = memory_system->getModule("mod-l1-1");
+		Module *module_l2_0 = memory_system->getModule("mod-l2-0");
+		Module *module_mm = memory_system->getModule("mod-mm");
+
+		// Dirty block in l1_1
+		module_l1_1->Warm(Module::AccessStore, 0x0);
+		EXPECT_EQ(Cache::BlockModified, getWarmState(module_l1_1, 0x0));
+
+		// Fill set 0 of l2_0
+		for (unsigned address : { 0x200u, 0x600u, 0xa00u, 0xe00u })
+			module_l1_0->Warm(Module::AccessLoad, address);
+
+		// Address 0 is evicted from l2_0 and l1_1
+		EXPECT_EQ(Cache::BlockInvalid, getWarmState(module_l2_0, 0x0));
+		EXPECT_EQ(Cache::BlockInvalid, getWarmState(module_l1_1, 0x0));
+		EXPECT_EQ(Cache::BlockExclusive, getWarmState(module_l2_0, 0xe00));
+
+		// Main memory received the dirty data and no longer lists l2_0
+		int set_id;
+		int way_id;
+		int tag;
+		Cache::BlockState state;
+		ASSERT_TRUE(module_mm->FindBlock(0x0, set_id, way_id, tag, state));
+		EXPECT_EQ(Cache::BlockModified, state);
+		EXPECT_EQ(0, module_mm->getNumSharers(set_id, way_id, 0));
+		EXPECT_EQ(nullptr, module_mm->getOwner(set_id, way_id, 0));
+	}
+	catch (misc::Exception &e)
+	{
+		e.Dump();
+		FAIL();
+	}
+}
+
+}